@@ -49,7 +49,7 @@ let
     nativeBuildInputs = [ pkgconfig autoreconfHook gettext ];
 
     buildInputs = [
-      ETL boost cairo fftw glibmm intltool libjpeg libsigcxx libxmlxx
+      ETL boost cairo fftw fftwFloat glibmm intltool libjpeg libsigcxx libxmlxx
       mlt imagemagick pango which
     ];
 
@@ -66,7 +66,7 @@ stdenv.mkDerivation rec {
 
   nativeBuildInputs = [ pkgconfig autoreconfHook gettext ];
   buildInputs = [
-    ETL boost cairo fftw glibmm gnome3.defaultIconTheme gtk3 gtkmm3
+    ETL boost cairo fftw fftwFloat glibmm gnome3.defaultIconTheme gtk3 gtkmm3
     imagemagick intltool libjack2 libsigcxx libxmlxx makeWrapper mlt
     synfig which
   ];
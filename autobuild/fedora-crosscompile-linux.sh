@@ -1283,12 +1283,16 @@ if [ ! -f ${PREFIX}/../${PKG_NAME}-${PKG_VERSION}.done ]; then
 	pushd ${SRCPREFIX}
 	[ ! -d ${PKG_NAME}-${PKG_VERSION} ] && tar -xf ${WORKSPACE}/cache/${PKG_NAME}-${PKG_VERSION}.tar.${TAREXT}
 	cd ${PKG_NAME}-${PKG_VERSION}
-	[ ! -e config.cache ] || rm config.cache
-	./configure --host=${HOST} --prefix=${PREFIX}/ \
-		${DEBUG_OPT2} \
-		--disable-static --enable-shared
-	make -j${THREADS}
-	make install
+	# double and single precision libraries are built separately
+	for FFTW_PRECISION in "" "--enable-float"; do
+		[ ! -e config.cache ] || rm config.cache
+		./configure --host=${HOST} --prefix=${PREFIX}/ \
+			${DEBUG_OPT2} \
+			--disable-static --enable-shared ${FFTW_PRECISION}
+		make -j${THREADS}
+		make install
+		make distclean
+	done
 	cd ..
 	popd
 	
@@ -0,0 +1,338 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file fontcache.cpp
+**	\brief Implementation of the cache of font faces and glyph outlines
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#ifdef WITH_FONTCONFIG
+#include <fontconfig/fontconfig.h>
+#endif
+
+#include <ETL/stringf>
+
+#include <synfig/localization.h>
+#include <synfig/general.h>
+
+#include "fontcache.h"
+#include "lyr_freetype.h"
+
+#include FT_OUTLINE_H
+
+#endif
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+#ifdef USE_MAC_FT_FUNCS
+static void fss2path(char *path, FSSpec *fss)
+{
+  int l;             //fss->name contains name of last item in path
+  for(l=0; l<(fss->name[0]); l++) path[l] = fss->name[l + 1];
+  path[l] = 0;
+
+  if(fss->parID != fsRtParID) //path is more than just a volume name
+  {
+    int i, len;
+    CInfoPBRec pb;
+
+    pb.dirInfo.ioNamePtr = fss->name;
+    pb.dirInfo.ioVRefNum = fss->vRefNum;
+    pb.dirInfo.ioDrParID = fss->parID;
+    do
+    {
+      pb.dirInfo.ioFDirIndex = -1;  //get parent directory name
+      pb.dirInfo.ioDrDirID = pb.dirInfo.ioDrParID;
+      if(PBGetCatInfoSync(&pb) != noErr) break;
+
+      len = fss->name[0] + 1;
+      for(i=l; i>=0;  i--) path[i + len] = path[i];
+      for(i=1; i<len; i++) path[i - 1] = fss->name[i]; //add to start of path
+      path[i - 1] = ':';
+      l += len;
+} while(pb.dirInfo.ioDrDirID != fsRtDirID); //while more directory levels
+  }
+}
+#endif
+
+namespace {
+
+Vector to_vector(const FT_Vector *v)
+	{ return Vector((Real)v->x, (Real)v->y); }
+
+//! receives contours of FT_Outline_Decompose
+struct OutlineBuilder
+{
+	rendering::Contour::ChunkList &chunks;
+	Vector start;
+
+	explicit OutlineBuilder(rendering::Contour::ChunkList &chunks): chunks(chunks) { }
+
+	void close()
+	{
+		if (!chunks.empty())
+			chunks.push_back(rendering::Contour::Chunk(rendering::Contour::CLOSE, start));
+	}
+
+	static int move_to(const FT_Vector *to, void *user)
+	{
+		OutlineBuilder &builder = *(OutlineBuilder*)user;
+		builder.close();
+		builder.start = to_vector(to);
+		builder.chunks.push_back(rendering::Contour::Chunk(rendering::Contour::MOVE, builder.start));
+		return 0;
+	}
+
+	static int line_to(const FT_Vector *to, void *user)
+	{
+		OutlineBuilder &builder = *(OutlineBuilder*)user;
+		builder.chunks.push_back(rendering::Contour::Chunk(rendering::Contour::LINE, to_vector(to)));
+		return 0;
+	}
+
+	static int conic_to(const FT_Vector *control, const FT_Vector *to, void *user)
+	{
+		OutlineBuilder &builder = *(OutlineBuilder*)user;
+		builder.chunks.push_back(rendering::Contour::Chunk(
+			rendering::Contour::CONIC, to_vector(to), to_vector(control) ));
+		return 0;
+	}
+
+	static int cubic_to(const FT_Vector *control1, const FT_Vector *control2, const FT_Vector *to, void *user)
+	{
+		OutlineBuilder &builder = *(OutlineBuilder*)user;
+		builder.chunks.push_back(rendering::Contour::Chunk(
+			rendering::Contour::CUBIC, to_vector(to), to_vector(control1), to_vector(control2) ));
+		return 0;
+	}
+};
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+const size_t FontCache::max_outlines = 16384;
+
+FontCache&
+FontCache::get_instance()
+{
+	// never destroyed, layers may keep faces while static objects destruct
+	static FontCache *cache = new FontCache();
+	return *cache;
+}
+
+FT_Face
+FontCache::open_face(const String &filename, FT_Long face_index)
+{
+	FaceKey key(filename, face_index);
+	std::map<FaceKey, FT_Face>::const_iterator i = faces.find(key);
+	if (i != faces.end())
+		return i->second;
+
+	FT_Face face = 0;
+	if (FT_New_Face(ft_library, filename.c_str(), face_index, &face))
+		return 0;
+	faces[key] = face;
+	return face;
+}
+
+FT_Face
+FontCache::find_face(const String &font, const String &path)
+{
+	FT_Long face_index=0;
+	FT_Face face=0;
+
+	if(!face)face=open_face(font,face_index);
+	if(!face)face=open_face(font+".ttf",face_index);
+
+	if(!path.empty())
+	{
+		if(!face)face=open_face(path+ETL_DIRECTORY_SEPARATOR+font,face_index);
+		if(!face)face=open_face(path+ETL_DIRECTORY_SEPARATOR+font+".ttf",face_index);
+	}
+
+#ifdef USE_MAC_FT_FUNCS
+	if(!face)
+	{
+		FSSpec fs_spec;
+		int error=FT_GetFile_From_Mac_Name(font.c_str(),&fs_spec,&face_index);
+		if(!error)
+		{
+			char filename[512];
+			fss2path(filename,&fs_spec);
+			face=open_face(filename,face_index);
+			synfig::info(__FILE__":%d: \"%s\" (%s) -- %s",__LINE__,font.c_str(),filename,face?"found":"not found");
+		}
+		else
+		{
+			synfig::info(__FILE__":%d: \"%s\" -- ft_error=%d",__LINE__,font.c_str(),error);
+			// Unable to generate fs_spec
+		}
+	}
+#endif
+
+#ifdef WITH_FONTCONFIG
+	if(!face)
+	{
+		FcFontSet *fs;
+		FcResult result;
+		if( !FcInit() )
+		{
+			synfig::warning("Layer_Freetype: fontconfig: %s",_("unable to initialize"));
+		} else {
+			FcPattern* pat = FcNameParse((FcChar8 *) font.c_str());
+			FcConfigSubstitute(0, pat, FcMatchPattern);
+			FcDefaultSubstitute(pat);
+			FcPattern *match;
+			fs = FcFontSetCreate();
+			match = FcFontMatch(0, pat, &result);
+			if (match)
+				FcFontSetAdd(fs, match);
+			if (pat)
+				FcPatternDestroy(pat);
+			if(fs && fs->nfont){
+				FcChar8* file;
+				if( FcPatternGetString (fs->fonts[0], FC_FILE, 0, &file) == FcResultMatch )
+					face=open_face((const char*)file,face_index);
+				FcFontSetDestroy(fs);
+			} else
+				synfig::warning("Layer_Freetype: fontconfig: %s",_("empty font set"));
+		}
+	}
+#endif
+
+#ifdef _WIN32
+	if(!face)face=open_face("C:\\WINDOWS\\FONTS\\"+font,face_index);
+	if(!face)face=open_face("C:\\WINDOWS\\FONTS\\"+font+".ttf",face_index);
+#else
+
+#ifdef __APPLE__
+	if(!face)face=open_face("~/Library/Fonts/"+font,face_index);
+	if(!face)face=open_face("~/Library/Fonts/"+font+".ttf",face_index);
+	if(!face)face=open_face("~/Library/Fonts/"+font+".dfont",face_index);
+
+	if(!face)face=open_face("/Library/Fonts/"+font,face_index);
+	if(!face)face=open_face("/Library/Fonts/"+font+".ttf",face_index);
+	if(!face)face=open_face("/Library/Fonts/"+font+".dfont",face_index);
+#endif
+
+	if(!face)face=open_face("/usr/X11R6/lib/X11/fonts/type1/"+font,face_index);
+	if(!face)face=open_face("/usr/X11R6/lib/X11/fonts/type1/"+font+".ttf",face_index);
+
+	if(!face)face=open_face("/usr/share/fonts/truetype/"+font,face_index);
+	if(!face)face=open_face("/usr/share/fonts/truetype/"+font+".ttf",face_index);
+
+	if(!face)face=open_face("/usr/X11R6/lib/X11/fonts/TTF/"+font,face_index);
+	if(!face)face=open_face("/usr/X11R6/lib/X11/fonts/TTF/"+font+".ttf",face_index);
+
+	if(!face)face=open_face("/usr/X11R6/lib/X11/fonts/truetype/"+font,face_index);
+	if(!face)face=open_face("/usr/X11R6/lib/X11/fonts/truetype/"+font+".ttf",face_index);
+
+#endif
+
+	return face;
+}
+
+FT_Face
+FontCache::get_face(const String &font, const String &path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	NameKey key(font, path);
+	std::map<NameKey, FT_Face>::const_iterator i = names.find(key);
+	if (i != names.end())
+		return i->second;
+
+	// failed lookups are not stored, font may be installed
+	// or placed near the canvas file later
+	FT_Face face = find_face(font, path);
+	if (face)
+		names[key] = face;
+	return face;
+}
+
+FT_UInt
+FontCache::get_char_index(FT_Face face, FT_ULong code)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return FT_Get_Char_Index(face, code);
+}
+
+Vector
+FontCache::get_kerning(FT_Face face, FT_UInt left_glyph, FT_UInt right_glyph)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	FT_Vector delta;
+	if (FT_Get_Kerning(face, left_glyph, right_glyph, FT_KERNING_UNSCALED, &delta))
+		return Vector();
+	return to_vector(&delta);
+}
+
+FontCache::OutlineHandle
+FontCache::get_outline(FT_Face face, FT_UInt glyph_index)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	GlyphKey key(face, glyph_index);
+	std::map<GlyphKey, OutlineHandle>::const_iterator i = outlines.find(key);
+	if (i != outlines.end())
+		return i->second;
+
+	if (FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_SCALE|FT_LOAD_NO_HINTING|FT_LOAD_NO_BITMAP))
+		return OutlineHandle();
+	FT_GlyphSlot slot = face->glyph;
+	if (slot->format != FT_GLYPH_FORMAT_OUTLINE)
+		return OutlineHandle();
+
+	static const FT_Outline_Funcs funcs = {
+		&OutlineBuilder::move_to,
+		&OutlineBuilder::line_to,
+		&OutlineBuilder::conic_to,
+		&OutlineBuilder::cubic_to,
+		0, 0 };
+
+	std::shared_ptr<Outline> outline(new Outline());
+	OutlineBuilder builder(outline->chunks);
+	if (FT_Outline_Decompose(&slot->outline, &funcs, &builder))
+		return OutlineHandle();
+	builder.close();
+	outline->chunks.shrink_to_fit();
+	outline->advance = to_vector(&slot->advance);
+
+	FT_BBox bbox;
+	FT_Outline_Get_CBox(&slot->outline, &bbox);
+	outline->height = (Real)bbox.yMax;
+
+	if (outlines.size() >= max_outlines)
+		outlines.clear();
+	outlines[key] = outline;
+	return outline;
+}
+
+/* === E N T R Y P O I N T ================================================= */
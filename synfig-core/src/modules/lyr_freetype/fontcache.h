@@ -0,0 +1,112 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file fontcache.h
+**	\brief Header file for the cache of font faces and glyph outlines
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_LYR_FREETYPE_FONTCACHE_H
+#define __SYNFIG_LYR_FREETYPE_FONTCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <synfig/string.h>
+#include <synfig/vector.h>
+#include <synfig/rendering/primitive/contour.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+/*!	\class FontCache
+**	\brief Process-wide cache of opened font faces and of glyph outlines.
+**
+**	Font names are resolved to files once (failed lookups are repeated
+**	on each request), and each file is opened once for all Text layers. Faces are never closed, layers keep raw pointers
+**	to them. Outlines are stored unscaled (in font units), so they serve
+**	text of any size.
+*/
+class FontCache
+{
+public:
+	//! Unscaled and unhinted glyph
+	struct Outline
+	{
+		synfig::rendering::Contour::ChunkList chunks;
+		synfig::Vector advance;
+		//! top of the control box, the same as FT_Glyph_Get_CBox gives
+		synfig::Real height;
+		Outline(): height() { }
+	};
+
+	typedef std::shared_ptr<const Outline> OutlineHandle;
+
+	//! all outlines are released when count of them exceeds this value
+	static const size_t max_outlines;
+
+private:
+	//! font name and path of the canvas file
+	typedef std::pair<synfig::String, synfig::String> NameKey;
+	//! file name and face index
+	typedef std::pair<synfig::String, FT_Long> FaceKey;
+	typedef std::pair<FT_Face, FT_UInt> GlyphKey;
+
+	mutable std::mutex mutex;
+	std::map<NameKey, FT_Face> names;
+	std::map<FaceKey, FT_Face> faces;
+	std::map<GlyphKey, OutlineHandle> outlines;
+
+	FontCache() { }
+	FontCache(const FontCache&) { }
+	FontCache& operator= (const FontCache&) { return *this; }
+
+	FT_Face open_face(const synfig::String &filename, FT_Long face_index);
+	FT_Face find_face(const synfig::String &font, const synfig::String &path);
+
+public:
+	//! cache shared by all Text layers
+	static FontCache& get_instance();
+
+	//! FT_Face objects are not thread-safe, lock this mutex
+	//! when a face is used directly
+	std::mutex& get_mutex() { return mutex; }
+
+	//! returns face by font name or by file name, \a path is the directory
+	//! of canvas file to search fonts placed near it. Returns null if not found.
+	FT_Face get_face(const synfig::String &font, const synfig::String &path);
+
+	FT_UInt get_char_index(FT_Face face, FT_ULong code);
+	//! returns kerning in font units
+	synfig::Vector get_kerning(FT_Face face, FT_UInt left_glyph, FT_UInt right_glyph);
+	//! returns null if glyph cannot be loaded as outline
+	OutlineHandle get_outline(FT_Face face, FT_UInt glyph_index);
+};
+
+/* === E N D =============================================================== */
+
+#endif
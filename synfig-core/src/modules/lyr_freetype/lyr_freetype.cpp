@@ -35,13 +35,10 @@
 #ifdef HAVE_CONFIG_H
 #	include <config.h>
 #endif
-#ifdef WITH_FONTCONFIG
-#include <fontconfig/fontconfig.h>
-#endif
-
 #include <pango/pangocairo.h>
 
 #include "lyr_freetype.h"
+#include "fontcache.h"
 
 #include <synfig/localization.h>
 #include <synfig/general.h>
@@ -49,6 +46,9 @@
 #include <synfig/canvasfilenaming.h>
 #include <synfig/cairo_renddesc.h>
 
+#include <synfig/rendering/common/task/taskcontour.h>
+#include <synfig/rendering/common/task/tasklayer.h>
+
 #endif
 
 using namespace std;
@@ -77,6 +77,28 @@ SYNFIG_LAYER_SET_CVS_ID(Layer_Freetype,"$Id$");
 
 /* === P R O C E D U R E S ================================================= */
 
+//! reads one utf-8 character and moves iterator to the next one,
+//! returns false for malformed sequence
+static bool
+read_utf8_char(String::const_iterator &iter, const String::const_iterator &end, unsigned int &code)
+{
+	unsigned int c = (unsigned char)*iter++;
+	int bytes;
+	if      (c < 0x80)           { code = c; return true; }
+	else if ((c & 0xe0) == 0xc0) { code = c & 0x1f; bytes = 1; }
+	else if ((c & 0xf0) == 0xe0) { code = c & 0x0f; bytes = 2; }
+	else if ((c & 0xf8) == 0xf0) { code = c & 0x07; bytes = 3; }
+	else return false;
+
+	for(; bytes > 0; --bytes, ++iter)
+	{
+		if (iter == end || ((unsigned char)*iter & 0xc0) != 0x80)
+			return false;
+		code = (code << 6) | ((unsigned char)*iter & 0x3f);
+	}
+	return true;
+}
+
 /*Glyph::~Glyph()
 {
 	if(glyph)FT_Done_Glyph(glyph);
@@ -99,6 +121,7 @@ TextLine::clear_and_free()
 Layer_Freetype::Layer_Freetype()
 {
 	face=0;
+	layout_key=0;
 
 	param_size=ValueBase(Vector(0.25,0.25));
 	param_text=ValueBase(_("Text Layer"));
@@ -134,8 +157,6 @@ Layer_Freetype::Layer_Freetype()
 
 Layer_Freetype::~Layer_Freetype()
 {
-	if(face)
-		FT_Done_Face(face);
 }
 
 void
@@ -327,152 +348,20 @@ Layer_Freetype::new_font_(const synfig::String &font_fam_, int style, int weight
 	return false;
 }
 
-#ifdef USE_MAC_FT_FUNCS
-void fss2path(char *path, FSSpec *fss)
-{
-  int l;             //fss->name contains name of last item in path
-  for(l=0; l<(fss->name[0]); l++) path[l] = fss->name[l + 1];
-  path[l] = 0;
-
-  if(fss->parID != fsRtParID) //path is more than just a volume name
-  {
-    int i, len;
-    CInfoPBRec pb;
-
-    pb.dirInfo.ioNamePtr = fss->name;
-    pb.dirInfo.ioVRefNum = fss->vRefNum;
-    pb.dirInfo.ioDrParID = fss->parID;
-    do
-    {
-      pb.dirInfo.ioFDirIndex = -1;  //get parent directory name
-      pb.dirInfo.ioDrDirID = pb.dirInfo.ioDrParID;
-      if(PBGetCatInfoSync(&pb) != noErr) break;
-
-      len = fss->name[0] + 1;
-      for(i=l; i>=0;  i--) path[i + len] = path[i];
-      for(i=1; i<len; i++) path[i - 1] = fss->name[i]; //add to start of path
-      path[i - 1] = ':';
-      l += len;
-} while(pb.dirInfo.ioDrDirID != fsRtDirID); //while more directory levels
-  }
-}
-#endif
-
 bool
 Layer_Freetype::new_face(const String &newfont)
 {
 	synfig::String font=param_font.get(synfig::String());
-	int error;
-	FT_Long face_index=0;
 
 	// If we are already loaded, don't bother reloading.
 	if(face && font==newfont)
 		return true;
 
-	if(face)
-	{
-		FT_Done_Face(face);
-		face=0;
-	}
-
-	error=FT_New_Face(ft_library,newfont.c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,(newfont+".ttf").c_str(),face_index,&face);
-
-	if(get_canvas())
-	{
-		if(error)error=FT_New_Face(ft_library,(get_canvas()->get_file_path()+ETL_DIRECTORY_SEPARATOR+newfont).c_str(),face_index,&face);
-		if(error)error=FT_New_Face(ft_library,(get_canvas()->get_file_path()+ETL_DIRECTORY_SEPARATOR+newfont+".ttf").c_str(),face_index,&face);
-	}
-
-#ifdef USE_MAC_FT_FUNCS
-	if(error)
-	{
-		FSSpec fs_spec;
-		error=FT_GetFile_From_Mac_Name(newfont.c_str(),&fs_spec,&face_index);
-		if(!error)
-		{
-			char filename[512];
-			fss2path(filename,&fs_spec);
-			//FSSpecToNativePathName(fs_spec,filename,sizeof(filename)-1, 0);
-
-			error=FT_New_Face(ft_library, filename, face_index,&face);
-			//error=FT_New_Face_From_FSSpec(ft_library, &fs_spec, face_index,&face);
-			synfig::info(__FILE__":%d: \"%s\" (%s) -- ft_error=%d",__LINE__,newfont.c_str(),filename,error);
-		}
-		else
-		{
-			synfig::info(__FILE__":%d: \"%s\" -- ft_error=%d",__LINE__,newfont.c_str(),error);
-			// Unable to generate fs_spec
-		}
-	}
-#endif
-
-#ifdef WITH_FONTCONFIG
-	if(error)
-	{
-		FcFontSet *fs;
-		FcResult result;
-		if( !FcInit() )
-		{
-			synfig::warning("Layer_Freetype: fontconfig: %s",_("unable to initialize"));
-			error = 1;
-		} else {
-			FcPattern* pat = FcNameParse((FcChar8 *) newfont.c_str());
-			FcConfigSubstitute(0, pat, FcMatchPattern);
-			FcDefaultSubstitute(pat);
-			FcPattern *match;
-			fs = FcFontSetCreate();
-			match = FcFontMatch(0, pat, &result);
-			if (match)
-				FcFontSetAdd(fs, match);
-			if (pat)
-				FcPatternDestroy(pat);
-			if(fs && fs->nfont){
-				FcChar8* file;
-				if( FcPatternGetString (fs->fonts[0], FC_FILE, 0, &file) == FcResultMatch )
-					error=FT_New_Face(ft_library,(const char*)file,face_index,&face);
-				FcFontSetDestroy(fs);
-			} else
-				synfig::warning("Layer_Freetype: fontconfig: %s",_("empty font set"));
-		}
-	}
-#endif
-
-#ifdef _WIN32
-	if(error)error=FT_New_Face(ft_library,("C:\\WINDOWS\\FONTS\\"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("C:\\WINDOWS\\FONTS\\"+newfont+".ttf").c_str(),face_index,&face);
-#else
-
-#ifdef __APPLE__
-	if(error)error=FT_New_Face(ft_library,("~/Library/Fonts/"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("~/Library/Fonts/"+newfont+".ttf").c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("~/Library/Fonts/"+newfont+".dfont").c_str(),face_index,&face);
-
-	if(error)error=FT_New_Face(ft_library,("/Library/Fonts/"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("/Library/Fonts/"+newfont+".ttf").c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("/Library/Fonts/"+newfont+".dfont").c_str(),face_index,&face);
-#endif
-
-	if(error)error=FT_New_Face(ft_library,("/usr/X11R6/lib/X11/fonts/type1/"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("/usr/X11R6/lib/X11/fonts/type1/"+newfont+".ttf").c_str(),face_index,&face);
-
-	if(error)error=FT_New_Face(ft_library,("/usr/share/fonts/truetype/"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("/usr/share/fonts/truetype/"+newfont+".ttf").c_str(),face_index,&face);
-
-	if(error)error=FT_New_Face(ft_library,("/usr/X11R6/lib/X11/fonts/TTF/"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("/usr/X11R6/lib/X11/fonts/TTF/"+newfont+".ttf").c_str(),face_index,&face);
-
-	if(error)error=FT_New_Face(ft_library,("/usr/X11R6/lib/X11/fonts/truetype/"+newfont).c_str(),face_index,&face);
-	if(error)error=FT_New_Face(ft_library,("/usr/X11R6/lib/X11/fonts/truetype/"+newfont+".ttf").c_str(),face_index,&face);
-
-#endif
-	if(error)
-	{
-		//synfig::error(strprintf("Layer_Freetype:%s (err=%d)",_("Unable to open face."),error));
+	// faces are opened once and shared by all layers
+	face=FontCache::get_instance().get_face(
+		newfont, get_canvas() ? get_canvas()->get_file_path() : synfig::String() );
+	if(!face)
 		return false;
-	}
-
-	font=newfont;
 
 	needs_sync_=true;
 	return true;
@@ -676,6 +565,157 @@ Layer_Freetype::sync()
 	needs_sync_=false;
 }
 
+synfig::String
+Layer_Freetype::get_text()const
+{
+	String text(param_text.get(synfig::String()));
+	if(text=="@_FILENAME_@" && get_canvas() && !get_canvas()->get_file_name().empty())
+		text=basename(get_canvas()->get_file_name());
+	return text;
+}
+
+void
+Layer_Freetype::build_layout(const synfig::String &text, rendering::Contour &contour)const
+{
+	// Glyphs are placed the same way as in accelerated_render(), but in
+	// font units instead of pixels and without rounding. Glyphs rendered
+	// by FreeType are 64/72 of the size of the font in pixels,
+	// the spacing is compensated in the same way too.
+	const Real error(72.0/64.0/1.13/0.996);
+	const Real compress(param_compress.get(Real())*error);
+	const Real vcompress(param_vcompress.get(Real())*error);
+	const Vector orient(param_orient.get(Vector()));
+	const bool use_kerning(param_use_kerning.get(bool()) && FT_HAS_KERNING(face));
+
+	FontCache &cache(FontCache::get_instance());
+
+	struct Line
+	{
+		std::vector< std::pair<Vector, FontCache::OutlineHandle> > glyphs;
+		Real width;
+		Real height;
+		Line(): width(), height() { }
+	};
+
+	std::vector<Line> lines(1);
+	Vector pen;
+	FT_UInt previous(0);
+	for(String::const_iterator iter=text.begin(); iter!=text.end(); )
+	{
+		int multiplier(1);
+		unsigned int code;
+		if(*iter=='\n')
+		{
+			lines.push_back(Line());
+			pen=Vector();
+			previous=0;
+			++iter;
+			continue;
+		}
+		if(*iter=='\t')
+		{
+			multiplier=8;
+			code=' ';
+			++iter;
+		}
+		else
+		if(!read_utf8_char(iter, text.end(), code))
+		{
+			synfig::warning("Layer_Freetype: multibyte: %s",
+							_("Can't parse multibyte character.\n"));
+			continue;
+		}
+
+		FT_UInt glyph_index(cache.get_char_index(face, code));
+		if(use_kerning && previous && glyph_index)
+			pen += cache.get_kerning(face, previous, glyph_index)*(compress<1.0 ? compress : 1.0);
+
+		FontCache::OutlineHandle outline(cache.get_outline(face, glyph_index));
+		if(!outline)
+			continue;
+		previous=glyph_index;
+
+		Line &line(lines.back());
+		line.glyphs.push_back(std::make_pair(pen, outline));
+		line.width=pen[0]+outline->advance[0];
+		line.height=std::max(line.height, outline->height);
+
+		if(multiplier>1)
+		{
+			Real tab(outline->advance[0]*multiplier*compress);
+			if(tab>0.0)
+				pen[0]=(floor(pen[0]/tab)+1.0)*tab;
+		}
+		else
+			pen[0]+=outline->advance[0]*compress;
+		pen[1]+=outline->advance[1]*multiplier;
+	}
+
+	// orient[1] places the top of the first line (0.0)
+	// or the baseline of the last line (1.0) to the origin
+	const Real line_height(vcompress*face->height);
+	const Real text_height((lines.size()-1)*line_height + lines.front().height);
+
+	contour.clear();
+	for(int i=0; i<(int)lines.size(); i++)
+	{
+		const Line &line(lines[i]);
+		const Vector offset(
+			-orient[0]*line.width,
+			((int)lines.size()-1-i)*line_height - (1.0-orient[1])*text_height );
+		for(std::vector< std::pair<Vector, FontCache::OutlineHandle> >::const_iterator j=line.glyphs.begin(); j!=line.glyphs.end(); ++j)
+		{
+			const Vector o(offset + j->first);
+			const rendering::Contour::ChunkList &chunks(j->second->chunks);
+			contour.reserve(chunks.size());
+			for(rendering::Contour::ChunkList::const_iterator k=chunks.begin(); k!=chunks.end(); ++k)
+				contour.add_chunk(rendering::Contour::Chunk(k->type, k->p1 + o, k->pp0 + o, k->pp1 + o));
+		}
+	}
+}
+
+rendering::Task::Handle
+Layer_Freetype::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// hinting needs the grid of pixels, which is unknown here,
+	// so sharpened text is still rendered by accelerated_render()
+	String text(get_text());
+	if(!face || !FT_IS_SCALABLE(face) || text.empty() || param_grid_fit.get(bool()))
+		return new rendering::TaskLayer();
+
+	rendering::Hasher hasher;
+	hasher.add(text);
+	hasher.add(face);
+	hasher.add(param_compress.get(Real()));
+	hasher.add(param_vcompress.get(Real()));
+	hasher.add(param_orient.get(Vector()));
+	hasher.add(param_use_kerning.get(bool()));
+	if(!layout || layout_key!=hasher.get())
+	{
+		layout=new rendering::Contour();
+		build_layout(text, *layout);
+		layout_key=hasher.get();
+	}
+
+	// the size of glyphs as in accelerated_render(), contour is not changed
+	// when the size is animated, so the contour cache may reuse it
+	const Vector size(param_size.get(Vector())*2.0*(64.0/72.0)/(Real)face->units_per_EM);
+
+	rendering::TaskContour::Handle task_contour(new rendering::TaskContour());
+	task_contour->transformation->matrix =
+		Matrix().set_translate(param_origin.get(Vector()))
+	  * Matrix().set_scale(fabs(size[0]), fabs(size[1]));
+	task_contour->contour = new rendering::Contour();
+	task_contour->contour->assign(*layout);
+	task_contour->contour->color = param_color.get(Color());
+	task_contour->contour->invert = param_invert.get(bool());
+	task_contour->contour->antialias = true;
+	task_contour->contour->winding_style = rendering::Contour::WINDING_NON_ZERO;
+	return task_contour;
+}
+
 inline Color
 Layer_Freetype::color_func(const Point &point_ __attribute__ ((unused)), int quality __attribute__ ((unused)), ColorReal supersample __attribute__ ((unused)))const
 {
@@ -715,8 +755,6 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 	synfig::Point origin=param_origin.get(Point());
 	synfig::Vector orient=param_orient.get(Vector());
 
-	static std::recursive_mutex freetype_mutex;
-
 	if(needs_sync_)
 		const_cast<Layer_Freetype*>(this)->sync();
 
@@ -736,11 +774,7 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 		return true;
 	}
 
-	String text(Layer_Freetype::param_text.get(synfig::String()));
-	if(text=="@_FILENAME_@" && get_canvas() && !get_canvas()->get_file_name().empty())
-	{
-		text=basename(get_canvas()->get_file_name());
-	}
+	String text(get_text());
 
 	// Width and Height of a pixel
 	Vector::value_type pw=renddesc.get_w()/(renddesc.get_br()[0]-renddesc.get_tl()[0]);
@@ -762,7 +796,8 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 		return true;
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(freetype_mutex);
+	// face is shared with other layers
+	std::lock_guard<std::mutex> lock(FontCache::get_instance().get_mutex());
 
 #define CHAR_RESOLUTION		(64)
 	error = FT_Set_Char_Size(
@@ -54,6 +54,8 @@
 #include <synfig/value.h>
 #include <synfig/valuenode.h>
 #include <synfig/canvas.h>
+#include <synfig/rendering/task.h>
+#include <synfig/rendering/primitive/contour.h>
 
 
 #include <ETL/misc>
@@ -138,8 +140,14 @@ private:
 	//!Parameter: (bool) inverts the rendered text
 	ValueBase param_invert;
 
+	//! owned by FontCache
 	FT_Face face;
 
+	//! glyphs of the text placed in font units, reused while text,
+	//! font and spacing are not changed
+	mutable rendering::Contour::Handle layout;
+	mutable rendering::Hasher::Value layout_key;
+
 	bool old_version;
 	bool needs_sync_;
 
@@ -149,6 +157,9 @@ private:
 
 	mutable std::mutex mutex;
 
+	synfig::String get_text()const;
+	void build_layout(const synfig::String &text, rendering::Contour &contour)const;
+
 public:
 	Layer_Freetype();
 	virtual ~Layer_Freetype();
@@ -167,6 +178,9 @@ public:
 
 	virtual synfig::Rect get_bounding_rect()const;
 
+protected:
+	virtual rendering::Task::Handle build_composite_task_vfunc(ContextParams context_params)const;
+
 private:
 	void new_font(const synfig::String &family, int style=0, int weight=400);
 	bool new_font_(const synfig::String &family, int style=0, int weight=400);
@@ -0,0 +1,159 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file fractal.cpp
+**	\brief Iterations of Mandelbrot and Julia sets
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "fractal.h"
+
+#endif
+
+// the same condition as for SYNFIG_SOFTWARE_BLEND_SIMD in blendkernels.h
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SYNFIG_LYR_STD_FRACTAL_SIMD
+#include <emmintrin.h>
+#endif
+
+using namespace synfig;
+using namespace modules;
+using namespace lyr_std;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+#ifdef SYNFIG_LYR_STD_FRACTAL_SIMD
+
+void
+FractalKernel::iterate(
+	Real *zr,
+	Real *zi,
+	const Real *cr,
+	const Real *ci,
+	ColorReal *mag,
+	int *escape,
+	int iterations,
+	Real bailout,
+	Broken broken )
+{
+	// two pixels per register, FMA is not used to keep results
+	// the same as in scalar code
+	enum { count = lanes/2 };
+
+	__m128d x[count], y[count], a[count], b[count];
+	__m128d m[count], e[count], run[count];
+	for(int j = 0; j < count; ++j) {
+		x[j] = _mm_loadu_pd(zr + 2*j);
+		y[j] = _mm_loadu_pd(zi + 2*j);
+		a[j] = _mm_loadu_pd(cr + 2*j);
+		b[j] = _mm_loadu_pd(ci + 2*j);
+		m[j] = _mm_setzero_pd();
+		e[j] = _mm_set1_pd(-1.0);
+		run[j] = _mm_castsi128_pd(_mm_set1_epi32(-1));
+	}
+
+	const __m128d limit = _mm_set1_pd(bailout);
+	for(int i = 0; i < iterations; ++i) {
+		const __m128d iteration = _mm_set1_pd((double)i);
+		int active = 0;
+		for(int j = 0; j < count; ++j) {
+			__m128d xy = _mm_mul_pd(x[j], y[j]);
+			__m128d r = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(x[j], x[j]), _mm_mul_pd(y[j], y[j])), a[j]);
+			__m128d s = _mm_add_pd(_mm_add_pd(xy, xy), b[j]);
+			if (broken == BROKEN_MANDELBROT)
+				r = _mm_add_pd(r, y[j]);
+			else
+			if (broken == BROKEN_JULIA)
+				r = _mm_add_pd(r, s);
+
+			// magnitude is rounded to ColorReal like in get_color()
+			__m128d mg = _mm_cvtps_pd(_mm_cvtpd_ps(
+				_mm_add_pd(_mm_mul_pd(r, r), _mm_mul_pd(s, s)) ));
+			__m128d out = _mm_and_pd(run[j], _mm_cmpgt_pd(mg, limit));
+
+			x[j] = _mm_or_pd(_mm_and_pd(run[j], r), _mm_andnot_pd(run[j], x[j]));
+			y[j] = _mm_or_pd(_mm_and_pd(run[j], s), _mm_andnot_pd(run[j], y[j]));
+			m[j] = _mm_or_pd(_mm_and_pd(run[j], mg), _mm_andnot_pd(run[j], m[j]));
+			e[j] = _mm_or_pd(_mm_and_pd(out, iteration), _mm_andnot_pd(out, e[j]));
+			run[j] = _mm_andnot_pd(out, run[j]);
+			active |= _mm_movemask_pd(run[j]);
+		}
+		if (!active) break;
+	}
+
+	for(int j = 0; j < count; ++j) {
+		_mm_storeu_pd(zr + 2*j, x[j]);
+		_mm_storeu_pd(zi + 2*j, y[j]);
+		double mm[2], ee[2];
+		_mm_storeu_pd(mm, m[j]);
+		_mm_storeu_pd(ee, e[j]);
+		for(int k = 0; k < 2; ++k) {
+			mag[2*j + k] = (ColorReal)mm[k];
+			escape[2*j + k] = (int)ee[k];
+		}
+	}
+}
+
+#else
+
+void
+FractalKernel::iterate(
+	Real *zr,
+	Real *zi,
+	const Real *cr,
+	const Real *ci,
+	ColorReal *mag,
+	int *escape,
+	int iterations,
+	Real bailout,
+	Broken broken )
+{
+	for(int l = 0; l < lanes; ++l) {
+		Real x = zr[l], y = zi[l];
+		ColorReal m = 0;
+		escape[l] = -1;
+		for(int i = 0; i < iterations; ++i) {
+			Real x_hold = x;
+			x = x*x - y*y + cr[l];
+			if (broken == BROKEN_MANDELBROT) x += y;
+			y = x_hold*y*2 + ci[l];
+			if (broken == BROKEN_JULIA) x += y;
+			m = x*x + y*y;
+			if (m > bailout) { escape[l] = i; break; }
+		}
+		zr[l] = x;
+		zi[l] = y;
+		mag[l] = m;
+	}
+}
+
+#endif
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,89 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file fractal.h
+**	\brief Iterations of Mandelbrot and Julia sets
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_LYR_STD_FRACTAL_H
+#define __SYNFIG_LYR_STD_FRACTAL_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/color.h>
+#include <synfig/real.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace modules
+{
+namespace lyr_std
+{
+
+/*!	\class FractalKernel
+**	\brief Iterates z = z*z + c for group of pixels at once.
+**
+**	On x86_64 pixels are iterated in SSE2 registers, escaped pixels are
+**	masked out and keep their values, iterations stop when all pixels
+**	of the group escaped. Results are the same as of the scalar
+**	calculations in Mandelbrot::get_color() and Julia::get_color(),
+**	unless compiler fuses multiply-add in those (e.g. with -mfma),
+**	then values may differ in the last bits.
+*/
+class FractalKernel
+{
+public:
+	enum { lanes = 8 }; //!< count of pixels in group
+
+	//! modifications of the equation made by "Break Set" parameter
+	enum Broken
+	{
+		BROKEN_NONE,
+		BROKEN_MANDELBROT, //!< previous imaginary part is added to real part
+		BROKEN_JULIA       //!< new imaginary part is added to real part
+	};
+
+	//! \param zr, zi take initial values and receive values of the last iteration
+	//! \param mag receives squared magnitude of the last iteration
+	//! \param escape receives iteration at which \a mag exceeded \a bailout,
+	//!        or -1 for pixels inside the set
+	static void iterate(
+		Real *zr,
+		Real *zi,
+		const Real *cr,
+		const Real *ci,
+		ColorReal *mag,
+		int *escape,
+		int iterations,
+		Real bailout,
+		Broken broken );
+};
+
+} /* end namespace lyr_std */
+} /* end namespace modules */
+} /* end namespace synfig */
+
+/* === E N D =============================================================== */
+
+#endif
@@ -32,7 +32,10 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
 #include "julia.h"
+#include "fractal.h"
 
 #include <synfig/localization.h>
 #include <synfig/general.h>
@@ -103,6 +106,130 @@ color_neg_flip(Color &color)
 
 /* === M E T H O D S ======================================================= */
 
+rendering::Task::Token TaskJulia::token(
+	DescAbstract<TaskJulia>("Julia") );
+rendering::Task::Token TaskJuliaSW::token(
+	DescReal<TaskJuliaSW, TaskJulia>("JuliaSW") );
+
+
+bool
+TaskJulia::hash_params(rendering::Hasher &hasher) const
+{
+	hasher.add(icolor);
+	hasher.add(ocolor);
+	hasher.add(color_shift);
+	hasher.add(iterations);
+	hasher.add(seed);
+	hasher.add(shade_inside);
+	hasher.add(invert_inside);
+	hasher.add(color_inside);
+	hasher.add(shade_outside);
+	hasher.add(invert_outside);
+	hasher.add(color_outside);
+	hasher.add(color_cycle);
+	hasher.add(smooth_outside);
+	hasher.add(broken);
+	hasher.add(transformation->matrix);
+	return true;
+}
+
+
+Color
+TaskJuliaSW::get_pixel(Real zr, Real zi, ColorReal mag, int escape) const
+{
+	Color ret;
+	if (escape >= 0) {
+		ColorReal depth;
+		if (smooth_outside) {
+			depth = (ColorReal)escape - log(log(sqrt(mag))) / LOG_OF_2;
+			if (depth < 0) depth = 0;
+		} else {
+			depth = static_cast<ColorReal>(escape);
+		}
+
+		ret = ocolor;
+		if (invert_outside)
+			ret = ~ret;
+		if (color_outside)
+			ret = ret.set_uv(zr, zi).clamped_negative();
+		if (color_cycle)
+			ret = ret.rotate_uv(color_shift.operator*(depth)).clamped_negative();
+		if (shade_outside) {
+			ColorReal alpha = depth/static_cast<ColorReal>(iterations);
+			ret = (ocolor - ret)*alpha + ret;
+		}
+		return ret;
+	}
+
+	ret = icolor;
+	if (invert_inside)
+		ret = ~ret;
+	if (color_inside)
+		ret = ret.set_uv(zr, zi).clamped_negative();
+	if (shade_inside)
+		ret = (icolor - ret)*mag + ret;
+	return ret;
+}
+
+bool
+TaskJuliaSW::run(RunParams&) const
+{
+	if (!is_valid())
+		return true;
+
+	const RectInt &r = target_rect;
+	Vector ppu = get_pixels_per_unit();
+
+	Matrix bounds_transfromation;
+	bounds_transfromation.m00 = ppu[0];
+	bounds_transfromation.m11 = ppu[1];
+	bounds_transfromation.m20 = r.minx - ppu[0]*source_rect.minx;
+	bounds_transfromation.m21 = r.miny - ppu[1]*source_rect.miny;
+
+	Matrix matrix = bounds_transfromation * transformation->matrix;
+	Matrix inv_matrix = matrix.get_inverted();
+
+	Vector dx = inv_matrix.axis_x();
+	Vector dy = inv_matrix.axis_y();
+	Point p = inv_matrix.get_transformed( Vector((Real)r.minx, (Real)r.miny) );
+
+	const int width = r.get_width();
+
+	LockWrite la(this);
+	if (!la)
+		return false;
+
+	const int lanes = FractalKernel::lanes;
+	const FractalKernel::Broken broken_mode = broken ? FractalKernel::BROKEN_JULIA : FractalKernel::BROKEN_NONE;
+
+	synfig::Surface &surface = la->get_surface();
+	Real zr[lanes], zi[lanes], cr[lanes], ci[lanes];
+	ColorReal mag[lanes];
+	int escape[lanes];
+	std::fill(cr, cr + lanes, seed[0]);
+	std::fill(ci, ci + lanes, seed[1]);
+	for(int y = r.miny; y < r.maxy; ++y, p += dy) {
+		Color *dst = &surface[y][r.minx];
+		for(int x = 0; x < width; x += lanes) {
+			// unused lanes repeat the last pixel, so they don't prolong iterations
+			int count = std::min(lanes, width - x);
+			for(int l = 0; l < lanes; ++l) {
+				Real xx = (Real)(x + std::min(l, count - 1));
+				zr[l] = p[0] + dx[0]*xx;
+				zi[l] = p[1] + dx[1]*xx;
+			}
+
+			FractalKernel::iterate(zr, zi, cr, ci, mag, escape, iterations, 4.0, broken_mode);
+
+			for(int l = 0; l < count; ++l, ++dst)
+				*dst = get_pixel(zr[l], zi[l], mag[l], escape[l]);
+		}
+	}
+
+	return true;
+}
+
+
 Julia::Julia():
 param_color_shift(ValueBase(Angle::deg(0)))
 {
@@ -417,3 +544,29 @@ Julia::get_param_vocab()const
 
 	return ret;
 }
+
+rendering::Task::Handle
+Julia::build_rendering_task_vfunc(Context context)const
+{
+	// colors taken from context are sampled at distorted positions,
+	// so such sets are still rendered by get_color()
+	if (!param_solid_inside.get(bool()) || !param_solid_outside.get(bool()))
+		return Layer::build_rendering_task_vfunc(context);
+
+	TaskJulia::Handle task(new TaskJulia());
+	task->icolor = param_icolor.get(Color());
+	task->ocolor = param_ocolor.get(Color());
+	task->color_shift = param_color_shift.get(Angle());
+	task->iterations = param_iterations.get(int());
+	task->seed = param_seed.get(Point());
+	task->shade_inside = param_shade_inside.get(bool());
+	task->invert_inside = param_invert_inside.get(bool());
+	task->color_inside = param_color_inside.get(bool());
+	task->shade_outside = param_shade_outside.get(bool());
+	task->invert_outside = param_invert_outside.get(bool());
+	task->color_outside = param_color_outside.get(bool());
+	task->color_cycle = param_color_cycle.get(bool());
+	task->smooth_outside = param_smooth_outside.get(bool());
+	task->broken = param_broken.get(bool());
+	return task;
+}
@@ -34,6 +34,9 @@
 #include <synfig/vector.h>
 #include <synfig/angle.h>
 
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
 /* === M A C R O S ========================================================= */
 
 /* === T Y P E D E F S ===================================================== */
@@ -47,6 +50,71 @@ namespace modules
 namespace lyr_std
 {
 
+//! Julia set with solid colors inside and outside,
+//! such set doesn't depend on context
+class TaskJulia: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskJulia> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Color icolor;
+	Color ocolor;
+	Angle color_shift;
+	int iterations;
+	Point seed;
+	bool shade_inside;
+	bool invert_inside;
+	bool color_inside;
+	bool shade_outside;
+	bool invert_outside;
+	bool color_outside;
+	bool color_cycle;
+	bool smooth_outside;
+	bool broken;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	TaskJulia():
+		icolor(Color::black()),
+		ocolor(Color::black()),
+		color_shift(Angle::deg(0)),
+		iterations(32),
+		shade_inside(true),
+		invert_inside(false),
+		color_inside(true),
+		shade_outside(true),
+		invert_outside(false),
+		color_outside(false),
+		color_cycle(false),
+		smooth_outside(true),
+		broken(false)
+	{ }
+
+	virtual const rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+//! Iterates groups of pixels by FractalKernel
+class TaskJuliaSW: public TaskJulia,
+	public rendering::TaskSW,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskJuliaSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams &params) const;
+
+private:
+	Color get_pixel(Real zr, Real zi, ColorReal mag, int escape) const;
+};
+
+
 class Julia : public Layer
 {
 	SYNFIG_LAYER_MODULE_EXT
@@ -104,6 +172,7 @@ public:
 
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
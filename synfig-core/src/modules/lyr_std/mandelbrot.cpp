@@ -32,7 +32,10 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
 #include "mandelbrot.h"
+#include "fractal.h"
 
 #include <synfig/localization.h>
 #include <synfig/general.h>
@@ -103,6 +106,116 @@ color_neg_flip(Color &color)
 
 /* === M E T H O D S ======================================================= */
 
+rendering::Task::Token TaskMandelbrot::token(
+	DescAbstract<TaskMandelbrot>("Mandelbrot") );
+rendering::Task::Token TaskMandelbrotSW::token(
+	DescReal<TaskMandelbrotSW, TaskMandelbrot>("MandelbrotSW") );
+
+
+bool
+TaskMandelbrot::hash_params(rendering::Hasher &hasher) const
+{
+	hasher.add(iterations);
+	hasher.add(bailout);
+	hasher.add(broken);
+	hasher.add(gradient_inside.size());
+	for(Gradient::const_iterator i = gradient_inside.begin(); i != gradient_inside.end(); ++i) {
+		hasher.add(i->pos);
+		hasher.add(i->color);
+	}
+	hasher.add(gradient_offset_inside);
+	hasher.add(gradient_loop_inside);
+	hasher.add(gradient_outside.size());
+	for(Gradient::const_iterator i = gradient_outside.begin(); i != gradient_outside.end(); ++i) {
+		hasher.add(i->pos);
+		hasher.add(i->color);
+	}
+	hasher.add(smooth_outside);
+	hasher.add(gradient_offset_outside);
+	hasher.add(gradient_scale_outside);
+	hasher.add(transformation->matrix);
+	return true;
+}
+
+
+bool
+TaskMandelbrotSW::run(RunParams&) const
+{
+	if (!is_valid())
+		return true;
+
+	const RectInt &r = target_rect;
+	Vector ppu = get_pixels_per_unit();
+
+	Matrix bounds_transfromation;
+	bounds_transfromation.m00 = ppu[0];
+	bounds_transfromation.m11 = ppu[1];
+	bounds_transfromation.m20 = r.minx - ppu[0]*source_rect.minx;
+	bounds_transfromation.m21 = r.miny - ppu[1]*source_rect.miny;
+
+	Matrix matrix = bounds_transfromation * transformation->matrix;
+	Matrix inv_matrix = matrix.get_inverted();
+
+	Vector dx = inv_matrix.axis_x();
+	Vector dy = inv_matrix.axis_y();
+	Point p = inv_matrix.get_transformed( Vector((Real)r.minx, (Real)r.miny) );
+
+	const int width = r.get_width();
+	const Real lp = log(log(bailout));
+
+	LockWrite la(this);
+	if (!la)
+		return false;
+
+	const int lanes = FractalKernel::lanes;
+	const FractalKernel::Broken broken_mode = broken ? FractalKernel::BROKEN_MANDELBROT : FractalKernel::BROKEN_NONE;
+
+	synfig::Surface &surface = la->get_surface();
+	Real cr[lanes], ci[lanes], zr[lanes], zi[lanes];
+	ColorReal mag[lanes];
+	int escape[lanes];
+	for(int y = r.miny; y < r.maxy; ++y, p += dy) {
+		Color *dst = &surface[y][r.minx];
+		for(int x = 0; x < width; x += lanes) {
+			// unused lanes repeat the last pixel, so they don't prolong iterations
+			int count = std::min(lanes, width - x);
+			for(int l = 0; l < lanes; ++l) {
+				Real xx = (Real)(x + std::min(l, count - 1));
+				cr[l] = p[0] + dx[0]*xx;
+				ci[l] = p[1] + dx[1]*xx;
+				zr[l] = 0.0;
+				zi[l] = 0.0;
+			}
+
+			FractalKernel::iterate(zr, zi, cr, ci, mag, escape, iterations, bailout, broken_mode);
+
+			for(int l = 0; l < count; ++l, ++dst) {
+				if (escape[l] >= 0) {
+					ColorReal depth;
+					if (smooth_outside) {
+						depth = (ColorReal)escape[l] + LOG_OF_2*lp - log(log(sqrt(mag[l]))) / LOG_OF_2;
+						if (depth < 0) depth = 0;
+					} else {
+						depth = static_cast<ColorReal>(escape[l]);
+					}
+					ColorReal amount(depth/static_cast<ColorReal>(iterations));
+					amount = amount*gradient_scale_outside + gradient_offset_outside;
+					amount -= floor(amount);
+					*dst = gradient_outside(amount);
+				} else {
+					ColorReal amount(abs(mag[l] + gradient_offset_inside));
+					if (gradient_loop_inside)
+						amount -= floor(amount);
+					*dst = gradient_inside(amount);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
 Mandelbrot::Mandelbrot():
 	param_gradient_inside(ValueBase(Gradient(Color::alpha(),Color::black()))),
 	param_gradient_offset_inside(ValueBase(Real(0.0))),
@@ -429,3 +542,25 @@ Mandelbrot::get_color(Context context, const Point &pos)const
 
 	return ret;
 }
+
+rendering::Task::Handle
+Mandelbrot::build_rendering_task_vfunc(Context context)const
+{
+	// colors taken from context are sampled at distorted positions,
+	// so such sets are still rendered by get_color()
+	if (!param_solid_inside.get(bool()) || !param_solid_outside.get(bool()))
+		return Layer::build_rendering_task_vfunc(context);
+
+	TaskMandelbrot::Handle task(new TaskMandelbrot());
+	task->iterations = param_iterations.get(int());
+	task->bailout = param_bailout.get(Real());
+	task->broken = param_broken.get(bool());
+	task->gradient_inside = param_gradient_inside.get(Gradient());
+	task->gradient_offset_inside = param_gradient_offset_inside.get(Real());
+	task->gradient_loop_inside = param_gradient_loop_inside.get(bool());
+	task->gradient_outside = param_gradient_outside.get(Gradient());
+	task->smooth_outside = param_smooth_outside.get(bool());
+	task->gradient_offset_outside = param_gradient_offset_outside.get(Real());
+	task->gradient_scale_outside = param_gradient_scale_outside.get(Real());
+	return task;
+}
@@ -34,6 +34,9 @@
 #include <synfig/angle.h>
 #include <synfig/gradient.h>
 
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
 /* === M A C R O S ========================================================= */
 
 /* === T Y P E D E F S ===================================================== */
@@ -47,6 +50,59 @@ namespace modules
 namespace lyr_std
 {
 
+//! Mandelbrot set with solid coloring inside and outside,
+//! such set doesn't depend on context
+class TaskMandelbrot: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskMandelbrot> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	int iterations;
+	Real bailout; //!< squared
+	bool broken;
+	Gradient gradient_inside;
+	Real gradient_offset_inside;
+	bool gradient_loop_inside;
+	Gradient gradient_outside;
+	bool smooth_outside;
+	Real gradient_offset_outside;
+	Real gradient_scale_outside;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	TaskMandelbrot():
+		iterations(32),
+		bailout(4.0),
+		broken(false),
+		gradient_offset_inside(0.0),
+		gradient_loop_inside(true),
+		smooth_outside(true),
+		gradient_offset_outside(0.0),
+		gradient_scale_outside(1.0)
+	{ }
+
+	virtual const rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+//! Iterates groups of pixels by FractalKernel
+class TaskMandelbrotSW: public TaskMandelbrot,
+	public rendering::TaskSW,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskMandelbrotSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams &params) const;
+};
+
+
 class Mandelbrot : public Layer
 {
 	SYNFIG_LAYER_MODULE_EXT
@@ -101,6 +157,7 @@ public:
 
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
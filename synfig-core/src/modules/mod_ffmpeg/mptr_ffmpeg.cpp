@@ -34,6 +34,7 @@
 
 #include <ETL/stringf>
 #include "mptr_ffmpeg.h"
+#include <cmath>
 #include <cstdio>
 #include <sys/types.h>
 #include <synfig/general.h>
@@ -80,113 +81,118 @@ SYNFIG_IMPORTER_SET_SUPPORTS_FILE_SYSTEM_WRAPPER(ffmpeg_mptr, false);
 
 /* === M E T H O D S ======================================================= */
 
+const size_t ffmpeg_mptr::frames_buffer_size = 4;
+const Time ffmpeg_mptr::max_skip_time = 2.0;
+
 bool ffmpeg_mptr::is_animated()
 {
 	return true;
 }
 
-bool
-ffmpeg_mptr::seek_to(const Time& time)
+void
+ffmpeg_mptr::close_stream()
 {
-	//if(frame<cur_frame || !file)
-	//{
-		if(file)
-		{
+	if(file)
+	{
 #if defined(WIN32_PIPE_TO_PROCESSES)
-			pclose(file);
+		pclose(file);
 #elif defined(UNIX_PIPE_TO_PROCESSES)
-			fclose(file);
-			int status;
-			waitpid(pid,&status,0);
+		fclose(file);
+		int status;
+		waitpid(pid,&status,0);
 #endif
-		}
-		
-		// FIXME: 24 fps is hardcoded now, but in fact we have to get it from canvas
-		//float position = (frame+1)/24; // ffmpeg didn't work with 0 frame
-		//float position = 1000/24; // ffmpeg didn't work with 0 frame
-		const char* position = time.get_string(Time::FORMAT_NORMAL).c_str();
+		file=NULL;
+		pid=-1;
+	}
+	last_frame=-1;
+}
+
+bool
+ffmpeg_mptr::open_stream(long long frame_index)
+{
+	close_stream();
+
+	// ffmpeg didn't work with the position string of Time, so pass seconds
+	String position = strprintf("%f", (double)frame_index/stream_fps);
+	String rate = strprintf("%f", (double)stream_fps);
 
 #if defined(WIN32_PIPE_TO_PROCESSES)
 
-		string command;
-		
-		String binary_path = synfig::get_binary_path("");
-		if (binary_path != "")
-			binary_path = etl::dirname(binary_path)+ETL_DIRECTORY_SEPARATOR;
-		binary_path += "ffmpeg.exe";
+	string command;
+
+	String binary_path = synfig::get_binary_path("");
+	if (binary_path != "")
+		binary_path = etl::dirname(binary_path)+ETL_DIRECTORY_SEPARATOR;
+	binary_path += "ffmpeg.exe";
+
+	if (streaming)
+		command=strprintf("\"%s\" -ss %s -i \"%s\" -r %s -an -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position.c_str(), identifier.filename.c_str(), rate.c_str());
+	else
+		command=strprintf("\"%s\" -ss %s -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position.c_str(), identifier.filename.c_str());
 
-		command=strprintf("\"%s\" -ss %s -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position, identifier.filename.c_str());
-		
-		// This covers the dumb cmd.exe behavior.
-		// See: http://eli.thegreenplace.net/2011/01/28/on-spaces-in-the-paths-of-programs-and-files-on-windows/
-		command = "\"" + command + "\"";
+	// This covers the dumb cmd.exe behavior.
+	// See: http://eli.thegreenplace.net/2011/01/28/on-spaces-in-the-paths-of-programs-and-files-on-windows/
+	command = "\"" + command + "\"";
 
-		file=popen(command.c_str(),POPEN_BINARY_READ_TYPE);
+	file=popen(command.c_str(),POPEN_BINARY_READ_TYPE);
 
 #elif defined(UNIX_PIPE_TO_PROCESSES)
 
-		int p[2];
+	int p[2];
 
-		if (pipe(p)) {
-			cerr<<"Unable to open pipe to ffmpeg (no pipe)"<<endl;
-			return false;
-		};
+	if (pipe(p)) {
+		cerr<<"Unable to open pipe to ffmpeg (no pipe)"<<endl;
+		return false;
+	};
 
-		pid = fork();
+	pid = fork();
 
-		if (pid == -1) {
-			cerr<<"Unable to open pipe to ffmpeg (pid == -1)"<<endl;
-			return false;
-		}
+	if (pid == -1) {
+		cerr<<"Unable to open pipe to ffmpeg (pid == -1)"<<endl;
+		return false;
+	}
 
-		if (pid == 0){
-			// Child process
-			// Close pipein, not needed
-			close(p[0]);
-			// Dup pipein to stdout
-			if( dup2( p[1], STDOUT_FILENO ) == -1 ){
-				cerr<<"Unable to open pipe to ffmpeg (dup2( p[1], STDOUT_FILENO ) == -1)"<<endl;
-				return false;
-			}
-			// Close the unneeded pipein
-			close(p[1]);
-			/*std::string command = strprintf("\"%s\" -ss '%s' -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", "ffmpeg", position2, identifier.filename.c_str());
-			synfig::warning("ffmpeg command: '%s'", command.c_str());*/
-			execlp("ffmpeg", "ffmpeg", "-ss", position, "-i", identifier.filename.c_str(), "-vframes", "1","-an", "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
-			// We should never reach here unless the exec failed
-			cerr<<"Unable to open pipe to ffmpeg (exec failed)"<<endl;
+	if (pid == 0){
+		// Child process
+		// Close pipein, not needed
+		close(p[0]);
+		// Dup pipein to stdout
+		if( dup2( p[1], STDOUT_FILENO ) == -1 ){
+			cerr<<"Unable to open pipe to ffmpeg (dup2( p[1], STDOUT_FILENO ) == -1)"<<endl;
 			_exit(1);
-		} else {
-			// Parent process
-			// Close pipeout, not needed
-			close(p[1]);
-			// Save pipein to file handle, will read from it later
-			file = fdopen(p[0], "rb");
 		}
+		// Close the unneeded pipein
+		close(p[1]);
+		if (streaming)
+			execlp("ffmpeg", "ffmpeg", "-ss", position.c_str(), "-i", identifier.filename.c_str(), "-r", rate.c_str(), "-an", "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
+		else
+			execlp("ffmpeg", "ffmpeg", "-ss", position.c_str(), "-i", identifier.filename.c_str(), "-vframes", "1", "-an", "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
+		// We should never reach here unless the exec failed
+		cerr<<"Unable to open pipe to ffmpeg (exec failed)"<<endl;
+		_exit(1);
+	} else {
+		// Parent process
+		// Close pipeout, not needed
+		close(p[1]);
+		// Save pipein to file handle, will read from it later
+		file = fdopen(p[0], "rb");
+	}
 
 #else
 	#error There are no known APIs for creating child processes
 #endif
 
-		if(!file)
-		{
-			cerr<<"Unable to open pipe to ffmpeg"<<endl;
-			return false;
-		}
-		cur_frame=-1;
-	//}
-
-	//while(cur_frame<frame-1)
-	//{
-	//	cerr<<"Seeking to..."<<frame<<'('<<cur_frame<<')'<<endl;
-	//	if(!grab_frame())
-	//		return false;
-	//}
+	if(!file)
+	{
+		cerr<<"Unable to open pipe to ffmpeg"<<endl;
+		return false;
+	}
+	last_frame=frame_index-1;
 	return true;
 }
 
 bool
-ffmpeg_mptr::grab_frame(void)
+ffmpeg_mptr::grab_frame(Surface &frame)
 {
 	if(!file)
 	{
@@ -210,26 +216,25 @@ ffmpeg_mptr::grab_frame(void)
 	}
 
 	fgetc(file);
-	fscanf(file,"%d %d\n",&w,&h);
-	fscanf(file,"%f",&divisor);
+	if (fscanf(file,"%d %d\n",&w,&h) != 2 || fscanf(file,"%f",&divisor) != 1)
+		return false;
 	fgetc(file);
 
-	if(feof(file))
+	if(feof(file) || w <= 0 || h <= 0)
 		return false;
 
 	frame.set_wh(w, h);
+	row.resize(3*w);
 	const ColorReal k = 1/255.0;
 	for(int y = 0; y < frame.get_h(); ++y)
-		for(int x = 0; x < frame.get_w(); ++x)
-		{
-			if(feof(file))
-				return false;
-			ColorReal r = k*(unsigned char)fgetc(file);
-			ColorReal g = k*(unsigned char)fgetc(file);
-			ColorReal b = k*(unsigned char)fgetc(file);
-			frame[y][x] = Color(r, g, b);
-		}
-	cur_frame++;
+	{
+		if(fread(&row.front(), 1, row.size(), file) != row.size())
+			return false;
+		const unsigned char *c = &row.front();
+		for(int x = 0; x < frame.get_w(); ++x, c += 3)
+			frame[y][x] = Color(k*c[0], k*c[1], k*c[2]);
+	}
+	++last_frame;
 	return true;
 }
 
@@ -241,36 +246,73 @@ ffmpeg_mptr::ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier):
 	tcgetattr (0, &oldtty);
 #endif
 	file=NULL;
-	fps=23.98;
-	cur_frame=-1;
+	streaming=!getenv("SYNFIG_DISABLE_FFMPEG_STREAMING");
+	fps=24;
+	stream_fps=fps;
+	last_frame=-1;
 }
 
 ffmpeg_mptr::~ffmpeg_mptr()
 {
-	if(file)
-	{
-#if defined(WIN32_PIPE_TO_PROCESSES)
-		pclose(file);
-#elif defined(UNIX_PIPE_TO_PROCESSES)
-		fclose(file);
-		int status;
-		waitpid(pid,&status,0);
-#endif
-	}
+	close_stream();
 #ifdef HAVE_TERMIOS_H
 	tcsetattr(0,TCSANOW,&oldtty);
 #endif
 }
 
 bool
-ffmpeg_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &/*renddesc*/, Time time, synfig::ProgressCallback *)
+ffmpeg_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &renddesc, Time time, synfig::ProgressCallback *)
 {
-	synfig::warning("time: %f", (float)time);
-	if(!seek_to(time))
-		return false;
-	if(!grab_frame())
-		return false;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	float frame_rate = renddesc.get_frame_rate() > 0 ? renddesc.get_frame_rate() : fps;
+	if (frame_rate != stream_fps)
+	{
+		close_stream();
+		frames.clear();
+		stream_fps = frame_rate;
+	}
+	long long index = (long long)floor((double)time*stream_fps + 0.5);
+
+	if (!streaming)
+	{
+		Surface frame;
+		if(!open_stream(index) || !grab_frame(frame))
+			return false;
+		surface=frame;
+		return true;
+	}
+
+	// repeated requests of the recent frames
+	for(std::deque<BufferedFrame>::const_iterator i = frames.begin(); i != frames.end(); ++i)
+		if (i->first == index)
+			{ surface=i->second; return true; }
+
+	// restart ffmpeg for backward or far seek,
+	// otherwise decode frames up to requested one
+	if ( !file
+	  || index <= last_frame
+	  || index - last_frame > std::max(1ll, (long long)floor((double)max_skip_time*stream_fps + 0.5)) )
+	{
+		frames.clear();
+		if (!open_stream(index))
+			return false;
+	}
+
+	while(last_frame < index)
+	{
+		if (frames.size() >= frames_buffer_size)
+			frames.pop_front();
+		frames.push_back(BufferedFrame(last_frame + 1, Surface()));
+		if (!grab_frame(frames.back().second))
+		{
+			frames.pop_back();
+			close_stream();
+			return false;
+		}
+		frames.back().first = last_frame;
+	}
 
-	surface=frame;
+	surface=frames.back().second;
 	return true;
 }
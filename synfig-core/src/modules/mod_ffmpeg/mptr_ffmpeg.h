@@ -32,6 +32,9 @@
 #include <synfig/importer.h>
 #include <sys/types.h>
 #include <cstdio>
+#include <deque>
+#include <mutex>
+#include <vector>
 #include "string.h"
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
@@ -44,22 +47,38 @@
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
+//! Imports video through the ffmpeg process.
+//! Frames are read sequentially from the single ffmpeg process,
+//! which is restarted only for backward or far seeks.
+//! Set SYNFIG_DISABLE_FFMPEG_STREAMING to run ffmpeg for each frame.
 class ffmpeg_mptr : public synfig::Importer
 {
 	SYNFIG_IMPORTER_MODULE_EXT
 public:
+	//! count of last decoded frames kept to serve repeated requests
+	static const size_t frames_buffer_size;
+	//! ffmpeg restarts when the requested frame is farther than that
+	static const synfig::Time max_skip_time;
+
 private:
+	typedef std::pair<long long, synfig::Surface> BufferedFrame;
+
+	std::mutex mutex;
 	pid_t pid;
 	FILE *file;
-	int cur_frame;
-	synfig::Surface frame;
+	bool streaming;
 	float fps;
+	float stream_fps;
+	long long last_frame; //!< index of the last frame read from ffmpeg
+	std::deque<BufferedFrame> frames;
+	std::vector<unsigned char> row;
 #ifdef HAVE_TERMIOS_H
 	struct termios oldtty;
 #endif
 
-	bool seek_to(const synfig::Time& time);
-	bool grab_frame(void);
+	void close_stream();
+	bool open_stream(long long frame_index);
+	bool grab_frame(synfig::Surface &frame);
 
 public:
 	ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier);
@@ -85,6 +85,13 @@ public:
 	TaskCheckerBoard(): antialias(true) { }
 	virtual const rendering::Transformation::Handle get_transformation() const
 		{ return transformation.handle(); }
+
+	virtual bool hash_params(rendering::Hasher &hasher) const {
+		hasher.add(color);
+		hasher.add(antialias);
+		hasher.add(transformation->matrix);
+		return true;
+	}
 };
 
 
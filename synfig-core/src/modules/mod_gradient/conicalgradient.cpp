@@ -44,6 +44,7 @@
 #include <synfig/angle.h>
 
 #include "conicalgradient.h"
+#include "taskgradient.h"
 
 #endif
 
@@ -52,6 +53,8 @@
 using namespace etl;
 using namespace std;
 using namespace synfig;
+using namespace modules;
+using namespace mod_gradient;
 
 /* === G L O B A L S ======================================================= */
 
@@ -439,3 +442,15 @@ ConicalGradient::compile_mesh(cairo_pattern_t* pattern, Gradient mygradient, Rea
 	}
 	return cpoints_all_opaque;
 }
+
+rendering::Task::Handle
+ConicalGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskGradientConical::Handle task(new TaskGradientConical());
+	task->gradient = param_gradient.get(Gradient());
+	task->loop = true;
+	task->zigzag = param_symmetric.get(bool());
+	task->center = param_center.get(Point());
+	task->angle = param_angle.get(Angle());
+	return task;
+}
@@ -33,6 +33,7 @@
 #endif
 
 #include "lineargradient.h"
+#include "taskgradient.h"
 
 #include <synfig/localization.h>
 #include <synfig/general.h>
@@ -48,6 +49,12 @@
 
 #endif
 
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace modules;
+using namespace mod_gradient;
+
 /* === M A C R O S ========================================================= */
 
 /* === G L O B A L S ======================================================= */
@@ -368,3 +375,15 @@ LinearGradient::compile_gradient(cairo_pattern_t* pattern, Gradient mygradient)c
 	}
 	return cpoints_all_opaque;
 }
+
+rendering::Task::Handle
+LinearGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskGradientLinear::Handle task(new TaskGradientLinear());
+	task->gradient = param_gradient.get(Gradient());
+	task->loop = param_loop.get(bool());
+	task->zigzag = param_zigzag.get(bool());
+	task->p1 = param_p1.get(Point());
+	task->p2 = param_p2.get(Point());
+	return task;
+}
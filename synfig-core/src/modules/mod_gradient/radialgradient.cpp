@@ -44,6 +44,7 @@
 #include <synfig/valuenode.h>
 
 #include "radialgradient.h"
+#include "taskgradient.h"
 
 #endif
 
@@ -52,6 +53,8 @@
 using namespace etl;
 using namespace std;
 using namespace synfig;
+using namespace modules;
+using namespace mod_gradient;
 
 /* === G L O B A L S ======================================================= */
 
@@ -342,3 +345,14 @@ RadialGradient::compile_gradient(cairo_pattern_t* pattern, Gradient mygradient)c
 	return cpoints_all_opaque;
 }
 
+rendering::Task::Handle
+RadialGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskGradientRadial::Handle task(new TaskGradientRadial());
+	task->gradient = param_gradient.get(Gradient());
+	task->loop = param_loop.get(bool());
+	task->zigzag = param_zigzag.get(bool());
+	task->center = param_center.get(Point());
+	task->radius = param_radius.get(Real());
+	return task;
+}
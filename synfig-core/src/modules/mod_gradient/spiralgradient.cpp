@@ -44,6 +44,7 @@
 #include <synfig/cairo_renddesc.h>
 
 #include "spiralgradient.h"
+#include "taskgradient.h"
 
 #endif
 
@@ -52,6 +53,8 @@
 using namespace etl;
 using namespace std;
 using namespace synfig;
+using namespace modules;
+using namespace mod_gradient;
 
 /* === G L O B A L S ======================================================= */
 
@@ -319,5 +322,15 @@ SpiralGradient::accelerated_cairorender(Context context, cairo_t *cr,int quality
 	return true;
 }
 
-
-
+rendering::Task::Handle
+SpiralGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskGradientSpiral::Handle task(new TaskGradientSpiral());
+	task->gradient = param_gradient.get(Gradient());
+	task->loop = true;
+	task->center = param_center.get(Point());
+	task->radius = param_radius.get(Real());
+	task->angle = param_angle.get(Angle());
+	task->clockwise = param_clockwise.get(bool());
+	return task;
+}
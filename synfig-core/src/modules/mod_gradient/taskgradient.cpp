@@ -0,0 +1,365 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file taskgradient.cpp
+**	\brief Implementation of rendering tasks of the gradient layers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <synfig/rendering/software/function/blend.h>
+
+#include "taskgradient.h"
+
+#endif
+
+using namespace synfig;
+using namespace modules;
+using namespace mod_gradient;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+const int GradientLUT::resolution = 4096;
+const int GradientLUT::max_size = 65536;
+
+
+GradientLUT::GradientLUT(const CompiledGradient &gradient, Real window):
+	repeat(gradient.get_repeat()),
+	begin(0.0),
+	end(1.0),
+	k(resolution),
+	size(resolution)
+{
+	if (!(window < Real(max_size/resolution))) {
+		// gradient is less than pixel, so all pixels have the average color
+		repeat = true;
+		k = 1.0;
+		size = 1;
+		colors.resize(1, gradient.average());
+		sums.resize(2);
+		sums[1] = period_sum = gradient.summary();
+		return;
+	}
+
+	window = std::max(Real(0.0), window);
+	if (!repeat) {
+		// outside of this range averaged color is the same as color of the edge
+		Real w = 0.5*window + 1.0/resolution;
+		begin = -w;
+		end = 1.0 + w;
+		size = std::min(max_size, (int)ceil((end - begin)*resolution));
+		k = size/(end - begin);
+	}
+
+	const Real step = 1.0/k;
+	const Real half = 0.5*window;
+
+	colors.resize(size);
+	for(int i = 0; i < size; ++i) {
+		Real x = begin + (i + 0.5)*step;
+		colors[i] = gradient.average(x - half, x + half);
+	}
+
+	sums.resize(size + 1);
+	for(int i = 0; i <= size; ++i)
+		sums[i] = gradient.summary(begin + i*step);
+
+	begin_color = Accumulator(gradient.color(begin));
+	end_color = Accumulator(gradient.color(end));
+	period_sum = sums.back() - sums.front();
+}
+
+GradientLUT::Accumulator
+GradientLUT::summary(Real x) const
+{
+	Real periods = 0.0;
+	if (repeat) {
+		periods = floor(x);
+		x -= periods;
+	} else {
+		if (x <= begin) return sums.front() + begin_color*(x - begin);
+		if (x >= end) return sums.back() + end_color*(x - end);
+	}
+
+	Real f = (x - begin)*k;
+	int i = f > 0 ? (f < size ? (int)f : size - 1) : 0;
+	Accumulator sum = sums[i] + (sums[i+1] - sums[i])*(f - i);
+	return repeat ? sum + period_sum*periods : sum;
+}
+
+void
+GradientLUT::get_row(Color *dst, const Real *x, int count) const
+{
+	for(Color *end = dst + count; dst < end; ++dst, ++x)
+		*dst = get(*x);
+}
+
+void
+GradientLUT::get_row(Color *dst, const Real *x, const Real *w, int count) const
+{
+	for(Color *end = dst + count; dst < end; ++dst, ++x, ++w)
+		*dst = get(*x, *w);
+}
+
+
+rendering::Task::Token TaskGradientLinear::token(
+	DescAbstract<TaskGradientLinear>("GradientLinear") );
+rendering::Task::Token TaskGradientRadial::token(
+	DescAbstract<TaskGradientRadial>("GradientRadial") );
+rendering::Task::Token TaskGradientConical::token(
+	DescAbstract<TaskGradientConical>("GradientConical") );
+rendering::Task::Token TaskGradientSpiral::token(
+	DescAbstract<TaskGradientSpiral>("GradientSpiral") );
+
+rendering::Task::Token TaskGradientLinearSW::token(
+	DescReal<TaskGradientLinearSW, TaskGradientLinear>("GradientLinearSW") );
+rendering::Task::Token TaskGradientRadialSW::token(
+	DescReal<TaskGradientRadialSW, TaskGradientRadial>("GradientRadialSW") );
+rendering::Task::Token TaskGradientConicalSW::token(
+	DescReal<TaskGradientConicalSW, TaskGradientConical>("GradientConicalSW") );
+rendering::Task::Token TaskGradientSpiralSW::token(
+	DescReal<TaskGradientSpiralSW, TaskGradientSpiral>("GradientSpiralSW") );
+
+
+bool
+TaskGradient::hash_params(Hasher &hasher) const
+{
+	hasher.add(gradient.size());
+	for(Gradient::const_iterator i = gradient.begin(); i != gradient.end(); ++i) {
+		hasher.add(i->pos);
+		hasher.add(i->color);
+	}
+	hasher.add(loop);
+	hasher.add(zigzag);
+	hasher.add(transformation->matrix);
+	return true;
+}
+
+bool
+TaskGradientLinear::hash_params(Hasher &hasher) const
+{
+	if (!TaskGradient::hash_params(hasher)) return false;
+	hasher.add(p1);
+	hasher.add(p2);
+	return true;
+}
+
+bool
+TaskGradientRadial::hash_params(Hasher &hasher) const
+{
+	if (!TaskGradient::hash_params(hasher)) return false;
+	hasher.add(center);
+	hasher.add(radius);
+	return true;
+}
+
+bool
+TaskGradientConical::hash_params(Hasher &hasher) const
+{
+	if (!TaskGradient::hash_params(hasher)) return false;
+	hasher.add(center);
+	hasher.add(angle);
+	return true;
+}
+
+bool
+TaskGradientSpiral::hash_params(Hasher &hasher) const
+{
+	if (!TaskGradient::hash_params(hasher)) return false;
+	hasher.add(center);
+	hasher.add(radius);
+	hasher.add(angle);
+	hasher.add(clockwise);
+	return true;
+}
+
+
+void
+TaskGradientSW::on_target_set_as_source()
+{
+	Task *task = dynamic_cast<Task*>(this);
+	Task::Handle &subtask = target_subtask();
+	if ( task
+	  && subtask
+	  && subtask->target_surface == task->target_surface
+	  && !Color::is_straight(blend_method) )
+	{
+		task->trunc_by_bounds();
+		subtask->source_rect = task->source_rect;
+		subtask->target_rect = task->target_rect;
+	}
+}
+
+bool
+TaskGradientSW::run_gradient(const TaskGradient &task) const
+{
+	if (!task.is_valid())
+		return true;
+
+	const RectInt &r = task.target_rect;
+	Vector ppu = task.get_pixels_per_unit();
+
+	Matrix bounds_transfromation;
+	bounds_transfromation.m00 = ppu[0];
+	bounds_transfromation.m11 = ppu[1];
+	bounds_transfromation.m20 = r.minx - ppu[0]*task.source_rect.minx;
+	bounds_transfromation.m21 = r.miny - ppu[1]*task.source_rect.miny;
+
+	Matrix matrix = bounds_transfromation * task.transformation->matrix;
+	Matrix inv_matrix = matrix.get_inverted();
+
+	Vector dx = inv_matrix.axis_x();
+	Vector dy = inv_matrix.axis_y();
+	Point p = inv_matrix.get_transformed( Vector((Real)r.minx, (Real)r.miny) );
+	Real pw = dx.mag();
+
+	// parameters of whole row are calculated first to let compiler vectorize loops,
+	// then colors are taken from the lookup table
+	Real window = get_window(pw);
+	GradientLUT lut(task.compile(), window);
+
+	int width = r.get_width();
+	std::vector<Real> x(width);
+	std::vector<Real> w(window < 0 ? width : 0);
+	std::vector<Color> row(width);
+
+	LockWrite la(&task);
+	if (!la)
+		return false;
+
+	synfig::Surface &surface = la->get_surface();
+	ColorReal amount = blend ? this->amount : ColorReal(1.0);
+	for(int y = r.miny; y < r.maxy; ++y, p += dy) {
+		if (window < 0) {
+			fill_row(&x.front(), &w.front(), width, p, dx, pw);
+			lut.get_row(&row.front(), &x.front(), &w.front(), width);
+		} else {
+			fill_row(&x.front(), NULL, width, p, dx, pw);
+			lut.get_row(&row.front(), &x.front(), width);
+		}
+
+		Color *dst = &surface[y][r.minx];
+		if (blend)
+			software::Blend::blend_row(dst, &row.front(), width, amount, blend_method);
+		else
+			std::copy(row.begin(), row.end(), dst);
+	}
+
+	return true;
+}
+
+
+Real
+TaskGradientLinearSW::get_window(Real pw) const
+{
+	Real len = (p2 - p1).mag();
+	return len > 0.0 ? pw/len : INFINITY;
+}
+
+void
+TaskGradientLinearSW::fill_row(Real *x, Real * /* w */, int count, const Point &p, const Vector &dx, Real /* pw */) const
+{
+	Vector diff = p2 - p1;
+	Real mag_squared = diff.mag_squared();
+	if (mag_squared > 0.0) diff /= mag_squared;
+
+	Real x0 = (p - p1)*diff;
+	Real step = dx*diff;
+	for(int i = 0; i < count; ++i)
+		x[i] = x0 + step*i;
+}
+
+
+Real
+TaskGradientRadialSW::get_window(Real pw) const
+	{ return 1.2*pw/radius; }
+
+void
+TaskGradientRadialSW::fill_row(Real *x, Real * /* w */, int count, const Point &p, const Vector &dx, Real /* pw */) const
+{
+	Vector c = p - center;
+	Real k = 1.0/radius;
+	for(int i = 0; i < count; ++i) {
+		Real px = c[0] + dx[0]*i;
+		Real py = c[1] + dx[1]*i;
+		x[i] = sqrt(px*px + py*py)*k;
+	}
+}
+
+
+Real
+TaskGradientConicalSW::get_window(Real /* pw */) const
+	{ return -1.0; }
+
+void
+TaskGradientConicalSW::fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const
+{
+	// gradient is looped, so angle is not reduced to one turn
+	Vector c = p - center;
+	Real rot = Angle::rot(angle).get();
+	Real k = 1.0/(2.0*PI);
+	for(int i = 0; i < count; ++i) {
+		Real px = c[0] + dx[0]*i;
+		Real py = c[1] + dx[1]*i;
+		x[i] = atan2(-py, px)*k + rot;
+		w[i] = std::fabs(px) < 0.5*pw && std::fabs(py) < 0.5*pw
+		     ? 0.5 : pw*k/sqrt(px*px + py*py);
+	}
+}
+
+
+Real
+TaskGradientSpiralSW::get_window(Real /* pw */) const
+	{ return -1.0; }
+
+void
+TaskGradientSpiralSW::fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const
+{
+	// gradient is looped, so angle is not reduced to one turn
+	Vector c = p - center;
+	Real rot = Angle::rot(angle).get();
+	Real k = 1.0/(2.0*PI);
+	Real kr = 1.0/radius;
+	Real sign = clockwise ? 1.0 : -1.0;
+	for(int i = 0; i < count; ++i) {
+		Real px = c[0] + dx[0]*i;
+		Real py = c[1] + dx[1]*i;
+		Real dist = sqrt(px*px + py*py);
+		x[i] = dist*kr + sign*(atan2(-py, px)*k + rot);
+		w[i] = std::max(Real(0.00001), (1.41421*pw*kr + 1.41421*pw*k/dist)*0.5);
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
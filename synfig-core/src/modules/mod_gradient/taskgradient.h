@@ -0,0 +1,287 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file taskgradient.h
+**	\brief Header file for rendering tasks of the gradient layers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_MOD_GRADIENT_TASKGRADIENT_H
+#define __SYNFIG_MOD_GRADIENT_TASKGRADIENT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <vector>
+
+#include <synfig/angle.h>
+#include <synfig/color.h>
+#include <synfig/gradient.h>
+#include <synfig/vector.h>
+
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace modules
+{
+namespace mod_gradient
+{
+
+/*!	\class GradientLUT
+**	\brief Lookup table of the compiled gradient.
+**
+**	Keeps colors averaged over the fixed window, so gradients with the same
+**	supersampling for all pixels (linear and radial) need only one lookup per pixel.
+**	Also keeps the sampled summary of the gradient to average colors over
+**	any window in constant time (conical and spiral gradients).
+*/
+class GradientLUT
+{
+public:
+	typedef CompiledGradient::Accumulator Accumulator;
+
+	//! entries per unit of gradient parameter
+	static const int resolution;
+	static const int max_size;
+
+private:
+	bool repeat;
+	Real begin;
+	Real end;
+	Real k;
+	int size;
+	std::vector<Color> colors;       //!< averaged over fixed window, entry i is centered at begin + (i + 0.5)/k
+	std::vector<Accumulator> sums;   //!< summary at begin + i/k
+	Accumulator begin_color;
+	Accumulator end_color;
+	Accumulator period_sum;
+
+	Accumulator summary(Real x) const;
+
+public:
+	GradientLUT(const CompiledGradient &gradient, Real window);
+
+	Real get_step() const { return 1.0/k; }
+
+	inline const Color& get(Real x) const
+	{
+		Real f = repeat ? (x - floor(x))*k : (x - begin)*k;
+		return colors[ f > 0 ? (f < size ? (int)f : size - 1) : 0 ];
+	}
+
+	//! averages gradient over window [x - w/2, x + w/2]
+	inline Color get(Real x, Real w) const
+	{
+		if (w <= get_step()) return get(x);
+		w *= 0.5;
+		return ((summary(x + w) - summary(x - w))/(w + w)).color();
+	}
+
+	//! colors averaged over the window which was passed into constructor
+	void get_row(Color *dst, const Real *x, int count) const;
+	//! colors averaged over own window for each pixel
+	void get_row(Color *dst, const Real *x, const Real *w, int count) const;
+};
+
+
+class TaskGradient: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskGradient> Handle;
+
+	Gradient gradient;
+	bool loop;
+	bool zigzag;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	TaskGradient(): loop(false), zigzag(false) { }
+
+	virtual const rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+
+	CompiledGradient compile() const
+		{ return CompiledGradient(gradient, loop, zigzag); }
+};
+
+
+class TaskGradientLinear: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskGradientLinear> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Point p1;
+	Point p2;
+
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+class TaskGradientRadial: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskGradientRadial> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Point center;
+	Real radius;
+
+	TaskGradientRadial(): radius(0.5) { }
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+class TaskGradientConical: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskGradientConical> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Point center;
+	Angle angle;
+
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+class TaskGradientSpiral: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskGradientSpiral> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Point center;
+	Real radius;
+	Angle angle;
+	bool clockwise;
+
+	TaskGradientSpiral(): radius(0.5), clockwise(false) { }
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+//! Common part of software implementations of gradient tasks,
+//! fills target row by row, calculated colors are blended by software::Blend
+class TaskGradientSW: public rendering::TaskSW,
+	public rendering::TaskInterfaceBlendToTarget,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	virtual void on_target_set_as_source();
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+protected:
+	//! Width of the supersampling window in units of gradient parameter,
+	//! negative value means that window is different for each pixel.
+	//! \param pw size of pixel in local coordinates of the gradient
+	virtual Real get_window(Real pw) const = 0;
+
+	//! Calculates gradient parameter for each pixel of row \a x,
+	//! and window for each pixel \a w if it is not NULL.
+	//! \param p position of the first pixel in local coordinates
+	//! \param dx step between pixels in local coordinates
+	virtual void fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const = 0;
+
+	bool run_gradient(const TaskGradient &task) const;
+};
+
+
+class TaskGradientLinearSW: public TaskGradientLinear, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskGradientLinearSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual Real get_window(Real pw) const;
+	virtual void fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const;
+};
+
+
+class TaskGradientRadialSW: public TaskGradientRadial, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskGradientRadialSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual Real get_window(Real pw) const;
+	virtual void fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const;
+};
+
+
+class TaskGradientConicalSW: public TaskGradientConical, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskGradientConicalSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual Real get_window(Real pw) const;
+	virtual void fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const;
+};
+
+
+class TaskGradientSpiralSW: public TaskGradientSpiral, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskGradientSpiralSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual Real get_window(Real pw) const;
+	virtual void fill_row(Real *x, Real *w, int count, const Point &p, const Vector &dx, Real pw) const;
+};
+
+} /* end namespace mod_gradient */
+} /* end namespace modules */
+} /* end namespace synfig */
+
+/* === E N D =============================================================== */
+
+#endif
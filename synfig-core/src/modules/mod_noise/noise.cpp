@@ -32,6 +32,7 @@
 #endif
 
 #include "noise.h"
+#include "tasknoise.h"
 
 #include <synfig/localization.h>
 #include <synfig/general.h>
@@ -51,6 +52,8 @@
 /* === M A C R O S ========================================================= */
 
 using namespace synfig;
+using namespace modules;
+using namespace mod_noise;
 using namespace std;
 using namespace etl;
 
@@ -330,6 +333,27 @@ Noise::get_cairocolor(Context context, const Point &point)const
 		return CairoColor::blend(color,context.get_cairocolor(point),get_amount(),get_blend_method());
 }
 
+rendering::Task::Handle
+Noise::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	Real speed = param_speed.get(Real());
+	int smooth = param_smooth.get(int());
+	if (!speed && smooth == (int)RandomNoise::SMOOTH_SPLINE)
+		smooth = (int)RandomNoise::SMOOTH_FAST_SPLINE;
+
+	TaskNoise::Handle task(new TaskNoise());
+	task->gradient = param_gradient.get(Gradient());
+	task->seed = param_random.get(int());
+	task->size = param_size.get(Vector());
+	task->smooth = RandomNoise::SmoothType(smooth);
+	task->detail = param_detail.get(int());
+	task->time = (Real)Time(speed*get_time_mark());
+	task->turbulent = param_turbulent.get(bool());
+	task->do_alpha = param_do_alpha.get(bool());
+	task->super_sample = param_super_sample.get(bool());
+	return task;
+}
+
 bool
 Noise::accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const
 {
@@ -73,6 +73,9 @@ private:
 	synfig::Color color_func(const synfig::Point &x, float supersample,synfig::Context context)const;
 	float calc_supersample(const synfig::Point &x, float pw,float ph)const;
 
+protected:
+	virtual synfig::rendering::Task::Handle build_composite_task_vfunc(synfig::ContextParams context_params)const;
+
 public:
 	Noise();
 
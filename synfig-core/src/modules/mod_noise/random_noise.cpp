@@ -33,7 +33,6 @@
 #include <synfig/general.h>
 #include <synfig/localization.h>
 #include "random_noise.h"
-#include <synfig/quick_rng.h>
 #include <cmath>
 #include <cstdlib>
 #endif
@@ -57,19 +56,7 @@ RandomNoise::set_seed(int x)
 float
 RandomNoise::operator()(const int salt,const int x,const int y,const int t)const
 {
-	static const unsigned int a(21870);
-	static const unsigned int b(11213);
-	static const unsigned int c(36979);
-	static const unsigned int d(31337);
-
-	quick_rng rng(
-		( static_cast<unsigned int>(x+y)        * a ) ^
-		( static_cast<unsigned int>(y+t)        * b ) ^
-		( static_cast<unsigned int>(t+x)        * c ) ^
-		( static_cast<unsigned int>(seed_+salt) * d )
-	);
-
-	return rng.f() * 2.0f - 1.0f;
+	return lattice(seed_+salt, x, y, t);
 }
 
 float
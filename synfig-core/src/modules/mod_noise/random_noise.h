@@ -28,6 +28,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <stdint.h>
+
 /* === M A C R O S ========================================================= */
 
 /* === T Y P E D E F S ===================================================== */
@@ -54,6 +56,21 @@ public:
 		SMOOTH_FAST_SPLINE	= 5,
 	};
 
+	//! Value in the lattice point, the same as operator()(subseed, x, y, t)
+	//! with seed equal to seed_+subseed. Inlined to let compiler vectorize
+	//! loops over rows of pixels.
+	static inline float lattice(int seed,int x,int y,int t)
+	{
+		uint32_t next =
+			( static_cast<uint32_t>(x+y)  * 21870u ) ^
+			( static_cast<uint32_t>(y+t)  * 11213u ) ^
+			( static_cast<uint32_t>(t+x)  * 36979u ) ^
+			( static_cast<uint32_t>(seed) * 31337u );
+		// one step of quick_rng
+		next = next*1664525u + 1013904223u;
+		return float(next >> 16)/65535.0f * 2.0f - 1.0f;
+	}
+
 	float operator()(int subseed,int x,int y=0, int t=0)const;
 	float operator()(SmoothType smooth,int subseed,float x,float y=0,float t=0,int loop=0)const;
 };
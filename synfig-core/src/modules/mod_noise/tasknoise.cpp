@@ -0,0 +1,396 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tasknoise.cpp
+**	\brief Rendering task of the "Noise Gradient" layer
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <synfig/rendering/software/function/blend.h>
+
+#include "tasknoise.h"
+
+#endif
+
+using namespace synfig;
+using namespace modules;
+using namespace mod_noise;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+
+//! the same value as in random_noise.cpp, to get the same cosine interpolation
+const double noise_pi = 3.1415927;
+
+//! size of the lookup table of the gradient
+const int gradient_table_size = 4096;
+
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+inline float spline_p(float x)
+	{ return x > 0 ? x*x*x : 0.0f; }
+
+//! cubic B-spline, the same as R(x) in random_noise.cpp
+inline float spline_r(float x)
+	{ return ( spline_p(x+2) - 4.0f*spline_p(x+1) + 6.0f*spline_p(x) - 4.0f*spline_p(x-1) )*(1.0f/6.0f); }
+
+//! Calculates lattice cells and weights of lattice points for coordinates \a src
+//! multiplied by \a scale. Weight of point with index k is stored at weights[k*count + i].
+//! Interpolation kernels are taken from RandomNoise::operator().
+//! \param reverse kernel of spline is evaluated at (f - k) instead of (k - f)
+//! \param first receives offset of the first lattice point from the cell
+//! \return count of lattice points per pixel
+int fill_axis(
+	RandomNoise::SmoothType smooth,
+	const float *src,
+	float scale,
+	int *cells,
+	float *weights,
+	int count,
+	bool reverse,
+	int &first )
+{
+	float *w0 = weights;
+	float *w1 = w0 + count;
+	float *w2 = w1 + count;
+	float *w3 = w2 + count;
+	float sign;
+
+	for(int i = 0; i < count; ++i)
+		cells[i] = (int)std::floor(src[i]*scale);
+
+	switch(smooth) {
+	case RandomNoise::SMOOTH_CUBIC:
+		first = -1;
+		for(int i = 0; i < count; ++i) {
+			float d = src[i]*scale - cells[i];
+			w0[i] = 0.5f*d*(d*(d*(-1.f) + 2.f) - 1.f);
+			w1[i] = 0.5f*(d*(d*(3.f*d - 5.f)) + 2.f);
+			w2[i] = 0.5f*d*(d*(-3.f*d + 4.f) + 1.f);
+			w3[i] = 0.5f*d*d*(d-1.f);
+		}
+		return 4;
+	case RandomNoise::SMOOTH_SPLINE:
+	case RandomNoise::SMOOTH_FAST_SPLINE:
+		first = -1;
+		sign = reverse ? -1.0f : 1.0f;
+		for(int i = 0; i < count; ++i) {
+			float d = src[i]*scale - cells[i];
+			w0[i] = spline_r(sign*(-1.0f - d));
+			w1[i] = spline_r(sign*( 0.0f - d));
+			w2[i] = spline_r(sign*( 1.0f - d));
+			w3[i] = spline_r(sign*( 2.0f - d));
+		}
+		return 4;
+	case RandomNoise::SMOOTH_COSINE:
+		first = 0;
+		for(int i = 0; i < count; ++i) {
+			float a = src[i]*scale - cells[i];
+			a = (1.0f - std::cos(a*noise_pi))*0.5f;
+			w0[i] = 1.0f - a;
+			w1[i] = a;
+		}
+		return 2;
+	case RandomNoise::SMOOTH_LINEAR:
+		first = 0;
+		for(int i = 0; i < count; ++i) {
+			float a = src[i]*scale - cells[i];
+			w0[i] = 1.0f - a;
+			w1[i] = a;
+		}
+		return 2;
+	default:
+		first = 0;
+		std::fill(w0, w0 + count, 1.0f);
+		return 1;
+	}
+}
+
+//! Calculates lattice points and weights along time axis, it is common for all pixels
+int fill_time(RandomNoise::SmoothType smooth, float tf, int *times, float *weights)
+{
+	int t = (int)std::floor(tf);
+	float c = tf - t;
+
+	switch(smooth) {
+	case RandomNoise::SMOOTH_CUBIC:
+		for(int k = 0; k < 4; ++k) times[k] = t + k - 1;
+		weights[0] = 0.5f*c*(c*(c*(-1.f) + 2.f) - 1.f);
+		weights[1] = 0.5f*(c*(c*(3.f*c - 5.f)) + 2.f);
+		weights[2] = 0.5f*c*(c*(-3.f*c + 4.f) + 1.f);
+		weights[3] = 0.5f*c*c*(c-1.f);
+		return 4;
+	case RandomNoise::SMOOTH_SPLINE:
+		for(int k = 0; k < 4; ++k) {
+			times[k] = t + k - 1;
+			weights[k] = spline_r((float)(k - 1) - c);
+		}
+		return 4;
+	case RandomNoise::SMOOTH_FAST_SPLINE:
+		// non-animated spline always takes zero time
+		times[0] = 0;
+		weights[0] = 1.0f;
+		return 1;
+	case RandomNoise::SMOOTH_COSINE: // time is interpolated linearly to get smooth motion
+	case RandomNoise::SMOOTH_LINEAR:
+		times[0] = t;
+		times[1] = t + 1;
+		weights[0] = 1.0f - c;
+		weights[1] = c;
+		return c == 0.0f ? 1 : 2;
+	default:
+		times[0] = t;
+		weights[0] = 1.0f;
+		return 1;
+	}
+}
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+
+//! Buffers for one row of pixels
+class TaskNoiseSW::Row
+{
+public:
+	int count;
+	int detail;
+	std::vector<int> cells_x;
+	std::vector<int> cells_y;
+	std::vector<float> weights_x;
+	std::vector<float> weights_y;
+	std::vector<float> octave;
+
+	Row(int count, int detail):
+		count(count),
+		detail(detail),
+		cells_x(count),
+		cells_y(count),
+		weights_x(4*count),
+		weights_y(4*count),
+		octave(count)
+	{ }
+};
+
+
+rendering::Task::Token TaskNoise::token(
+	DescAbstract<TaskNoise>("Noise") );
+rendering::Task::Token TaskNoiseSW::token(
+	DescReal<TaskNoiseSW, TaskNoise>("NoiseSW") );
+
+
+bool
+TaskNoise::hash_params(Hasher &hasher) const
+{
+	hasher.add(gradient.size());
+	for(Gradient::const_iterator i = gradient.begin(); i != gradient.end(); ++i) {
+		hasher.add(i->pos);
+		hasher.add(i->color);
+	}
+	hasher.add(seed);
+	hasher.add(size);
+	hasher.add((int)smooth);
+	hasher.add(detail);
+	hasher.add(time);
+	hasher.add(turbulent);
+	hasher.add(do_alpha);
+	hasher.add(super_sample);
+	hasher.add(transformation->matrix);
+	return true;
+}
+
+
+void
+TaskNoiseSW::on_target_set_as_source()
+{
+	Task::Handle &subtask = target_subtask();
+	if ( subtask
+	  && subtask->target_surface == target_surface
+	  && !Color::is_straight(blend_method) )
+	{
+		trunc_by_bounds();
+		subtask->source_rect = source_rect;
+		subtask->target_rect = target_rect;
+	}
+}
+
+void
+TaskNoiseSW::add_octave(Row &row, float *dst, const float *x, const float *y, int subseed, float scale) const
+{
+	const int count = row.count;
+	int first_x, first_y;
+	int nx = fill_axis(smooth, x, scale, &row.cells_x.front(), &row.weights_x.front(), count, false, first_x);
+	int ny = fill_axis(smooth, y, scale, &row.cells_y.front(), &row.weights_y.front(), count, true, first_y);
+
+	int times[4];
+	float weights_t[4];
+	int nt = fill_time(smooth, (float)time, times, weights_t);
+
+	std::fill(dst, dst + count, 0.0f);
+
+	// every lattice point is a separate pass over the row,
+	// so inner loop has no branches and can be vectorized
+	const int s = seed + subseed;
+	const int *cx = &row.cells_x.front();
+	const int *cy = &row.cells_y.front();
+	for(int k = 0; k < nt; ++k) {
+		const int t = times[k];
+		const float wt = weights_t[k];
+		for(int j = 0; j < ny; ++j) {
+			const int oy = first_y + j;
+			const float *wy = &row.weights_y[j*count];
+			for(int i = 0; i < nx; ++i) {
+				const int ox = first_x + i;
+				const float *wx = &row.weights_x[i*count];
+				for(int p = 0; p < count; ++p)
+					dst[p] += RandomNoise::lattice(s, cx[p] + ox, cy[p] + oy, t)*(wx[p]*wy[p]*wt);
+			}
+		}
+	}
+}
+
+void
+TaskNoiseSW::fill_noise(Row &row, float *dst, const float *x, const float *y, int salt) const
+{
+	const int count = row.count;
+	float *octave = &row.octave.front();
+
+	std::fill(dst, dst + count, 0.0f);
+	for(int i = 0; i < row.detail; ++i) {
+		add_octave(row, octave, x, y, salt + (row.detail - i)*5, 1.0f/(float)(1 << i));
+		for(int p = 0; p < count; ++p) {
+			float a = octave[p] + dst[p]*0.5f;
+			a = a < -1.0f ? -1.0f : a > 1.0f ? 1.0f : a;
+			dst[p] = turbulent ? std::fabs(a) : a;
+		}
+	}
+
+	if (!turbulent)
+		for(int p = 0; p < count; ++p)
+			dst[p] = dst[p]*0.5f + 0.5f;
+}
+
+bool
+TaskNoiseSW::run(RunParams&) const
+{
+	if (!is_valid())
+		return true;
+
+	const RectInt &r = target_rect;
+	Vector ppu = get_pixels_per_unit();
+
+	Matrix bounds_transfromation;
+	bounds_transfromation.m00 = ppu[0];
+	bounds_transfromation.m11 = ppu[1];
+	bounds_transfromation.m20 = r.minx - ppu[0]*source_rect.minx;
+	bounds_transfromation.m21 = r.miny - ppu[1]*source_rect.miny;
+
+	Matrix matrix = bounds_transfromation * transformation->matrix;
+	Matrix inv_matrix = matrix.get_inverted();
+
+	Vector dx = inv_matrix.axis_x();
+	Vector dy = inv_matrix.axis_y();
+	Point p = inv_matrix.get_transformed( Vector((Real)r.minx, (Real)r.miny) );
+	Real pixel_size = super_sample ? 0.5*(dx.mag() + dy.mag()) : 0.0;
+
+	const int width = r.get_width();
+	Row row(width, std::max(0, std::min(30, detail)));
+	const Real k = Real(1 << row.detail);
+
+	// noise is in range [0, 1], so colors are taken from the table
+	CompiledGradient compiled_gradient(gradient);
+	std::vector<Color> table(gradient_table_size + 1);
+	for(int i = 0; i <= gradient_table_size; ++i)
+		table[i] = compiled_gradient.color(Real(i)/gradient_table_size);
+
+	std::vector<float> x(width), y(width), values(width);
+	std::vector<float> x2(pixel_size ? width : 0), y2(x2.size());
+	std::vector<float> values_x(x2.size()), values_y(x2.size());
+	std::vector<float> alpha(do_alpha ? width : 0);
+	std::vector<Color> colors(width);
+
+	LockWrite la(this);
+	if (!la)
+		return false;
+
+	synfig::Surface &surface = la->get_surface();
+	ColorReal amount = blend ? this->amount : ColorReal(1.0);
+	for(int yy = r.miny; yy < r.maxy; ++yy, p += dy) {
+		for(int i = 0; i < width; ++i) {
+			x[i] = (float)((p[0] + dx[0]*i)/size[0]*k);
+			y[i] = (float)((p[1] + dx[1]*i)/size[1]*k);
+		}
+		fill_noise(row, &values.front(), &x.front(), &y.front(), 0);
+
+		if (do_alpha)
+			fill_noise(row, &alpha.front(), &x.front(), &y.front(), 3);
+
+		if (pixel_size) {
+			for(int i = 0; i < width; ++i) {
+				x2[i] = (float)((p[0] + dx[0]*i + pixel_size)/size[0]*k);
+				y2[i] = (float)((p[1] + dx[1]*i + pixel_size)/size[1]*k);
+			}
+			fill_noise(row, &values_x.front(), &x2.front(), &y.front(), 0);
+			fill_noise(row, &values_y.front(), &x.front(), &y2.front(), 0);
+
+			for(int i = 0; i < width; ++i) {
+				Real da = std::max(values_y[i], std::max(values[i], values_x[i]))
+				        - std::min(values_y[i], std::min(values[i], values_x[i]));
+				colors[i] = compiled_gradient.average(values[i] - da, values[i] + da);
+			}
+		} else {
+			for(int i = 0; i < width; ++i) {
+				float f = values[i]*gradient_table_size + 0.5f;
+				colors[i] = table[ f > 0 ? (f < gradient_table_size ? (int)f : gradient_table_size) : 0 ];
+			}
+		}
+
+		if (do_alpha)
+			for(int i = 0; i < width; ++i)
+				colors[i].set_a(colors[i].get_a()*alpha[i]);
+
+		Color *dst = &surface[yy][r.minx];
+		if (blend)
+			software::Blend::blend_row(dst, &colors.front(), width, amount, blend_method);
+		else
+			std::copy(colors.begin(), colors.end(), dst);
+	}
+
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,123 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tasknoise.h
+**	\brief Rendering task of the "Noise Gradient" layer
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_MOD_NOISE_TASKNOISE_H
+#define __SYNFIG_MOD_NOISE_TASKNOISE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <vector>
+
+#include <synfig/color.h>
+#include <synfig/gradient.h>
+#include <synfig/vector.h>
+
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
+#include "random_noise.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace modules
+{
+namespace mod_noise
+{
+
+class TaskNoise: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskNoise> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Gradient gradient;
+	int seed;
+	Vector size;
+	RandomNoise::SmoothType smooth;
+	int detail;
+	Real time; //!< time of the noise, speed multiplied by time of the layer
+	bool turbulent;
+	bool do_alpha;
+	bool super_sample;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	TaskNoise():
+		seed(),
+		size(1.0, 1.0),
+		smooth(RandomNoise::SMOOTH_COSINE),
+		detail(4),
+		time(),
+		turbulent(false),
+		do_alpha(false),
+		super_sample(false)
+	{ }
+
+	virtual const rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+
+	virtual bool hash_params(rendering::Hasher &hasher) const;
+};
+
+
+//! Software implementation of TaskNoise, calculates noise for whole row of pixels
+//! in the loops over arrays, then takes colors from the lookup table of the gradient
+class TaskNoiseSW: public TaskNoise,
+	public rendering::TaskSW,
+	public rendering::TaskInterfaceBlendToTarget,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskNoiseSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual void on_target_set_as_source();
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	virtual bool run(RunParams&) const;
+
+private:
+	class Row;
+
+	//! Sum of the octaves of noise like in Noise::color_func(),
+	//! values are in range [0, 1], \a x and \a y are coordinates of the first octave
+	void fill_noise(Row &row, float *dst, const float *x, const float *y, int salt) const;
+	//! Adds one octave of noise interpolated between lattice points
+	void add_octave(Row &row, float *dst, const float *x, const float *y, int subseed, float scale) const;
+};
+
+} /* end namespace mod_noise */
+} /* end namespace modules */
+} /* end namespace synfig */
+
+/* === E N D =============================================================== */
+
+#endif
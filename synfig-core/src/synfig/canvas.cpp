@@ -30,6 +30,7 @@
 #	include <config.h>
 #endif
 
+#include <atomic>
 #include <cassert>
 #include <cstring>
 
@@ -304,8 +305,14 @@ Canvas::get_context_sorted(const ContextParams &params, CanvasBase &out_queue) c
 rendering::Task::Handle
 Canvas::build_rendering_task(const ContextParams &context_params) const
 {
+	ContextParams params(context_params);
+	if (params.use_task_cache) {
+		static std::atomic<int> last_pass(0);
+		params.task_cache_pass = ++last_pass;
+	}
+
 	CanvasBase sub_queue;
-	Context context = get_context_sorted(context_params, sub_queue);
+	Context context = get_context_sorted(params, sub_queue);
 	rendering::Task::Handle task = context.build_rendering_task();
 	
 	rendering::TaskPixelGamma::Handle task_gamma(new rendering::TaskPixelGamma());
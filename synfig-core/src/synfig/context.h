@@ -97,13 +97,21 @@ public:
 	Real z_range_depth;
 	//! Layers with z_Depth inside transition are partially visible
 	Real z_range_blur;
+	//! When \c true layers keep built rendering tasks and return them again
+	//! while the layer and its context are not changed.
+	//! Such tasks are shared between builds and should be cloned before rendering.
+	bool use_task_cache;
+	//! Identifies the current build, it's set by Canvas::build_rendering_task()
+	int task_cache_pass;
 
 	explicit ContextParams(bool render_excluded_contexts = false):
 	render_excluded_contexts(render_excluded_contexts),
 	z_range(false),
 	z_range_position(0.0),
 	z_range_depth(0.0),
-	z_range_blur(0.0){ }
+	z_range_blur(0.0),
+	use_task_cache(false),
+	task_cache_pass(0){ }
 };
 
 /*!	\class Context
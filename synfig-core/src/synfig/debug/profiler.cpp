@@ -0,0 +1,281 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file profiler.cpp
+**	\brief Collects timings of the rendering and saves them as trace events
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+
+#include <glib.h>
+
+#include <synfig/general.h>
+#include <synfig/localization.h>
+
+#include "profiler.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace debug;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+String
+escape(const String &s)
+{
+	String result;
+	result.reserve(s.size());
+	for(String::const_iterator i = s.begin(); i != s.end(); ++i) {
+		if (*i == '"' || *i == '\\')
+			{ result += '\\'; result += *i; }
+		else
+		if ((unsigned char)*i < 0x20)
+			result += strprintf("\\u%04x", (int)(unsigned char)*i);
+		else
+			result += *i;
+	}
+	return result;
+}
+
+struct Total {
+	long long count;
+	Profiler::Time time;
+	Profiler::Time max_time;
+	Total(): count(), time(), max_time() { }
+};
+
+bool
+total_greater(const std::pair<String, Total> &a, const std::pair<String, Total> &b)
+	{ return a.second.time > b.second.time; }
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+class Profiler::Buffer {
+public:
+	std::mutex mutex;
+	int thread_id;
+	String thread_name;
+	long long allocations; //!< changed only by own thread
+	std::vector<Event> events;
+
+	Buffer(): thread_id(), allocations() { }
+};
+
+
+std::atomic<bool> Profiler::enabled(false);
+std::atomic<int> Profiler::last_thread_id(0);
+std::atomic<long long> Profiler::allocations(0);
+std::atomic<long long> Profiler::allocated_pixels(0);
+std::mutex Profiler::mutex;
+Profiler::BufferList Profiler::buffers;
+Profiler::Time Profiler::start_time = 0;
+
+
+Profiler::Scope::Scope(const char *category, const String &name):
+	category(category),
+	begin(Profiler::now())
+{
+	if (begin) this->name = name;
+}
+
+Profiler::Scope::~Scope()
+{
+	if (begin)
+		Profiler::add_event(category, name, begin, Profiler::now(), args);
+}
+
+
+Profiler::Buffer&
+Profiler::get_buffer()
+{
+	// buffers are never deleted, so pointer stays valid while thread lives
+	static thread_local Buffer *buffer = NULL;
+	if (!buffer) {
+		Buffer *b = new Buffer();
+		b->thread_id = ++last_thread_id;
+		b->thread_name = strprintf("thread %d", b->thread_id);
+		std::lock_guard<std::mutex> lock(mutex);
+		buffers.push_back(b);
+		buffer = b;
+	}
+	return *buffer;
+}
+
+void
+Profiler::set_enabled(bool x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (x && !enabled) start_time = g_get_monotonic_time();
+	enabled = x;
+}
+
+Profiler::Time
+Profiler::now()
+	{ return enabled ? g_get_monotonic_time() : 0; }
+
+void
+Profiler::add_event(
+	const char *category,
+	const String &name,
+	Time begin,
+	Time end,
+	const ArgList &args )
+{
+	if (!enabled || !begin) return;
+	Buffer &buffer = get_buffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.events.push_back(Event());
+	Event &event = buffer.events.back();
+	event.category = category;
+	event.name = name;
+	event.begin = begin;
+	event.duration = std::max(Time(0), end - begin);
+	event.args = args;
+}
+
+void
+Profiler::add_allocation(long long pixels)
+{
+	if (!enabled) return;
+	++get_buffer().allocations;
+	++allocations;
+	allocated_pixels += pixels;
+}
+
+long long
+Profiler::get_thread_allocations()
+	{ return enabled ? get_buffer().allocations : 0; }
+
+void
+Profiler::set_thread_name(const String &name)
+{
+	Buffer &buffer = get_buffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.thread_name = name;
+}
+
+void
+Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for(BufferList::const_iterator i = buffers.begin(); i != buffers.end(); ++i) {
+		std::lock_guard<std::mutex> buffer_lock((*i)->mutex);
+		(*i)->events.clear();
+	}
+	allocations = 0;
+	allocated_pixels = 0;
+	start_time = g_get_monotonic_time();
+}
+
+bool
+Profiler::save(const String &filename)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) {
+		error(_("Cannot open profile file for writing: %s"), filename.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	fprintf(f, "{\"traceEvents\":[\n");
+	bool first = true;
+	for(BufferList::const_iterator i = buffers.begin(); i != buffers.end(); ++i) {
+		const Buffer &buffer = **i;
+		std::lock_guard<std::mutex> buffer_lock((*i)->mutex);
+
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", buffer.thread_id, escape(buffer.thread_name).c_str() );
+		first = false;
+
+		for(std::vector<Event>::const_iterator j = buffer.events.begin(); j != buffer.events.end(); ++j) {
+			fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d",
+				escape(j->name).c_str(), j->category, j->begin - start_time, j->duration, buffer.thread_id );
+			if (!j->args.empty()) {
+				fprintf(f, ",\"args\":{");
+				for(ArgList::const_iterator k = j->args.begin(); k != j->args.end(); ++k)
+					fprintf(f, "%s\"%s\":%lld", k == j->args.begin() ? "" : ",", k->first, k->second);
+				fprintf(f, "}");
+			}
+			fprintf(f, "}");
+		}
+	}
+	fprintf(f, "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"surface_allocations\":\"%lld\",\"allocated_pixels\":\"%lld\"}}\n",
+		(long long)allocations, (long long)allocated_pixels );
+
+	bool success = !ferror(f);
+	if (fclose(f) != 0) success = false;
+	if (!success)
+		error(_("Cannot write profile file: %s"), filename.c_str());
+	return success;
+}
+
+String
+Profiler::get_summary()
+{
+	std::map<String, Total> totals;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(BufferList::const_iterator i = buffers.begin(); i != buffers.end(); ++i) {
+			std::lock_guard<std::mutex> buffer_lock((*i)->mutex);
+			for(std::vector<Event>::const_iterator j = (*i)->events.begin(); j != (*i)->events.end(); ++j) {
+				// frames have own names, so group them by category
+				Total &t = totals[ strcmp(j->category, "task") == 0 ? j->name : String(j->category) ];
+				++t.count;
+				t.time += j->duration;
+				t.max_time = std::max(t.max_time, j->duration);
+			}
+		}
+	}
+
+	std::vector< std::pair<String, Total> > sorted(totals.begin(), totals.end());
+	std::sort(sorted.begin(), sorted.end(), total_greater);
+
+	String text = strprintf("%-32s %8s %12s %12s\n", "name", "count", "total, s", "max, s");
+	for(std::vector< std::pair<String, Total> >::const_iterator i = sorted.begin(); i != sorted.end(); ++i)
+		text += strprintf("%-32s %8lld %12.6f %12.6f\n",
+			i->first.c_str(),
+			i->second.count,
+			(double)i->second.time*0.000001,
+			(double)i->second.max_time*0.000001 );
+	text += strprintf("surface allocations: %lld (%lld pixels)\n",
+		(long long)allocations, (long long)allocated_pixels );
+	return text;
+}
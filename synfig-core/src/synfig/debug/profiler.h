@@ -0,0 +1,139 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file profiler.h
+**	\brief Collects timings of the rendering and saves them as trace events
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_DEBUG_PROFILER_H
+#define __SYNFIG_DEBUG_PROFILER_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <atomic>
+#include <mutex>
+
+#include <synfig/string.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+namespace debug {
+
+/*!	\class Profiler
+**	\brief Collects timings of the rendering in Chrome trace-event format.
+**
+**	Profiler is disabled by default and costs one atomic check per call then.
+**	Every thread writes events into own buffer, so threads are not
+**	serialized by a global lock like in debug::Measure. Buffers are merged
+**	when the trace is saved, the result can be loaded into chrome://tracing
+**	or any other viewer of the trace-event format.
+*/
+class Profiler {
+public:
+	typedef long long Time; //!< microseconds
+	typedef std::pair<const char*, long long> Arg;
+	typedef std::vector<Arg> ArgList;
+
+	struct Event {
+		const char *category;
+		String name;
+		Time begin;
+		Time duration;
+		ArgList args;
+		Event(): category(), begin(), duration() { }
+	};
+
+	//! Measures the time of own life, and adds event when destroyed
+	class Scope {
+	private:
+		const char *category;
+		String name;
+		Time begin;
+		ArgList args;
+
+		Scope(const Scope&): category(), begin() { }
+		Scope& operator= (const Scope&) { return *this; }
+
+	public:
+		Scope(const char *category, const String &name);
+		~Scope();
+		void add_arg(const char *name, long long value)
+			{ if (begin) args.push_back(Arg(name, value)); }
+	};
+
+private:
+	class Buffer;
+	typedef std::list<Buffer*> BufferList;
+
+	static std::atomic<bool> enabled;
+	static std::atomic<int> last_thread_id;
+	static std::atomic<long long> allocations;
+	static std::atomic<long long> allocated_pixels;
+	static std::mutex mutex;
+	static BufferList buffers;
+	static Time start_time;
+
+	static Buffer& get_buffer();
+
+public:
+	static bool is_enabled() { return enabled; }
+	static void set_enabled(bool x);
+
+	//! current time, zero if profiler is disabled
+	static Time now();
+
+	static void add_event(
+		const char *category,
+		const String &name,
+		Time begin,
+		Time end,
+		const ArgList &args = ArgList() );
+
+	//! should be called for each allocated surface
+	static void add_allocation(long long pixels);
+	//! count of allocations made by the current thread
+	static long long get_thread_allocations();
+
+	//! name of the current thread in the trace
+	static void set_thread_name(const String &name);
+
+	//! removes all collected events
+	static void clear();
+
+	//! writes collected events into file in JSON format
+	static bool save(const String &filename);
+
+	//! human-readable totals for each event name
+	static String get_summary();
+};
+
+}; // END of namespace debug
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
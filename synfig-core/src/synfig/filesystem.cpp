@@ -96,6 +96,13 @@ FileSystem::WriteStream::overflow(int character)
 	return character != EOF && sizeof(c) == internal_write(&c, sizeof(c)) ? character : EOF;
 }
 
+std::streamsize
+FileSystem::WriteStream::xsputn(const char *s, std::streamsize n)
+{
+	// stream is not buffered, so pass whole block at once
+	return n > 0 ? (std::streamsize)internal_write(s, (size_t)n) : 0;
+}
+
 // Identifier
 
 FileSystem::ReadStream::Handle FileSystem::Identifier::get_read_stream() const
@@ -101,15 +101,14 @@ namespace synfig
 		protected:
 			WriteStream(FileSystem::Handle file_system);
 	        virtual int overflow(int ch);
+	        virtual std::streamsize xsputn(const char *s, std::streamsize n);
 			virtual size_t internal_write(const void *buffer, size_t size) = 0;
 
 		public:
-			bool write_block(const void *buffer, size_t size)
+			size_t write_block(const void *buffer, size_t size)
 			{
-				for(size_t i = 0; i < size; i++)
-					if (!put(((const char*)buffer)[i]).good())
-						return i;
-				return size;
+				std::streamsize written = sputn((const char*)buffer, (std::streamsize)size);
+				return written > 0 ? (size_t)written : 0;
 			}
 			bool write_whole_block(const void *buffer, size_t size)
 				{ return size == write_block(buffer, size); }
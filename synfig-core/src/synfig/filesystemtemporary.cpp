@@ -523,7 +523,7 @@ FileSystemTemporary::save_temporary() const
 		  + get_temporary_filename_base() );
 	if (!stream) return false;
 
-	stream = new ZWriteStream(stream);
+	stream = new ZWriteStream(stream, zstreambuf::fast_option_compression_level);
 	try
 	{
 		document.write_to_stream_formatted(*stream, "UTF-8");
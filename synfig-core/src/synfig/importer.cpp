@@ -36,6 +36,7 @@
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <mutex>
 
 #include <glibmm.h>
 
@@ -44,6 +45,7 @@
 
 #include "canvas.h"
 #include "importer.h"
+#include "importercache.h"
 #include "string.h"
 #include "surface.h"
 
@@ -63,6 +65,8 @@ using namespace synfig;
 Importer::Book* synfig::Importer::book_;
 
 static map<FileSystem::Identifier,Importer::LooseHandle> *__open_importers;
+// importers may be created and destroyed while prefetching in other threads
+static std::mutex __open_importers_mutex;
 
 /* === P R O C E D U R E S ================================================= */
 
@@ -73,14 +77,23 @@ Importer::subsys_init()
 {
 	book_=new Book();
 	__open_importers=new map<FileSystem::Identifier,Importer::LooseHandle>();
+
+	// memory limit of decoded frames kept for reuse, in megabytes
+	if (const char *s = getenv("SYNFIG_IMPORTER_CACHE_MEMORY"))
+		ImporterCache::get_instance().set_memory_limit((size_t)std::max(0ll, atoll(s))*1024*1024);
 	return true;
 }
 
 bool
 Importer::subsys_stop()
 {
+	ImporterCache::get_instance().clear();
 	delete book_;
-	delete __open_importers;
+	{
+		std::lock_guard<std::mutex> lock(__open_importers_mutex);
+		delete __open_importers;
+		__open_importers = NULL;
+	}
 	return true;
 }
 
@@ -103,11 +116,29 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 
 	// If we already have an importer open under that filename,
 	// then use it instead.
-	if(__open_importers->count(identifier))
 	{
-		//synfig::info("Found importer already open, using it...");
-		return (*__open_importers)[identifier];
+		std::lock_guard<std::mutex> lock(__open_importers_mutex);
+		if(__open_importers->count(identifier))
+		{
+			//synfig::info("Found importer already open, using it...");
+			return (*__open_importers)[identifier];
+		}
+	}
+
+	Importer::Handle importer = open_private(identifier);
+	if (importer)
+	{
+		std::lock_guard<std::mutex> lock(__open_importers_mutex);
+		(*__open_importers)[identifier]=importer;
 	}
+	return importer;
+}
+
+Importer::Handle
+Importer::open_private(const FileSystem::Identifier &identifier)
+{
+	if(identifier.filename.empty())
+		return 0;
 
 	if(filename_extension(identifier.filename) == "")
 	{
@@ -127,10 +158,7 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 	}
 
 	try {
-		Importer::Handle importer;
-		importer=Importer::book()[ext].factory(identifier);
-		(*__open_importers)[identifier]=importer;
-		return importer;
+		return Importer::Handle(Importer::book()[ext].factory(identifier));
 	}
 	catch (const String& str)
 	{
@@ -141,6 +169,7 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 
 void Importer::forget(const FileSystem::Identifier &identifier)
 {
+	std::lock_guard<std::mutex> lock(__open_importers_mutex);
 	__open_importers->erase(identifier);
 }
 
@@ -153,6 +182,8 @@ Importer::Importer(const FileSystem::Identifier &identifier):
 Importer::~Importer()
 {
 	// Remove ourselves from the open importer list
+	std::lock_guard<std::mutex> lock(__open_importers_mutex);
+	if (!__open_importers) return;
 	map<FileSystem::Identifier,Importer::LooseHandle>::iterator iter;
 	for(iter=__open_importers->begin();iter!=__open_importers->end();)
 		if(iter->second==this)
@@ -165,6 +196,14 @@ Importer::get_frame(const RendDesc & /* renddesc */, const Time &time)
 	if (last_surface_ && last_surface_->is_exists() && !is_animated())
 		return last_surface_;
 
+	ImporterCache &cache = ImporterCache::get_instance();
+	ImporterCache::Key key(
+		identifier,
+		ImporterCache::get_file_time(identifier),
+		is_animated() ? time : Time() );
+	if (rendering::Surface::Handle surface = cache.get(key))
+		return last_surface_ = surface;
+
 	Surface surface;
 	bool trimmed = false;
 	unsigned int width = 0, height = 0, top = 0, left = 0;
@@ -177,8 +216,10 @@ Importer::get_frame(const RendDesc & /* renddesc */, const Time &time)
 	else
 		last_surface_ = new rendering::SurfaceSW();
 
-	if (surface.is_valid())
+	if (surface.is_valid()) {
 		last_surface_->assign(surface[0], surface.get_w(), surface.get_h());
+		cache.put(key, last_surface_);
+	}
 
 	return last_surface_;
 }
@@ -184,6 +184,9 @@ public:
 
 	//! Attempts to open \a filename, and returns a handle to the associated Importer
 	static Handle open(const FileSystem::Identifier &identifier, bool force=false);
+	//! Creates new importer which is not shared with other open() calls,
+	//! so it may be used in another thread
+	static Handle open_private(const FileSystem::Identifier &identifier);
 	static void forget(const FileSystem::Identifier &identifier);
 };
 
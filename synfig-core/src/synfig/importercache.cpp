@@ -0,0 +1,197 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file importercache.cpp
+**	\brief Cache of decoded frames shared by all importers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <glibmm.h>
+#include <glib/gstdio.h>
+
+#include "color.h"
+#include "importer.h"
+#include "importercache.h"
+#include "renddesc.h"
+#include "threadpool.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+ImporterCache::ImporterCache(size_t memory_limit):
+	memory_limit(memory_limit), memory(), hits(), misses(), prefetches() { }
+
+ImporterCache::~ImporterCache()
+	{ clear(); }
+
+ImporterCache&
+ImporterCache::get_instance()
+{
+	// never destroyed, prefetching may still run while static objects destruct
+	static ImporterCache *cache = new ImporterCache(256*1024*1024);
+	return *cache;
+}
+
+long long
+ImporterCache::get_file_time(const FileSystem::Identifier &identifier)
+{
+	if (!identifier.file_system)
+		return 0;
+	String uri = identifier.file_system->get_real_uri(identifier.filename);
+	if (uri.empty())
+		return 0;
+	try {
+		GStatBuf buf;
+		if (g_stat(Glib::filename_from_uri(uri).c_str(), &buf) == 0)
+			return (long long)buf.st_mtime;
+	} catch (...) { }
+	return 0;
+}
+
+size_t
+ImporterCache::get_surface_size(const rendering::Surface::Handle &surface)
+{
+	return surface && surface->is_exists()
+	     ? sizeof(Color)*(size_t)surface->get_width()*(size_t)surface->get_height()
+	     : 0;
+}
+
+void
+ImporterCache::erase(Map::iterator i)
+{
+	memory -= i->second.size;
+	lru.erase(i->second.lru_position);
+	entries.erase(i);
+}
+
+void
+ImporterCache::shrink(size_t limit)
+{
+	while(memory > limit && !lru.empty())
+		erase(entries.find(lru.front()));
+}
+
+rendering::Surface::Handle
+ImporterCache::get(const Key &key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Map::iterator i = entries.find(key);
+	if (i == entries.end()) {
+		++misses;
+		return rendering::Surface::Handle();
+	}
+	++hits;
+	lru.splice(lru.end(), lru, i->second.lru_position);
+	return i->second.surface;
+}
+
+void
+ImporterCache::put(const Key &key, const rendering::Surface::Handle &surface)
+{
+	size_t size = get_surface_size(surface);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Map::iterator i = entries.find(key);
+	if (i != entries.end())
+		erase(i);
+	if (!size || size > memory_limit)
+		return;
+
+	shrink(memory_limit - size);
+	Entry &entry = entries[key];
+	entry.surface = surface;
+	entry.size = size;
+	entry.lru_position = lru.insert(lru.end(), key);
+	memory += size;
+}
+
+void
+ImporterCache::load(Key key)
+{
+	// importer is not shared, so decoding does not interfere with other threads,
+	// Importer::get_frame() puts the result into the cache
+	if (Importer::Handle importer = Importer::open_private(key.identifier))
+		importer->get_frame(RendDesc(), key.time);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	prefetching.erase(key);
+}
+
+void
+ImporterCache::prefetch(const FileSystem::Identifier &identifier)
+{
+	Key key(identifier, get_file_time(identifier), Time());
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!memory_limit || entries.count(key) || prefetching.count(key))
+			return;
+		prefetching.insert(key);
+	}
+	++prefetches;
+	ThreadPool::instance().enqueue(
+		sigc::bind(sigc::mem_fun(*this, &ImporterCache::load), key),
+		ThreadPool::PRIORITY_BACKGROUND );
+}
+
+void
+ImporterCache::set_memory_limit(size_t x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	memory_limit = x;
+	shrink(memory_limit);
+}
+
+size_t
+ImporterCache::get_memory_limit() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory_limit;
+}
+
+size_t
+ImporterCache::get_memory() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory;
+}
+
+void
+ImporterCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	shrink(0);
+}
+
+/* === E N T R Y P O I N T ================================================= */
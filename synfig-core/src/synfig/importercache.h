@@ -0,0 +1,148 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file importercache.h
+**	\brief Cache of decoded frames shared by all importers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_IMPORTERCACHE_H
+#define __SYNFIG_IMPORTERCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstddef>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "filesystem.h"
+#include "time.h"
+
+#include <synfig/rendering/surface.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+/*!	\class ImporterCache
+**	\brief Keeps decoded frames of imported files while they fit the memory limit.
+**
+**	Frames are identified by file, modification time of the file and
+**	time of the frame (zero for static images), so changed files are
+**	decoded again. Least recently used frames are released first.
+**	Frames may be decoded in advance by prefetch() in the thread pool.
+*/
+class ImporterCache
+{
+public:
+	struct Key
+	{
+		FileSystem::Identifier identifier;
+		long long file_time;
+		Time time;
+
+		Key(): file_time() { }
+		Key(const FileSystem::Identifier &identifier, long long file_time, const Time &time):
+			identifier(identifier), file_time(file_time), time(time) { }
+
+		bool operator< (const Key &other) const
+		{
+			if (identifier < other.identifier) return true;
+			if (other.identifier < identifier) return false;
+			if (file_time < other.file_time) return true;
+			if (other.file_time < file_time) return false;
+			// exact comparison, Time::operator< uses epsilon
+			return (Time::value_type)time < (Time::value_type)other.time;
+		}
+	};
+
+private:
+	typedef std::list<Key> KeyList;
+
+	struct Entry
+	{
+		rendering::Surface::Handle surface;
+		size_t size;
+		KeyList::iterator lru_position;
+		Entry(): size() { }
+	};
+
+	typedef std::map<Key, Entry> Map;
+
+	mutable std::mutex mutex;
+	size_t memory_limit;
+	size_t memory;
+	Map entries;
+	KeyList lru; //!< least recently used keys go first
+	std::set<Key> prefetching;
+
+	std::atomic<long long> hits;
+	std::atomic<long long> misses;
+	std::atomic<long long> prefetches;
+
+	void shrink(size_t limit);
+	void erase(Map::iterator i);
+	void load(Key key);
+
+	ImporterCache(const ImporterCache&): memory_limit(), memory(), hits(), misses(), prefetches() { }
+	ImporterCache& operator= (const ImporterCache&) { return *this; }
+
+public:
+	explicit ImporterCache(size_t memory_limit = 0);
+	~ImporterCache();
+
+	//! cache shared by all importers
+	static ImporterCache& get_instance();
+
+	//! returns modification time of file, or zero if file system can't tell it
+	static long long get_file_time(const FileSystem::Identifier &identifier);
+	//! estimated memory used by decoded frame
+	static size_t get_surface_size(const rendering::Surface::Handle &surface);
+
+	//! returns cached frame or empty handle, counts hits and misses
+	rendering::Surface::Handle get(const Key &key);
+	void put(const Key &key, const rendering::Surface::Handle &surface);
+
+	//! decodes static image in the thread pool, if it is not cached yet
+	void prefetch(const FileSystem::Identifier &identifier);
+
+	//! zero limit disables the cache
+	void set_memory_limit(size_t x);
+	size_t get_memory_limit() const;
+	size_t get_memory() const;
+
+	long long get_hits() const { return hits; }
+	long long get_misses() const { return misses; }
+	long long get_prefetches() const { return prefetches; }
+	void reset_counters() { hits = 0; misses = 0; prefetches = 0; }
+
+	void clear();
+};
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -167,7 +167,8 @@ Layer::Layer():
 	exclude_from_rendering_(false),
 	param_z_depth(Real(0.0f)),
 	time_mark(Time::end()),
-	outline_grow_mark(0.0)
+	outline_grow_mark(0.0),
+	rendering_task_dirty(true)
 {
 	_layer_counter.counter++;
 	SET_INTERPOLATION_DEFAULTS();
@@ -386,6 +387,7 @@ Layer::on_changed()
 		printf("%s:%d Layer::on_changed()\n", __FILE__, __LINE__);
 
 	clear_time_mark();
+	rendering_task_dirty = true;
 	Node::on_changed();
 }
 
@@ -931,7 +933,40 @@ Layer::build_rendering_task_vfunc(Context context)const
 rendering::Task::Handle
 Layer::build_rendering_task(Context context)const
 {
-	return build_rendering_task_vfunc(context);
+	const ContextParams &params = context.get_params();
+	if (!params.use_task_cache)
+		return build_rendering_task_vfunc(context);
+
+	// changes of layer come through on_changed(), also from children and sub-canvases,
+	// changes under the layer are seen as different task of the context
+	RenderingTaskCache &cache = rendering_task_cache;
+	Real visibility = Context::z_depth_visibility(params, *this);
+	const Layer *next = (*context).get();
+	bool same = !rendering_task_dirty
+			 && cache.task
+			 && cache.next == next
+			 && cache.time.is_equal(get_time_mark())
+			 && approximate_equal(cache.outline_grow, get_outline_grow_mark())
+			 && approximate_equal(cache.visibility, visibility)
+			 && cache.render_excluded_contexts == params.render_excluded_contexts;
+
+	// context already checked in this pass
+	if (same && cache.pass == params.task_cache_pass)
+		return cache.task;
+
+	rendering::Task::Handle sub_task = context.build_rendering_task();
+	if (!same || cache.sub_task != sub_task) {
+		cache.task = build_rendering_task_vfunc(context);
+		cache.sub_task = sub_task;
+		cache.next = next;
+		cache.time = get_time_mark();
+		cache.outline_grow = get_outline_grow_mark();
+		cache.visibility = visibility;
+		cache.render_excluded_contexts = params.render_excluded_contexts;
+		rendering_task_dirty = false;
+	}
+	cache.pass = params.task_cache_pass;
+	return cache.task;
 }
 
 String
@@ -1064,7 +1099,7 @@ void Layer::on_file_changed(const RefPtr<Gio::File> &/*file*/, const RefPtr<Gio:
 		set_param("filename", ValueBase("")); // first clear filename to force image reload
 		Importer::forget(get_canvas()->get_file_system()->get_identifier(monitored_path)); // clear file in list of loaded files
 		set_param("filename", ValueBase(monitored_path));
-		get_canvas()->signal_changed()();
+		changed(); // marks rendering task of layer and parents as dirty and notifies canvas
 	}
 }
 
@@ -308,6 +308,26 @@ private:
 	mutable Time time_mark;
 	mutable Real outline_grow_mark;
 
+	//! Task made by previous build and the state of layer and context for it,
+	//! see build_rendering_task() and ContextParams::use_task_cache
+	struct RenderingTaskCache {
+		rendering::Task::Handle task;
+		rendering::Task::Handle sub_task; //!< task of the context under the layer
+		const Layer *next;                //!< first layer of the context
+		Time time;
+		Real outline_grow;
+		Real visibility;
+		bool render_excluded_contexts;
+		int pass;
+
+		RenderingTaskCache():
+			next(), outline_grow(), visibility(), render_excluded_contexts(), pass() { }
+	};
+	mutable RenderingTaskCache rendering_task_cache;
+
+	//! Set when the layer or any of its children is changed
+	mutable bool rendering_task_dirty;
+
 	//! Contains the name of the group that this layer belongs to
 	String group_;
 
@@ -623,6 +643,8 @@ public:
 	//! Returns rendering task for context
 	/*!	\param context		Context iterator referring to next Layer.
 	**	\return \c null on failure
+	**	When ContextParams::use_task_cache is set, the task of previous build is
+	**	returned if the layer was not changed and task of the context is the same.
 	**	\see Context::build_rendering_task()
 	*/
 	rendering::Task::Handle build_rendering_task(Context context)const;
@@ -30,6 +30,8 @@
 #	include <config.h>
 #endif
 
+#include <vector>
+
 #include "layer_duplicate.h"
 
 #include <synfig/general.h>
@@ -64,6 +66,41 @@ SYNFIG_LAYER_SET_CATEGORY(Layer_Duplicate,N_("Other"));
 SYNFIG_LAYER_SET_VERSION(Layer_Duplicate,"0.1");
 SYNFIG_LAYER_SET_CVS_ID(Layer_Duplicate,"$Id$");
 
+/* === P R O C E D U R E S ================================================= */
+
+static rendering::Task::Handle
+create_blend(
+	const rendering::Task::Handle &a,
+	const rendering::Task::Handle &b,
+	ColorReal amount,
+	Color::BlendMethod blend_method )
+{
+	rendering::TaskBlend::Handle task_blend(new rendering::TaskBlend());
+	task_blend->amount = amount;
+	task_blend->blend_method = blend_method;
+	task_blend->sub_task_a() = a;
+	task_blend->sub_task_b() = b;
+	return task_blend;
+}
+
+//! amount is applied to each copy, so nodes of the tree blend with amount 1.0
+static rendering::Task::Handle
+build_blend_tree(
+	std::vector<rendering::Task::Handle>::const_iterator begin,
+	std::vector<rendering::Task::Handle>::const_iterator end,
+	ColorReal amount,
+	Color::BlendMethod blend_method )
+{
+	if (end - begin == 1)
+		return create_blend(rendering::Task::Handle(), *begin, amount, blend_method);
+	std::vector<rendering::Task::Handle>::const_iterator middle = begin + (end - begin)/2;
+	return create_blend(
+		build_blend_tree(begin, middle, amount, blend_method),
+		build_blend_tree(middle, end, amount, blend_method),
+		1.0,
+		blend_method );
+}
+
 /* === M E M B E R S ======================================================= */
 
 Layer_Duplicate::Layer_Duplicate():
@@ -267,22 +304,46 @@ Layer_Duplicate::build_rendering_task_vfunc(Context context) const
 	ColorReal amount = get_amount() * Context::z_depth_visibility(context.get_params(), *this);
 	Color::BlendMethod blend_method = get_blend_method();
 
-	rendering::Task::Handle task;
+	// when nothing except this layer reads the index, all copies are equal
+	// and context should be evaluated only once
+	bool shared = duplicate_param->parent_set.size() == 1
+	           && duplicate_param->parent_set.count(const_cast<Layer_Duplicate*>(this));
 
-	std::lock_guard<std::mutex> lock(mutex);
-	duplicate_param->reset_index(time_cur);
-	do
-	{
-		context.set_time(time_cur, true);
+	// index changes parameters of layers without a change of their time marks,
+	// so cached tasks of these layers cannot be reused between copies
+	ContextParams copy_params(context.get_params());
+	if (!shared)
+		copy_params.use_task_cache = false;
+	Context copy_context(context, copy_params);
 
-		rendering::TaskBlend::Handle task_blend(new rendering::TaskBlend());
-		task_blend->amount = amount;
-		task_blend->blend_method = blend_method;
-		task_blend->sub_task_a() = task;
-		task_blend->sub_task_b() = context.build_rendering_task();
-		task = task_blend;
+	std::vector<rendering::Task::Handle> copies;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		duplicate_param->reset_index(time_cur);
+		do
+		{
+			if (shared && !copies.empty()) {
+				copies.push_back(copies.front() ? copies.front()->clone_recursive() : rendering::Task::Handle());
+				continue;
+			}
+			copy_context.set_time(time_cur, true);
+			copies.push_back(copy_context.build_rendering_task());
+		}
+		while (duplicate_param->step(time_cur));
 	}
-	while (duplicate_param->step(time_cur));
 
+	// associative blending lets to build balanced tree instead of chain,
+	// so copies may be blended in parallel
+	bool balanced = ((1 << blend_method) & Color::BLEND_METHODS_ASSOCIATIVE)
+	             && ( approximate_equal_lp(amount, ColorReal(1.0))
+	               || blend_method == Color::BLEND_COMPOSITE
+	               || blend_method == Color::BLEND_BEHIND );
+
+	if (balanced)
+		return build_blend_tree(copies.begin(), copies.end(), amount, blend_method);
+
+	rendering::Task::Handle task;
+	for(std::vector<rendering::Task::Handle>::const_iterator i = copies.begin(); i != copies.end(); ++i)
+		task = create_blend(task, *i, amount, blend_method);
 	return task;
 }
@@ -38,6 +38,7 @@
 #include <synfig/localization.h>
 
 #include "filesystemnative.h"
+#include "importercache.h"
 #include <synfig/rendering/software/surfacesw.h>
 
 
@@ -52,6 +53,7 @@ using namespace synfig;
 /* === M A C R O S ========================================================= */
 
 #define LIST_IMPORTER_CACHE_SIZE	20
+#define LIST_IMPORTER_PREFETCH_SIZE	4
 
 /* === G L O B A L S ======================================================= */
 
@@ -193,6 +195,12 @@ ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCall
 		frame_cache.pop_front();
 	frame_cache.push_back(importer);
 
+	// decode next frames in background, they are likely to be requested soon
+	for(int i = frame + 1; i <= frame + LIST_IMPORTER_PREFETCH_SIZE && i < (int)filename_list.size(); ++i)
+		if (filename_list[i] != filename)
+			ImporterCache::get_instance().prefetch(
+				FileSystem::Identifier(FileSystemNative::instance(), filename_list[i]) );
+
 	return importer;
 }
 
@@ -44,6 +44,7 @@
 #include <stdexcept>
 
 #include <libxml++/libxml++.h>
+#include <libxml/xmlreader.h>
 #include <sigc++/bind.h>
 
 #include <ETL/stringf>
@@ -121,6 +122,11 @@ std::set<FileSystem::Identifier> CanvasParser::loading_;
 
 /* === P R O C E D U R E S ================================================= */
 
+// SVN r2013 and r2014 renamed all 'pos' and 'offset' parameters to 'origin'
+// 'pos' and 'offset' will appear in old .sif files; handle them correctly
+static String fix_layer_param_name(const String &name)
+	{ return name == "pos" || name == "offset" ? String("origin") : name; }
+
 static std::map<String, Canvas::LooseHandle>* open_canvas_map_(0);
 
 std::map<synfig::String, etl::loose_handle<Canvas> >& synfig::get_open_canvas_map()
@@ -203,6 +209,150 @@ synfig::open_canvas_as(const FileSystem::Identifier &identifier,const String &as
 
 /* === M E T H O D S ======================================================= */
 
+//! Reads XML document node by node, so the whole document is never kept in memory
+class CanvasParser::StreamReader
+{
+private:
+	xmlTextReaderPtr reader;
+	String error_text;
+	//! reader was moved to the next node by skip(), and this node is not visited yet
+	bool pending;
+
+	static int read_callback(void *context, char *buffer, int len)
+		{ return (int)((FileSystem::ReadStream*)context)->read_block(buffer, len); }
+
+	static int close_callback(void * /* context */)
+		{ return 0; }
+
+	static void error_callback(void *arg, const char *msg, xmlParserSeverities severity, xmlTextReaderLocatorPtr locator)
+	{
+		StreamReader &r = *(StreamReader*)arg;
+		if ( r.error_text.empty()
+		  && ( severity == XML_PARSER_SEVERITY_ERROR
+		    || severity == XML_PARSER_SEVERITY_VALIDITY_ERROR ))
+			r.error_text = strprintf("line %d: %s", xmlTextReaderLocatorLineNumber(locator), msg);
+	}
+
+	void throw_error()
+	{
+		String text = error_text.empty() ? String(_("Invalid XML document")) : error_text;
+		throw runtime_error(text);
+	}
+
+	bool read()
+	{
+		if (pending) { pending = false; return true; }
+		int result = xmlTextReaderRead(reader);
+		if (result < 0) throw_error();
+		return result > 0;
+	}
+
+	StreamReader(const StreamReader&): reader(), pending() { }
+	StreamReader& operator= (const StreamReader&) { return *this; }
+
+public:
+	StreamReader(FileSystem::ReadStream &stream, const String &filename):
+		reader(), pending()
+	{
+		reader = xmlReaderForIO(
+			read_callback, close_callback, &stream,
+			filename.c_str(), NULL, XML_PARSE_BIG_LINES );
+		if (!reader)
+			throw runtime_error(String("  * ") + _("Can't open file") + " \"" + filename + "\"");
+		xmlTextReaderSetErrorHandler(reader, error_callback, this);
+	}
+
+	~StreamReader()
+		{ xmlFreeTextReader(reader); }
+
+	//! Moves to the next child element of element at \a depth,
+	//! returns false when the parent element ends.
+	//! Use depth -1 to find the root element.
+	bool next_child(int depth)
+	{
+		while(read())
+		{
+			int type = xmlTextReaderNodeType(reader);
+			if (type == XML_READER_TYPE_ELEMENT)
+			{
+				assert(get_depth() == depth + 1);
+				return true;
+			}
+			if (type == XML_READER_TYPE_END_ELEMENT && get_depth() <= depth)
+				return false;
+		}
+		return false;
+	}
+
+	//! Moves to the node after the current element and all its children
+	void skip()
+	{
+		int result = xmlTextReaderNext(reader);
+		if (result < 0) throw_error();
+		pending = result > 0;
+	}
+
+	int get_depth() const
+		{ return xmlTextReaderDepth(reader); }
+
+	int get_line() const
+	{
+		xmlNodePtr node = xmlTextReaderCurrentNode(reader);
+		return node ? (int)xmlGetLineNo(node) : 0;
+	}
+
+	//! Element has no closing tag, so it have no children
+	bool is_empty() const
+		{ return xmlTextReaderIsEmptyElement(reader) > 0; }
+
+	String get_name() const
+	{
+		const xmlChar *name = xmlTextReaderConstName(reader);
+		return name ? String((const char*)name) : String();
+	}
+
+	bool has_attribute(const char *name) const
+	{
+		xmlChar *value = xmlTextReaderGetAttribute(reader, (const xmlChar*)name);
+		if (!value) return false;
+		xmlFree(value);
+		return true;
+	}
+
+	//! Copies the current element without children into \a document
+	xmlpp::Element* read_element(xmlpp::Document &document)
+	{
+		xmlpp::Element *element = document.create_root_node(get_name());
+		for(int i = xmlTextReaderMoveToFirstAttribute(reader); i > 0; i = xmlTextReaderMoveToNextAttribute(reader))
+			if (!xmlTextReaderIsNamespaceDecl(reader))
+				element->set_attribute(
+					(const char*)xmlTextReaderConstName(reader),
+					(const char*)xmlTextReaderConstValue(reader) );
+		xmlTextReaderMoveToElement(reader);
+		return element;
+	}
+
+	//! Copies the current element with all its children into \a parser,
+	//! and moves to the node after it
+	xmlpp::Element* expand_element(xmlpp::DomParser &parser)
+	{
+		xmlChar *xml = xmlTextReaderReadOuterXml(reader);
+		if (!xml) throw_error();
+		try
+		{
+			parser.parse_memory_raw(xml, xmlStrlen(xml));
+		}
+		catch(...)
+		{
+			xmlFree(xml);
+			throw;
+		}
+		xmlFree(xml);
+		skip();
+		return parser.get_document()->get_root_node();
+	}
+};
+
 void
 CanvasParser::error_unexpected_element(xmlpp::Node *element,const String &got, const String &expected)
 {
@@ -218,7 +368,7 @@ CanvasParser::error_unexpected_element(xmlpp::Node *element,const String &got)
 void
 CanvasParser::warning(xmlpp::Node *element, const String &text)
 {
-	string str=strprintf("%s:<%s>:%d: ",filename.c_str(),element->get_name().c_str(),element->get_line())+text;
+	string str=strprintf("%s:<%s>:%d: ",filename.c_str(),element->get_name().c_str(),element->get_line()+line_offset_)+text;
 
 	synfig::warning(str);
 	// cerr<<str<<endl;
@@ -232,7 +382,7 @@ CanvasParser::warning(xmlpp::Node *element, const String &text)
 void
 CanvasParser::error(xmlpp::Node *element, const String &text)
 {
-	string str=strprintf("%s:<%s>:%d: error: ",filename.c_str(),element->get_name().c_str(),element->get_line())+text;
+	string str=strprintf("%s:<%s>:%d: error: ",filename.c_str(),element->get_name().c_str(),element->get_line()+line_offset_)+text;
 	total_errors_++;
 	errors_text += "  * " + str + "\n";
 	if(!allow_errors_)
@@ -244,7 +394,7 @@ CanvasParser::error(xmlpp::Node *element, const String &text)
 void
 CanvasParser::fatal_error(xmlpp::Node *element, const String &text)
 {
-	string str=strprintf("%s:<%s>:%d:",filename.c_str(),element->get_name().c_str(),element->get_line())+text;
+	string str=strprintf("%s:<%s>:%d:",filename.c_str(),element->get_name().c_str(),element->get_line()+line_offset_)+text;
 	throw runtime_error(str);
 }
 
@@ -2765,21 +2915,43 @@ CanvasParser::parse_canvas_bones(xmlpp::Element *element,Canvas::Handle canvas)
 	return bone_list;
 }
 
-Layer::Handle
-CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
+//! Layer being parsed, and state of conversion of old groups
+class CanvasParser::LayerState
 {
+public:
+	Layer::Handle layer;
+	Canvas::Handle canvas;
+	String type;
+	String version;
 
+	bool old_pastecanvas;
+	ValueNode::Handle origin_node;
+	ValueNode_Composite::Handle transformation_node;
+	ValueNode_Add::Handle offset_node;
+	ValueNode_Scale::Handle scale_scalar_node;
+	ValueNode_Exp::Handle scale_node;
+	bool origin_const, focus_const, zoom_const;
+
+	LayerState(): old_pastecanvas(), origin_const(true), focus_const(true), zoom_const(true) { }
+};
+
+bool
+CanvasParser::begin_layer(xmlpp::Element *element,Canvas::Handle canvas,LayerState &state)
+{
 	assert(element->get_name()=="layer");
-	Layer::Handle layer;
 
 	if(!element->get_attribute("type"))
 	{
 		error(element,_("Missing \"type\" attribute to \"layer\" element"));
-		return Layer::Handle();
+		return false;
 	}
-	if(element->get_attribute("type")->get_value() == "filled_rectangle")
+	state.type=element->get_attribute("type")->get_value();
+	state.canvas=canvas;
+
+	Layer::Handle &layer=state.layer;
+	if(state.type == "filled_rectangle")
 	layer=Layer::create("rectangle");
-	else layer=Layer::create(element->get_attribute("type")->get_value());
+	else layer=Layer::create(state.type);
 	layer->set_canvas(canvas);
 
 	if(element->get_attribute("group"))
@@ -2790,7 +2962,7 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 	}
 
 	// Handle the version attribute
-	String version;
+	String &version=state.version;
 	if(element->get_attribute("version"))
 	{
 		version = element->get_attribute("version")->get_value();
@@ -2812,301 +2984,315 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 
 	// Load old groups
 	etl::handle<Layer_PasteCanvas> layer_pastecanvas = etl::handle<Layer_Group>::cast_dynamic(layer);
-	bool old_pastecanvas = layer_pastecanvas && version=="0.1";
-	ValueNode::Handle origin_node;
-	ValueNode_Composite::Handle transformation_node;
-	ValueNode_Add::Handle offset_node;
-	ValueNode_Scale::Handle scale_scalar_node;
-	ValueNode_Exp::Handle scale_node;
-	bool origin_const=true, focus_const=true, zoom_const=true;
-	if (old_pastecanvas) {
-		transformation_node = ValueNode_Composite::create(ValueBase(Transformation()), canvas);
-		layer->connect_dynamic_param("transformation", ValueNode::Handle(transformation_node));
+	state.old_pastecanvas = layer_pastecanvas && version=="0.1";
+	if (state.old_pastecanvas) {
+		state.transformation_node = ValueNode_Composite::create(ValueBase(Transformation()), canvas);
+		layer->connect_dynamic_param("transformation", ValueNode::Handle(state.transformation_node));
 
-		offset_node = ValueNode_Add::create(ValueBase(Vector(0,0)));
-		transformation_node->set_link("offset", offset_node);
+		state.offset_node = ValueNode_Add::create(ValueBase(Vector(0,0)));
+		state.transformation_node->set_link("offset", state.offset_node);
 
-		origin_node = offset_node->get_link("rhs");
-		layer->connect_dynamic_param("origin", ValueNode::Handle(origin_node));
+		state.origin_node = state.offset_node->get_link("rhs");
+		layer->connect_dynamic_param("origin", ValueNode::Handle(state.origin_node));
 
-		scale_scalar_node = ValueNode_Scale::create(ValueBase(Vector(1,1)));
-		transformation_node->set_link("scale", scale_scalar_node);
+		state.scale_scalar_node = ValueNode_Scale::create(ValueBase(Vector(1,1)));
+		state.transformation_node->set_link("scale", state.scale_scalar_node);
 
-		scale_node = ValueNode_Exp::create(ValueBase(Real(1)));
-		scale_scalar_node->set_link("scalar", scale_node);
+		state.scale_node = ValueNode_Exp::create(ValueBase(Real(1)));
+		state.scale_scalar_node->set_link("scalar", state.scale_node);
 	}
 
-	xmlpp::Element::NodeList list = element->get_children();
-	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+	return true;
+}
+
+void
+CanvasParser::parse_layer_child(xmlpp::Element *child,LayerState &state)
+{
+	Layer::Handle layer=state.layer;
+	Canvas::Handle canvas=state.canvas;
+
+	if(child->get_name()=="name")
+		warning(child,_("<name> entry for <layer> is not yet supported. Ignoring..."));
+	else
+	if(child->get_name()=="desc")
+		warning(child,_("<desc> entry for <layer> is not yet supported. Ignoring..."));
+	else
+	if(child->get_name()=="param")
 	{
-		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
-		if(!child)
-			continue;
-		else
-		if(child->get_name()=="name")
-			warning(child,_("<name> entry for <layer> is not yet supported. Ignoring..."));
-		else
-		if(child->get_name()=="desc")
-			warning(child,_("<desc> entry for <layer> is not yet supported. Ignoring..."));
-		else
-		if(child->get_name()=="param")
+		xmlpp::Element::NodeList list = child->get_children();
+
+		if(!child->get_attribute("name"))
 		{
-			xmlpp::Element::NodeList list = child->get_children();
+			error(child,_("Missing \"name\" attribute for <param>."));
+			return;
+		}
 
-			if(!child->get_attribute("name"))
-			{
-				error(child,_("Missing \"name\" attribute for <param>."));
-				continue;
-			}
+		String param_name=fix_layer_param_name(child->get_attribute("name")->get_value());
 
-			String param_name=child->get_attribute("name")->get_value();
+		if(child->get_attribute("use"))
+		{
+			// If the "use" attribute is used, then the
+			// element should be empty. Warn the user if
+			// we find otherwise.
+			if(!list.empty())
+				warning(child,_("Found \"use\" attribute for <param>, but it wasn't empty. Ignoring contents..."));
 
-			// SVN r2013 and r2014 renamed all 'pos' and 'offset' parameters to 'origin'
-			// 'pos' and 'offset' will appear in old .sif files; handle them correctly
-			if (param_name == "pos" || param_name == "offset")
-				param_name = "origin";
+			String str=	child->get_attribute("use")->get_value();
 
-			if(child->get_attribute("use"))
+			if (str.empty())
+				error(child,_("Empty use=\"\" value in <param>"));
+			else if(layer->get_param(param_name).get_type()==type_canvas)
 			{
-				// If the "use" attribute is used, then the
-				// element should be empty. Warn the user if
-				// we find otherwise.
-				if(!list.empty())
-					warning(child,_("Found \"use\" attribute for <param>, but it wasn't empty. Ignoring contents..."));
-
-				String str=	child->get_attribute("use")->get_value();
+				String warnings;
+				Canvas::Handle c(canvas->surefind_canvas(str, warnings));
+				warnings_text += warnings;
+				if(!c) error(child,strprintf(_("Failed to load subcanvas '%s'"), str.c_str()));
+				if(!layer->set_param(param_name,c))
+					error(child,_("Layer rejected canvas link"));
+				//Parse the static option and sets it to the canvas ValueBase
+				ValueBase v=layer->get_param(param_name);
+				v.set_static(parse_static(child));
+				layer->set_param(param_name, v);
+			}
+			else
+			try
+			{
+				handle<ValueNode> value_node=canvas->surefind_value_node(str);
+				if(PlaceholderValueNode::Handle::cast_dynamic(value_node))
+					throw Exception::IDNotFound("parse_layer()");
 
-				if (str.empty())
-					error(child,_("Empty use=\"\" value in <param>"));
-				else if(layer->get_param(param_name).get_type()==type_canvas)
+				// Assign the value_node to the dynamic parameter list
+				if (param_name == "segment_list" && (layer->get_name() == "region" || layer->get_name() == "outline"))
 				{
-					String warnings;
-					Canvas::Handle c(canvas->surefind_canvas(str, warnings));
-					warnings_text += warnings;
-					if(!c) error((*iter),strprintf(_("Failed to load subcanvas '%s'"), str.c_str()));
-					if(!layer->set_param(param_name,c))
-						error((*iter),_("Layer rejected canvas link"));
-					//Parse the static option and sets it to the canvas ValueBase
-					ValueBase v=layer->get_param(param_name);
-					v.set_static(parse_static(child));
-					layer->set_param(param_name, v);
+					synfig::warning("%s: Updated valuenode connection to use the \"bline\" parameter instead of \"segment_list\".",
+									layer->get_name().c_str());
+					param_name = "bline";
 				}
-				else
-				try
-				{
-					handle<ValueNode> value_node=canvas->surefind_value_node(str);
-					if(PlaceholderValueNode::Handle::cast_dynamic(value_node))
-						throw Exception::IDNotFound("parse_layer()");
 
-					// Assign the value_node to the dynamic parameter list
-					if (param_name == "segment_list" && (layer->get_name() == "region" || layer->get_name() == "outline"))
+				// NB: this part of code has copy below
+				bool processed = false;
+				if (state.old_pastecanvas)
+				{
+					processed = true;
+					if (param_name == "origin")
 					{
-						synfig::warning("%s: Updated valuenode connection to use the \"bline\" parameter instead of \"segment_list\".",
-										layer->get_name().c_str());
-						param_name = "bline";
+						state.origin_const = false;
+						state.offset_node->set_link("lhs", value_node);
 					}
-
-					// NB: this part of code has copy below
-					bool processed = false;
-					if (old_pastecanvas)
+					else
+					if (param_name == "focus")
 					{
-						processed = true;
-						if (param_name == "origin")
-						{
-							origin_const = false;
-							offset_node->set_link("lhs", value_node);
-						}
-						else
-						if (param_name == "focus")
-						{
-							focus_const = false;
-							origin_node = value_node;
-							layer->connect_dynamic_param("origin_node", ValueNode::Handle(origin_node));
-							offset_node->set_link("rhs", value_node);
-						}
-						else
-						if (param_name == "zoom")
-						{
-							zoom_const = false;
-							scale_node->set_link("exp", value_node);
-						}
-						else
-							processed = false;
+						state.focus_const = false;
+						state.origin_node = value_node;
+						layer->connect_dynamic_param("origin_node", ValueNode::Handle(state.origin_node));
+						state.offset_node->set_link("rhs", value_node);
 					}
-
-					if (!processed) layer->connect_dynamic_param(param_name,value_node);
-    			}
-				catch(Exception::IDNotFound&)
-				{
-					error(child,strprintf(_("Unknown ID (%s) referenced in parameter \"%s\""),str.c_str(), param_name.c_str()));
+					else
+					if (param_name == "zoom")
+					{
+						state.zoom_const = false;
+						state.scale_node->set_link("exp", value_node);
+					}
+					else
+						processed = false;
 				}
 
-				continue;
-			}
-
-			xmlpp::Element::NodeList::iterator iter;
-
-			// Search for the first non-text XML element
-			for(iter = list.begin(); iter != list.end(); ++iter)
-				if(dynamic_cast<xmlpp::Element*>(*iter))
-					break;
-				//if(!(!dynamic_cast<xmlpp::Element*>(*iter) && (*iter)->get_name()=="text"||(*iter)->get_name()=="comment"   )) break;
-
-			if(iter==list.end())
+				if (!processed) layer->connect_dynamic_param(param_name,value_node);
+    		}
+			catch(Exception::IDNotFound&)
 			{
-				error(child,_("<param> is either missing its contents, or missing a \"use\" attribute."));
-				continue;
+				error(child,strprintf(_("Unknown ID (%s) referenced in parameter \"%s\""),str.c_str(), param_name.c_str()));
 			}
 
-			ValueBase data;
-			handle<ValueNode> value_node;
+			return;
+		}
 
-			// If we recognize the element name as a
-			// ValueBase, then treat is at one
-			if(/*(*iter)->get_name()!="canvas" && */ValueBase::ident_type((*iter)->get_name()) != type_nil && !dynamic_cast<xmlpp::Element*>(*iter)->get_attribute("guid"))
-			{
-				data=parse_value(dynamic_cast<xmlpp::Element*>(*iter),canvas);
+		xmlpp::Element::NodeList::iterator iter;
 
-				if(!data.is_valid())
-				{
-					error((*iter),_("Bad data for <param>"));
-					continue;
-				}
-			}
-			else	// ... otherwise, we assume that it is a ValueNode
-			{
-				value_node=parse_value_node(dynamic_cast<xmlpp::Element*>(*iter),canvas);
+		// Search for the first non-text XML element
+		for(iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::Element*>(*iter))
+				break;
+			//if(!(!dynamic_cast<xmlpp::Element*>(*iter) && (*iter)->get_name()=="text"||(*iter)->get_name()=="comment"   )) break;
 
-				if(!value_node)
-				{
-					error((*iter),_("Bad data for <param>"));
-					continue;
-				}
-			}
+		if(iter==list.end())
+		{
+			error(child,_("<param> is either missing its contents, or missing a \"use\" attribute."));
+			return;
+		}
 
-			// NB: this part of code has copy above
-			bool processed = false;
-			if (old_pastecanvas)
-			{
-				processed = true;
-				bool is_const = !value_node;
-				ValueNode::Handle node = value_node ? value_node : ValueNode_Const::create(data,canvas);
-				if (param_name == "origin")
-				{
-					// ice0: check here 
-					if (!is_const) origin_const = false;
-					offset_node->set_link("lhs", node);
-				}
-				else
-				if (param_name == "focus")
-				{
-					if (!is_const) focus_const = false;
-					origin_node = node;
-					layer->connect_dynamic_param("origin_node", ValueNode::Handle(origin_node));
-					offset_node->set_link("rhs", node);
-				}
-				else
-				if (param_name == "zoom")
-				{
-					if (!is_const) zoom_const = false;
-					scale_node->set_link("exp", node);
-				}
-				else
-					processed = false;
-			}
+		if(!parse_layer_param(dynamic_cast<xmlpp::Element*>(*iter),state,param_name))
+			return;
 
-			if (!processed)
-			{
-				if (value_node) {
-					// Assign the value_node to the dynamic parameter list
-					layer->connect_dynamic_param(param_name,value_node);
-				} else {
-					// Set the layer's parameter, and make sure that
-					// the layer linked it
-					if(!layer->set_param(param_name,data))
-					{
-						// TODO(ice0): Add normal version comparision function (check glib)
-						// TODO(ice0): Remove stubs after updating image files (.sif)
-						if (param_name == "loopyness" && layer->get_name() == "outline" && (layer->get_version() == "0.3")) {
-							continue;
-						}
+		// Warn if there is trash after the param value
+		for(iter++; iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::Element*>(*iter))
+				warning((*iter),strprintf(_("Unexpected element <%s> after <param> data, ignoring..."),(*iter)->get_name().c_str()));
+	}
+	else
+	{
+		printf("%s:%d\n", __FILE__, __LINE__);
+		error_unexpected_element(child,child->get_name());
+	}
+}
 
-						if (param_name == "falloff" && layer->get_name() == "circle" && (layer->get_version() == "0.2")) {
-							continue;
-						}
+bool
+CanvasParser::parse_layer_param(xmlpp::Element *element,LayerState &state,const String &param_name)
+{
+	ValueBase data;
+	handle<ValueNode> value_node;
 
-						if (param_name == "fast" && layer->get_name() == "advanced_outline" && (layer->get_version() == "0.3")) {
-							continue;
-						}
+	// If we recognize the element name as a
+	// ValueBase, then treat is at one
+	if(/*element->get_name()!="canvas" && */ValueBase::ident_type(element->get_name()) != type_nil && !element->get_attribute("guid"))
+	{
+		data=parse_value(element,state.canvas);
 
-						if (param_name == "enable_transformation" && layer->get_name() == "group" && (layer->get_version() == "0.3")) {
-							continue;
-						}
+		if(!data.is_valid())
+		{
+			error(element,_("Bad data for <param>"));
+			return false;
+		}
+	}
+	else	// ... otherwise, we assume that it is a ValueNode
+	{
+		value_node=parse_value_node(element,state.canvas);
 
+		if(!value_node)
+		{
+			error(element,_("Bad data for <param>"));
+			return false;
+		}
+	}
 
-						warning((*iter),strprintf(_("Layer '%s' rejected value for parameter '%s'"),
-												  element->get_attribute("type")->get_value().c_str(),
-												  param_name.c_str()));
-						continue;
-					}
-				}
-			}
+	return set_layer_param(element,state,param_name,data,value_node);
+}
 
-			// Warn if there is trash after the param value
-			for(iter++; iter != list.end(); ++iter)
-				if(dynamic_cast<xmlpp::Element*>(*iter))
-					warning((*iter),strprintf(_("Unexpected element <%s> after <param> data, ignoring..."),(*iter)->get_name().c_str()));
-			continue;
+bool
+CanvasParser::set_layer_param(xmlpp::Element *element,LayerState &state,const String &param_name,const ValueBase &data,const etl::handle<ValueNode> &value_node)
+{
+	Layer::Handle layer=state.layer;
+	Canvas::Handle canvas=state.canvas;
+
+	// NB: this part of code has copy above
+	bool processed = false;
+	if (state.old_pastecanvas)
+	{
+		processed = true;
+		bool is_const = !value_node;
+		ValueNode::Handle node = value_node ? value_node : ValueNode_Const::create(data,canvas);
+		if (param_name == "origin")
+		{
+			// ice0: check here 
+			if (!is_const) state.origin_const = false;
+			state.offset_node->set_link("lhs", node);
 		}
 		else
+		if (param_name == "focus")
 		{
-			printf("%s:%d\n", __FILE__, __LINE__);
-			error_unexpected_element(child,child->get_name());
+			if (!is_const) state.focus_const = false;
+			state.origin_node = node;
+			layer->connect_dynamic_param("origin_node", ValueNode::Handle(state.origin_node));
+			state.offset_node->set_link("rhs", node);
+		}
+		else
+		if (param_name == "zoom")
+		{
+			if (!is_const) state.zoom_const = false;
+			state.scale_node->set_link("exp", node);
+		}
+		else
+			processed = false;
+	}
+
+	if (!processed)
+	{
+		if (value_node) {
+			// Assign the value_node to the dynamic parameter list
+			layer->connect_dynamic_param(param_name,value_node);
+		} else {
+			// Set the layer's parameter, and make sure that
+			// the layer linked it
+			if(!layer->set_param(param_name,data))
+			{
+				// TODO(ice0): Add normal version comparision function (check glib)
+				// TODO(ice0): Remove stubs after updating image files (.sif)
+				if (param_name == "loopyness" && layer->get_name() == "outline" && (layer->get_version() == "0.3")) {
+					return false;
+				}
+
+				if (param_name == "falloff" && layer->get_name() == "circle" && (layer->get_version() == "0.2")) {
+					return false;
+				}
+
+				if (param_name == "fast" && layer->get_name() == "advanced_outline" && (layer->get_version() == "0.3")) {
+					return false;
+				}
+
+				if (param_name == "enable_transformation" && layer->get_name() == "group" && (layer->get_version() == "0.3")) {
+					return false;
+				}
+
+
+				warning(element,strprintf(_("Layer '%s' rejected value for parameter '%s'"),
+										  state.type.c_str(),
+										  param_name.c_str()));
+				return false;
+			}
 		}
 	}
 
+	return true;
+}
+
+Layer::Handle
+CanvasParser::end_layer(xmlpp::Element *element,LayerState &state)
+{
+	Layer::Handle layer=state.layer;
+	Canvas::Handle canvas=state.canvas;
+
 	// Simplify old pastecanvas conversion
-	if (old_pastecanvas) {
-		bool focus_zero = focus_const && (*origin_node)(0).get(Vector()) == Vector(0,0);
-		bool zoom_zero = zoom_const && (*scale_node->get_link("exp"))(0).get(Real()) == 0;
-		if (origin_const && focus_const && zoom_const)
-		{
-			ValueBase origin = (*origin_node)(0);
-			transformation_node->set_link("offset", ValueNode_Const::create((*offset_node)(0), canvas));
-			transformation_node->set_link("scale", ValueNode_Const::create((*scale_scalar_node)(0), canvas));
+	if (state.old_pastecanvas) {
+		bool focus_zero = state.focus_const && (*state.origin_node)(0).get(Vector()) == Vector(0,0);
+		bool zoom_zero = state.zoom_const && (*state.scale_node->get_link("exp"))(0).get(Real()) == 0;
+		if (state.origin_const && state.focus_const && state.zoom_const)
+		{
+			ValueBase origin = (*state.origin_node)(0);
+			state.transformation_node->set_link("offset", ValueNode_Const::create((*state.offset_node)(0), canvas));
+			state.transformation_node->set_link("scale", ValueNode_Const::create((*state.scale_scalar_node)(0), canvas));
 			layer->disconnect_dynamic_param("origin");
 			layer->set_param("origin", origin);
 		} else {
-			if (origin_const && focus_const)
+			if (state.origin_const && state.focus_const)
 			{
-				ValueBase origin = (*origin_node)(0);
+				ValueBase origin = (*state.origin_node)(0);
 				layer->disconnect_dynamic_param("origin");
 				layer->set_param("origin", origin);
-				transformation_node->set_link("offset", ValueNode_Const::create((*offset_node)(0), canvas));
+				state.transformation_node->set_link("offset", ValueNode_Const::create((*state.offset_node)(0), canvas));
 			} else
 			if (focus_zero)
 			{
 				layer->disconnect_dynamic_param("origin");
-				transformation_node->set_link("offset", offset_node->get_link("lhs"));
+				state.transformation_node->set_link("offset", state.offset_node->get_link("lhs"));
 			}
 			else
-			if (focus_const)
+			if (state.focus_const)
 			{
-				ValueBase origin = (*origin_node)(0);
+				ValueBase origin = (*state.origin_node)(0);
 				layer->disconnect_dynamic_param("origin");
 				layer->set_param("origin", origin);
 			}
 
 			if (zoom_zero)
-				transformation_node->set_link("scale", ValueNode_Const::create(ValueBase(Vector(1,1)), canvas));
+				state.transformation_node->set_link("scale", ValueNode_Const::create(ValueBase(Vector(1,1)), canvas));
 			else
-			if (zoom_const)
-				transformation_node->set_link("scale", ValueNode_Const::create((*scale_scalar_node)(0), canvas));
+			if (state.zoom_const)
+				state.transformation_node->set_link("scale", ValueNode_Const::create((*state.scale_scalar_node)(0), canvas));
 		}
 	}
 
 	// add amplifiers for blur
-	if (layer->get_name() == "blur" && (version == "0.0" || version == "0.1" || version == "0.2"))
+	if (layer->get_name() == "blur" && (state.version == "0.0" || state.version == "0.1" || state.version == "0.2"))
 	{
 		if (layer->dynamic_param_list().count("type"))
 		{
@@ -3135,7 +3321,7 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 	}
 
 	// init blending for skeleton_deformation
-	if (layer->get_name() == "skeleton_deformation" && (version == "0.0" || version == "0.1"))
+	if (layer->get_name() == "skeleton_deformation" && (state.version == "0.0" || state.version == "0.1"))
 	{
 		layer->disconnect_dynamic_param("amount");
 		layer->disconnect_dynamic_param("blend_method");
@@ -3147,9 +3333,25 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 	return layer;
 }
 
+Layer::Handle
+CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
+{
+	LayerState state;
+	if(!begin_layer(element,canvas,state))
+		return Layer::Handle();
+
+	xmlpp::Element::NodeList list = element->get_children();
+	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+		if(xmlpp::Element *child = dynamic_cast<xmlpp::Element*>(*iter))
+			parse_layer_child(child,state);
+
+	return end_layer(element,state);
+}
+
 Canvas::Handle
-CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+CanvasParser::begin_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename,bool &loaded)
 {
+	loaded=false;
 
 	if(element->get_name()!="canvas")
 	{
@@ -3196,7 +3398,10 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	{
 		GUID guid(element->get_attribute("guid")->get_value());
 		if(guid_cast<Canvas>(guid))
+		{
+			loaded=true;
 			return guid_cast<Canvas>(guid);
+		}
 		else
 			canvas->set_guid(guid);
 	}
@@ -3317,151 +3522,149 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 
 	canvas->rend_desc().set_flags(RendDesc::PX_ASPECT|RendDesc::IM_SPAN);
 
-	list<ValueNode::Handle> bone_list;
-	xmlpp::Element::NodeList list = element->get_children();
-	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+	return canvas;
+}
+
+void
+CanvasParser::parse_canvas_child(xmlpp::Element *child,Canvas::Handle canvas)
+{
+	if(child->get_name()=="defs")
 	{
-		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
-		if(child)
+		if(canvas->is_inline())
+			error(child,_("Group canvases cannot have a <defs> section"));
+		parse_canvas_defs(child, canvas);
+	}
+	else
+	if(child->get_name()=="bones")
+	{
+		if(canvas->is_inline())
+			error(child,_("Inline canvas cannot have a <bones> section"));
+		parse_canvas_bones(child, canvas);
+	}
+	else
+	if(child->get_name()=="keyframe")
+	{
+		if(canvas->is_inline())
 		{
-			if(child->get_name()=="defs")
-			{
-				if(canvas->is_inline())
-					error(child,_("Group canvases cannot have a <defs> section"));
-				parse_canvas_defs(child, canvas);
-			}
-			else
-			if(child->get_name()=="bones")
-			{
-				if(canvas->is_inline())
-					error(child,_("Inline canvas cannot have a <bones> section"));
-				bone_list = parse_canvas_bones(child, canvas);
-			}
-			else
-			if(child->get_name()=="keyframe")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have keyframes"));
-					continue;
-				}
+			warning(child,_("Group canvases cannot have keyframes"));
+			return;
+		}
 
-				canvas->keyframe_list().add(parse_keyframe(child,canvas));
-				canvas->keyframe_list().sync();
-			}
-			else
-			if(child->get_name()=="meta")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have metadata"));
-					continue;
-				}
+		canvas->keyframe_list().add(parse_keyframe(child,canvas));
+		canvas->keyframe_list().sync();
+	}
+	else
+	if(child->get_name()=="meta")
+	{
+		if(canvas->is_inline())
+		{
+			warning(child,_("Group canvases cannot have metadata"));
+			return;
+		}
 
-				if(!child->get_attribute("name"))
-				{
-					warning(child,_("<meta> must have a name"));
-					continue;
-				}
+		if(!child->get_attribute("name"))
+		{
+			warning(child,_("<meta> must have a name"));
+			return;
+		}
 
-				if(!child->get_attribute("content"))
-				{
-					warning(child,_("<meta> must have content"));
-					continue;
-				}
-				
-				// In Synfig prior to version 1.0 we have messed decimal separator:
-				// some files use ".", but other ones use ","/
-				// Let's try to put a workaround for that.
-				std::vector<String> replacelist;
-				replacelist.push_back("background_first_color");
-				replacelist.push_back("background_second_color");
-				replacelist.push_back("background_size");
-				replacelist.push_back("grid_color");
-				replacelist.push_back("grid_size");
-				replacelist.push_back("jack_offset");
-				String content;
-				content=child->get_attribute("content")->get_value();
-				if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
-				{
-					size_t index = 0;
-					while (true) {
-					     /* Locate the substring to replace. */
-					     index = content.find(",", index);
-					     if (index == string::npos) break;
+		if(!child->get_attribute("content"))
+		{
+			warning(child,_("<meta> must have content"));
+			return;
+		}
+		
+		// In Synfig prior to version 1.0 we have messed decimal separator:
+		// some files use ".", but other ones use ","/
+		// Let's try to put a workaround for that.
+		std::vector<String> replacelist;
+		replacelist.push_back("background_first_color");
+		replacelist.push_back("background_second_color");
+		replacelist.push_back("background_size");
+		replacelist.push_back("grid_color");
+		replacelist.push_back("grid_size");
+		replacelist.push_back("jack_offset");
+		String content;
+		content=child->get_attribute("content")->get_value();
+		if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
+		{
+			size_t index = 0;
+			while (true) {
+			     /* Locate the substring to replace. */
+			     index = content.find(",", index);
+			     if (index == string::npos) break;
 
-					     /* Make the replacement. */
-					     content.replace(index, 1, ".");
+			     /* Make the replacement. */
+			     content.replace(index, 1, ".");
 
-					     /* Advance index forward so the next iteration doesn't pick it up as well. */
-					     index += 1;
-					}
-					
-				}
-				canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+			     /* Advance index forward so the next iteration doesn't pick it up as well. */
+			     index += 1;
 			}
-			else if(child->get_name()=="name")
-			{
-				xmlpp::Element::NodeList list = child->get_children();
+			
+		}
+		canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+	}
+	else if(child->get_name()=="name")
+	{
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any name, warn
-				if(list.empty())
-					warning(child,_("blank \"name\" entity"));
+		// If we don't have any name, warn
+		if(list.empty())
+			warning(child,_("blank \"name\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_name(tmp);
-			}
-			else
-			if(child->get_name()=="desc")
-			{
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_name(tmp);
+	}
+	else
+	if(child->get_name()=="desc")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"desc\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"desc\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_description(tmp);
-			}
-			else
-			if(child->get_name()=="author")
-			{
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_description(tmp);
+	}
+	else
+	if(child->get_name()=="author")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"author\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"author\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_author(tmp);
-			}
-			else
-			if(child->get_name()=="layer")
-			{
-				//if(canvas->is_inline())
-				//	canvas->push_front(parse_layer(child,canvas->parent()));
-				//else
-					canvas->push_front(parse_layer(child,canvas));
-			}
-			else
-			{
-				printf("%s:%d\n", __FILE__, __LINE__);
-				error_unexpected_element(child,child->get_name());
-			}
-		}
-//		else
-//		if((child->get_name()=="text"||child->get_name()=="comment") && child->has_child_text())
-//			continue;
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_author(tmp);
+	}
+	else
+	if(child->get_name()=="layer")
+	{
+		//if(canvas->is_inline())
+		//	canvas->push_front(parse_layer(child,canvas->parent()));
+		//else
+			canvas->push_front(parse_layer(child,canvas));
 	}
+	else
+	{
+		printf("%s:%d\n", __FILE__, __LINE__);
+		error_unexpected_element(child,child->get_name());
+	}
+}
 
+void
+CanvasParser::end_canvas(xmlpp::Element *element,Canvas::Handle canvas)
+{
 	if(canvas->value_node_list().placeholder_count())
 	{
 		String nodes;
@@ -3478,9 +3681,173 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	}
 
 	canvas->set_version(CURRENT_CANVAS_VERSION);
+}
+
+Canvas::Handle
+CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+{
+	bool loaded;
+	Canvas::Handle canvas=begin_canvas(element,parent,inline_,identifier,filename,loaded);
+	if(!canvas || loaded)
+		return canvas;
+
+	xmlpp::Element::NodeList list = element->get_children();
+	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+	{
+		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
+		if(child)
+			parse_canvas_child(child,canvas);
+//		else
+//		if((child->get_name()=="text"||child->get_name()=="comment") && child->has_child_text())
+//			continue;
+	}
+
+	end_canvas(element,canvas);
+	return canvas;
+}
+
+Canvas::Handle
+CanvasParser::parse_canvas_stream(StreamReader &reader,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+{
+	int depth=reader.get_depth();
+	int line=reader.get_line();
+	bool empty=reader.is_empty();
+	xmlpp::Document document;
+	xmlpp::Element *element=reader.read_element(document);
+
+	line_offset_=line;
+	bool loaded;
+	Canvas::Handle canvas=begin_canvas(element,parent,inline_,identifier,filename,loaded);
+	if(!canvas || loaded)
+	{
+		reader.skip();
+		return canvas;
+	}
+
+	if(!empty)
+	{
+		while(reader.next_child(depth))
+		{
+			// layers may contain whole inline canvases, so parse them element by element,
+			// other children are parsed as separate small documents
+			if(reader.get_name()=="layer")
+			{
+				canvas->push_front(parse_layer_stream(reader,canvas));
+			}
+			else
+			{
+				xmlpp::DomParser parser;
+				line_offset_=reader.get_line()-1;
+				parse_canvas_child(reader.expand_element(parser),canvas);
+			}
+		}
+	}
+
+	line_offset_=line;
+	end_canvas(element,canvas);
 	return canvas;
 }
 
+Layer::Handle
+CanvasParser::parse_layer_stream(StreamReader &reader,Canvas::Handle canvas)
+{
+	int depth=reader.get_depth();
+	int line=reader.get_line();
+	bool empty=reader.is_empty();
+	xmlpp::Document document;
+	xmlpp::Element *element=reader.read_element(document);
+
+	line_offset_=line;
+	LayerState state;
+	if(!begin_layer(element,canvas,state))
+	{
+		reader.skip();
+		return Layer::Handle();
+	}
+
+	if(!empty)
+	{
+		while(reader.next_child(depth))
+		{
+			if( reader.get_name()=="param"
+			 && reader.has_attribute("name")
+			 && !reader.has_attribute("use")
+			 && !reader.is_empty() )
+			{
+				parse_layer_param_stream(reader,state);
+			}
+			else
+			{
+				xmlpp::DomParser parser;
+				line_offset_=reader.get_line()-1;
+				parse_layer_child(reader.expand_element(parser),state);
+			}
+		}
+	}
+
+	line_offset_=line;
+	return end_layer(element,state);
+}
+
+void
+CanvasParser::parse_layer_param_stream(StreamReader &reader,LayerState &state)
+{
+	int depth=reader.get_depth();
+	int line=reader.get_line();
+	xmlpp::Document document;
+	xmlpp::Element *param=reader.read_element(document);
+	String param_name=fix_layer_param_name(param->get_attribute("name")->get_value());
+
+	bool found=false;
+	bool applied=false;
+	while(reader.next_child(depth))
+	{
+		if(found)
+		{
+			// Warn if there is trash after the param value
+			if(applied)
+			{
+				xmlpp::Document trash_document;
+				line_offset_=reader.get_line();
+				warning(reader.read_element(trash_document),strprintf(_("Unexpected element <%s> after <param> data, ignoring..."),reader.get_name().c_str()));
+			}
+			reader.skip();
+			continue;
+		}
+		found=true;
+
+		if(reader.get_name()=="canvas" && !reader.has_attribute("guid"))
+		{
+			// inline canvas, the same as parse_value() does, but element by element
+			int canvas_line=reader.get_line();
+			xmlpp::Document canvas_document;
+			xmlpp::Element *element=reader.read_element(canvas_document);
+
+			ValueBase data;
+			data.set(parse_canvas_stream(reader,state.canvas,true));
+			line_offset_=canvas_line;
+			data.set_static(parse_static(element));
+
+			if(!data.is_valid())
+				error(element,_("Bad data for <param>"));
+			else
+				applied=set_layer_param(element,state,param_name,data,ValueNode::Handle());
+		}
+		else
+		{
+			xmlpp::DomParser parser;
+			line_offset_=reader.get_line()-1;
+			applied=parse_layer_param(reader.expand_element(parser),state,param_name);
+		}
+	}
+
+	if(!found)
+	{
+		line_offset_=line;
+		error(param,_("<param> is either missing its contents, or missing a \"use\" attribute."));
+	}
+}
+
 void
 CanvasParser::register_canvas_in_map(Canvas::Handle canvas, String as)
 {
@@ -3527,31 +3894,46 @@ CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const
 			if (filename_extension(identifier.filename) == ".sifz")
 				stream = FileSystem::ReadStream::Handle(new ZReadStream(stream));
 
-			xmlpp::DomParser parser;
-			parser.parse_stream(*stream);
-			stream.reset();
-			if(parser)
+			Canvas::Handle canvas;
+			line_offset_=0;
+			if (getenv("SYNFIG_DISABLE_CANVAS_STREAMING"))
 			{
-				Canvas::Handle canvas(parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as));
-				if (!canvas) return canvas;
-				register_canvas_in_map(canvas, as);
+				// whole document in memory, useful to compare results
+				xmlpp::DomParser parser;
+				parser.parse_stream(*stream);
+				stream.reset();
+				if(!parser)
+					return Canvas::Handle();
+				canvas=parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as);
+			}
+			else
+			{
+				StreamReader reader(*stream,filename);
+				if(!reader.next_child(-1))
+					throw runtime_error(String("  * ") + _("Document is empty") + " \"" + identifier.filename + "\"");
+				canvas=parse_canvas_stream(reader,0,false,identifier,as);
+			}
+			stream.reset();
+			line_offset_=0;
 
-				const ValueNodeList& value_node_list(canvas->value_node_list());
+			if (!canvas) return canvas;
+			register_canvas_in_map(canvas, as);
 
-				again:
-				ValueNodeList::const_iterator iter;
-				for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			const ValueNodeList& value_node_list(canvas->value_node_list());
+
+			again:
+			ValueNodeList::const_iterator iter;
+			for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			{
+				ValueNode::Handle value_node(*iter);
+				if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
 				{
-					ValueNode::Handle value_node(*iter);
-					if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
-					{
-						canvas->remove_value_node(value_node, true);
-						goto again;
-					}
+					canvas->remove_value_node(value_node, true);
+					goto again;
 				}
-
-				return canvas;
 			}
+
+			return canvas;
 		} else {
 			throw runtime_error(String("  * ") + _("Can't find linked file") + " \"" + identifier.filename + "\"");
 		}
@@ -3590,6 +3972,7 @@ CanvasParser::parse_as(xmlpp::Element* node,String &errors)
 	try
 	{
 		total_warnings_=0;
+		line_offset_=0;
 		if(node)
 		{
 			Canvas::Handle canvas(parse_canvas(node,0,false,FileSystemNative::instance()->get_identifier(std::string()),""));
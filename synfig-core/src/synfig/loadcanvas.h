@@ -66,6 +66,9 @@ class CanvasParser
 	*/
 
 private:
+	class StreamReader;
+	class LayerState;
+
 	//! Maximum number of allowed warnings before fatal error is thrown
 	int max_warnings_;
 	//! Total number of warning during canvas parsing
@@ -84,6 +87,8 @@ private:
 	String warnings_text;
 	//! Seems not to be used
 	GUID guid_;
+	//! Added to line numbers of elements in messages, when document is parsed by parts
+	int line_offset_;
 
 	/*
  --	** -- C O N S T R U C T O R S ---------------------------------------------
@@ -95,7 +100,8 @@ public:
 		max_warnings_	(1000),
 		total_warnings_	(0),
 		total_errors_	(0),
-		allow_errors_	(false)
+		allow_errors_	(false),
+		line_offset_	(0)
 	{ }
 
 	/*
@@ -163,6 +169,14 @@ private:
 
 	//! Canvas Parsing Function
 	Canvas::Handle parse_canvas(xmlpp::Element *node,Canvas::Handle parent=0,bool inline_=false,const FileSystem::Identifier &identifier = FileSystemNative::instance()->get_identifier(std::string()),String path=".");
+	//! Canvas Parsing Function, reads document from stream element by element
+	Canvas::Handle parse_canvas_stream(StreamReader &reader,Canvas::Handle parent=0,bool inline_=false,const FileSystem::Identifier &identifier = FileSystemNative::instance()->get_identifier(std::string()),String path=".");
+	//! Creates canvas from attributes of element, \a loaded is set when canvas with the same guid already exists
+	Canvas::Handle begin_canvas(xmlpp::Element *node,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String path,bool &loaded);
+	//! Canvas child element (layer, defs, metadata, etc.) Parsing Function
+	void parse_canvas_child(xmlpp::Element *node,Canvas::Handle canvas);
+	//! Checks canvas after all children are parsed
+	void end_canvas(xmlpp::Element *node,Canvas::Handle canvas);
 	//! Canvas definitions Parsing Function (exported value nodes and exported canvases)
 	void parse_canvas_defs(xmlpp::Element *node,Canvas::Handle canvas);
 
@@ -170,6 +184,20 @@ private:
 
 	//! Layer Parsing Function
 	etl::handle<Layer> parse_layer(xmlpp::Element *node,Canvas::Handle canvas);
+	//! Layer Parsing Function, reads layer from stream element by element
+	etl::handle<Layer> parse_layer_stream(StreamReader &reader,Canvas::Handle canvas);
+	//! Creates layer from attributes of element
+	bool begin_layer(xmlpp::Element *node,Canvas::Handle canvas,LayerState &state);
+	//! Layer child element (param, etc.) Parsing Function
+	void parse_layer_child(xmlpp::Element *node,LayerState &state);
+	//! Layer Parameter Parsing Function, \a node is the value of parameter
+	bool parse_layer_param(xmlpp::Element *node,LayerState &state,const String &param_name);
+	//! Layer Parameter Parsing Function, reads parameter from stream
+	void parse_layer_param_stream(StreamReader &reader,LayerState &state);
+	//! Sets parsed value of layer parameter, returns false if layer rejected it
+	bool set_layer_param(xmlpp::Element *node,LayerState &state,const String &param_name,const ValueBase &data,const etl::handle<ValueNode> &value_node);
+	//! Finishes layer after all children are parsed
+	etl::handle<Layer> end_layer(xmlpp::Element *node,LayerState &state);
 	//! Generic Value Base Parsing Function
 	ValueBase parse_value(xmlpp::Element *node,Canvas::Handle canvas);
 	//! Generic Value Node Parsing Function
@@ -0,0 +1,132 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizercache.cpp
+**	\brief OptimizerCache
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "optimizercache.h"
+
+#include "../../renderer.h"
+#include "../../rendercache.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+OptimizerCache::OptimizerCache()
+{
+	category_id = CATEGORY_ID_COORDS;
+	depends_from = CATEGORY_BEGIN;
+	for_task = false;
+	for_root_task = true;
+}
+
+Task::Handle
+OptimizerCache::process(RenderCache &cache, Task::HashMap &hashes, const Task::Handle &task)
+{
+	//
+	// taskA(targetA) - static sub-tree, requested first time
+	//
+	// leaves as is, but remembers hash of taskA, requested second time:
+	//
+	// cacheA(targetA)
+	// - taskA(targetA)
+	//
+	// cacheA stores targetA into the cache when taskA is complete, next time:
+	//
+	// surfaceA(cached targetA)
+	//
+
+	if ( !task
+	  || task.type_is<TaskSurface>()
+	  || task.type_is<TaskCache>()
+	  || !task->is_valid() )
+		return task;
+
+	if (RenderCache::Key key = task->get_hash(hashes)) {
+		if (SurfaceResource::Handle surface = cache.get(key)) {
+			TaskSurface::Handle surface_task = new TaskSurface();
+			surface_task->assign_target(*task);
+			surface_task->target_surface = surface;
+			return surface_task;
+		}
+
+		// whole sub-tree will be stored
+		if (cache.request(key)) {
+			TaskCache::Handle cache_task = new TaskCache();
+			cache_task->assign_target(*task);
+			cache_task->key = key;
+			cache_task->surface = task->target_surface;
+			cache_task->sub_task() = task;
+			return cache_task;
+		}
+	}
+
+	return process_sub_tasks(cache, hashes, task);
+}
+
+Task::Handle
+OptimizerCache::process_sub_tasks(RenderCache &cache, Task::HashMap &hashes, const Task::Handle &task)
+{
+	Task::Handle new_task = task;
+	for(int i = 0; i < (int)task->sub_tasks.size(); ++i) {
+		Task::Handle sub_task = process(cache, hashes, task->sub_tasks[i]);
+		if (sub_task != task->sub_tasks[i]) {
+			if (new_task == task) new_task = task->clone();
+			new_task->sub_tasks[i] = sub_task;
+		}
+	}
+	return new_task;
+}
+
+void
+OptimizerCache::run(const RunParams& params) const
+{
+	// root task draws into the external surface, so only sub-tasks are cached
+	if (params.parent || !params.ref_task)
+		return;
+
+	RenderCache *cache = Renderer::get_cache();
+	if (!cache || !cache->is_enabled())
+		return;
+
+	// hashes of sub-trees are calculated once for whole tree
+	Task::HashMap hashes;
+	Task::Handle task = process_sub_tasks(*cache, hashes, params.ref_task);
+	if (task != params.ref_task)
+		apply(params, task);
+}
+
+/* === E N T R Y P O I N T ================================================= */
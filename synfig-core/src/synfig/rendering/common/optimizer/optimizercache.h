@@ -0,0 +1,62 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizercache.h
+**	\brief OptimizerCache Header
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_OPTIMIZERCACHE_H
+#define __SYNFIG_RENDERING_OPTIMIZERCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "../../optimizer.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+class RenderCache;
+
+//! Replaces sub-trees by surfaces rendered in previous frames (see RenderCache),
+//! and marks sub-trees which results should be stored for next frames.
+//! Runs once for the root task, so hash of each sub-tree is calculated once.
+class OptimizerCache: public Optimizer
+{
+private:
+	static Task::Handle process(RenderCache &cache, Task::HashMap &hashes, const Task::Handle &task);
+	static Task::Handle process_sub_tasks(RenderCache &cache, Task::HashMap &hashes, const Task::Handle &task);
+
+public:
+	OptimizerCache();
+	virtual void run(const RunParams &params) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
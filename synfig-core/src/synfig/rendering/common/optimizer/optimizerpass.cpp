@@ -96,6 +96,11 @@ OptimizerPass::run(const RunParams& params) const
 	if (!task || !task->is_valid())
 		{ apply(params, Task::Handle()); return; }
 
+	// surface which is not the target of this task (e.g. from RenderCache)
+	// cannot be redirected to the target, so this task stays to copy it
+	if (task.type_is<TaskSurface>() && task->target_surface != params.ref_task->target_surface)
+		return;
+
 	apply(params, replace_target(params.ref_task, task));
 }
 
@@ -29,11 +29,17 @@
 #	include <config.h>
 #endif
 
+#include <cstdlib>
+
+#include <algorithm>
+
 #include <synfig/general.h>
 #include <synfig/localization.h>
 
 #include "optimizersplit.h"
 
+#include "../task/taskpixelprocessor.h"
+
 #endif
 
 using namespace synfig;
@@ -47,43 +53,127 @@ using namespace rendering;
 
 /* === M E T H O D S ======================================================= */
 
-OptimizerSplit::OptimizerSplit()
+const int OptimizerSplit::tile_bytes = 256*1024;
+const int OptimizerSplit::min_area = 128*128;
+const int OptimizerSplit::segments_per_thread = 2;
+
+OptimizerSplit::OptimizerSplit(int max_threads):
+	max_segments(std::max(1, max_threads)*segments_per_thread)
 {
 	category_id = CATEGORY_ID_LIST;
 	depends_from = CATEGORY_SPECIALIZED;
 	for_list = true;
 }
 
-void
-OptimizerSplit::run(const RunParams &params) const
+bool
+OptimizerSplit::can_split(const Task::Handle &task)
 {
-	if (!params.list) return;
-	const int min_area = 256*256;
-	for(Task::List::iterator i = params.list->begin(); i != params.list->end(); ++i)
+	if (!task || !task->is_valid())
+		return false;
+
+	const TaskInterfaceSplit *split = task.type_pointer<TaskInterfaceSplit>();
+	if (!split || !split->is_splittable())
+		return false;
+
+	// task may read own target surface only at the same pixels which it writes,
+	// otherwise parts of task will overwrite the source of each other
+	const TaskInterfaceTargetAsSource *target_as_source = task.type_pointer<TaskInterfaceTargetAsSource>();
+	int target_index = target_as_source ? target_as_source->get_target_subtask_index() : -1;
+	bool per_pixel = task.type_is<TaskPixelProcessor>();
+	for(Task::List::const_iterator i = task->sub_tasks.begin(); i != task->sub_tasks.end(); ++i)
 	{
-		if (TaskInterfaceSplit *split = i->type_pointer<TaskInterfaceSplit>())
-		if (split->is_splittable())
+		if ( *i
+		  && (*i)->is_valid()
+		  && (*i)->target_surface == task->target_surface )
 		{
-			RectInt r = (*i)->target_rect;
-			int w = r.maxx - r.minx;
-			int h = r.maxy - r.miny;
-			int t = std::min(h/10, w*h/min_area);
-			if (t >= 2)
+			if (!per_pixel && target_index != i - task->sub_tasks.begin())
+				return false;
+			if (TaskList::calc_target_offset(*task, **i) != VectorInt::zero())
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int
+OptimizerSplit::calc_band_rows(const RectInt &rect, const VectorInt &overlap) const
+{
+	int w = rect.maxx - rect.minx;
+	int h = rect.maxy - rect.miny;
+	if (w <= 0 || h <= 0 || max_segments < 2)
+		return 0;
+
+	// band which fits into the cache
+	int rows = std::max(1, tile_bytes/(w*(int)sizeof(Color)));
+	// but band should not be too small,
+	rows = std::max(rows, (min_area + w - 1)/w);
+	// and overlapped area should be less than the band itself,
+	rows = std::max(rows, 2*std::abs(overlap[1]));
+	// and count of bands is limited
+	rows = std::max(rows, (h + max_segments - 1)/max_segments);
+
+	return rows < h ? rows : 0;
+}
+
+void
+OptimizerSplit::split(const Task::Handle &task, int band_rows, Task::List &list)
+{
+	assert(task && band_rows > 0);
+
+	// bands have equal size (differs by one row at most)
+	RectInt r = task->target_rect;
+	int h = r.maxy - r.miny;
+	int count = (h + band_rows - 1)/band_rows;
+	for(int i = 0; i < count; ++i)
+	{
+		RectInt band( r.minx, r.miny + h*i/count,
+		              r.maxx, r.miny + h*(i + 1)/count );
+
+		Task::Handle t = task->clone();
+		t->trunc_target_rect(band);
+
+		// sub-tasks which used as source at the same surface should be cut too,
+		// otherwise bands will wait for each other (see Task::allow_run_before)
+		for(Task::List::iterator j = t->sub_tasks.begin(); j != t->sub_tasks.end(); ++j)
+			if ( *j
+			  && (*j)->is_valid()
+			  && (*j)->target_surface == t->target_surface )
 			{
-				int hh = h/t;
-				int y = r.miny;
-				for(int j = 1; j < t; ++j, y += hh)
-				{
-					Task::Handle task = (*i)->clone();
-					task->trunc_target_rect( RectInt(r.minx, y, r.maxx, y + hh) );
-					i = params.list->insert(i, task);
-					++i;
-				}
-				*i = (*i)->clone();
-				(*i)->trunc_target_rect( RectInt(r.minx, y, r.maxx, r.maxy) );
-				apply(params);
+				*j = (*j)->clone();
+				(*j)->trunc_target_rect(band);
 			}
-		}
+
+		list.push_back(t);
+	}
+}
+
+void
+OptimizerSplit::run(const RunParams &params) const
+{
+	if (!params.list) return;
+
+	Task::List list;
+	list.reserve(params.list->size());
+	bool changed = false;
+	for(Task::List::const_iterator i = params.list->begin(); i != params.list->end(); ++i)
+	{
+		int rows = 0;
+		if (can_split(*i))
+			rows = calc_band_rows(
+				(*i)->target_rect,
+				i->type_pointer<TaskInterfaceSplit>()->get_split_overlap() );
+
+		if (rows > 0)
+			{ split(*i, rows, list); changed = true; }
+		else
+			list.push_back(*i);
+	}
+
+	if (changed)
+	{
+		params.list->swap(list);
+		apply(params);
 	}
 }
 
@@ -40,11 +40,37 @@ namespace synfig
 namespace rendering
 {
 
+//! OptimizerSplit cuts splittable tasks (see TaskInterfaceSplit) into horizontal bands,
+//! so one large task may be processed by several threads simultaneously.
+//! Each band covers the whole width of the task, so it's a continuous block of memory,
+//! and band size is chosen to fit into the processor cache when possible.
 class OptimizerSplit: public Optimizer
 {
 public:
-	OptimizerSplit();
+	//! preferred size of band in bytes
+	static const int tile_bytes;
+	//! minimal area of band in pixels
+	static const int min_area;
+	//! maximal count of bands per each thread
+	static const int segments_per_thread;
+
+	//! max_threads - count of threads which will process the bands
+	explicit OptimizerSplit(int max_threads = 1);
+
+	int get_max_segments() const
+		{ return max_segments; }
+
+	//! returns true when task can be divided into independent parts by target rect
+	static bool can_split(const Task::Handle &task);
+	//! calculates count of rows in each band for rect, returns zero if split is not required
+	int calc_band_rows(const RectInt &rect, const VectorInt &overlap = VectorInt::zero()) const;
+	//! cuts task into bands, bands will inserted into list
+	static void split(const Task::Handle &task, int band_rows, Task::List &list);
+
 	virtual void run(const RunParams &params) const;
+
+private:
+	int max_segments;
 };
 
 } /* end namespace rendering */
@@ -88,4 +88,12 @@ TaskBlend::calc_bounds() const
 	return bounds;
 }
 
+bool
+TaskBlend::hash_params(Hasher &hasher) const
+{
+	hasher.add(blend_method);
+	hasher.add(amount);
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
@@ -57,4 +57,29 @@ TaskContour::calc_bounds() const
          :                   contour->calc_bounds(transformation->matrix);
 }
 
+bool
+TaskContour::hash_params(Hasher &hasher) const
+{
+	if (!contour) return false;
+
+	const Contour::ChunkList &chunks = contour->get_chunks();
+	hasher.add(chunks.size());
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		hasher.add(i->type);
+		hasher.add(i->p1);
+		hasher.add(i->pp0);
+		hasher.add(i->pp1);
+	}
+	hasher.add(contour->beginning_of_unclosed());
+	hasher.add(contour->invert);
+	hasher.add(contour->antialias);
+	hasher.add(contour->winding_style);
+	hasher.add(contour->color);
+
+	hasher.add(detail);
+	hasher.add(allow_antialias);
+	hasher.add(transformation->matrix);
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
@@ -58,6 +58,7 @@ public:
 	TaskContour(): detail(1.0), allow_antialias(true) { }
 
 	virtual Rect calc_bounds() const;
+	virtual bool hash_params(Hasher &hasher) const;
 
 	virtual const Transformation::Handle get_transformation() const
 		{ return transformation.handle(); }
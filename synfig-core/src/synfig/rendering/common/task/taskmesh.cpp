@@ -64,4 +64,22 @@ TaskMesh::set_coords_sub_tasks()
 	sub_task()->set_coords(mesh->get_source_rectangle(), target_rect.get_size()*3/2);
 }
 
+bool
+TaskMesh::hash_params(Hasher &hasher) const
+{
+	if (!mesh) return false;
+
+	hasher.add(mesh->vertices.size());
+	for(Mesh::VertexList::const_iterator i = mesh->vertices.begin(); i != mesh->vertices.end(); ++i) {
+		hasher.add(i->position);
+		hasher.add(i->tex_coords);
+	}
+	hasher.add(mesh->triangles.size());
+	for(Mesh::TriangleList::const_iterator i = mesh->triangles.begin(); i != mesh->triangles.end(); ++i)
+		hasher.add(i->vertices);
+
+	hasher.add(transformation->matrix);
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
@@ -62,6 +62,7 @@ public:
 
 	virtual Rect calc_bounds() const;
 	virtual void set_coords_sub_tasks();
+	virtual bool hash_params(Hasher &hasher) const;
 };
 
 } /* end namespace rendering */
@@ -70,4 +70,20 @@ TaskPixelProcessor::get_offset() const
 	return VectorInt((int)round(offset[0]), (int)round(offset[1])) - sub_task()->target_rect.get_min();
 }
 
+bool
+TaskPixelGamma::hash_params(Hasher &hasher) const
+{
+	hasher.add(gamma.get_r());
+	hasher.add(gamma.get_g());
+	hasher.add(gamma.get_b());
+	return true;
+}
+
+bool
+TaskPixelColorMatrix::hash_params(Hasher &hasher) const
+{
+	hasher.add(matrix);
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
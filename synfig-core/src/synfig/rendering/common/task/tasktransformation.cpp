@@ -133,6 +133,14 @@ TaskTransformation::set_coords_sub_tasks()
 	trunc_to_zero();
 }
 
+bool
+TaskTransformation::hash_params(Hasher &hasher) const
+{
+	hasher.add(interpolation);
+	hasher.add(supersample);
+	return true;
+}
+
 
 int
 TaskTransformationAffine::get_pass_subtask_index() const
@@ -141,4 +149,12 @@ TaskTransformationAffine::get_pass_subtask_index() const
 		return 0;
 	return TaskTransformation::get_pass_subtask_index();
 }
+
+bool
+TaskTransformationAffine::hash_params(Hasher &hasher) const
+{
+	if (!TaskTransformation::hash_params(hasher)) return false;
+	hasher.add(transformation->matrix);
+	return true;
+}
 /* === E N T R Y P O I N T ================================================= */
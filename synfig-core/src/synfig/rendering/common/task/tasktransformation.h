@@ -83,6 +83,7 @@ public:
 
 	virtual Rect calc_bounds() const;
 	virtual void set_coords_sub_tasks();
+	virtual bool hash_params(Hasher &hasher) const;
 };
 
 
@@ -99,6 +100,7 @@ public:
 		{ return transformation.handle(); }
 
 	virtual int get_pass_subtask_index() const;
+	virtual bool hash_params(Hasher &hasher) const;
 };
 
 
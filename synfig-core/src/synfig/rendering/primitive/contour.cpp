@@ -282,6 +282,8 @@ Contour::Contour():
 	autocurve_begin(false),
 	autocurve_end(false),
 	bounds_calculated(false),
+	hash_calculated(false),
+	hash(),
 	invert(false),
 	antialias(false),
 	winding_style(WINDING_NON_ZERO)
@@ -295,6 +297,7 @@ Contour::touch_chunks()
 {
 	autocurve_end = false;
 	bounds_calculated = false;
+	hash_calculated = false;
 	intersector.reset();
 }
 
@@ -456,6 +459,8 @@ Contour::assign(const Contour &other)
 		std::lock_guard<std::mutex> lock(other.bounds_read_mutex);
 		bounds_calculated = other.bounds_calculated;
 		bounds = other.bounds;
+		hash_calculated = other.hash_calculated;
+		hash = other.hash;
 	}
 	{
 		std::lock_guard<std::mutex> lock(other.intersector_read_mutex);
@@ -593,6 +598,30 @@ Contour::get_bounds() const
 	return bounds;
 }
 
+unsigned long long
+Contour::calc_hash() const
+{
+	// FNV-1a, the same as rendering::Hasher, but only for the fields of chunks
+	unsigned long long value = 14695981039346656037ull;
+	for(ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		const Real data[] = { (Real)i->type, i->p1[0], i->p1[1], i->pp0[0], i->pp0[1], i->pp1[0], i->pp1[1] };
+		for(const unsigned char *c = (const unsigned char*)data, *end = c + sizeof(data); c < end; ++c)
+			{ value ^= *c; value *= 1099511628211ull; }
+	}
+	return value;
+}
+
+unsigned long long
+Contour::get_hash() const
+{
+	std::lock_guard<std::mutex> lock(bounds_read_mutex);
+	if (!hash_calculated) {
+		hash = calc_hash();
+		hash_calculated = true;
+	}
+	return hash;
+}
+
 void
 Contour::to_intersector(Intersector &intersector) const
 {
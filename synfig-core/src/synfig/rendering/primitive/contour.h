@@ -105,6 +105,8 @@ private:
 	mutable std::mutex bounds_read_mutex;
 	mutable bool bounds_calculated;
 	mutable Rect bounds;
+	mutable bool hash_calculated;
+	mutable unsigned long long hash;
 	
 	mutable std::mutex intersector_read_mutex;
 	mutable etl::handle<Intersector> intersector;
@@ -172,6 +174,13 @@ public:
 	//! method is thread-safe for constant contours - you must not modify a contour while this call
 	Rect get_bounds() const;
 	
+	//! hash of chunks, equal geometry gives equal hash
+	unsigned long long calc_hash() const;
+
+	//! actualize internal value of hash (if needed) and return it
+	//! method is thread-safe for constant contours - you must not modify a contour while this call
+	unsigned long long get_hash() const;
+
 	void to_intersector(Intersector &intersector) const;
 	etl::handle<Intersector> crerate_intersector() const;
 
@@ -54,6 +54,7 @@ using namespace rendering;
 
 //default constructor - 0 everything
 Polyspan::Polyspan():
+	accumulation_stride(0),
 	open_index(0),
 	cur_x(0.0),
 	cur_y(0.0),
@@ -69,18 +70,47 @@ void
 Polyspan::clear()
 {
 	covers.clear();
+	accumulated_cover.clear();
+	accumulated_area.clear();
+	accumulation_stride = 0;
 	cur_x = cur_y = close_x = close_y = 0;
 	open_index = 0;
 	current.set(0, 0, 0, 0);
 	flags = NotSorted;
 }
 
+void
+Polyspan::init(const RectInt &window, bool accumulation)
+{
+	clear();
+	this->window = window;
+	if (accumulation && window.is_valid()) {
+		// clipped lines may put cells at window.maxx
+		accumulation_stride = window.maxx - window.minx + 1;
+		size_t size = (size_t)accumulation_stride*(window.maxy - window.miny);
+		accumulated_cover.resize(size, 0.f);
+		accumulated_area.resize(size, 0.f);
+	}
+}
+
 //add the current cell, but only if there is information to add
 void
 Polyspan::addcurrent()
 {
 	if(current.cover || current.area)
 	{
+		if (is_accumulation())
+		{
+			if ( current.y >= window.miny && current.y < window.maxy
+			  && current.x >= window.minx && current.x <= window.maxx )
+			{
+				int index = (current.y - window.miny)*accumulation_stride + current.x - window.minx;
+				accumulated_cover[index] += (float)current.cover;
+				accumulated_area[index] += (float)current.area;
+			}
+			return;
+		}
+
 		if (covers.size() == covers.capacity())
 			covers.reserve(covers.size() + 1024*1024);
 		covers.push_back(current);
@@ -152,7 +182,9 @@ Polyspan::sort_marks()
 		addcurrent();
 		current.setcover(0,0);
 
-		sort(covers.begin() + open_index,covers.end());
+		//accumulated cells are already in place
+		if (!is_accumulation())
+			sort(covers.begin() + open_index,covers.end());
 		flags &= ~NotSorted;
 	}
 }
@@ -953,6 +985,7 @@ Polyspan::extract_alpha(Real area, Contour::WindingStyle winding_style) const
 RectInt
 Polyspan::calc_bounds() const
 {
+	if (is_accumulation()) return window;
 	if (covers.empty()) return RectInt(window.minx, window.miny);
 	RectInt bounds(covers.front().x, covers.front().y);
 	for(cover_array::const_iterator i = covers.begin() + 1; i != covers.end(); ++i)
@@ -90,6 +90,11 @@ private:
 	cover_array		covers;
 	PenMark			current;
 
+	//cells summed in place by rows of window, used instead of covers when not empty
+	std::vector<float> accumulated_cover;
+	std::vector<float> accumulated_area;
+	int				accumulation_stride;
+
 	int				open_index;
 
 	//ending position of last primitive
@@ -136,13 +141,23 @@ public:
 	const RectInt& get_window() const { return window; }
 	const cover_array& get_covers() const { return covers; }
 
+	//! cells are accumulated in buffer instead of the list of marks, see init()
+	bool is_accumulation() const { return !accumulated_cover.empty(); }
+	//! row of accumulated cells, it has one more cell than window width
+	const float* get_accumulated_cover(int y) const
+		{ return &accumulated_cover[(y - window.miny)*accumulation_stride]; }
+	const float* get_accumulated_area(int y) const
+		{ return &accumulated_area[(y - window.miny)*accumulation_stride]; }
+
 	bool notclosed() const
 		{ return (flags & NotClosed) || (cur_x != close_x) || (cur_y != close_y); }
 
 	//0 out all the variables involved in processing
 	void clear();
-	void init(const RectInt &window)
-		{ clear(); this->window = window; }
+	//! \param accumulation sum cells in buffer of window size instead
+	//!        of collecting them into the list of marks which should be sorted,
+	//!        it's faster for contours with many edges per pixel of window
+	void init(const RectInt &window, bool accumulation = false);
 	void init(int minx, int miny, int maxx, int maxy)
 	{
 		clear();
@@ -0,0 +1,191 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/rendercache.cpp
+**	\brief RenderCache
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+
+#include <algorithm>
+
+#include <synfig/color.h>
+
+#include "rendercache.h"
+#include "renderer.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+const size_t RenderCache::candidates_limit = 4096;
+
+
+RenderCache::RenderCache(size_t memory_limit):
+	memory_limit(memory_limit), memory() { }
+
+size_t
+RenderCache::calc_memory(const SurfaceResource::Handle &surface)
+{
+	if (!surface) return 0;
+	VectorInt size = surface->get_size();
+	return (size_t)std::max(0, size[0])*(size_t)std::max(0, size[1])*sizeof(Color);
+}
+
+void
+RenderCache::shrink(size_t limit)
+{
+	while(memory > limit && !entries_lru.empty()) {
+		Map::iterator i = entries.find(entries_lru.back());
+		assert(i != entries.end());
+		memory -= i->second.memory;
+		entries.erase(i);
+		entries_lru.pop_back();
+	}
+}
+
+void
+RenderCache::set_memory_limit(size_t x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	memory_limit = x;
+	shrink(memory_limit);
+	if (!memory_limit) {
+		candidates.clear();
+		candidates_lru.clear();
+	}
+}
+
+size_t
+RenderCache::get_memory_limit() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory_limit;
+}
+
+size_t
+RenderCache::get_memory() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory;
+}
+
+SurfaceResource::Handle
+RenderCache::get(Key key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Map::iterator i = entries.find(key);
+	if (i == entries.end())
+		return SurfaceResource::Handle();
+	entries_lru.splice(entries_lru.begin(), entries_lru, i->second.lru);
+	return i->second.surface;
+}
+
+bool
+RenderCache::request(Key key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!memory_limit)
+		return false;
+
+	CandidateMap::iterator i = candidates.find(key);
+	if (i != candidates.end()) {
+		candidates_lru.splice(candidates_lru.begin(), candidates_lru, i->second);
+		return true;
+	}
+
+	candidates_lru.push_front(key);
+	candidates[key] = candidates_lru.begin();
+	while(candidates_lru.size() > candidates_limit) {
+		candidates.erase(candidates_lru.back());
+		candidates_lru.pop_back();
+	}
+	return false;
+}
+
+void
+RenderCache::put(Key key, const SurfaceResource::Handle &surface)
+{
+	size_t surface_memory = calc_memory(surface);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!surface_memory || surface_memory > memory_limit)
+		return;
+
+	Map::iterator i = entries.find(key);
+	if (i != entries.end()) {
+		// same key means same content, just mark as used
+		entries_lru.splice(entries_lru.begin(), entries_lru, i->second.lru);
+		return;
+	}
+
+	shrink(memory_limit - surface_memory);
+
+	entries_lru.push_front(key);
+	Entry &entry = entries[key];
+	entry.surface = surface;
+	entry.memory = surface_memory;
+	entry.lru = entries_lru.begin();
+	memory += surface_memory;
+}
+
+void
+RenderCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	entries_lru.clear();
+	candidates.clear();
+	candidates_lru.clear();
+	memory = 0;
+}
+
+
+Task::Token TaskCache::token(
+	DescSpecial<TaskCache>("Cache") );
+
+bool
+TaskCache::run(RunParams & /* params */) const
+{
+	if ( key
+	  && surface
+	  && surface == target_surface
+	  && surface->is_exists() )
+		if (RenderCache *cache = Renderer::get_cache())
+			cache->put(key, surface);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,135 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/rendercache.h
+**	\brief RenderCache Header
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_RENDERCACHE_H
+#define __SYNFIG_RENDERING_RENDERCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <list>
+#include <map>
+#include <mutex>
+
+#include "task.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+/*!	\class RenderCache
+**	\brief Keeps rendered surfaces of task sub-trees between frames.
+**
+**	Surfaces are identified by Task::get_hash() and evicted in LRU order
+**	when total memory exceeds the limit. Result of the task is stored only
+**	when the same hash was requested before (see OptimizerCache),
+**	so animated sub-trees don't push static ones out of the cache.
+*/
+class RenderCache
+{
+public:
+	typedef Hasher::Value Key;
+
+private:
+	typedef std::list<Key> KeyList;
+
+	struct Entry
+	{
+		SurfaceResource::Handle surface;
+		size_t memory;
+		KeyList::iterator lru;
+		Entry(): memory() { }
+	};
+
+	typedef std::map<Key, Entry> Map;
+	typedef std::map<Key, KeyList::iterator> CandidateMap;
+
+	static const size_t candidates_limit;
+
+	mutable std::mutex mutex;
+	size_t memory_limit;
+	size_t memory;
+
+	Map entries;
+	KeyList entries_lru;          //!< most recently used first
+
+	CandidateMap candidates;
+	KeyList candidates_lru;       //!< most recently requested first
+
+	void shrink(size_t limit);
+
+public:
+	explicit RenderCache(size_t memory_limit = 0);
+
+	static size_t calc_memory(const SurfaceResource::Handle &surface);
+
+	//! zero limit disables the cache
+	void set_memory_limit(size_t x);
+	size_t get_memory_limit() const;
+	size_t get_memory() const;
+	bool is_enabled() const
+		{ return get_memory_limit() > 0; }
+
+	//! returns stored surface or null handle
+	SurfaceResource::Handle get(Key key);
+	//! remembers request of the key, returns true when key was requested before
+	bool request(Key key);
+	void put(Key key, const SurfaceResource::Handle &surface);
+	void clear();
+};
+
+
+//! Stores the result of sub-task into the RenderCache of renderer.
+//! Target of this task is the same as target of sub-task,
+//! so it does nothing but waits for sub-task completion.
+class TaskCache: public Task
+{
+public:
+	typedef etl::handle<TaskCache> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	RenderCache::Key key;
+	//! surface to store, optimizers may redirect sub-task to other target,
+	//! then sub-task draws not only own content and result will not stored
+	SurfaceResource::Handle surface;
+
+	TaskCache(): key() { }
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual bool run(RunParams &params) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -32,6 +32,8 @@
 #include <cstdlib>
 #include <climits>
 
+#include <algorithm>
+
 #include <typeinfo>
 
 #include <synfig/general.h>
@@ -40,11 +42,15 @@
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
 #include <synfig/debug/measure.h>
+#include <synfig/debug/profiler.h>
 
 #include "renderer.h"
+#include "rendercache.h"
 #include "renderqueue.h"
 
+#include "software/contourcache.h"
 #include "software/renderersw.h"
+#include "software/surfacepool.h"
 #include "software/rendererdraftsw.h"
 #include "software/rendererpreviewsw.h"
 #include "software/rendererlowressw.h"
@@ -82,6 +88,7 @@ using namespace rendering;
 Renderer::Handle Renderer::blank;
 std::map<String, Renderer::Handle> *Renderer::renderers;
 RenderQueue *Renderer::queue;
+RenderCache *Renderer::cache;
 Renderer::DebugOptions Renderer::debug_options;
 long long Renderer::last_registered_optimizer_index = 0;
 long long Renderer::last_batch_index = 0;
@@ -835,8 +842,14 @@ Renderer::enqueue(const Task::List &list, const TaskEvent::Handle &finish_event_
 		log(get_debug_options().task_list_log, list, "input list");
 
 	Task::List optimized_list(list);
-	optimize(optimized_list);
-	find_deps(optimized_list, ++last_batch_index);
+	{
+		debug::Profiler::Scope profile("optimize", "optimize");
+		long long batch_index = ++last_batch_index;
+		optimize(optimized_list);
+		find_deps(optimized_list, batch_index);
+		profile.add_arg("batch", batch_index);
+		profile.add_arg("tasks", (long long)optimized_list.size());
+	}
 
 	#ifdef DEBUG_TASK_LIST
 	if (!quiet) log("", optimized_list, "optimized list");
@@ -932,7 +945,7 @@ Renderer::log(
 				t->get_bounds().maxx, t->get_bounds().maxy )
 			  : "" )
 			+ ( t->target_surface
-              ? etl::strprintf(" source (%f, %f)-(%f, %f) target (%d, %d)-(%d, %d) surface [%s] (%dx%d) id %d",
+              ? etl::strprintf(" source (%f, %f)-(%f, %f) target (%d, %d)-(%d, %d) surface [%s] (%dx%d) id %lld",
 				t->source_rect.minx, t->source_rect.miny,
 				t->source_rect.maxx, t->source_rect.maxy,
 				t->target_rect.minx, t->target_rect.miny,
@@ -986,8 +999,22 @@ Renderer::initialize()
 	if (const char *s = getenv("SYNFIG_RENDERING_DEBUG_RESULT_IMAGE"))
 		debug_options.result_image = s;
 
+	// memory limit of cache in megabytes, zero disables the cache
+	long long cache_memory = 128;
+	if (const char *s = getenv("SYNFIG_RENDERING_CACHE_MEMORY"))
+		cache_memory = std::max(0ll, atoll(s));
+
+	// memory limit of released software surfaces kept for reuse, in megabytes
+	if (const char *s = getenv("SYNFIG_RENDERING_SURFACE_POOL_MEMORY"))
+		SurfacePool::get_instance().set_memory_limit((size_t)std::max(0ll, atoll(s))*1024*1024);
+
+	// memory limit of contours with flattened curves, in megabytes
+	if (const char *s = getenv("SYNFIG_RENDERING_CONTOUR_CACHE_MEMORY"))
+		ContourCache::get_instance().set_memory_limit((size_t)std::max(0ll, atoll(s))*1024*1024);
+
 	renderers = new std::map<String, Handle>();
 	queue = new RenderQueue();
+	cache = new RenderCache((size_t)cache_memory*1024*1024);
 
 	initialize_renderers();
 }
@@ -1005,6 +1032,11 @@ Renderer::deinitialize()
 
 	delete renderers;
 	delete queue;
+	delete cache;
+	cache = NULL;
+
+	SurfacePool::get_instance().clear();
+	ContourCache::get_instance().clear();
 }
 
 void
@@ -46,6 +46,7 @@ namespace rendering
 {
 
 class RenderQueue;
+class RenderCache;
 
 class Renderer: public etl::shared_object
 {
@@ -63,6 +64,7 @@ private:
 	static Handle blank;
 	static std::map<String, Handle> *renderers;
 	static RenderQueue *queue;
+	static RenderCache *cache;
 	static DebugOptions debug_options;
 	static long long last_registered_optimizer_index;
 	static long long last_batch_index; // TODO: atomic
@@ -180,6 +182,10 @@ public:
 	static const Renderer::Handle& get_renderer(const String &name);
 	static const std::map<String, Handle>& get_renderers();
 
+	//! surfaces of unchanged sub-trees which are shared between frames
+	static RenderCache* get_cache()
+		{ return cache; }
+
 	static const DebugOptions& get_debug_options()
 		{ return debug_options; }
 
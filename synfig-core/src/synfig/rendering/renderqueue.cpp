@@ -39,6 +39,7 @@
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
 #include <synfig/debug/measure.h>
+#include <synfig/debug/profiler.h>
 
 #include "renderqueue.h"
 #include "renderer.h"
@@ -85,7 +86,15 @@ Task::Token TaskSubQueue::token(
 } // end of anonimous namespace
 
 
-RenderQueue::RenderQueue(): started(false) { start(); }
+RenderQueue::RenderQueue():
+	ready_count(0),
+	single_ready_count(0),
+	sleeping_count(0),
+	single_sleeping_count(0),
+	next_queue(0),
+	started(false)
+	{ start(); }
+
 RenderQueue::~RenderQueue() { stop(); }
 
 void
@@ -109,12 +118,18 @@ RenderQueue::start()
 	if (count > SYNFIG_RENDERING_MAX_THREADS) count = SYNFIG_RENDERING_MAX_THREADS;
 	if (count < 2) count = 2;
 
+	// queues should be ready before threads started
+	queues.resize(count);
+	for(int i = 0; i < count; ++i)
+		queues[i] = new ThreadQueue();
+	tasks_in_process.resize(count);
+
+	started = true;
 	for(int i = 0; i < count; ++i)
 		threads.push_back(
 			Glib::Threads::Thread::create(
 				sigc::bind(sigc::mem_fun(*this, &RenderQueue::process), i) ));
 	info("rendering threads %d", count);
-	started = true;
 }
 
 void
@@ -128,11 +143,17 @@ RenderQueue::stop()
 	}
 	while(!threads.empty())
 		{ threads.front()->join(); threads.pop_front(); }
+
+	for(ThreadQueueList::iterator i = queues.begin(); i != queues.end(); ++i)
+		delete *i;
+	queues.clear();
+	tasks_in_process.clear();
 }
 
 void
 RenderQueue::process(int thread_index)
 {
+	debug::Profiler::set_thread_name(etl::strprintf("rendering thread %d", thread_index));
 	while(Task::Handle task = get(thread_index))
 	{
 		#ifdef DEBUG_THREAD_TASK
@@ -150,6 +171,9 @@ RenderQueue::process(int thread_index)
 			continue;
 		}
 
+		debug::Profiler::Time begin = debug::Profiler::now();
+		long long allocations = debug::Profiler::get_thread_allocations();
+
 		bool success = false;
 		try {
 			success = task->run(task->renderer_data.params);
@@ -157,6 +181,18 @@ RenderQueue::process(int thread_index)
 		if (!success)
 			task->renderer_data.success = false;
 
+		if (begin) {
+			debug::Profiler::ArgList args;
+			args.push_back(debug::Profiler::Arg("batch", task->renderer_data.batch_index));
+			args.push_back(debug::Profiler::Arg("index", task->renderer_data.index));
+			if (task->target_surface && task->target_rect.is_valid())
+				args.push_back(debug::Profiler::Arg("pixels",
+					(long long)task->target_rect.get_width()*task->target_rect.get_height() ));
+			args.push_back(debug::Profiler::Arg("allocations",
+				debug::Profiler::get_thread_allocations() - allocations ));
+			debug::Profiler::add_event("task", task->get_token()->name, begin, debug::Profiler::now(), args);
+		}
+
 		#ifdef DEBUG_TASK_SURFACE
 		debug::DebugSurface::save_to_file(
 			task->target_surface,
@@ -192,73 +228,146 @@ RenderQueue::process(int thread_index)
 }
 
 void
-RenderQueue::done(int thread_index, const Task::Handle &task)
+RenderQueue::push(int thread_index, const Task::Handle &task)
 {
-	assert(task);
-	int single_signals = 0;
-	int signals = 0;
-	std::lock_guard<std::mutex> lock(mutex);
-	for(Task::Set::iterator i = task->renderer_data.back_deps.begin(); i != task->renderer_data.back_deps.end(); ++i)
+	// ready tasks goes to the queue of the current thread,
+	// tasks from other threads are distributed between workers,
+	// and non-multithreading tasks always goes to the thread 0
+	bool mt = task->get_allow_multithreading();
+	int workers = (int)queues.size() - 1;
+	int index = !mt ? 0
+	          : thread_index > 0 ? thread_index
+	          : 1 + (int)(next_queue++ % (unsigned int)workers);
+
+	ThreadQueue &queue = *queues[index];
 	{
-		assert(*i);
-		(*i)->renderer_data.deps.erase(task);
-		if ((*i)->renderer_data.deps.empty())
-		{
-			bool mt = (*i)->get_allow_multithreading();
-			TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-			TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-			wait.erase(*i);
-			queue.push_back(*i);
-			++(mt ? signals : single_signals);
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+	++(mt ? ready_count : single_ready_count);
+}
+
+Task::Handle
+RenderQueue::take(int thread_index)
+{
+	if (thread_index == 0) {
+		// thread 0 runs tasks in order of arrival and never steals
+		ThreadQueue &queue = *queues[0];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			return Task::Handle();
+		Task::Handle task = queue.tasks.front();
+		queue.tasks.pop_front();
+		--single_ready_count;
+		return task;
+	}
+
+	{
+		// own queue, take the last task, it's data is probably still in cache
+		ThreadQueue &queue = *queues[thread_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			Task::Handle task = queue.tasks.back();
+			queue.tasks.pop_back();
+			--ready_count;
+			return task;
+		}
+	}
+
+	// steal the oldest task from other workers
+	int workers = (int)queues.size() - 1;
+	for(int i = 1; i < workers; ++i) {
+		ThreadQueue &queue = *queues[1 + (thread_index - 1 + i) % workers];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			Task::Handle task = queue.tasks.front();
+			queue.tasks.pop_front();
+			--ready_count;
+			return task;
 		}
 	}
-	task->renderer_data.back_deps.clear();
-	assert( tasks_in_process.count(thread_index) == 1 );
-	tasks_in_process.erase(thread_index);
-	//info("rendering threads used %d", tasks_in_process.size());
 
+	return Task::Handle();
+}
+
+void
+RenderQueue::wake_up(int thread_index, int signals, int single_signals)
+{
 	// limit signals count
 	int threads = get_threads_count() - 1;
 	if (signals > threads) signals = threads;
 	if (single_signals > 1) single_signals = 1;
 
 	// we don't need to wakeup the current thread
-	--(thread_index ? signals : single_signals);
+	if (thread_index >= 0)
+		--(thread_index ? signals : single_signals);
 
-	// wake up
-	while(signals-- > 0) cond.notify_one();
-	while(single_signals-- > 0) single_cond.notify_one();
+	if (signals > 0 && sleeping_count > 0) {
+		std::lock_guard<std::mutex> lock(mutex);
+		while(signals-- > 0) cond.notify_one();
+	}
+	if (single_signals > 0 && single_sleeping_count > 0) {
+		std::lock_guard<std::mutex> lock(mutex);
+		single_cond.notify_one();
+	}
+}
+
+void
+RenderQueue::done(int thread_index, const Task::Handle &task)
+{
+	assert(task);
+	int single_signals = 0;
+	int signals = 0;
+	{
+		// many threads may finish tasks simultaneously,
+		// so dependencies are modified only via atomic counters here
+		Glib::Threads::RWLock::ReaderLock lock(deps_lock);
+		for(Task::Set::iterator i = task->renderer_data.back_deps.begin(); i != task->renderer_data.back_deps.end(); ++i)
+		{
+			assert(*i);
+			if (--(*i)->renderer_data.deps_count == 0)
+			{
+				push(thread_index, *i);
+				++((*i)->get_allow_multithreading() ? signals : single_signals);
+			}
+		}
+		task->renderer_data.back_deps.clear();
+		task->renderer_data.deps.clear();
+	}
+	assert( tasks_in_process[thread_index] == task
+	     || TaskSubQueue::Handle::cast_dynamic(tasks_in_process[thread_index]) );
+
+	wake_up(thread_index, signals, single_signals);
 }
 
 Task::Handle
 RenderQueue::get(int thread_index)
 {
-	std::unique_lock<std::mutex> lock(mutex);
+	std::atomic<int> &count = thread_index == 0 ? single_ready_count : ready_count;
+	std::atomic<int> &sleeping = thread_index == 0 ? single_sleeping_count : sleeping_count;
+	std::condition_variable &c = thread_index == 0 ? single_cond : cond;
 
-	TaskQueue &queue  = thread_index == 0 ? single_ready_tasks     : ready_tasks;
-	TaskQueue &queue2 = thread_index != 0 ? single_ready_tasks     : ready_tasks;
-	TaskSet   &wait   = thread_index == 0 ? single_not_ready_tasks : not_ready_tasks;
+	tasks_in_process[thread_index].reset();
 	while(started)
 	{
-		if (!queue.empty())
+		if (Task::Handle task = take(thread_index))
 		{
-			Task::Handle task = queue.front();
-			queue.pop_front();
-			if (!task) continue;
-			assert( tasks_in_process.count(thread_index) == 0 );
 			tasks_in_process[thread_index] = task;
-			//info("rendering threads used %d", tasks_in_process.size());
 			return task;
 		}
 
-		#ifdef DEBUG_THREAD_WAIT
-		if (!wait.empty())
+		std::unique_lock<std::mutex> lock(mutex);
+		++sleeping;
+		if (started && count <= 0)
+		{
+			#ifdef DEBUG_THREAD_WAIT
 			info("thread %d: rendering wait for task", thread_index);
-		#endif
-
-		assert( wait.empty() || !tasks_in_process.empty() || !queue2.empty() );
-
-		(thread_index ? cond : single_cond).wait(lock);
+			#endif
+			debug::Profiler::Time begin = debug::Profiler::now();
+			c.wait(lock);
+			debug::Profiler::add_event("queue", "wait", begin, debug::Profiler::now());
+		}
+		--sleeping;
 	}
 	return Task::Handle();
 }
@@ -282,7 +391,7 @@ RenderQueue::get_threads_count() const
 bool
 RenderQueue::remove_if_orphan(const Task::Handle &task, bool in_queue)
 {
-	// mutex must be already locked
+	// deps_lock must be already locked for writing
 
 	if (!task)
 		return true;
@@ -295,6 +404,8 @@ RenderQueue::remove_if_orphan(const Task::Handle &task, bool in_queue)
 		ii = tasks->find(task);
 		if (ii == tasks->end())
 			return true;
+		if (task->renderer_data.deps_count <= 0)
+			{ tasks->erase(ii); return true; }
 	}
 
 	if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
@@ -303,7 +414,7 @@ RenderQueue::remove_if_orphan(const Task::Handle &task, bool in_queue)
 
 	if (!task->renderer_data.back_deps.empty())
 		return false;
-		
+
 	for(TaskSet::iterator i = task->renderer_data.deps.begin(); i != task->renderer_data.deps.end(); ++i)
 		if (*i) {
 			(*i)->renderer_data.back_deps.erase(task);
@@ -320,12 +431,21 @@ RenderQueue::remove_if_orphan(const Task::Handle &task, bool in_queue)
 void
 RenderQueue::remove_orphans()
 {
-	// mutex must be already locked
+	// deps_lock must be already locked for writing
 
-	for(TaskQueue::iterator i = ready_tasks.begin(); i != ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) ready_tasks.erase(i++); else ++i;
-	for(TaskQueue::iterator i = single_ready_tasks.begin(); i != single_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) single_ready_tasks.erase(i++); else ++i;
+	// forget tasks which are already moved to the ready queues
+	for(TaskSet::iterator i = not_ready_tasks.begin(); i != not_ready_tasks.end();)
+		if ((*i)->renderer_data.deps_count <= 0) not_ready_tasks.erase(i++); else ++i;
+	for(TaskSet::iterator i = single_not_ready_tasks.begin(); i != single_not_ready_tasks.end();)
+		if ((*i)->renderer_data.deps_count <= 0) single_not_ready_tasks.erase(i++); else ++i;
+
+	for(int j = 0; j < (int)queues.size(); ++j) {
+		ThreadQueue &queue = *queues[j];
+		std::atomic<int> &count = j ? ready_count : single_ready_count;
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		for(TaskQueue::iterator i = queue.tasks.begin(); i != queue.tasks.end();)
+			if (remove_if_orphan(*i, true)) i = queue.tasks.erase(i), --count; else ++i;
+	}
 
 	for(TaskSet::iterator i = not_ready_tasks.begin(); i != not_ready_tasks.end();)
 		if (remove_if_orphan(*i, true)) not_ready_tasks.erase(i++); else ++i;
@@ -339,21 +459,25 @@ RenderQueue::enqueue(const Task::Handle &task, const Task::RunParams &params)
 {
 	if (!task) return;
 	fix_task(*task, params);
-	std::lock_guard<std::mutex> lock(mutex);
 
-	bool mt = task->get_allow_multithreading();
-	TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-	TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-	if (task->renderer_data.deps.empty()) {
-		queue.push_back(task);
-		(mt ? cond : single_cond).notify_one();
-	}
-	else
+	int single_signals = 0;
+	int signals = 0;
 	{
-		wait.insert(task);
+		Glib::Threads::RWLock::WriterLock lock(deps_lock);
+
+		bool mt = task->get_allow_multithreading();
+		task->renderer_data.deps_count = (int)task->renderer_data.deps.size();
+		if (task->renderer_data.deps.empty()) {
+			push(-1, task);
+			++(mt ? signals : single_signals);
+		} else {
+			(mt ? not_ready_tasks : single_not_ready_tasks).insert(task);
+		}
+
+		remove_orphans();
 	}
 
-	remove_orphans();
+	wake_up(-1, signals, single_signals);
 }
 
 void
@@ -366,49 +490,53 @@ RenderQueue::enqueue(const Task::List &tasks, const Task::RunParams &params)
 		if (*i) { fix_task(**i, p); ++count; }
 	if (!count) return;
 
-	std::lock_guard<std::mutex> lock(mutex);
 	int single_signals = 0;
 	int signals = 0;
-	for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
 	{
-		if (*i)
+		Glib::Threads::RWLock::WriterLock lock(deps_lock);
+
+		// counters should be set before any task of batch will be pushed
+		for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
+			if (*i) (*i)->renderer_data.deps_count = (int)(*i)->renderer_data.deps.size();
+
+		for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
 		{
-			bool mt = (*i)->get_allow_multithreading();
-			TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-			TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-			if ((*i)->renderer_data.deps.empty()) {
-				queue.push_back(*i);
-				++(mt ? signals : single_signals);
-			} else {
-				wait.insert(*i);
+			if (*i)
+			{
+				bool mt = (*i)->get_allow_multithreading();
+				if ((*i)->renderer_data.deps.empty()) {
+					push(-1, *i);
+					++(mt ? signals : single_signals);
+				} else {
+					(mt ? not_ready_tasks : single_not_ready_tasks).insert(*i);
+				}
 			}
 		}
-	}
 
-	// limit signals count
-	int threads = get_threads_count() - 1;
-	if (signals > threads) signals = threads;
-	if (single_signals > 1) single_signals = 1;
-
-	// wake up
-	while(signals-- > 0) cond.notify_one();
-	while(single_signals-- > 0) single_cond.notify_one();
+		remove_orphans();
+	}
 
-	remove_orphans();
+	wake_up(-1, signals, single_signals);
 }
 
 bool
 RenderQueue::remove_task(const Task::Handle &task)
 {
+	// deps_lock must be already locked for writing
+
 	bool found = false;
 	if (task) {
 		bool mt = task->get_allow_multithreading();
-		TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-		TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-
-		for(TaskQueue::iterator i = queue.begin(); i != queue.end();)
-			if (*i == task) found = true, queue.erase(i++); else ++i;
-		if (wait.erase(task)) found = true;
+		TaskSet &wait = mt ? not_ready_tasks : single_not_ready_tasks;
+		std::atomic<int> &count = mt ? ready_count : single_ready_count;
+
+		for(int j = mt ? 1 : 0; j < (mt ? (int)queues.size() : 1); ++j) {
+			ThreadQueue &queue = *queues[j];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			for(TaskQueue::iterator i = queue.tasks.begin(); i != queue.tasks.end();)
+				if (*i == task) found = true, i = queue.tasks.erase(i), --count; else ++i;
+		}
+		if (wait.erase(task) && task->renderer_data.deps_count > 0) found = true;
 	}
 	return found;
 }
@@ -419,7 +547,7 @@ RenderQueue::cancel(const Task::Handle &task)
 	if (!task) return;
 
 	{
-		std::lock_guard<std::mutex> lock(mutex);
+		Glib::Threads::RWLock::WriterLock lock(deps_lock);
 		if (remove_task(task))
 			remove_orphans();
 	}
@@ -436,7 +564,7 @@ RenderQueue::cancel(const Task::List &list)
 	TaskEvent::List events;
 
 	{
-		std::lock_guard<std::mutex> lock(mutex);
+		Glib::Threads::RWLock::WriterLock lock(deps_lock);
 		bool found = false;
 		for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
 			if (remove_task(*i))
@@ -454,9 +582,13 @@ RenderQueue::cancel(const Task::List &list)
 void
 RenderQueue::clear()
 {
-	std::lock_guard<std::mutex> lock(mutex);
-	ready_tasks.clear();
-	single_ready_tasks.clear();
+	Glib::Threads::RWLock::WriterLock lock(deps_lock);
+	for(int j = 0; j < (int)queues.size(); ++j) {
+		ThreadQueue &queue = *queues[j];
+		std::lock_guard<std::mutex> queue_lock(queue.mutex);
+		(j ? ready_count : single_ready_count) -= (int)queue.tasks.size();
+		queue.tasks.clear();
+	}
 	not_ready_tasks.clear();
 	single_not_ready_tasks.clear();
 }
@@ -29,11 +29,15 @@
 
 #include <cstdio>
 
-#include <map>
+#include <deque>
+#include <vector>
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 
+#include <glibmm/threads.h>
+
 #include "task.h"
 
 /* === M A C R O S ========================================================= */
@@ -47,31 +51,62 @@ namespace synfig
 namespace rendering
 {
 
+/*!	\class RenderQueue
+**	\brief Runs tasks in worker threads respecting dependencies between them.
+**
+**	Every worker thread owns a queue of ready tasks. Thread takes tasks
+**	from the back of own queue and steals from the front of queues of other
+**	threads when own queue is empty. Tasks without multithreading support
+**	are always placed into the queue of thread 0 and only this thread runs them.
+**
+**	Each task counts its unfinished dependencies. Finished task decrements
+**	counters of dependent tasks and pushes the ready ones into the queue
+**	of the current thread, so the whole graph of tasks is locked
+**	exclusively only by enqueue and cancel.
+*/
 class RenderQueue
 {
 public:
 	typedef std::list<Glib::Threads::Thread*> ThreadList;
-	typedef std::map<int, Task::Handle> ThreadTaskMap;
+	typedef std::vector<Task::Handle> ThreadTaskList;
 	typedef std::set<Task::Handle> TaskSet;
-	typedef std::list<Task::Handle> TaskQueue;
+	typedef std::deque<Task::Handle> TaskQueue;
+
+	class ThreadQueue
+	{
+	public:
+		std::mutex mutex;
+		TaskQueue tasks;
+	};
+
+	typedef std::vector<ThreadQueue*> ThreadQueueList;
 
 private:
-	static int last_batch_index;
+	// locked for reading when task done,
+	// and for writing when dependencies of tasks are changed (enqueue, cancel)
+	Glib::Threads::RWLock deps_lock;
 
+	// used only to sleep and to wake up threads
 	std::mutex mutex;
-	std::mutex threads_mutex;
 	std::condition_variable cond;
 	std::condition_variable single_cond;
 
-	TaskQueue ready_tasks;
-	TaskQueue single_ready_tasks;
+	std::atomic<int> ready_count;
+	std::atomic<int> single_ready_count;
+	std::atomic<int> sleeping_count;
+	std::atomic<int> single_sleeping_count;
+	std::atomic<unsigned int> next_queue;
+
+	// may contain tasks which are already became ready,
+	// such tasks are removed in remove_orphans()
 	TaskSet not_ready_tasks;
 	TaskSet single_not_ready_tasks;
 
-	bool started;
+	std::atomic<bool> started;
 
 	ThreadList threads;
-	ThreadTaskMap tasks_in_process;
+	ThreadQueueList queues;
+	ThreadTaskList tasks_in_process;
 
 	void start();
 	void stop();
@@ -80,6 +115,10 @@ private:
 	void done(int thread_index, const Task::Handle &task);
 	Task::Handle get(int thread_index);
 
+	void push(int thread_index, const Task::Handle &task);
+	Task::Handle take(int thread_index);
+	void wake_up(int thread_index, int signals, int single_signals);
+
 	static void fix_task(const Task &task, const Task::RunParams &params);
 	bool remove_if_orphan(const Task::Handle &task, bool in_queue);
 	void remove_orphans();
@@ -0,0 +1,322 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/contourcache.cpp
+**	\brief ContourCache
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <climits>
+#include <cmath>
+
+#include <algorithm>
+
+#include "contourcache.h"
+
+#include "../task.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+// depth of subdivision, limits count of lines from the single curve
+const int max_depth = 16;
+
+Real max_edge(const Vector &p0, const Vector &p1, const Vector &p2)
+{
+	return std::max(
+		std::max(std::max(p0[0], p1[0]), p2[0]) - std::min(std::min(p0[0], p1[0]), p2[0]),
+		std::max(std::max(p0[1], p1[1]), p2[1]) - std::min(std::min(p0[1], p1[1]), p2[1]) );
+}
+
+Real max_edge(const Vector &p0, const Vector &p1, const Vector &p2, const Vector &p3)
+{
+	return std::max(
+		std::max(std::max(p0[0], p1[0]), std::max(p2[0], p3[0])) - std::min(std::min(p0[0], p1[0]), std::min(p2[0], p3[0])),
+		std::max(std::max(p0[1], p1[1]), std::max(p2[1], p3[1])) - std::min(std::min(p0[1], p1[1]), std::min(p2[1], p3[1])) );
+}
+
+// distance from curve to its chord is not bigger than the half of the distance
+// from control point to the middle of the chord
+Real conic_flatness(const Vector &p0, const Vector &p1, const Vector &p2)
+{
+	Vector d = p1 - (p0 + p2)*0.5;
+	return 0.5*std::max(fabs(d[0]), fabs(d[1]));
+}
+
+// distance from curve to its chord is not bigger than 3/4 of the distance
+// from control points to the points of chord at 1/3 and 2/3
+Real cubic_flatness(const Vector &p0, const Vector &p1, const Vector &p2, const Vector &p3)
+{
+	Vector d1 = p1 - (p0*2.0 + p3)*(1.0/3.0);
+	Vector d2 = p2 - (p0 + p3*2.0)*(1.0/3.0);
+	return 0.75*std::max(std::max(fabs(d1[0]), fabs(d1[1])), std::max(fabs(d2[0]), fabs(d2[1])));
+}
+
+void flatten_conic(
+	Contour::ChunkList &out_chunks,
+	const Vector &p0, const Vector &p1, const Vector &p2,
+	Real tolerance, int depth )
+{
+	if (depth >= max_depth || conic_flatness(p0, p1, p2) <= tolerance)
+		{ out_chunks.push_back(Contour::Chunk(Contour::LINE, p2)); return; }
+	Vector a = (p0 + p1)*0.5;
+	Vector b = (p1 + p2)*0.5;
+	Vector c = (a + b)*0.5;
+	flatten_conic(out_chunks, p0, a, c, tolerance, depth + 1);
+	flatten_conic(out_chunks, c, b, p2, tolerance, depth + 1);
+}
+
+void flatten_cubic(
+	Contour::ChunkList &out_chunks,
+	const Vector &p0, const Vector &p1, const Vector &p2, const Vector &p3,
+	Real tolerance, int depth )
+{
+	if (depth >= max_depth || cubic_flatness(p0, p1, p2, p3) <= tolerance)
+		{ out_chunks.push_back(Contour::Chunk(Contour::LINE, p3)); return; }
+	Vector a = (p0 + p1)*0.5;
+	Vector b = (p1 + p2)*0.5;
+	Vector c = (p2 + p3)*0.5;
+	Vector d = (a + b)*0.5;
+	Vector e = (b + c)*0.5;
+	Vector f = (d + e)*0.5;
+	flatten_cubic(out_chunks, p0, a, d, f, tolerance, depth + 1);
+	flatten_cubic(out_chunks, f, e, c, p3, tolerance, depth + 1);
+}
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+
+const int ContourCache::buckets_per_octave = 4;
+const Real ContourCache::max_size = 4.0;
+
+
+ContourCache::ContourCache(size_t memory_limit):
+	memory_limit(memory_limit), memory(), hits(), misses() { }
+
+ContourCache::~ContourCache()
+	{ clear(); }
+
+ContourCache&
+ContourCache::get_instance()
+{
+	// never destroyed, tasks may be still running while static objects destruct
+	static ContourCache *cache = new ContourCache(32*1024*1024);
+	return *cache;
+}
+
+int
+ContourCache::calc_scale_bucket(const Matrix &matrix)
+{
+	// the biggest singular value of the linear part
+	Real t = matrix.m00*matrix.m00 + matrix.m01*matrix.m01
+	       + matrix.m10*matrix.m10 + matrix.m11*matrix.m11;
+	Real d = matrix.m00*matrix.m11 - matrix.m01*matrix.m10;
+	Real scale = sqrt(0.5*(t + sqrt(std::max(0.0, t*t - 4.0*d*d))));
+	if (!(scale > 1e-8) || !(scale < 1e8))
+		return INT_MIN;
+	return (int)ceil(log2(scale)*buckets_per_octave - 1e-8);
+}
+
+Real
+ContourCache::get_bucket_scale(int bucket)
+	{ return exp2((Real)bucket/buckets_per_octave); }
+
+void
+ContourCache::flatten(
+	const Contour::ChunkList &chunks,
+	Real scale,
+	Real detail,
+	Contour::ChunkList &out_chunks )
+{
+	// curves smaller than the half of detail are lines for Polyspan too,
+	// other curves are split while they deviate from chords more than
+	// the tenth of detail (Polyspan splits them to pieces of detail size)
+	detail = std::max(0.0, detail);
+	Real coarse = detail*0.5/scale;
+	Real tolerance = std::max(0.01, detail*0.1)/scale;
+
+	out_chunks.clear();
+	out_chunks.reserve(chunks.size());
+	Vector start, prev;
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		switch(i->type) {
+		case Contour::CONIC:
+			if (max_edge(prev, i->pp0, i->p1) <= coarse)
+				out_chunks.push_back(Contour::Chunk(Contour::LINE, i->p1));
+			else
+				flatten_conic(out_chunks, prev, i->pp0, i->p1, tolerance, 0);
+			prev = i->p1;
+			break;
+		case Contour::CUBIC:
+			if (max_edge(prev, i->pp0, i->pp1, i->p1) <= coarse)
+				out_chunks.push_back(Contour::Chunk(Contour::LINE, i->p1));
+			else
+				flatten_cubic(out_chunks, prev, i->pp0, i->pp1, i->p1, tolerance, 0);
+			prev = i->p1;
+			break;
+		case Contour::MOVE:
+			out_chunks.push_back(*i);
+			start = prev = i->p1;
+			break;
+		case Contour::CLOSE:
+			out_chunks.push_back(*i);
+			prev = start;
+			break;
+		default:
+			out_chunks.push_back(*i);
+			prev = i->p1;
+			break;
+		}
+	}
+}
+
+void
+ContourCache::erase(Map::iterator i)
+{
+	memory -= i->second.size;
+	lru.erase(i->second.lru_position);
+	entries.erase(i);
+}
+
+void
+ContourCache::shrink(size_t limit)
+{
+	while(memory > limit && !lru.empty())
+		erase(entries.find(lru.front()));
+}
+
+ContourCache::Handle
+ContourCache::get(
+	const Contour &contour,
+	const Matrix &matrix,
+	Real detail,
+	const RectInt &target_rect )
+{
+	if (!get_memory_limit() || !target_rect.is_valid())
+		return Handle();
+
+	// lines are already in Polyspan
+	const Contour::ChunkList &chunks = contour.get_chunks();
+	bool curves = false;
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end() && !curves; ++i)
+		curves = i->type == Contour::CONIC || i->type == Contour::CUBIC;
+	if (!curves)
+		return Handle();
+
+	Rect bounds = contour.get_bounds();
+	if (!bounds.is_valid())
+		return Handle();
+	Rect transformed_bounds(matrix.get_transformed(Vector(bounds.minx, bounds.miny)));
+	transformed_bounds.expand(matrix.get_transformed(Vector(bounds.maxx, bounds.miny)));
+	transformed_bounds.expand(matrix.get_transformed(Vector(bounds.minx, bounds.maxy)));
+	transformed_bounds.expand(matrix.get_transformed(Vector(bounds.maxx, bounds.maxy)));
+	if ( transformed_bounds.maxx - transformed_bounds.minx > max_size*(target_rect.maxx - target_rect.minx)
+	  || transformed_bounds.maxy - transformed_bounds.miny > max_size*(target_rect.maxy - target_rect.miny) )
+		return Handle();
+
+	int bucket = calc_scale_bucket(matrix);
+	if (bucket == INT_MIN)
+		return Handle();
+
+	Hasher hasher;
+	hasher.add(contour.get_hash());
+	hasher.add(bucket);
+	hasher.add(detail);
+	Key key = hasher.get();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Map::iterator i = entries.find(key);
+		if (i != entries.end()) {
+			++hits;
+			lru.splice(lru.end(), lru, i->second.lru_position);
+			return i->second.chunks;
+		}
+	}
+	++misses;
+
+	// flatten without lock, other threads may flatten the same contour at the same time,
+	// then the last result is stored
+	std::shared_ptr<Contour::ChunkList> flattened(new Contour::ChunkList());
+	flatten(chunks, get_bucket_scale(bucket), detail, *flattened);
+	flattened->shrink_to_fit();
+	size_t size = flattened->size()*sizeof(Contour::Chunk);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Map::iterator i = entries.find(key);
+	if (i != entries.end())
+		erase(i);
+	if (size <= memory_limit) {
+		shrink(memory_limit - size);
+		Entry &entry = entries[key];
+		entry.chunks = flattened;
+		entry.size = size;
+		entry.lru_position = lru.insert(lru.end(), key);
+		memory += size;
+	}
+	return flattened;
+}
+
+void
+ContourCache::set_memory_limit(size_t x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	memory_limit = x;
+	shrink(memory_limit);
+}
+
+size_t
+ContourCache::get_memory_limit() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory_limit;
+}
+
+size_t
+ContourCache::get_memory() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory;
+}
+
+void
+ContourCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	shrink(0);
+}
+
+/* === E N T R Y P O I N T ================================================= */
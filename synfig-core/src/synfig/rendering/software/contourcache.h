@@ -0,0 +1,147 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/contourcache.h
+**	\brief ContourCache Header
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_CONTOURCACHE_H
+#define __SYNFIG_RENDERING_CONTOURCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstddef>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <synfig/matrix.h>
+#include <synfig/rect.h>
+
+#include "../primitive/contour.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+/*!	\class ContourCache
+**	\brief Keeps contours with curves flattened to lines between frames.
+**
+**	Contours are identified by Contour::get_hash() and by the scale
+**	of transformation rounded up to buckets (four buckets per power of two),
+**	so translated and rotated contours reuse the same lines, and only
+**	points of lines are transformed for each frame. Lines are precise enough
+**	for Polyspan at any scale of the bucket. Least recently used contours
+**	are released first when memory exceeds the limit.
+*/
+class ContourCache
+{
+public:
+	typedef std::shared_ptr<const Contour::ChunkList> Handle;
+	typedef unsigned long long Key;
+
+	static const int buckets_per_octave;
+	//! contours bigger than this count of target rects are not cached,
+	//! Polyspan subdivides only visible parts of their curves
+	static const Real max_size;
+
+private:
+	typedef std::list<Key> KeyList;
+
+	struct Entry
+	{
+		Handle chunks;
+		size_t size;
+		KeyList::iterator lru_position;
+		Entry(): size() { }
+	};
+
+	typedef std::map<Key, Entry> Map;
+
+	mutable std::mutex mutex;
+	size_t memory_limit;
+	size_t memory;
+	Map entries;
+	KeyList lru; //!< least recently used keys go first
+
+	std::atomic<long long> hits;
+	std::atomic<long long> misses;
+
+	void shrink(size_t limit);
+	void erase(Map::iterator i);
+
+	ContourCache(const ContourCache&): memory_limit(), memory(), hits(), misses() { }
+	ContourCache& operator= (const ContourCache&) { return *this; }
+
+public:
+	explicit ContourCache(size_t memory_limit = 0);
+	~ContourCache();
+
+	//! cache shared by all software renderers
+	static ContourCache& get_instance();
+
+	//! returns index of scale bucket of the linear part of matrix
+	static int calc_scale_bucket(const Matrix &matrix);
+	//! returns biggest scale of the bucket
+	static Real get_bucket_scale(int bucket);
+
+	//! replaces curves by lines, which are precise enough for Polyspan
+	//! with the same \a detail when contour will be scaled by \a scale
+	static void flatten(
+		const Contour::ChunkList &chunks,
+		Real scale,
+		Real detail,
+		Contour::ChunkList &out_chunks );
+
+	//! returns lines of \a contour to render it with \a matrix into \a target_rect,
+	//! flattens contour if it is not cached yet. Returns empty handle
+	//! if contour has no curves or too big for \a target_rect.
+	Handle get(
+		const Contour &contour,
+		const Matrix &matrix,
+		Real detail,
+		const RectInt &target_rect );
+
+	//! zero limit disables the cache
+	void set_memory_limit(size_t x);
+	size_t get_memory_limit() const;
+	size_t get_memory() const;
+
+	long long get_hits() const { return hits; }
+	long long get_misses() const { return misses; }
+	void reset_counters() { hits = 0; misses = 0; }
+
+	void clear();
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,310 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/blend.cpp
+**	\brief Blend
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <vector>
+
+#include <synfig/general.h>
+#include <synfig/color/colorblendingfunctions.h>
+
+#include "blend.h"
+#include "blendkernels.h"
+
+#endif
+
+#ifdef SYNFIG_SOFTWARE_BLEND_SIMD
+#include <emmintrin.h>
+#endif
+
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+#ifdef SYNFIG_SOFTWARE_BLEND_SIMD
+namespace {
+	class VectorSSE2
+	{
+	public:
+		typedef __m128 Type;
+		enum { pixels = 1 };
+
+		static Type load(const float *x) { return _mm_loadu_ps(x); }
+		static void store(float *x, const Type &v) { _mm_storeu_ps(x, v); }
+
+		static Type set(float x) { return _mm_set1_ps(x); }
+		static Type set(float r, float g, float b, float a) { return _mm_setr_ps(r, g, b, a); }
+		static Type mask(bool r, bool g, bool b, bool a)
+			{ return _mm_castsi128_ps(_mm_setr_epi32(-(int)r, -(int)g, -(int)b, -(int)a)); }
+
+		static Type add(const Type &x, const Type &y) { return _mm_add_ps(x, y); }
+		static Type sub(const Type &x, const Type &y) { return _mm_sub_ps(x, y); }
+		static Type mul(const Type &x, const Type &y) { return _mm_mul_ps(x, y); }
+		static Type div(const Type &x, const Type &y) { return _mm_div_ps(x, y); }
+		static Type sqrt(const Type &x) { return _mm_sqrt_ps(x); }
+
+		static Type cmplt(const Type &x, const Type &y) { return _mm_cmplt_ps(x, y); }
+		static Type cmpgt(const Type &x, const Type &y) { return _mm_cmpgt_ps(x, y); }
+		static Type cmpeq(const Type &x, const Type &y) { return _mm_cmpeq_ps(x, y); }
+		static Type cmpneq(const Type &x, const Type &y) { return _mm_cmpneq_ps(x, y); }
+
+		static Type bit_and(const Type &x, const Type &y) { return _mm_and_ps(x, y); }
+		static Type bit_or(const Type &x, const Type &y) { return _mm_or_ps(x, y); }
+		static Type bit_xor(const Type &x, const Type &y) { return _mm_xor_ps(x, y); }
+		//! ~x & y
+		static Type bit_andnot(const Type &x, const Type &y) { return _mm_andnot_ps(x, y); }
+
+		template<int i>
+		static Type splat(const Type &x) { return _mm_shuffle_ps(x, x, _MM_SHUFFLE(i, i, i, i)); }
+	};
+}
+
+void
+software::blend_kernel_rows_sse2(BlendKernelRows &rows)
+	{ BlendKernels<VectorSSE2>::fill_rows(rows); }
+#endif
+
+
+namespace {
+	template<blendfunc func>
+	void blend_row_scalar(Color *dest, const Color *src, int count, ColorReal amount)
+	{
+		for(Color *end = dest + count; dest < end; ++dest, ++src) {
+			Color a = *src, b = *dest;
+			*dest = func(a, b, amount);
+		}
+	}
+
+	class Tables
+	{
+	public:
+		typedef void (*ScalarRowFunc)(Color*, const Color*, int, ColorReal);
+
+		BlendKernelConstants constants;
+		ScalarRowFunc scalar[Color::BLEND_END];
+		BlendKernelRowFunc kernels[Blend::INSTRUCTIONS_COUNT][Color::BLEND_END];
+		Blend::Instructions instructions;
+
+		Tables(): constants(), scalar(), kernels(), instructions(Blend::INSTRUCTIONS_SCALAR)
+		{
+			// keep the same order as in Color::blend()
+			scalar[Color::BLEND_COMPOSITE]      = &blend_row_scalar< blendfunc_COMPOSITE<Color> >;
+			scalar[Color::BLEND_STRAIGHT]       = &blend_row_scalar< blendfunc_STRAIGHT<Color> >;
+			scalar[Color::BLEND_BRIGHTEN]       = &blend_row_scalar< blendfunc_BRIGHTEN<Color> >;
+			scalar[Color::BLEND_DARKEN]         = &blend_row_scalar< blendfunc_DARKEN<Color> >;
+			scalar[Color::BLEND_ADD]            = &blend_row_scalar< blendfunc_ADD<Color> >;
+			scalar[Color::BLEND_SUBTRACT]       = &blend_row_scalar< blendfunc_SUBTRACT<Color> >;
+			scalar[Color::BLEND_MULTIPLY]       = &blend_row_scalar< blendfunc_MULTIPLY<Color> >;
+			scalar[Color::BLEND_DIVIDE]         = &blend_row_scalar< blendfunc_DIVIDE<Color> >;
+			scalar[Color::BLEND_COLOR]          = &blend_row_scalar< blendfunc_COLOR<Color> >;
+			scalar[Color::BLEND_HUE]            = &blend_row_scalar< blendfunc_HUE<Color> >;
+			scalar[Color::BLEND_SATURATION]     = &blend_row_scalar< blendfunc_SATURATION<Color> >;
+			scalar[Color::BLEND_LUMINANCE]      = &blend_row_scalar< blendfunc_LUMINANCE<Color> >;
+			scalar[Color::BLEND_BEHIND]         = &blend_row_scalar< blendfunc_BEHIND<Color> >;
+			scalar[Color::BLEND_ONTO]           = &blend_row_scalar< blendfunc_ONTO<Color> >;
+			scalar[Color::BLEND_ALPHA_BRIGHTEN] = &blend_row_scalar< blendfunc_ALPHA_BRIGHTEN<Color> >;
+			scalar[Color::BLEND_ALPHA_DARKEN]   = &blend_row_scalar< blendfunc_ALPHA_DARKEN<Color> >;
+			scalar[Color::BLEND_SCREEN]         = &blend_row_scalar< blendfunc_SCREEN<Color> >;
+			scalar[Color::BLEND_HARD_LIGHT]     = &blend_row_scalar< blendfunc_HARD_LIGHT<Color> >;
+			scalar[Color::BLEND_DIFFERENCE]     = &blend_row_scalar< blendfunc_DIFFERENCE<Color> >;
+			scalar[Color::BLEND_ALPHA_OVER]     = &blend_row_scalar< blendfunc_ALPHA_OVER<Color> >;
+			scalar[Color::BLEND_OVERLAY]        = &blend_row_scalar< blendfunc_OVERLAY<Color> >;
+			scalar[Color::BLEND_STRAIGHT_ONTO]  = &blend_row_scalar< blendfunc_STRAIGHT_ONTO<Color> >;
+			scalar[Color::BLEND_ADD_COMPOSITE]  = &blend_row_scalar< blendfunc_ADD_COMPOSITE<Color> >;
+
+			constants.epsilon = COLOR_EPSILON;
+			Color transparent = Color::alpha();
+			constants.transparent[0] = transparent.get_r();
+			constants.transparent[1] = transparent.get_g();
+			constants.transparent[2] = transparent.get_b();
+			constants.transparent[3] = transparent.get_a();
+			memcpy(constants.encode_yuv, EncodeYUV, sizeof(constants.encode_yuv));
+			memcpy(constants.decode_yuv, DecodeYUV, sizeof(constants.decode_yuv));
+
+			#ifdef SYNFIG_SOFTWARE_BLEND_SIMD
+			// kernels read colors as arrays of four floats
+			if (sizeof(Color) == 4*sizeof(float)) {
+				BlendKernelRows rows;
+				blend_kernel_rows_sse2(rows);
+				set_kernels(Blend::INSTRUCTIONS_SSE2, rows);
+				instructions = Blend::INSTRUCTIONS_SSE2;
+
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx2")) {
+					blend_kernel_rows_avx2(rows);
+					set_kernels(Blend::INSTRUCTIONS_AVX2, rows);
+					instructions = Blend::INSTRUCTIONS_AVX2;
+				}
+			}
+			#endif
+
+			if (const char *s = getenv("SYNFIG_SOFTWARE_BLEND_INSTRUCTIONS"))
+				for(int i = 0; i < (int)instructions; ++i)
+					if (!strcmp(s, Blend::get_instructions_name((Blend::Instructions)i)))
+						{ instructions = (Blend::Instructions)i; break; }
+		}
+
+		void set_kernels(Blend::Instructions instructions, const BlendKernelRows &rows)
+		{
+			BlendKernelRowFunc *k = kernels[instructions];
+			k[Color::BLEND_COMPOSITE]      = rows.composite;
+			k[Color::BLEND_STRAIGHT]       = rows.straight;
+			k[Color::BLEND_BRIGHTEN]       = rows.brighten;
+			k[Color::BLEND_DARKEN]         = rows.darken;
+			k[Color::BLEND_ADD]            = rows.add;
+			k[Color::BLEND_SUBTRACT]       = rows.subtract;
+			k[Color::BLEND_MULTIPLY]       = rows.multiply;
+			k[Color::BLEND_DIVIDE]         = rows.divide;
+			k[Color::BLEND_COLOR]          = rows.color;
+			k[Color::BLEND_SATURATION]     = rows.saturation;
+			k[Color::BLEND_LUMINANCE]      = rows.luminance;
+			k[Color::BLEND_BEHIND]         = rows.behind;
+			k[Color::BLEND_ONTO]           = rows.onto;
+			k[Color::BLEND_ALPHA_BRIGHTEN] = rows.alpha_brighten;
+			k[Color::BLEND_ALPHA_DARKEN]   = rows.alpha_darken;
+			k[Color::BLEND_SCREEN]         = rows.screen;
+			k[Color::BLEND_HARD_LIGHT]     = rows.hard_light;
+			k[Color::BLEND_DIFFERENCE]     = rows.difference;
+			k[Color::BLEND_ALPHA_OVER]     = rows.alpha_over;
+			k[Color::BLEND_OVERLAY]        = rows.overlay;
+			k[Color::BLEND_STRAIGHT_ONTO]  = rows.straight_onto;
+			k[Color::BLEND_ADD_COMPOSITE]  = rows.add_composite;
+			// hue uses trigonometric functions, it's processed by scalar code only
+		}
+
+		static const Tables& get()
+			{ static Tables tables; return tables; }
+	};
+}
+
+
+Blend::Instructions
+Blend::get_instructions()
+	{ return Tables::get().instructions; }
+
+const char*
+Blend::get_instructions_name(Instructions instructions)
+{
+	switch(instructions) {
+	case INSTRUCTIONS_SCALAR: return "scalar";
+	case INSTRUCTIONS_SSE2:   return "sse2";
+	case INSTRUCTIONS_AVX2:   return "avx2";
+	default: break;
+	}
+	return "";
+}
+
+void
+Blend::blend_row(
+	Color *dest,
+	const Color *src,
+	int count,
+	ColorReal amount,
+	Color::BlendMethod method,
+	Instructions instructions )
+{
+	// see Color::blend()
+	if (fabsf(amount) <= COLOR_EPSILON) return;
+	if (count <= 0) return;
+	assert(method >= 0 && method < Color::BLEND_END);
+
+	const Tables &tables = Tables::get();
+	if (instructions > tables.instructions)
+		instructions = tables.instructions;
+
+	if (BlendKernelRowFunc kernel = tables.kernels[instructions][method]) {
+		int processed = kernel((float*)dest, (const float*)src, count, amount, tables.constants);
+		dest += processed;
+		src += processed;
+		count -= processed;
+	}
+	if (count > 0)
+		tables.scalar[method](dest, src, count, amount);
+}
+
+void
+Blend::blend(
+	synfig::Surface &dest,
+	const RectInt &dest_rect,
+	const synfig::Surface &src,
+	const VectorInt &src_offset,
+	ColorReal amount,
+	Color::BlendMethod method )
+{
+	if (!dest_rect.is_valid()) return;
+	assert( 0 <= dest_rect.minx && dest_rect.maxx <= dest.get_w()
+		 && 0 <= dest_rect.miny && dest_rect.maxy <= dest.get_h() );
+	assert( 0 <= dest_rect.minx + src_offset[0] && dest_rect.maxx + src_offset[0] <= src.get_w()
+		 && 0 <= dest_rect.miny + src_offset[1] && dest_rect.maxy + src_offset[1] <= src.get_h() );
+
+	// Surface::blit_to() just copies pixels in this case
+	const bool copy = method == Color::BLEND_STRAIGHT && fabs(amount - 1.f) < 0.00001f;
+
+	const Instructions instructions = get_instructions();
+	const int w = dest_rect.maxx - dest_rect.minx;
+	for(int y = dest_rect.miny; y < dest_rect.maxy; ++y) {
+		Color *d = &dest[y][dest_rect.minx];
+		const Color *s = &src[y + src_offset[1]][dest_rect.minx + src_offset[0]];
+		if (copy)
+			memcpy(d, s, w*sizeof(Color));
+		else
+			blend_row(d, s, w, amount, method, instructions);
+	}
+}
+
+void
+Blend::fill(
+	synfig::Surface &dest,
+	const RectInt &dest_rect,
+	const Color &color,
+	ColorReal amount,
+	Color::BlendMethod method )
+{
+	if (!dest_rect.is_valid()) return;
+	assert( 0 <= dest_rect.minx && dest_rect.maxx <= dest.get_w()
+		 && 0 <= dest_rect.miny && dest_rect.maxy <= dest.get_h() );
+
+	const Instructions instructions = get_instructions();
+	const int w = dest_rect.maxx - dest_rect.minx;
+	std::vector<Color> row(w, color);
+	for(int y = dest_rect.miny; y < dest_rect.maxy; ++y)
+		blend_row(&dest[y][dest_rect.minx], &row.front(), w, amount, method, instructions);
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,111 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/blend.h
+**	\brief Blend Header
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_BLEND_H
+#define __SYNFIG_RENDERING_SOFTWARE_BLEND_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/color.h>
+#include <synfig/rect.h>
+#include <synfig/surface.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+/*!	\class Blend
+**	\brief Blends rows of pixels with vectorized kernels
+**
+**	Results are bit-exact with Color::blend(). Kernels are chosen
+**	by instructions supported by CPU, methods without vectorized kernel
+**	(BLEND_HUE) are processed by scalar code.
+*/
+class Blend
+{
+public:
+	enum Instructions
+	{
+		INSTRUCTIONS_SCALAR,
+		INSTRUCTIONS_SSE2,
+		INSTRUCTIONS_AVX2,
+		INSTRUCTIONS_COUNT
+	};
+
+	//! Best instructions supported by CPU,
+	//! may be limited by environment variable SYNFIG_SOFTWARE_BLEND_INSTRUCTIONS
+	static Instructions get_instructions();
+	static bool is_supported(Instructions instructions)
+		{ return instructions <= get_instructions(); }
+	static const char* get_instructions_name(Instructions instructions);
+
+	//! dest[i] = Color::blend(src[i], dest[i], amount, method)
+	static void blend_row(
+		Color *dest,
+		const Color *src,
+		int count,
+		ColorReal amount,
+		Color::BlendMethod method,
+		Instructions instructions );
+
+	static void blend_row(
+		Color *dest,
+		const Color *src,
+		int count,
+		ColorReal amount,
+		Color::BlendMethod method )
+	{ blend_row(dest, src, count, amount, method, get_instructions()); }
+
+	//! Blends \a src onto \a dest_rect of \a dest, same as Surface::blit_to() with alpha_pen
+	static void blend(
+		synfig::Surface &dest,
+		const RectInt &dest_rect,
+		const synfig::Surface &src,
+		const VectorInt &src_offset,
+		ColorReal amount,
+		Color::BlendMethod method );
+
+	//! Blends \a color onto \a dest_rect of \a dest, same as Surface::fill() with alpha_pen
+	static void fill(
+		synfig::Surface &dest,
+		const RectInt &dest_rect,
+		const Color &color,
+		ColorReal amount,
+		Color::BlendMethod method );
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,118 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/blend_avx2.cpp
+**	\brief Blend kernels for AVX2
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+// Don't use precompiled header here:
+// only code of this file should be compiled for AVX2
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+// same condition as for SYNFIG_SOFTWARE_BLEND_SIMD in blendkernels.h
+#if defined(__GNUC__) && defined(__x86_64__)
+
+#include <immintrin.h>
+
+// everything below is compiled for AVX2,
+// this code is called only when CPU supports it (see Blend::get_instructions())
+// FMA is not enabled, it would break bit-exactness with scalar code
+#ifdef __clang__
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#endif
+
+#include "blendkernels.h"
+
+#ifdef SYNFIG_SOFTWARE_BLEND_SIMD
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+	//! two pixels in one vector
+	class VectorAVX2
+	{
+	public:
+		typedef __m256 Type;
+		enum { pixels = 2 };
+
+		static Type load(const float *x) { return _mm256_loadu_ps(x); }
+		static void store(float *x, const Type &v) { _mm256_storeu_ps(x, v); }
+
+		static Type set(float x) { return _mm256_set1_ps(x); }
+		static Type set(float r, float g, float b, float a) { return _mm256_setr_ps(r, g, b, a, r, g, b, a); }
+		static Type mask(bool r, bool g, bool b, bool a) {
+			return _mm256_castsi256_ps(_mm256_setr_epi32(
+				-(int)r, -(int)g, -(int)b, -(int)a,
+				-(int)r, -(int)g, -(int)b, -(int)a ));
+		}
+
+		static Type add(const Type &x, const Type &y) { return _mm256_add_ps(x, y); }
+		static Type sub(const Type &x, const Type &y) { return _mm256_sub_ps(x, y); }
+		static Type mul(const Type &x, const Type &y) { return _mm256_mul_ps(x, y); }
+		static Type div(const Type &x, const Type &y) { return _mm256_div_ps(x, y); }
+		static Type sqrt(const Type &x) { return _mm256_sqrt_ps(x); }
+
+		static Type cmplt(const Type &x, const Type &y) { return _mm256_cmp_ps(x, y, _CMP_LT_OQ); }
+		static Type cmpgt(const Type &x, const Type &y) { return _mm256_cmp_ps(x, y, _CMP_GT_OQ); }
+		static Type cmpeq(const Type &x, const Type &y) { return _mm256_cmp_ps(x, y, _CMP_EQ_OQ); }
+		static Type cmpneq(const Type &x, const Type &y) { return _mm256_cmp_ps(x, y, _CMP_NEQ_UQ); }
+
+		static Type bit_and(const Type &x, const Type &y) { return _mm256_and_ps(x, y); }
+		static Type bit_or(const Type &x, const Type &y) { return _mm256_or_ps(x, y); }
+		static Type bit_xor(const Type &x, const Type &y) { return _mm256_xor_ps(x, y); }
+		//! ~x & y
+		static Type bit_andnot(const Type &x, const Type &y) { return _mm256_andnot_ps(x, y); }
+
+		template<int i>
+		static Type splat(const Type &x) { return _mm256_permute_ps(x, _MM_SHUFFLE(i, i, i, i)); }
+	};
+}
+
+void
+software::blend_kernel_rows_avx2(BlendKernelRows &rows)
+	{ BlendKernels<VectorAVX2>::fill_rows(rows); }
+
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+
+/* === E N T R Y P O I N T ================================================= */
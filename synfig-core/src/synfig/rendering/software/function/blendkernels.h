@@ -0,0 +1,373 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/blendkernels.h
+**	\brief Vectorized blend kernels
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_BLENDKERNELS_H
+#define __SYNFIG_RENDERING_SOFTWARE_BLENDKERNELS_H
+
+/* === H E A D E R S ======================================================= */
+
+// This header is included into the translation unit compiled for AVX2,
+// so it must not include any header with inline functions,
+// otherwise the AVX2 version of such function may be chosen by linker
+// for the whole library.
+
+/* === M A C R O S ========================================================= */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SYNFIG_SOFTWARE_BLEND_SIMD
+#endif
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Constants of synfig::Color required by kernels
+struct BlendKernelConstants
+{
+	float epsilon;
+	float transparent[4];
+	float encode_yuv[3][3];
+	float decode_yuv[3][3];
+};
+
+//! Blends \a count pixels of \a src onto \a dest,
+//! returns the count of processed pixels, rest should be processed by scalar code
+typedef int (*BlendKernelRowFunc)(
+	float *dest,
+	const float *src,
+	int count,
+	float amount,
+	const BlendKernelConstants &constants );
+
+struct BlendKernelRows
+{
+	BlendKernelRowFunc composite;
+	BlendKernelRowFunc straight;
+	BlendKernelRowFunc onto;
+	BlendKernelRowFunc straight_onto;
+	BlendKernelRowFunc behind;
+	BlendKernelRowFunc screen;
+	BlendKernelRowFunc overlay;
+	BlendKernelRowFunc hard_light;
+	BlendKernelRowFunc multiply;
+	BlendKernelRowFunc divide;
+	BlendKernelRowFunc add;
+	BlendKernelRowFunc add_composite;
+	BlendKernelRowFunc subtract;
+	BlendKernelRowFunc difference;
+	BlendKernelRowFunc brighten;
+	BlendKernelRowFunc darken;
+	BlendKernelRowFunc color;
+	BlendKernelRowFunc saturation;
+	BlendKernelRowFunc luminance;
+	BlendKernelRowFunc alpha_brighten;
+	BlendKernelRowFunc alpha_darken;
+	BlendKernelRowFunc alpha_over;
+};
+
+#ifdef SYNFIG_SOFTWARE_BLEND_SIMD
+void blend_kernel_rows_sse2(BlendKernelRows &rows);
+void blend_kernel_rows_avx2(BlendKernelRows &rows);
+#endif
+
+//! Kernels repeat operations of functions from color/colorblendingfunctions.h
+//! in the same order, so results are bit-exact with scalar code.
+//! Each 128-bit lane of vector V::Type holds one pixel (r, g, b, a).
+template<typename V>
+class BlendKernels
+{
+public:
+	typedef typename V::Type T;
+
+	const T zero;
+	const T one;
+	const T half;
+	const T two;
+	const T epsilon;
+	const T transparent;
+	const T sign_mask;
+	const T alpha_mask;
+	const T rgb_mask;
+	const T encode_yuv[3];
+	const T decode_yuv[3];
+
+	explicit BlendKernels(const BlendKernelConstants &c):
+		zero(V::set(0.f)),
+		one(V::set(1.f)),
+		half(V::set(0.5f)),
+		two(V::set(2.f)),
+		epsilon(V::set(c.epsilon)),
+		transparent(V::set(c.transparent[0], c.transparent[1], c.transparent[2], c.transparent[3])),
+		sign_mask(V::set(-0.f)),
+		alpha_mask(V::mask(false, false, false, true)),
+		rgb_mask(V::mask(true, true, true, false)),
+		encode_yuv {
+			V::set(c.encode_yuv[0][0], c.encode_yuv[0][1], c.encode_yuv[0][2], 0.f),
+			V::set(c.encode_yuv[1][0], c.encode_yuv[1][1], c.encode_yuv[1][2], 0.f),
+			V::set(c.encode_yuv[2][0], c.encode_yuv[2][1], c.encode_yuv[2][2], 0.f) },
+		decode_yuv {
+			V::set(c.decode_yuv[0][0], c.decode_yuv[1][0], c.decode_yuv[2][0], 0.f),
+			V::set(c.decode_yuv[0][1], c.decode_yuv[1][1], c.decode_yuv[2][1], 0.f),
+			V::set(c.decode_yuv[0][2], c.decode_yuv[1][2], c.decode_yuv[2][2], 0.f) }
+		{ }
+
+	// helpers
+
+	static T select(const T &mask, const T &x, const T &y)
+		{ return V::bit_or(V::bit_and(mask, x), V::bit_andnot(mask, y)); }
+	static T r(const T &x) { return V::template splat<0>(x); }
+	static T g(const T &x) { return V::template splat<1>(x); }
+	static T b(const T &x) { return V::template splat<2>(x); }
+	static T a(const T &x) { return V::template splat<3>(x); }
+
+	T abs(const T &x) const { return V::bit_andnot(sign_mask, x); }
+	T neg(const T &x) const { return V::bit_xor(sign_mask, x); }
+	//! rgb from \a x and alpha from \a y
+	T set_a(const T &x, const T &y) const { return select(alpha_mask, y, x); }
+	//! rgb from \a x where mask is set, all other from \a y
+	T select_rgb(const T &mask, const T &x, const T &y) const
+		{ return select(V::bit_and(mask, rgb_mask), x, y); }
+	//! Color::operator~()
+	T invert(const T &x) const { return set_a(V::sub(one, x), x); }
+	//! 'if (amount<0) a=~a, amount=-amount;'
+	void invert_if_negative(T &x, T &amount) const {
+		T m = V::cmplt(amount, zero);
+		x = select(m, invert(x), x);
+		amount = select(m, neg(amount), amount);
+	}
+
+	T dot3(const T &x, const T &y) const {
+		T m = V::mul(x, y);
+		return V::add(V::add(r(m), g(m)), b(m));
+	}
+	T get_y(const T &x) const { return dot3(x, encode_yuv[0]); }
+	T get_u(const T &x) const { return dot3(x, encode_yuv[1]); }
+	T get_v(const T &x) const { return dot3(x, encode_yuv[2]); }
+	//! Color::set_yuv(), alpha taken from \a x
+	T set_yuv(const T &x, const T &y, const T &u, const T &v) const {
+		return set_a(
+			V::add(
+				V::add(V::mul(y, decode_yuv[0]), V::mul(u, decode_yuv[1])),
+				V::mul(v, decode_yuv[2]) ),
+			x );
+	}
+	//! '(temp-b)*amount*a.get_a()+b'
+	T mix(const T &temp, const T &x, const T &y, const T &amount) const
+		{ return V::add(V::mul(V::mul(V::sub(temp, y), amount), a(x)), y); }
+
+	// kernels, x is the color to blend onto y
+
+	T composite(const T &x, const T &y, const T &amount) const {
+		T a_src = V::mul(a(x), amount);
+		T a_dest = a(y);
+		T k = V::sub(one, a_src);
+		T dest = V::add(V::mul(x, a_src), V::mul(V::mul(y, a_dest), k));
+		a_dest = V::add(a_src, V::mul(a_dest, k));
+		dest = set_a(V::mul(dest, V::div(one, a_dest)), a_dest);
+		return select(V::cmpgt(abs(a_dest), epsilon), dest, transparent);
+	}
+
+	T straight(const T &x, const T &y, const T &amount) const {
+		T a_src = a(x);
+		T a_bg = a(y);
+		T a_out = V::add(V::mul(V::sub(a_src, a_bg), amount), a_bg);
+		T c_bg = V::mul(y, a_bg);
+		T out = V::add(V::mul(V::sub(V::mul(x, a_src), c_bg), amount), c_bg);
+		out = set_a(V::mul(out, V::div(one, a_out)), a_out);
+		return select(V::cmpgt(abs(a_out), epsilon), out, transparent);
+	}
+
+	T onto(const T &x, const T &y, const T &amount) const
+		{ return set_a(composite(x, set_a(y, one), amount), y); }
+
+	T straight_onto(const T &x, const T &y, const T &amount) const
+		{ return straight(set_a(x, V::mul(a(x), a(y))), y, amount); }
+
+	T behind(const T &x, const T &y, const T &amount) const {
+		T a_src = select(V::cmpeq(a(x), zero), V::mul(epsilon, amount), V::mul(a(x), amount));
+		return composite(y, set_a(x, a_src), one);
+	}
+
+	T screen(const T &x, const T &y, const T &amount) const {
+		T xx = x, aa = amount;
+		invert_if_negative(xx, aa);
+		xx = set_a(V::sub(one, V::mul(V::sub(one, xx), V::sub(one, y))), xx);
+		return onto(xx, y, aa);
+	}
+
+	T overlay(const T &x, const T &y, const T &amount) const {
+		T xx = x, aa = amount;
+		invert_if_negative(xx, aa);
+		T rm = V::mul(y, xx);
+		T rs = V::sub(one, V::mul(V::sub(one, xx), V::sub(one, y)));
+		xx = set_a(V::add(V::mul(xx, rs), V::mul(V::sub(one, xx), rm)), xx);
+		return onto(xx, y, aa);
+	}
+
+	T hard_light(const T &x, const T &y, const T &amount) const {
+		T xx = x, aa = amount;
+		invert_if_negative(xx, aa);
+		T x2 = V::mul(V::mul(xx, two), one);
+		T hi = V::sub(one, V::mul(V::sub(one, V::sub(x2, one)), V::sub(one, y)));
+		T lo = V::mul(y, x2);
+		xx = set_a(select(V::cmpgt(xx, half), hi, lo), xx);
+		return onto(xx, y, aa);
+	}
+
+	T multiply(const T &x, const T &y, const T &amount) const {
+		T xx = x, aa = amount;
+		invert_if_negative(xx, aa);
+		aa = V::mul(aa, a(xx));
+		return set_a(V::add(V::mul(V::sub(V::mul(y, xx), y), aa), y), y);
+	}
+
+	T divide(const T &x, const T &y, const T &amount) const {
+		T aa = V::mul(amount, a(x));
+		return set_a(V::add(V::mul(V::sub(V::div(y, V::add(x, epsilon)), y), aa), y), y);
+	}
+
+	T add(const T &x, const T &y, const T &amount) const {
+		T ba = a(y);
+		T aa = V::mul(a(x), amount);
+		return set_a(V::add(V::mul(y, ba), V::mul(x, aa)), ba);
+	}
+
+	T add_composite(const T &x, const T &y, const T &amount) const {
+		T ba = a(y);
+		T aa = V::mul(a(x), amount);
+		T alpha = V::add(ba, aa);
+		alpha = select(V::cmplt(alpha, one), alpha, one);
+		alpha = select(V::cmplt(zero, alpha), alpha, zero);
+		// 1e-8f is the nearest float below 1e-8, so the comparison is the same as for double
+		T k = V::bit_and(V::cmpgt(abs(alpha), V::set(1e-8f)), V::div(one, alpha));
+		aa = V::mul(aa, k);
+		ba = V::mul(ba, k);
+		return set_a(V::add(V::mul(y, ba), V::mul(x, aa)), alpha);
+	}
+
+	T subtract(const T &x, const T &y, const T &amount) const {
+		T ba = a(y);
+		T aa = V::mul(a(x), amount);
+		return set_a(V::sub(V::mul(y, ba), V::mul(x, aa)), ba);
+	}
+
+	T difference(const T &x, const T &y, const T &amount) const {
+		T ba = a(y);
+		T aa = V::mul(a(x), amount);
+		return set_a(abs(V::sub(V::mul(y, ba), V::mul(x, aa))), ba);
+	}
+
+	T brighten(const T &x, const T &y, const T &amount) const {
+		T c = V::mul(x, V::mul(a(x), amount));
+		return select_rgb(V::cmplt(y, c), c, y);
+	}
+
+	T darken(const T &x, const T &y, const T &amount) const {
+		T c = V::add(V::mul(V::sub(x, one), V::mul(a(x), amount)), one);
+		return select_rgb(V::cmpgt(y, c), c, y);
+	}
+
+	T color(const T &x, const T &y, const T &amount) const
+		{ return mix(set_yuv(y, get_y(y), get_u(x), get_v(x)), x, y, amount); }
+
+	T saturation(const T &x, const T &y, const T &amount) const {
+		T u = get_u(x), v = get_v(x);
+		T s_src = V::sqrt(V::add(V::mul(u, u), V::mul(v, v)));
+		u = get_u(y); v = get_v(y);
+		T s = V::sqrt(V::add(V::mul(u, u), V::mul(v, v)));
+		u = V::mul(V::div(u, s), s_src);
+		v = V::mul(V::div(v, s), s_src);
+		T temp = select(V::cmpneq(s, zero), set_yuv(y, get_y(y), u, v), y);
+		return mix(temp, x, y, amount);
+	}
+
+	T luminance(const T &x, const T &y, const T &amount) const
+		{ return mix(set_yuv(y, get_y(x), get_u(y), get_v(y)), x, y, amount); }
+
+	T alpha_brighten(const T &x, const T &y, const T &amount) const {
+		T m = V::cmplt(a(x), V::mul(a(y), amount));
+		return select(m, set_a(x, V::mul(a(x), amount)), y);
+	}
+
+	T alpha_darken(const T &x, const T &y, const T &amount) const {
+		T aa = V::mul(a(x), amount);
+		return select(V::cmpgt(aa, a(y)), set_a(x, aa), y);
+	}
+
+	T alpha_over(const T &x, const T &y, const T &amount) const
+		{ return straight(set_a(y, V::mul(V::sub(one, a(x)), a(y))), y, amount); }
+
+	// rows
+
+	template<T (BlendKernels::*func)(const T&, const T&, const T&) const>
+	static int row(float *dest, const float *src, int count, float amount, const BlendKernelConstants &constants)
+	{
+		const BlendKernels kernels(constants);
+		const T aa = V::set(amount);
+		const int step = 4*V::pixels;
+		const int processed = count - count%V::pixels;
+		for(float *end = dest + 4*processed; dest < end; dest += step, src += step)
+			V::store(dest, (kernels.*func)(V::load(src), V::load(dest), aa));
+		return processed;
+	}
+
+	static void fill_rows(BlendKernelRows &rows)
+	{
+		rows.composite      = &row<&BlendKernels::composite>;
+		rows.straight       = &row<&BlendKernels::straight>;
+		rows.onto           = &row<&BlendKernels::onto>;
+		rows.straight_onto  = &row<&BlendKernels::straight_onto>;
+		rows.behind         = &row<&BlendKernels::behind>;
+		rows.screen         = &row<&BlendKernels::screen>;
+		rows.overlay        = &row<&BlendKernels::overlay>;
+		rows.hard_light     = &row<&BlendKernels::hard_light>;
+		rows.multiply       = &row<&BlendKernels::multiply>;
+		rows.divide         = &row<&BlendKernels::divide>;
+		rows.add            = &row<&BlendKernels::add>;
+		rows.add_composite  = &row<&BlendKernels::add_composite>;
+		rows.subtract       = &row<&BlendKernels::subtract>;
+		rows.difference     = &row<&BlendKernels::difference>;
+		rows.brighten       = &row<&BlendKernels::brighten>;
+		rows.darken         = &row<&BlendKernels::darken>;
+		rows.color          = &row<&BlendKernels::color>;
+		rows.saturation     = &row<&BlendKernels::saturation>;
+		rows.luminance      = &row<&BlendKernels::luminance>;
+		rows.alpha_brighten = &row<&BlendKernels::alpha_brighten>;
+		rows.alpha_darken   = &row<&BlendKernels::alpha_darken>;
+		rows.alpha_over     = &row<&BlendKernels::alpha_over>;
+	}
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -118,6 +118,10 @@ private:
 	static void blur_pattern(const Params &params);
 
 	//! Full-size blur using Furier transform
+	template<typename T>
+	static void blur_fft_typed(const Params &params);
+
+	//! Full-size blur using single precision Furier transform
 	static void blur_fft(const Params &params);
 
 	//! Fast box-blur
@@ -29,6 +29,10 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "contour.h"
 
 #include <synfig/debug/debugsurface.h>
@@ -46,6 +50,120 @@ using namespace rendering;
 
 /* === M E T H O D S ======================================================= */
 
+bool
+software::Contour::is_dense(
+	const rendering::Contour::ChunkList &chunks,
+	const Matrix &transform_matrix,
+	const RectInt &window )
+{
+	// accumulation buffer takes 8 bytes per pixel
+	const long long max_area = 1ll << 22;
+
+	if (!window.is_valid()) return false;
+	long long area = (long long)(window.maxx - window.minx)*(window.maxy - window.miny);
+	if (area > max_area) return false;
+
+	// each segment produces about one cell per pixel of its length along x and y,
+	// length of control polygon is used for curves
+	Real cells = 0.0;
+	Vector prev;
+	for(rendering::Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		Vector p1 = transform_matrix.get_transformed(i->p1);
+		if (i->type == rendering::Contour::CONIC || i->type == rendering::Contour::CUBIC) {
+			Vector pp0 = transform_matrix.get_transformed(i->pp0);
+			Vector pp1 = transform_matrix.get_transformed(i->pp1);
+			cells += fabs(pp0[0] - prev[0]) + fabs(pp0[1] - prev[1])
+			       + fabs(pp1[0] - pp0[0]) + fabs(pp1[1] - pp0[1])
+			       + fabs(p1[0] - pp1[0]) + fabs(p1[1] - pp1[1]);
+		} else
+		if (i->type == rendering::Contour::LINE) {
+			cells += fabs(p1[0] - prev[0]) + fabs(p1[1] - prev[1]);
+		}
+		if (i->type != rendering::Contour::CLOSE)
+			prev = p1;
+	}
+
+	// sorting takes about cells*log2(cells) steps,
+	// accumulation takes one step per pixel of window
+	return cells*log2(cells + 2.0) > Real(area);
+}
+
+void
+software::Contour::render_accumulation(
+	synfig::Surface &target_surface,
+	const Polyspan &polyspan,
+	bool invert,
+	bool antialias,
+	rendering::Contour::WindingStyle winding_style,
+	const Color &color,
+	Color::value_type opacity,
+	Color::BlendMethod blend_method )
+{
+	bool simple_fill = (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
+			        && fabsf(1.f - opacity*color.get_a()) <= 1e-6;
+
+	synfig::Surface::alpha_pen p(target_surface.begin(), opacity, blend_method);
+	synfig::Surface::pen sp(target_surface.begin());
+	p.set_value(color);
+	sp.set_value(color);
+
+	const RectInt &window = polyspan.get_window();
+	const int width = window.maxx - window.minx;
+	std::vector<float> alpha_row(width);
+	float *alpha = &alpha_row.front();
+
+	for(int y = window.miny; y < window.maxy; ++y) {
+		const float *cover = polyspan.get_accumulated_cover(y);
+		const float *area = polyspan.get_accumulated_area(y);
+
+		// running sum of covers is a winding of the pixel,
+		// area is the uncovered part of pixels crossed by edges
+		float sum = 0.f;
+		for(int x = 0; x < width; ++x)
+			{ sum += cover[x]; alpha[x] = sum - area[x]; }
+
+		// the same as Polyspan::extract_alpha(), but without branches
+		if (winding_style == rendering::Contour::WINDING_NON_ZERO) {
+			for(int x = 0; x < width; ++x)
+				alpha[x] = std::min(fabsf(alpha[x]), 1.f);
+		} else {
+			for(int x = 0; x < width; ++x) {
+				float a = fabsf(alpha[x]);
+				alpha[x] = fabsf(a - 2.f*(float)(int)(a*0.5f + 0.5f));
+			}
+		}
+		if (invert)
+			for(int x = 0; x < width; ++x)
+				alpha[x] = 1.f - alpha[x];
+
+		// pixels crossed by edges are antialiased,
+		// spans between them are filled when covered by half or more like in render_polyspan()
+		for(int x = 0; x < width;) {
+			if (area[x]) {
+				if (antialias ? alpha[x] != 0.f : alpha[x] >= .5f) {
+					p.move_to(window.minx + x, y);
+					if (antialias) p.put_value_alpha(alpha[x]); else p.put_value();
+				}
+				++x;
+				continue;
+			}
+
+			int begin = x;
+			bool fill = alpha[x] >= .5f;
+			while(++x < width && !area[x] && (alpha[x] >= .5f) == fill) { }
+			if (fill) {
+				if (simple_fill) {
+					sp.move_to(window.minx + begin, y);
+					sp.put_hline(x - begin);
+				} else {
+					p.move_to(window.minx + begin, y);
+					p.put_hline(x - begin);
+				}
+			}
+		}
+	}
+}
+
 void
 software::Contour::render_polyspan(
 	synfig::Surface &target_surface,
@@ -57,6 +175,19 @@ software::Contour::render_polyspan(
 	Color::value_type opacity,
 	Color::BlendMethod blend_method )
 {
+	if (polyspan.is_accumulation()) {
+		render_accumulation(
+			target_surface,
+			polyspan,
+			invert,
+			antialias,
+			winding_style,
+			color,
+			opacity,
+			blend_method );
+		return;
+	}
+
 	bool simple_fill = (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
 			        && fabsf(1.f - opacity*color.get_a()) <= 1e-6;
 
@@ -301,6 +432,97 @@ software::Contour::build_polyspan(
 }
 
 
+void
+software::Contour::split_bands(
+	const rendering::Contour::ChunkList &chunks,
+	const Matrix &transform_matrix,
+	const RectInt &window,
+	int band_rows,
+	std::vector<rendering::Contour::ChunkList> &out_bands )
+{
+	typedef rendering::Contour::Chunk Chunk;
+
+	out_bands.clear();
+	if (!window.is_valid() || band_rows <= 0) return;
+	const int count = (window.maxy - window.miny + band_rows - 1)/band_rows;
+	out_bands.resize(count);
+
+	// for each band: index of the last chunk of current subpath added to band, or -1
+	std::vector<int> last(count, -1);
+	std::vector<int> touched;
+	Vector start, prev;
+	int first_index = -1, prev_index = -1;
+
+	for(int i = 0; i <= (int)chunks.size(); ++i) {
+		const Chunk *chunk = i < (int)chunks.size() ? &chunks[i] : NULL;
+		bool draw = chunk
+		         && ( chunk->type == rendering::Contour::LINE
+		           || chunk->type == rendering::Contour::CONIC
+		           || chunk->type == rendering::Contour::CUBIC );
+
+		if (!draw) {
+			// finish subpath, lines from skipped chunks to the start are outside of band
+			for(std::vector<int>::const_iterator j = touched.begin(); j != touched.end(); ++j) {
+				rendering::Contour::ChunkList &band = out_bands[*j];
+				if (last[*j] != prev_index)
+					band.push_back(Chunk(rendering::Contour::LINE, prev));
+				band.push_back(Chunk(rendering::Contour::CLOSE, start));
+				last[*j] = -1;
+			}
+			touched.clear();
+			first_index = prev_index = -1;
+			if (!chunk) break;
+			if (chunk->type == rendering::Contour::MOVE)
+				start = transform_matrix.get_transformed(chunk->p1);
+			prev = start;
+			continue;
+		}
+
+		Chunk c(*chunk);
+		c.p1 = transform_matrix.get_transformed(c.p1);
+		c.pp0 = transform_matrix.get_transformed(c.pp0);
+		c.pp1 = transform_matrix.get_transformed(c.pp1);
+
+		// curve lays inside of the bounds of its control points
+		Real miny = std::min(prev[1], c.p1[1]);
+		Real maxy = std::max(prev[1], c.p1[1]);
+		if (c.type != rendering::Contour::LINE) {
+			miny = std::min(miny, c.pp0[1]);
+			maxy = std::max(maxy, c.pp0[1]);
+		}
+		if (c.type == rendering::Contour::CUBIC) {
+			miny = std::min(miny, c.pp1[1]);
+			maxy = std::max(maxy, c.pp1[1]);
+		}
+
+		// the same condition as for the lines which ignored by Polyspan::line_to()
+		Real b0 = floor((miny - window.miny)/band_rows);
+		Real b1 = floor((maxy - window.miny)/band_rows);
+		if (first_index < 0) first_index = i;
+		if (b1 >= 0.0 && b0 < count) {
+			int begin = b0 < 0.0 ? 0 : (int)b0;
+			int end = b1 >= count ? count : (int)b1 + 1;
+			for(int j = begin; j < end; ++j) {
+				rendering::Contour::ChunkList &band = out_bands[j];
+				if (last[j] < 0) {
+					band.push_back(Chunk(rendering::Contour::MOVE, start));
+					touched.push_back(j);
+					if (i != first_index)
+						band.push_back(Chunk(rendering::Contour::LINE, prev));
+				} else
+				if (last[j] != prev_index) {
+					band.push_back(Chunk(rendering::Contour::LINE, prev));
+				}
+				band.push_back(c);
+				last[j] = i;
+			}
+		}
+
+		prev = c.p1;
+		prev_index = i;
+	}
+}
+
 void
 software::Contour::render_contour(
 	synfig::Surface &target_surface,
@@ -313,8 +535,9 @@ software::Contour::render_contour(
 	Color::value_type opacity,
 	Color::BlendMethod blend_method )
 {
+	RectInt window(0, 0, target_surface.get_w(), target_surface.get_h());
 	Polyspan polyspan;
-	polyspan.init(0, 0, target_surface.get_w(), target_surface.get_h());
+	polyspan.init(window, is_dense(chunks, transform_matrix, window));
 	build_polyspan(chunks, transform_matrix, polyspan);
 	polyspan.sort_marks();
 
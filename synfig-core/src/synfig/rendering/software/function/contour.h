@@ -27,6 +27,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <vector>
+
 #include <synfig/surface.h>
 
 #include "../../primitive/contour.h"
@@ -47,7 +49,25 @@ namespace software
 
 class Contour
 {
+private:
+	static void render_accumulation(
+		synfig::Surface &target_surface,
+		const Polyspan &polyspan,
+		bool invert,
+		bool antialias,
+		rendering::Contour::WindingStyle winding_style,
+		const Color &color,
+		Color::value_type opacity,
+		Color::BlendMethod blend_method );
+
 public:
+	//! Chooses way to collect cells of polyspan: accumulation buffer is faster when
+	//! count of cells is comparable with area of window, sorted marks are faster for sparse contours
+	static bool is_dense(
+		const rendering::Contour::ChunkList &chunks,
+		const Matrix &transform_matrix,
+		const RectInt &window );
+
 	static void render_polyspan(
 		synfig::Surface &target_surface,
 		const Polyspan &polyspan,
@@ -64,6 +84,17 @@ public:
 		Polyspan &out_polyspan,
 		Real detail = 0.25 );
 
+	//! Splits contour into horizontal bands of \a window with \a band_rows rows each,
+	//! so bands may be rasterized independently. Chunks of bands are already transformed.
+	//! Chunks which don't touch the band are replaced by straight lines
+	//! outside of band, so winding of pixels inside band stays the same.
+	static void split_bands(
+		const rendering::Contour::ChunkList &chunks,
+		const Matrix &transform_matrix,
+		const RectInt &window,
+		int band_rows,
+		std::vector<rendering::Contour::ChunkList> &out_bands );
+
 	static void render_contour(
 		synfig::Surface &target_surface,
 		const rendering::Contour::ChunkList &chunks,
@@ -31,15 +31,21 @@
 
 #include <cassert>
 #include <climits>
+#include <cstdlib>
+#include <cstring>
 //#include <ccomplex>
 
 #include <mutex>
 
+#include <map>
 #include <vector>
 #include <set>
 
 #include <fftw3.h>
 
+#include <synfig/general.h>
+#include <synfig/localization.h>
+
 #include "fft.h"
 
 #endif
@@ -53,17 +59,316 @@ using namespace rendering;
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+//! Dimensions of transform in terms of fftw_plan_guru_dft
+class PlanKey
+{
+public:
+	enum { MaxDims = 2 };
+
+	int rank;
+	int howmany_rank;
+	int sign;
+	int dims[MaxDims][3]; //!< n, is, os
+
+	PlanKey(): rank(), howmany_rank(), sign()
+		{ memset(dims, 0, sizeof(dims)); }
+
+	void add_dim(int n, int stride)
+	{
+		assert(rank + howmany_rank < MaxDims);
+		int *d = dims[rank + howmany_rank];
+		d[0] = n;
+		d[1] = stride;
+		d[2] = stride;
+	}
+
+	bool operator< (const PlanKey &other) const
+	{
+		if (rank != other.rank) return rank < other.rank;
+		if (howmany_rank != other.howmany_rank) return howmany_rank < other.howmany_rank;
+		if (sign != other.sign) return sign < other.sign;
+		return memcmp(dims, other.dims, sizeof(dims)) < 0;
+	}
+
+	//! count of elements between first and last items of array
+	int get_span() const
+	{
+		int span = 1;
+		for(int i = 0; i < rank + howmany_rank; ++i)
+			span += (dims[i][0] - 1)*abs(dims[i][1]);
+		return span;
+	}
+
+	//! offset of the first item to fit array with negative strides into span
+	int get_offset() const
+	{
+		int offset = 0;
+		for(int i = 0; i < rank + howmany_rank; ++i)
+			if (dims[i][1] < 0)
+				offset += (dims[i][0] - 1)*(-dims[i][1]);
+		return offset;
+	}
+};
+
+template<typename T>
+class PlanTraits;
+
+template<>
+class PlanTraits<double>
+{
+public:
+	typedef fftw_plan Plan;
+	typedef fftw_complex Complex;
+	typedef fftw_iodim IODim;
+
+	static Plan plan(int rank, const IODim *dims, int howmany_rank, const IODim *howmany_dims, Complex *x, int sign, unsigned flags)
+		{ return fftw_plan_guru_dft(rank, dims, howmany_rank, howmany_dims, x, x, sign, flags); }
+	static void execute(Plan plan, Complex *x)
+		{ fftw_execute_dft(plan, x, x); }
+	static void destroy(Plan plan)
+		{ fftw_destroy_plan(plan); }
+	static Complex* alloc(int count)
+		{ return fftw_alloc_complex(count); }
+	static void free(Complex *x)
+		{ fftw_free(x); }
+	static void set_timelimit(double seconds)
+		{ fftw_set_timelimit(seconds); }
+	static bool import_wisdom(const String &filename)
+		{ return fftw_import_wisdom_from_filename(filename.c_str()); }
+	static bool export_wisdom(const String &filename)
+		{ return fftw_export_wisdom_to_filename(filename.c_str()); }
+};
+
+template<>
+class PlanTraits<float>
+{
+public:
+	typedef fftwf_plan Plan;
+	typedef fftwf_complex Complex;
+	typedef fftwf_iodim IODim;
+
+	static Plan plan(int rank, const IODim *dims, int howmany_rank, const IODim *howmany_dims, Complex *x, int sign, unsigned flags)
+		{ return fftwf_plan_guru_dft(rank, dims, howmany_rank, howmany_dims, x, x, sign, flags); }
+	static void execute(Plan plan, Complex *x)
+		{ fftwf_execute_dft(plan, x, x); }
+	static void destroy(Plan plan)
+		{ fftwf_destroy_plan(plan); }
+	static Complex* alloc(int count)
+		{ return fftwf_alloc_complex(count); }
+	static void free(Complex *x)
+		{ fftwf_free(x); }
+	static void set_timelimit(double seconds)
+		{ fftwf_set_timelimit(seconds); }
+	static bool import_wisdom(const String &filename)
+		{ return fftwf_import_wisdom_from_filename(filename.c_str()); }
+	static bool export_wisdom(const String &filename)
+		{ return fftwf_export_wisdom_to_filename(filename.c_str()); }
+};
+
+//! Thread-safe storage of plans, planner of FFTW is not reentrant
+template<typename T>
+class PlanCache
+{
+public:
+	typedef PlanTraits<T> Traits;
+	typedef typename Traits::Plan Plan;
+	typedef typename Traits::Complex FFTWComplex;
+	typedef typename Traits::IODim IODim;
+	typedef std::map<PlanKey, Plan> Map;
+
+	//! plans are small, but count of layouts is not limited
+	static const size_t max_plans = 4096;
+
+private:
+	std::mutex mutex;
+	Map plans;
+	bool measure;
+
+	//! should be called under the lock
+	Plan create_plan(const PlanKey &key, FFTWComplex *x)
+	{
+		IODim dims[PlanKey::MaxDims];
+		for(int i = 0; i < key.rank + key.howmany_rank; ++i) {
+			dims[i].n  = key.dims[i][0];
+			dims[i].is = key.dims[i][1];
+			dims[i].os = key.dims[i][2];
+		}
+
+		// plans are executed with new arrays, so alignment of arrays
+		// should not be assumed by planner
+		if (!measure)
+			return Traits::plan(
+				key.rank, dims, key.howmany_rank, dims + key.rank,
+				x, key.sign, FFTW_ESTIMATE | FFTW_UNALIGNED );
+
+		// measuring overwrites array, so use a temporary one
+		FFTWComplex *buffer = Traits::alloc(key.get_span());
+		Plan plan = Traits::plan(
+			key.rank, dims, key.howmany_rank, dims + key.rank,
+			buffer + key.get_offset(), key.sign, FFTW_MEASURE | FFTW_UNALIGNED );
+		Traits::free(buffer);
+		return plan;
+	}
+
+public:
+	PlanCache(): measure() { }
+
+	void set_measure(bool x)
+		{ std::lock_guard<std::mutex> lock(mutex); measure = x; }
+
+	void execute(const PlanKey &key, std::complex<T> *pointer)
+	{
+		// std::complex is binary compatible with fftw_complex
+		FFTWComplex *x = (FFTWComplex*)pointer;
+		Plan plan;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			typename Map::const_iterator i = plans.find(key);
+			if (i != plans.end()) {
+				plan = i->second;
+			} else {
+				plan = create_plan(key, x);
+				if (plans.size() >= max_plans) {
+					// too many layouts, don't cache this one
+					Traits::execute(plan, x);
+					Traits::destroy(plan);
+					return;
+				}
+				plans[key] = plan;
+			}
+		}
+		// new-array execute functions are thread-safe
+		Traits::execute(plan, x);
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(typename Map::const_iterator i = plans.begin(); i != plans.end(); ++i)
+			Traits::destroy(i->second);
+		plans.clear();
+	}
+};
+
+template<typename T>
+PlanCache<T>& get_plans()
+{
+	static PlanCache<T> plans;
+	return plans;
+}
+
+template<typename T>
+String get_wisdom_filename(const String &filename);
+
+template<>
+String get_wisdom_filename<double>(const String &filename)
+	{ return filename; }
+
+template<>
+String get_wisdom_filename<float>(const String &filename)
+	{ return filename + ".float"; }
+
+template<typename T>
+void initialize_plans(const String &wisdom_filename)
+{
+	PlanTraits<T>::set_timelimit(wisdom_filename.empty() ? 0.0 : 1.0);
+	get_plans<T>().set_measure(!wisdom_filename.empty());
+	if (!wisdom_filename.empty())
+		PlanTraits<T>::import_wisdom(get_wisdom_filename<T>(wisdom_filename));
+}
+
+template<typename T>
+void deinitialize_plans(const String &wisdom_filename)
+{
+	get_plans<T>().clear();
+	if ( !wisdom_filename.empty()
+	  && !PlanTraits<T>::export_wisdom(get_wisdom_filename<T>(wisdom_filename)) )
+		warning(_("Cannot save FFT wisdom to file: %s"), get_wisdom_filename<T>(wisdom_filename).c_str());
+}
+
+}
+
 /* === M E T H O D S ======================================================= */
 
 class software::FFT::Internal
 {
 public:
 	static std::set<int> counts;
-	static std::mutex mutex;
+	static String wisdom_filename;
+
+	template<typename T>
+	static void fft(const Array<std::complex<T>, 1> &x, bool invert)
+	{
+		typedef std::complex<T> C;
+
+		if (x.count == 0 || x.count == 1) return;
+
+		assert(is_valid_count(x.count));
+
+		PlanKey key;
+		key.rank = 1;
+		key.sign = invert ? FFTW_BACKWARD : FFTW_FORWARD;
+		key.add_dim(x.count, x.stride);
+		get_plans<T>().execute(key, x.pointer);
+
+		// divide by count to complete back-FFT
+		if (invert)
+			x.template process< std::multiplies<C> >( C(T(1.0)/(T)x.count) );
+	}
+
+	template<typename T>
+	static void fft2d(const Array<std::complex<T>, 2> &x, bool invert, bool do_rows, bool do_cols)
+	{
+		typedef std::complex<T> C;
+
+		if (x.count == 0 || x.sub().count == 0) return;
+		if ( (!do_cols || x.count == 1)
+		  && (!do_rows || x.sub().count == 1) )
+			return;
+
+		assert(is_valid_count(x.count) && is_valid_count(x.sub().count));
+
+		if (!do_rows && !do_cols) return;
+
+		PlanKey key;
+		key.sign = invert ? FFTW_BACKWARD : FFTW_FORWARD;
+		if (do_rows && do_cols)
+		{
+			key.rank = 2;
+			key.add_dim(x.sub().count, x.sub().stride);
+			key.add_dim(x.count, x.stride);
+		}
+		else
+		if (do_rows)
+		{
+			key.rank = 1;
+			key.howmany_rank = 1;
+			key.add_dim(x.sub().count, x.sub().stride);
+			key.add_dim(x.count, x.stride);
+		}
+		else
+		{
+			key.rank = 1;
+			key.howmany_rank = 1;
+			key.add_dim(x.count, x.stride);
+			key.add_dim(x.sub().count, x.sub().stride);
+		}
+		get_plans<T>().execute(key, x.pointer);
+
+		// divide by count to complete back-FFT
+		if (invert)
+		{
+			int count = (do_cols ? x.count : 1)
+				      * (do_rows ? x.sub().count : 1);
+			x.template process< std::multiplies<C> >( C(T(1.0)/(T)count) );
+		}
+	}
 };
 
 std::set<int> software::FFT::Internal::counts;
-std::mutex software::FFT::Internal::mutex;
+String software::FFT::Internal::wisdom_filename;
 
 void
 software::FFT::initialize()
@@ -77,12 +382,19 @@ software::FFT::initialize()
 			for(int c5 = c3; c5 < max5; c5 *= 5)
 				for(int c7 = c5; c7 < max7; c7 *= 7)
 					Internal::counts.insert(c7);
-	fftw_set_timelimit(0.0);
+
+	Internal::wisdom_filename.clear();
+	if (const char *s = getenv("SYNFIG_RENDERING_FFT_WISDOM"))
+		Internal::wisdom_filename = s;
+	initialize_plans<double>(Internal::wisdom_filename);
+	initialize_plans<float>(Internal::wisdom_filename);
 }
 
 void
 software::FFT::deinitialize()
 {
+	deinitialize_plans<double>(Internal::wisdom_filename);
+	deinitialize_plans<float>(Internal::wisdom_filename);
 	Internal::counts.clear();
 }
 
@@ -107,80 +419,18 @@ software::FFT::is_valid_count(int x)
 
 void
 software::FFT::fft(const Array<Complex, 1> &x, bool invert)
-{
-	if (x.count == 0 || x.count == 1) return;
-
-	assert(is_valid_count(x.count));
-
-	fftw_iodim iodim;
-	iodim.n  = x.count;
-	iodim.is = x.stride;
-	iodim.os = x.stride;
-
-	{
-		std::lock_guard<std::mutex> lock(Internal::mutex);
-		fftw_plan plan = fftw_plan_guru_dft(
-			1, &iodim, 0, NULL,
-			(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-			invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		fftw_execute(plan);
-		fftw_destroy_plan(plan);
-	}
-
-	// divide by count to complete back-FFT
-	if (invert)
-		x.process< std::multiplies<Complex> >( Complex(1.0/(Real)x.count) );
-}
+	{ Internal::fft<Real>(x, invert); }
 
 void
 software::FFT::fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows, bool do_cols)
-{
-	if (x.count == 0 || x.sub().count == 0) return;
-	if ( (!do_cols || x.count == 1)
-	  && (!do_rows || x.sub().count == 1) )
-		return;
-
-	assert(is_valid_count(x.count) && is_valid_count(x.sub().count));
-
-	if (!do_rows && !do_cols) return;
-
-	fftw_iodim iodim[2];
-	iodim[0].n  = x.sub().count;
-	iodim[0].is = x.sub().stride;
-	iodim[0].os = x.sub().stride;
-	iodim[1].n  = x.count;
-	iodim[1].is = x.stride;
-	iodim[1].os = x.stride;
+	{ Internal::fft2d<Real>(x, invert, do_rows, do_cols); }
 
-	{
-		std::lock_guard<std::mutex> lock(Internal::mutex);
-
-		fftw_plan plan;
-		if (do_rows && do_cols)
-		{
-			plan = fftw_plan_guru_dft(
-				2, iodim, 0, NULL,
-				(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-				invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		}
-		else
-		{
-			plan = fftw_plan_guru_dft(
-				1, &iodim[do_rows ? 0 : 1], 1, &iodim[do_rows ? 1 : 0],
-				(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-				invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		}
-		fftw_execute(plan);
-		fftw_destroy_plan(plan);
-	}
+void
+software::FFT::fft(const Array<ComplexFloat, 1> &x, bool invert)
+	{ Internal::fft<float>(x, invert); }
 
-	// divide by count to complete back-FFT
-	if (invert)
-	{
-		int count = (do_cols ? x.count : 1)
-			      * (do_rows ? x.sub().count : 1);
-		x.process< std::multiplies<Complex> >( Complex(1.0/(Real)count) );
-	}
-}
+void
+software::FFT::fft2d(const Array<ComplexFloat, 2> &x, bool invert, bool do_rows, bool do_cols)
+	{ Internal::fft2d<float>(x, invert, do_rows, do_cols); }
 
 /* === E N T R Y P O I N T ================================================= */
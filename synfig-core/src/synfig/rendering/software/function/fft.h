@@ -27,6 +27,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <complex>
+
 #include "array.h"
 #include <synfig/complex.h>
 
@@ -43,18 +45,34 @@ namespace rendering
 namespace software
 {
 
+/*!	\class FFT
+**	\brief Wrapper for FFTW.
+**
+**	Plans are cached by sizes, strides and direction of transform, so
+**	planning happens once for each layout, and execution of the cached
+**	plans is not serialized between threads. If SYNFIG_RENDERING_FFT_WISDOM
+**	environment variable contains filename, then plans are measured and
+**	accumulated wisdom is saved into this file (and into file with ".float"
+**	suffix for single precision) at deinitialization.
+*/
 class FFT
 {
 private:
 	class Internal;
 
 public:
+	typedef std::complex<float> ComplexFloat;
+
 	static int get_valid_count(int x);
 	static bool is_valid_count(int x);
 
 	static void fft(const Array<Complex, 1> &x, bool invert);
 	static void fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows = true, bool do_cols = true);
 
+	//! single precision variants, \see fft()
+	static void fft(const Array<ComplexFloat, 1> &x, bool invert);
+	static void fft2d(const Array<ComplexFloat, 2> &x, bool invert, bool do_rows = true, bool do_cols = true);
+
 	static void initialize();
 	static void deinitialize();
 };
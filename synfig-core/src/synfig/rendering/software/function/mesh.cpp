@@ -29,8 +29,19 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
+
+#include <algorithm>
+
 #include "mesh.h"
+#include "blend.h"
+
+#endif
 
+// the same condition as for SYNFIG_SOFTWARE_BLEND_SIMD in blendkernels.h
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SYNFIG_SOFTWARE_MESH_SIMD
+#include <emmintrin.h>
 #endif
 
 using namespace synfig;
@@ -83,7 +94,263 @@ namespace {
 			if (coords[1] < 0.0 || coords[1] > size[1])
 				coords[1] -= floor(coords[1]/size[1])*size[1];
 		}
+
+		//! edge of triangle, function a*x + b*y + c is not negative inside of triangle,
+		//! the same edge of the neighbour triangle has exactly opposite coefficients
+		struct Edge
+		{
+			Real a, b, c;
+			//! pixels with centers exactly on the edge belong to this triangle
+			bool owner;
+
+			Edge(const Vector &p0, const Vector &p1)
+			{
+				bool reverse = p1[0] < p0[0] || (p1[0] == p0[0] && p1[1] < p0[1]);
+				const Vector &q0 = reverse ? p1 : p0;
+				const Vector &q1 = reverse ? p0 : p1;
+				a = q0[1] - q1[1];
+				b = q1[0] - q0[0];
+				c = -(a*q0[0] + b*q0[1]);
+				if (reverse) { a = -a; b = -b; c = -c; }
+				owner = a > 0.0 || (a == 0.0 && b > 0.0);
+			}
+
+			//! narrows span [x0, x1) of row to pixels with centers inside of edge
+			void clip_span(Real cy, int &x0, int &x1) const
+			{
+				Real r = b*cy + c;
+				if (a == 0.0) {
+					if (r < 0.0 || (r == 0.0 && !owner)) x1 = x0;
+					return;
+				}
+				// center of pixel x is x + 0.5
+				Real t = std::max(Real(x0 - 1), std::min(Real(x1 + 1), -r/a - 0.5));
+				if (a > 0.0)
+					x0 = std::max(x0, owner ? (int)ceil(t) : (int)floor(t) + 1);
+				else
+					x1 = std::min(x1, owner ? (int)floor(t) + 1 : (int)ceil(t));
+			}
+		};
+
+		inline static bool outside(const Vector &t0, const Vector &t1, const Vector &t2, const Rect &bounds)
+		{
+			return (t0[0] < bounds.minx && t1[0] < bounds.minx && t2[0] < bounds.minx)
+			    || (t0[1] < bounds.miny && t1[1] < bounds.miny && t2[1] < bounds.miny)
+			    || (t0[0] > bounds.maxx && t1[0] > bounds.maxx && t2[0] > bounds.maxx)
+			    || (t0[1] > bounds.maxy && t1[1] > bounds.maxy && t2[1] > bounds.maxy);
+		}
+
+		inline static bool inside(const Vector &t, const Rect &bounds)
+		{
+			return t[0] >= bounds.minx && t[0] <= bounds.maxx
+			    && t[1] >= bounds.miny && t[1] <= bounds.maxy;
+		}
+
+		//! bilinear samples of \a texture along the row, interpolation is made
+		//! by premultiplied colors like in Surface::linear_sample()
+		static void sample_row(
+			Color *dest,
+			int count,
+			const synfig::Surface &texture,
+			const Vector &tex_point,
+			const Vector &tdx );
+
+		//! rasterizes triangle clipped by \a bounds,
+		//! renders transparent triangle when texture is null
+		static void render_triangle(
+			synfig::Surface &target_surface,
+			const RectInt &bounds,
+			const software::Mesh::Triangle &triangle,
+			const synfig::Surface *texture,
+			const Rect &tex_bounds,
+			Color::value_type opacity,
+			Color::BlendMethod blend_method,
+			std::vector<Color> &buffer );
 	};
+
+#ifdef SYNFIG_SOFTWARE_MESH_SIMD
+
+	inline __m128 premult(__m128 c, __m128 rgb_mask, __m128 alpha_one)
+	{
+		__m128 a = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+		return _mm_mul_ps(c, _mm_or_ps(_mm_and_ps(a, rgb_mask), alpha_one));
+	}
+
+	void
+	Internal::sample_row(
+		Color *dest,
+		int count,
+		const synfig::Surface &texture,
+		const Vector &tex_point,
+		const Vector &tdx )
+	{
+		const int w = texture.get_w();
+		const int h = texture.get_h();
+
+		// texture coordinates of pixel are in one register, texel centers are at x.5
+		__m128d coord = _mm_set_pd(tex_point[1] - 0.5, tex_point[0] - 0.5);
+		const __m128d step = _mm_set_pd(tdx[1], tdx[0]);
+		const __m128d one_d = _mm_set1_pd(1.0);
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 alpha_one = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+		const __m128 rgb_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+		for(int i = 0; i < count; ++i, coord = _mm_add_pd(coord, step)) {
+			// floor, coordinates are inside of texture, so they fit to int
+			__m128d fl = _mm_cvtepi32_pd(_mm_cvttpd_epi32(coord));
+			fl = _mm_sub_pd(fl, _mm_and_pd(_mm_cmpgt_pd(fl, coord), one_d));
+			__m128i ifl = _mm_cvttpd_epi32(fl);
+			__m128 frac = _mm_cvtpd_ps(_mm_sub_pd(coord, fl));
+
+			int u = _mm_cvtsi128_si32(ifl);
+			int v = _mm_cvtsi128_si32(_mm_shuffle_epi32(ifl, _MM_SHUFFLE(1, 1, 1, 1)));
+			int u0 = std::max(0, std::min(w - 1, u));
+			int u1 = std::max(0, std::min(w - 1, u + 1));
+			const Color *row0 = texture[std::max(0, std::min(h - 1, v))];
+			const Color *row1 = texture[std::max(0, std::min(h - 1, v + 1))];
+
+			__m128 a = _mm_shuffle_ps(frac, frac, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 b = _mm_shuffle_ps(frac, frac, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 c = _mm_sub_ps(one, a);
+			__m128 d = _mm_sub_ps(one, b);
+
+			__m128 sum =            _mm_mul_ps(premult(_mm_loadu_ps((const float*)&row0[u0]), rgb_mask, alpha_one), _mm_mul_ps(c, d));
+			sum = _mm_add_ps(sum, _mm_mul_ps(premult(_mm_loadu_ps((const float*)&row0[u1]), rgb_mask, alpha_one), _mm_mul_ps(a, d)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(premult(_mm_loadu_ps((const float*)&row1[u0]), rgb_mask, alpha_one), _mm_mul_ps(c, b)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(premult(_mm_loadu_ps((const float*)&row1[u1]), rgb_mask, alpha_one), _mm_mul_ps(a, b)));
+
+			// demultiply, fully transparent color is zero
+			__m128 alpha = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 k = _mm_or_ps(_mm_and_ps(_mm_div_ps(one, alpha), rgb_mask), alpha_one);
+			_mm_storeu_ps((float*)&dest[i], _mm_and_ps(_mm_mul_ps(sum, k), _mm_cmpneq_ps(alpha, zero)));
+		}
+	}
+
+#else
+
+	void
+	Internal::sample_row(
+		Color *dest,
+		int count,
+		const synfig::Surface &texture,
+		const Vector &tex_point,
+		const Vector &tdx )
+	{
+		const int w = texture.get_w();
+		const int h = texture.get_h();
+
+		// texel centers are at x.5
+		Vector coord = tex_point - Vector(0.5, 0.5);
+		for(int i = 0; i < count; ++i, coord += tdx) {
+			Real fx = floor(coord[0]);
+			Real fy = floor(coord[1]);
+			int u = (int)fx;
+			int v = (int)fy;
+			int u0 = std::max(0, std::min(w - 1, u));
+			int u1 = std::max(0, std::min(w - 1, u + 1));
+			const Color *row0 = texture[std::max(0, std::min(h - 1, v))];
+			const Color *row1 = texture[std::max(0, std::min(h - 1, v + 1))];
+
+			ColorReal a = (ColorReal)(coord[0] - fx);
+			ColorReal b = (ColorReal)(coord[1] - fy);
+			ColorReal c = 1.f - a;
+			ColorReal d = 1.f - b;
+
+			Color sum = synfig::Surface::value_prep_type::cook_static(row0[u0])*(c*d)
+			          + synfig::Surface::value_prep_type::cook_static(row0[u1])*(a*d)
+			          + synfig::Surface::value_prep_type::cook_static(row1[u0])*(c*b)
+			          + synfig::Surface::value_prep_type::cook_static(row1[u1])*(a*b);
+			dest[i] = synfig::Surface::value_prep_type::uncook_static(sum);
+		}
+	}
+
+#endif
+
+	void
+	Internal::render_triangle(
+		synfig::Surface &target_surface,
+		const RectInt &bounds,
+		const software::Mesh::Triangle &triangle,
+		const synfig::Surface *texture,
+		const Rect &tex_bounds,
+		Color::value_type opacity,
+		Color::BlendMethod blend_method,
+		std::vector<Color> &buffer )
+	{
+		Vector p0 = triangle.p[0], p1 = triangle.p[1], p2 = triangle.p[2];
+		Vector t0 = triangle.t[0], t1 = triangle.t[1], t2 = triangle.t[2];
+
+		// make triangle counter-clockwise, skip degenerated triangles
+		Real area = (p1[0] - p0[0])*(p2[1] - p0[1]) - (p1[1] - p0[1])*(p2[0] - p0[0]);
+		if (!(fabs(area) > real_precision<Real>()))
+			return;
+		if (area < 0.0)
+			{ std::swap(p1, p2); std::swap(t1, t2); }
+
+		Real minx = std::max((Real)bounds.minx, floor(std::min(std::min(p0[0], p1[0]), p2[0])));
+		Real miny = std::max((Real)bounds.miny, floor(std::min(std::min(p0[1], p1[1]), p2[1])));
+		Real maxx = std::min((Real)bounds.maxx, ceil (std::max(std::max(p0[0], p1[0]), p2[0])));
+		Real maxy = std::min((Real)bounds.maxy, ceil (std::max(std::max(p0[1], p1[1]), p2[1])));
+		if (!(minx < maxx) || !(miny < maxy))
+			return;
+		int x0 = (int)minx, y0 = (int)miny, x1 = (int)maxx, y1 = (int)maxy;
+
+		const Edge e0(p0, p1), e1(p1, p2), e2(p2, p0);
+
+		Matrix matrix;
+		Vector tdx;
+		if (texture) {
+			Matrix matrix_of_texture_triangle(
+				t1[0]-t0[0], t1[1]-t0[1], 0.0,
+				t2[0]-t0[0], t2[1]-t0[1], 0.0,
+				t0[0], t0[1], 1.0 );
+			Matrix matrix_of_target_triangle(
+				p1[0]-p0[0], p1[1]-p0[1], 0.0,
+				p2[0]-p0[0], p2[1]-p0[1], 0.0,
+				p0[0], p0[1], 1.0 );
+			matrix_of_target_triangle.invert();
+			matrix = matrix_of_texture_triangle * matrix_of_target_triangle;
+			tdx = matrix.get_transformed(Vector(1.0, 0.0), false);
+		}
+
+		if ((int)buffer.size() < x1 - x0)
+			buffer.resize(x1 - x0);
+
+		for(int y = y0; y < y1; ++y) {
+			Real cy = y + 0.5;
+			int xa = x0, xb = x1;
+			e0.clip_span(cy, xa, xb);
+			e1.clip_span(cy, xa, xb);
+			e2.clip_span(cy, xa, xb);
+			if (xa >= xb)
+				continue;
+
+			Color *row = target_surface[y];
+			if (!texture) {
+				std::fill(buffer.begin(), buffer.begin() + (xb - xa), Color());
+				software::Blend::blend_row(row + xa, &buffer.front(), xb - xa, opacity, blend_method);
+				continue;
+			}
+
+			// pixels outside of texture are skipped,
+			// other pixels are sampled and blended by runs
+			Vector tex_point = matrix.get_transformed(Vector(xa + 0.5, cy));
+			for(int x = xa; x < xb; ) {
+				while(x < xb && !inside(tex_point, tex_bounds))
+					{ ++x; tex_point += tdx; }
+				int begin = x;
+				Vector begin_tex_point = tex_point;
+				while(x < xb && inside(tex_point, tex_bounds))
+					{ ++x; tex_point += tdx; }
+				if (begin < x) {
+					sample_row(&buffer.front(), x - begin, *texture, begin_tex_point, tdx);
+					software::Blend::blend_row(row + begin, &buffer.front(), x - begin, opacity, blend_method);
+				}
+			}
+		}
+	}
 }
 
 void
@@ -212,163 +479,15 @@ software::Mesh::render_triangle(
 	Color::value_type opacity,
 	Color::BlendMethod blend_method )
 {
-	if (approximate_equal(opacity, Color::value_type(0))) return;
-	
-	bool straight = Color::is_straight(blend_method);
-	Rect tex_bounds = texture_rect & Rect(0.0, 0.0, texture.get_w(), texture.get_h());
-	if ( !texture.is_valid() || !tex_bounds.is_valid()
-	  || (t0[0] < tex_bounds.minx && t1[0] < tex_bounds.minx && t2[0] < tex_bounds.minx)
-	  || (t0[1] < tex_bounds.miny && t1[1] < tex_bounds.miny && t2[1] < tex_bounds.miny)
-	  || (t0[0] > tex_bounds.maxx && t1[0] > tex_bounds.maxx && t2[0] > tex_bounds.maxx)
-	  || (t0[1] > tex_bounds.maxy && t1[1] > tex_bounds.maxy && t2[1] > tex_bounds.maxy) )
-	{
-		if (straight)
-			render_triangle(
-				target_surface, target_rect,
-				p0, p1, p2, Color(), opacity, blend_method );
-		return;
-	}
-
-	if (!target_surface.is_valid()) return;
-
-	// convert points to int
-	Internal::IntVector ip0(p0), ip1(p1), ip2(p2);
-	if (ip0 == ip1 || ip0 == ip2 || ip1 == ip2) return;
-
-	RectInt bounds = target_rect & RectInt(0, 0, target_surface.get_w(), target_surface.get_h());
-	if (!bounds.is_valid()) return;
-	if (ip0.x <  bounds.minx && ip1.x <  bounds.minx && ip2.x <  bounds.minx) return;
-	if (ip0.y <  bounds.miny && ip1.y <  bounds.miny && ip2.y <  bounds.miny) return;
-	if (ip0.x >= bounds.maxx && ip1.x >= bounds.maxx && ip2.x >= bounds.maxx) return;
-	if (ip0.y >= bounds.maxy && ip1.y >= bounds.maxy && ip2.y >= bounds.maxy) return;
-
-	// prepare texture matrix
-	Matrix matrix_of_texture_triangle(
-		t1[0]-t0[0], t1[1]-t0[1], 0.0,
-		t2[0]-t0[0], t2[1]-t0[1], 0.0,
-		t0[0], t0[1], 1.0 );
-	Matrix matrix_of_target_triangle(
-		p1[0]-p0[0], p1[1]-p0[1], 0.0,
-		p2[0]-p0[0], p2[1]-p0[1], 0.0,
-		p0[0], p0[1], 1.0 );
-	matrix_of_target_triangle.invert();
-
-	Matrix matrix = matrix_of_texture_triangle * matrix_of_target_triangle;
-	Vector tdx = matrix.get_transformed(Vector(1.0, 0.0), false);
-	//Vector tdy = matrix.get_transformed(Vector(0.0, 1.0), false);
-
-	synfig::Surface::alpha_pen apen(target_surface.get_pen(0, 0));
-	apen.set_alpha(opacity);
-	apen.set_blend_method(blend_method);
-
-    // sort points
-    if (ip0.y > ip1.y) std::swap(ip0, ip1);
-    if (ip0.y > ip2.y) std::swap(ip0, ip2);
-    if (ip1.y > ip2.y) std::swap(ip1, ip2);
-
-    // increments
-    long long dx02 = (ip2-ip0).get_fixed_x_div_y();
-    long long dx01 = (ip1-ip0).get_fixed_x_div_y();
-    long long dx12 = (ip2-ip1).get_fixed_x_div_y();
-
-    // work points
-    // initially at top point (p0)
-    long long wx0 = Internal::int_to_fixed(ip0.x);
-    long long wx1 = wx0;
-
-    // process top part of triangle
-
-    // make copy of dx02
-    long long dx02_copy = dx02;
-    // sort increments
-    if (dx01 < dx02) std::swap(dx02, dx01);
-    // rasterize
-    for (int y = ip0.y; y < ip1.y; ++y)
-    {
-		// draw horizontal line (this code has a copy below)
-    	if (y >= bounds.miny && y < bounds.maxy)
-    	{
-			int x0 = Internal::fixed_to_int(wx0);
-			int x1 = Internal::fixed_to_int(wx1);
-			if (x0 <  bounds.minx) x0 = bounds.minx;
-			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
-			if (x1 >= x0)
-			{
-				apen.move_to(x0, y);
-				Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
-				for(int x = x0; x <= x1; ++x)
-				{
-					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
-					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
-					{
-						apen.set_alpha(0.0);
-						apen.put_value(Color());
-					}
-					else
-					{
-						apen.set_alpha(opacity);
-						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
-					}
-					// uncomment following line to debug
-					//apen.put_value(Color(0,0,1,0.5));
-					apen.inc_x();
-					tex_point += tdx;
-				}
-			}
-    	}
-
-		wx0 += dx02;
-		wx1 += dx01;
-    }
-
-    if (ip0.y == ip1.y) {
-		wx0 = Internal::int_to_fixed(ip0.x);
-		wx1 = Internal::int_to_fixed(ip1.x);
-		if (wx0 > wx1) std::swap(wx0, wx1);
-    }
-
-    // process bottom part of triangle
-
-    // sort increments
-    if (dx02_copy < dx12) std::swap(dx02_copy, dx12);
-
-    // rasterize
-    for (int y = ip1.y; y <= ip2.y; ++y){
-		// draw horizontal line (this code has a copy above)
-    	if (y >= bounds.miny && y < bounds.maxy)
-    	{
-			int x0 = Internal::fixed_to_int(wx0);
-			int x1 = Internal::fixed_to_int(wx1);
-			if (x0 <  bounds.minx) x0 = bounds.minx;
-			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
-			if (x1 >= x0)
-			{
-				apen.move_to(x0, y);
-				Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
-				for(int x = x0; x <= x1; ++x)
-				{
-					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
-					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
-					{
-						apen.set_alpha(0.0);
-						apen.put_value(Color());
-					}
-					else
-					{
-						apen.set_alpha(opacity);
-						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
-					}
-					// uncomment following line to debug
-					//apen.put_value(Color(1,0,0,0.5));
-					apen.inc_x();
-					tex_point += tdx;
-				}
-			}
-    	}
-
-		wx0 += dx02_copy;
-		wx1 += dx12;
-    }
+	Triangle triangle;
+	triangle.p[0] = p0; triangle.t[0] = t0;
+	triangle.p[1] = p1; triangle.t[1] = t1;
+	triangle.p[2] = p2; triangle.t[2] = t2;
+	render_triangles(
+		target_surface, target_rect,
+		TriangleList(1, triangle),
+		texture, texture_rect,
+		opacity, blend_method );
 }
 
 void
@@ -450,44 +569,29 @@ software::Mesh::render_mesh(
 	Color::value_type opacity,
 	Color::BlendMethod blend_method )
 {
-	if ( !texture.is_valid()
-	  || !(texture_rect & Rect(0.0, 0.0, texture.get_w(), texture.get_h())).is_valid() )
-	{
-		if (Color::is_straight(blend_method))
-			render_polygon(
-				target_surface, target_rect,
-				vertices, vertices_strip,
-				triangles, triangles_strip, triangles_count,
-				transform_matrix, Color(), opacity, blend_method );
-		return;
-	}
-
-	if (approximate_equal(opacity, Color::value_type(0))) return;
-	if (!target_surface.is_valid()) return;
-	RectInt bounds = target_rect & RectInt(0, 0, target_surface.get_w(), target_surface.get_h());
-	if (!bounds.is_valid()) return;
-
 	if (vertices_strip <= 0) vertices_strip = sizeof(Vector);
 	if (tex_coords_strip <= 0) tex_coords_strip = sizeof(Vector);
 	if (triangles_strip <= 0) triangles_strip = sizeof(int[3]);
 
+	TriangleList list(triangles_count);
 	for(int i = 0; i < triangles_count; ++i)
 	{
 		int *triangle = (int*)((char*)triangles + i*triangles_strip);
-		render_triangle(
-			target_surface,
-			target_rect,
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[0]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[0]*tex_coords_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[1]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[1]*tex_coords_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[2]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[2]*tex_coords_strip)),
-			texture,
-			texture_rect,
-			opacity,
-			blend_method );
+		for(int j = 0; j < 3; ++j)
+		{
+			list[i].p[j] = transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[j]*vertices_strip));
+			list[i].t[j] = texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[j]*tex_coords_strip));
+		}
 	}
+
+	render_triangles(
+		target_surface,
+		target_rect,
+		list,
+		texture,
+		texture_rect,
+		opacity,
+		blend_method );
 }
 
 void
@@ -502,22 +606,129 @@ software::Mesh::render_mesh(
 	Color::value_type opacity,
 	Color::BlendMethod blend_method )
 {
-	render_mesh(
+	TriangleList triangles;
+	transform_triangles(mesh, transform_matrix, texture_matrix, target_rect, triangles);
+	render_triangles(
 		target_surface,
 		target_rect,
-		&mesh.vertices.front().position,
-		sizeof(mesh.vertices.front()),
-		&mesh.vertices.front().tex_coords,
-		sizeof(mesh.vertices.front()),
-		mesh.triangles.front().vertices,
-		sizeof(mesh.triangles.front()),
-		mesh.triangles.size(),
+		triangles,
 		texture,
 		texture_rect,
-		transform_matrix,
-		texture_matrix,
 		opacity,
 		blend_method );
 }
 
+void
+software::Mesh::transform_triangles(
+	const rendering::Mesh &mesh,
+	const Matrix &transform_matrix,
+	const Matrix &texture_matrix,
+	const RectInt &target_rect,
+	TriangleList &out_triangles )
+{
+	out_triangles.clear();
+
+	std::vector<Vector> positions(mesh.vertices.size());
+	std::vector<Vector> tex_coords(mesh.vertices.size());
+	for(int i = 0; i < (int)mesh.vertices.size(); ++i)
+	{
+		positions[i] = transform_matrix.get_transformed(mesh.vertices[i].position);
+		tex_coords[i] = texture_matrix.get_transformed(mesh.vertices[i].tex_coords);
+	}
+
+	out_triangles.reserve(mesh.triangles.size());
+	for(rendering::Mesh::TriangleList::const_iterator i = mesh.triangles.begin(); i != mesh.triangles.end(); ++i)
+	{
+		const Vector &p0 = positions[i->vertices[0]];
+		const Vector &p1 = positions[i->vertices[1]];
+		const Vector &p2 = positions[i->vertices[2]];
+		if ( (p0[0] <  target_rect.minx && p1[0] <  target_rect.minx && p2[0] <  target_rect.minx)
+		  || (p0[1] <  target_rect.miny && p1[1] <  target_rect.miny && p2[1] <  target_rect.miny)
+		  || (p0[0] >= target_rect.maxx && p1[0] >= target_rect.maxx && p2[0] >= target_rect.maxx)
+		  || (p0[1] >= target_rect.maxy && p1[1] >= target_rect.maxy && p2[1] >= target_rect.maxy) )
+			continue;
+
+		out_triangles.push_back(Triangle());
+		Triangle &triangle = out_triangles.back();
+		for(int j = 0; j < 3; ++j)
+		{
+			triangle.p[j] = positions[i->vertices[j]];
+			triangle.t[j] = tex_coords[i->vertices[j]];
+		}
+	}
+}
+
+void
+software::Mesh::split_tiles(
+	const TriangleList &triangles,
+	const RectInt &target_rect,
+	int tile_size,
+	std::vector<TriangleList> &out_tiles )
+{
+	out_tiles.clear();
+	if (!target_rect.is_valid() || tile_size <= 0)
+		return;
+
+	int tiles_x = (target_rect.maxx - target_rect.minx + tile_size - 1)/tile_size;
+	int tiles_y = (target_rect.maxy - target_rect.miny + tile_size - 1)/tile_size;
+	out_tiles.resize(tiles_x*tiles_y);
+
+	for(TriangleList::const_iterator i = triangles.begin(); i != triangles.end(); ++i)
+	{
+		Real minx = std::min(std::min(i->p[0][0], i->p[1][0]), i->p[2][0]) - target_rect.minx;
+		Real miny = std::min(std::min(i->p[0][1], i->p[1][1]), i->p[2][1]) - target_rect.miny;
+		Real maxx = std::max(std::max(i->p[0][0], i->p[1][0]), i->p[2][0]) - target_rect.minx;
+		Real maxy = std::max(std::max(i->p[0][1], i->p[1][1]), i->p[2][1]) - target_rect.miny;
+		if (!(minx < tiles_x*tile_size) || !(miny < tiles_y*tile_size) || !(maxx >= 0.0) || !(maxy >= 0.0))
+			continue;
+
+		int tx0 = std::max(0, (int)floor(minx/tile_size));
+		int ty0 = std::max(0, (int)floor(miny/tile_size));
+		int tx1 = std::min(tiles_x - 1, (int)floor(maxx/tile_size));
+		int ty1 = std::min(tiles_y - 1, (int)floor(maxy/tile_size));
+		for(int ty = ty0; ty <= ty1; ++ty)
+			for(int tx = tx0; tx <= tx1; ++tx)
+				out_tiles[ty*tiles_x + tx].push_back(*i);
+	}
+}
+
+void
+software::Mesh::render_triangles(
+	synfig::Surface &target_surface,
+	const RectInt &target_rect,
+	const TriangleList &triangles,
+	const synfig::Surface &texture,
+	const Rect &texture_rect,
+	Color::value_type opacity,
+	Color::BlendMethod blend_method )
+{
+	if (approximate_equal(opacity, Color::value_type(0))) return;
+	if (!target_surface.is_valid()) return;
+	RectInt bounds = target_rect & RectInt(0, 0, target_surface.get_w(), target_surface.get_h());
+	if (!bounds.is_valid()) return;
+
+	// triangles outside of texture are transparent, so they change target only by straight blending
+	bool straight = Color::is_straight(blend_method);
+	Rect tex_bounds = texture_rect & Rect(0.0, 0.0, texture.get_w(), texture.get_h());
+	bool valid_texture = texture.is_valid() && tex_bounds.is_valid();
+	if (!valid_texture && !straight) return;
+
+	std::vector<Color> buffer(bounds.maxx - bounds.minx);
+	for(TriangleList::const_iterator i = triangles.begin(); i != triangles.end(); ++i)
+	{
+		bool textured = valid_texture && !Internal::outside(i->t[0], i->t[1], i->t[2], tex_bounds);
+		if (!textured && !straight)
+			continue;
+		Internal::render_triangle(
+			target_surface,
+			bounds,
+			*i,
+			textured ? &texture : NULL,
+			tex_bounds,
+			opacity,
+			blend_method,
+			buffer );
+	}
+}
+
 /* === E N T R Y P O I N T ================================================= */
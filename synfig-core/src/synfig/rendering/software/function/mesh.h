@@ -27,6 +27,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <vector>
+
 #include <synfig/rect.h>
 #include <synfig/surface.h>
 
@@ -48,6 +50,16 @@ namespace software
 class Mesh
 {
 public:
+	//! triangle with vertices in pixels of target surface
+	//! and texture coordinates in pixels of texture
+	struct Triangle
+	{
+		Vector p[3];
+		Vector t[3];
+	};
+
+	typedef std::vector<Triangle> TriangleList;
+
 	static void render_triangle(
 		synfig::Surface &target_surface,
 		const RectInt &target_rect,
@@ -121,6 +133,35 @@ public:
 		const Matrix &texture_matrix,
 		Color::value_type opacity,
 		Color::BlendMethod blend_method );
+
+	//! transforms each vertex of \a mesh once, so neighbour triangles
+	//! have exactly the same shared edges, skips triangles outside of \a target_rect
+	static void transform_triangles(
+		const rendering::Mesh &mesh,
+		const Matrix &transform_matrix,
+		const Matrix &texture_matrix,
+		const RectInt &target_rect,
+		TriangleList &out_triangles );
+
+	//! bins triangles to square tiles of \a tile_size pixels which cover \a target_rect,
+	//! tiles go by rows, triangles keep their order in each tile
+	static void split_tiles(
+		const TriangleList &triangles,
+		const RectInt &target_rect,
+		int tile_size,
+		std::vector<TriangleList> &out_tiles );
+
+	//! renders textured triangles clipped by \a target_rect, which may be
+	//! the whole target or its tile. Pixel belongs to triangle when its center
+	//! is inside, so pixels of shared edges are blended once.
+	static void render_triangles(
+		synfig::Surface &target_surface,
+		const RectInt &target_rect,
+		const TriangleList &triangles,
+		const synfig::Surface &texture,
+		const Rect &texture_rect,
+		Color::value_type opacity,
+		Color::BlendMethod blend_method );
 };
 
 } /* end namespace software */
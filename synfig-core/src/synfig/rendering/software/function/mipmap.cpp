@@ -0,0 +1,115 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/mipmap.cpp
+**	\brief Mipmap
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "mipmap.h"
+#include "resample.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+void
+software::Mipmap::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for(std::vector<PackedSurface*>::iterator i = levels.begin(); i != levels.end(); ++i)
+		delete *i;
+	levels.clear();
+}
+
+const software::PackedSurface*
+software::Mipmap::get_level(const PackedSurface &source, int level) const
+{
+	if (level <= 0)
+		return &source;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	while((int)levels.size() < level) {
+		const PackedSurface &prev = levels.empty() ? source : *levels.back();
+		int w = prev.get_width();
+		int h = prev.get_height();
+		if (w <= 1 && h <= 1)
+			break;
+
+		int lw, lh;
+		get_level_size(w, h, 1, lw, lh);
+
+		// only the previous level is read, so each level costs
+		// a quarter of the previous one
+		synfig::Surface surface(lw, lh);
+		Resample::downscale(surface, RectInt(0, 0, lw, lh), prev, RectInt(0, 0, w, h));
+
+		PackedSurface *packed = new PackedSurface();
+		packed->set_pixels(surface[0], lw, lh, surface.get_pitch());
+		levels.push_back(packed);
+	}
+
+	return levels.empty() ? &source : levels[std::min(level, (int)levels.size()) - 1];
+}
+
+void
+software::Mipmap::get_level_size(int width, int height, int level, int &level_width, int &level_height)
+{
+	level_width = width;
+	level_height = height;
+	for(int i = 0; i < level; ++i) {
+		level_width = std::max(1, (level_width + 1)/2);
+		level_height = std::max(1, (level_height + 1)/2);
+	}
+}
+
+int
+software::Mipmap::choose_level(int width, int height, int min_width, int min_height)
+{
+	int level = 0;
+	while(width > 1 || height > 1) {
+		int w, h;
+		get_level_size(width, height, 1, w, h);
+		if (w < min_width || h < min_height)
+			break;
+		width = w;
+		height = h;
+		++level;
+	}
+	return level;
+}
+
+/* === E N T R Y P O I N T ================================================= */
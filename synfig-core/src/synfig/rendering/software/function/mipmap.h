@@ -0,0 +1,86 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/mipmap.h
+**	\brief Mipmap Header
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_MIPMAP_H
+#define __SYNFIG_RENDERING_SOFTWARE_MIPMAP_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <mutex>
+#include <vector>
+
+#include "packedsurface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+/*!	\class Mipmap
+**	\brief Pyramid of downscaled copies of PackedSurface.
+**
+**	Each level is twice smaller than previous one (rounded up),
+**	level 0 is the source surface itself. Levels are built on demand,
+**	every level from the previous one, and kept until clear().
+*/
+class Mipmap
+{
+private:
+	mutable std::mutex mutex;
+	mutable std::vector<PackedSurface*> levels;
+
+	Mipmap(const Mipmap&) { }
+	Mipmap& operator= (const Mipmap&) { return *this; }
+
+public:
+	Mipmap() { }
+	~Mipmap() { clear(); }
+
+	//! should be called when source surface changes
+	void clear();
+
+	//! returns level with given index, builds it if need,
+	//! pointer stays valid until clear()
+	const PackedSurface* get_level(const PackedSurface &source, int level) const;
+
+	static void get_level_size(int width, int height, int level, int &level_width, int &level_height);
+
+	//! returns biggest level index which is not smaller than
+	//! \a min_width x \a min_height
+	static int choose_level(int width, int height, int min_width, int min_height);
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -57,6 +57,16 @@ namespace {
 		struct MapPixelFull { int src; int dst; };
 		struct MapPixelPart { int src; int dst; ColorReal k0; ColorReal k1; };
 
+		// size of destination pixel in source pixels, with reserve for interpolation
+		static Vector get_downscale_resolution(const Matrix &transformation)
+		{
+			const Real threshold = 1.2;
+			Transformation::Bounds bounds =
+				TransformationAffine( transformation.get_inverted() )
+					.transform_bounds( Rect(0.0, 0.0, 1.0, 1.0), Vector(1.0, 1.0) );
+			return bounds.resolution * threshold;
+		}
+
 		template< Color reader(const void*,int,int),
 				ColorAccumulator reader_cook(const void*,int,int) >
 		class Generic {
@@ -431,17 +441,12 @@ namespace {
 				Color::BlendMethod blend_method )
 			{
 				if (interpolation != Color::INTERPOLATION_NEAREST) {
-					const Real threshold = 1.2;
-
-					Transformation::Bounds bounds =
-						TransformationAffine( transformation.get_inverted() )
-							.transform_bounds( Rect(0.0, 0.0, 1.0, 1.0), Vector(1.0, 1.0) );
-					bounds.resolution *= threshold;
+					Vector resolution = get_downscale_resolution(transformation);
 
 					int sw = src_bounds.get_width();
 					int sh = src_bounds.get_height();
-					int w = std::min( sw, std::max(1, (int)ceil((Real)sw * bounds.resolution[0])) );
-					int h = std::min( sh, std::max(1, (int)ceil((Real)sh * bounds.resolution[1])) );
+					int w = std::min( sw, std::max(1, (int)ceil((Real)sw * resolution[0])) );
+					int h = std::min( sh, std::max(1, (int)ceil((Real)sh * resolution[1])) );
 
 					if (w < sw || h < sh) {
 						synfig::Surface new_src(w, h);
@@ -505,9 +510,10 @@ software::Resample::downscale(
 	bool keep_cooked )
 {
 	typedef software::PackedSurface::Reader Reader;
+	software::PackedSurface::Reader src_reader(src);
 	Helper::Generic<Reader::reader, Reader::reader_cook>::downscale(
 		dest, dest_bounds,
-		&src, src_bounds,
+		&src_reader, src_bounds,
 		keep_cooked );
 }
 
@@ -547,8 +553,45 @@ software::Resample::resample(
 	Color::Interpolation interpolation,
 	bool blend,
 	ColorReal blend_amount,
-	Color::BlendMethod blend_method )
+	Color::BlendMethod blend_method,
+	const software::Mipmap *mipmap )
 {
+	if ( mipmap
+	  && interpolation != Color::INTERPOLATION_NEAREST
+	  && src_bounds.minx == 0 && src_bounds.maxx == src.get_width()
+	  && src_bounds.miny == 0 && src_bounds.maxy == src.get_height() )
+	{
+		// read the smallest level which still has enough pixels,
+		// so work depends on the size of the result, not of the source
+		Vector resolution = Helper::get_downscale_resolution(transformation);
+		int sw = src_bounds.get_width();
+		int sh = src_bounds.get_height();
+		int level = Mipmap::choose_level(
+			sw, sh,
+			(int)ceil((Real)sw * resolution[0]),
+			(int)ceil((Real)sh * resolution[1]) );
+		if (level > 0) {
+			const PackedSurface *level_surface = mipmap->get_level(src, level);
+			int w = level_surface->get_width();
+			int h = level_surface->get_height();
+			if (w < sw || h < sh) {
+				Matrix level_transformation = transformation
+											* Matrix().set_scale((Real)sw/(Real)w, (Real)sh/(Real)h);
+				resample(
+					dest,
+					dest_bounds,
+					*level_surface,
+					RectInt(0, 0, w, h),
+					level_transformation,
+					interpolation,
+					blend,
+					blend_amount,
+					blend_method );
+				return;
+			}
+		}
+	}
+
 	typedef software::PackedSurface::Reader Reader;
 	software::PackedSurface::Reader src_reader(src);
 	Helper::Generic<Reader::reader, Reader::reader_cook>::resample_with_downscale(
@@ -31,6 +31,7 @@
 #include <synfig/surface.h>
 
 #include "../surfaceswpacked.h"
+#include "mipmap.h"
 
 /* === M A C R O S ========================================================= */
 
@@ -73,6 +74,8 @@ public:
 		ColorReal blend_amount,
 		Color::BlendMethod blend_method );
 
+	//! if \a mipmap is set, the nearest level of it is read instead of
+	//! \a src when image is downscaled and \a src_bounds covers whole \a src
 	static void resample(
 		synfig::Surface &dest,
 		const RectInt &dest_bounds,
@@ -82,7 +85,8 @@ public:
 		Color::Interpolation interpolation,
 		bool blend,
 		ColorReal blend_amount,
-		Color::BlendMethod blend_method );
+		Color::BlendMethod blend_method,
+		const software::Mipmap *mipmap = NULL );
 };
 
 } /* end namespace software */
@@ -0,0 +1,164 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfacepool.cpp
+**	\brief SurfacePool
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+#include <cstdlib>
+
+#include "surfacepool.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+const size_t SurfacePool::min_size = 256*1024;
+
+
+SurfacePool::SurfacePool(size_t memory_limit):
+	memory_limit(memory_limit), memory(), hits(), misses() { }
+
+SurfacePool::~SurfacePool()
+	{ clear(); }
+
+SurfacePool&
+SurfacePool::get_instance()
+{
+	// never destroyed, surfaces may be released while static objects destruct
+	static SurfacePool *pool = new SurfacePool(256*1024*1024);
+	return *pool;
+}
+
+size_t
+SurfacePool::calc_bucket_size(size_t size)
+{
+	if (size < min_size) return size;
+	size_t quarter = min_size/4;
+	while(quarter*8 <= size) quarter *= 2;
+	return (size + quarter - 1)/quarter*quarter;
+}
+
+void
+SurfacePool::shrink(size_t limit)
+{
+	// biggest buffers are freed first
+	while(memory > limit && !buffers.empty()) {
+		Map::iterator i = buffers.end(); --i;
+		memory -= i->first;
+		std::free(i->second);
+		buffers.erase(i);
+	}
+}
+
+void*
+SurfacePool::alloc(size_t size, bool &zeroed)
+{
+	size_t bucket_size = calc_bucket_size(size);
+	if (bucket_size >= min_size) {
+		std::lock_guard<std::mutex> lock(mutex);
+		Map::iterator i = buffers.find(bucket_size);
+		if (i != buffers.end()) {
+			void *buffer = i->second;
+			memory -= bucket_size;
+			buffers.erase(i);
+			++hits;
+			zeroed = false;
+			return buffer;
+		}
+		++misses;
+	}
+
+	zeroed = true;
+	if (void *buffer = std::calloc(bucket_size, 1))
+		return buffer;
+
+	// out of memory, release kept buffers and try again
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shrink(0);
+	}
+	return std::calloc(bucket_size, 1);
+}
+
+void
+SurfacePool::free(void *buffer, size_t size)
+{
+	if (!buffer) return;
+	size_t bucket_size = calc_bucket_size(size);
+	if (bucket_size >= min_size) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (bucket_size <= memory_limit) {
+			shrink(memory_limit - bucket_size);
+			buffers.insert(Map::value_type(bucket_size, buffer));
+			memory += bucket_size;
+			return;
+		}
+	}
+	std::free(buffer);
+}
+
+void
+SurfacePool::set_memory_limit(size_t x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	memory_limit = x;
+	shrink(memory_limit);
+}
+
+size_t
+SurfacePool::get_memory_limit() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory_limit;
+}
+
+size_t
+SurfacePool::get_memory() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memory;
+}
+
+void
+SurfacePool::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	shrink(0);
+	assert(buffers.empty() && !memory);
+}
+
+/* === E N T R Y P O I N T ================================================= */
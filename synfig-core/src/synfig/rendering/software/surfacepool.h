@@ -0,0 +1,109 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfacepool.h
+**	\brief SurfacePool Header
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SURFACEPOOL_H
+#define __SYNFIG_RENDERING_SURFACEPOOL_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstddef>
+
+#include <map>
+#include <atomic>
+#include <mutex>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+/*!	\class SurfacePool
+**	\brief Keeps released pixel buffers of software surfaces for reuse.
+**
+**	Sizes are rounded up to buckets (four buckets per power of two),
+**	so surfaces of slightly different size share buffers. Released buffers
+**	are kept while their total size fits the memory limit, the biggest
+**	ones are freed first. Small buffers are not pooled at all.
+**
+**	New buffers come zeroed from calloc(), so the system maps zero pages
+**	lazily and nothing is touched until the first write. Only reused
+**	buffers need to be cleared by the caller (see \a zeroed flag of alloc()).
+*/
+class SurfacePool
+{
+private:
+	typedef std::multimap<size_t, void*> Map;
+
+	static const size_t min_size;
+
+	mutable std::mutex mutex;
+	size_t memory_limit;
+	size_t memory;
+	Map buffers;
+
+	std::atomic<long long> hits;
+	std::atomic<long long> misses;
+
+	void shrink(size_t limit);
+
+	SurfacePool(const SurfacePool&): memory_limit(), memory(), hits(), misses() { }
+	SurfacePool& operator= (const SurfacePool&) { return *this; }
+
+public:
+	explicit SurfacePool(size_t memory_limit = 0);
+	~SurfacePool();
+
+	//! pool shared by all software surfaces
+	static SurfacePool& get_instance();
+
+	static size_t calc_bucket_size(size_t size);
+
+	//! returns buffer of at least \a size bytes, or NULL if out of memory
+	void* alloc(size_t size, bool &zeroed);
+	//! returns buffer into pool, \a size should be the same as for alloc()
+	void free(void *buffer, size_t size);
+
+	//! zero limit disables the pool
+	void set_memory_limit(size_t x);
+	size_t get_memory_limit() const;
+	//! total size of buffers kept in pool
+	size_t get_memory() const;
+
+	long long get_hits() const { return hits; }
+	long long get_misses() const { return misses; }
+	void reset_counters() { hits = 0; misses = 0; }
+
+	void clear();
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -30,6 +30,7 @@
 #endif
 
 #include "surfacesw.h"
+#include "surfacepool.h"
 
 #endif
 
@@ -51,12 +52,16 @@ rendering::Surface::Token SurfaceSW::token(
 
 SurfaceSW::SurfaceSW():
 	own_surface(true),
-	surface(new synfig::Surface())
+	surface(new synfig::Surface()),
+	buffer(),
+	buffer_size()
 { }
 
 SurfaceSW::SurfaceSW(synfig::Surface &surface, bool own_surface):
 	own_surface(own_surface),
-	surface(&surface)
+	surface(&surface),
+	buffer(),
+	buffer_size()
 {
 	assert(this->surface);
 	set_desc(this->surface->get_w(), this->surface->get_h(), false);
@@ -68,26 +73,56 @@ SurfaceSW::~SurfaceSW()
 	if (own_surface)
 		{ assert(surface); delete surface; }
 	surface = NULL;
+	release_buffer();
 	set_desc(0, 0, true);
 }
 
 bool
-SurfaceSW::create_vfunc(int width, int height)
+SurfaceSW::alloc_buffer(int width, int height, bool clear)
 {
 	assert(surface);
-	surface->set_wh(width, height);
-	surface->clear();
+	if (!own_surface) {
+		// surface may live longer than this object, so it should own pixels
+		surface->set_wh(width, height);
+		if (clear) surface->clear();
+		return true;
+	}
+
+	size_t size = sizeof(Color)*width*height;
+	bool zeroed = false;
+	void *buffer = SurfacePool::get_instance().alloc(size, zeroed);
+	if (!buffer)
+		return false;
+
+	surface->set_wh(width, height, (unsigned char*)buffer, sizeof(Color)*width);
+	release_buffer();
+	this->buffer = buffer;
+	buffer_size = size;
+
+	if (clear && !zeroed) surface->clear();
 	return true;
 }
 
+void
+SurfaceSW::release_buffer()
+{
+	SurfacePool::get_instance().free(buffer, buffer_size);
+	buffer = NULL;
+	buffer_size = 0;
+}
+
+bool
+SurfaceSW::create_vfunc(int width, int height)
+	{ return alloc_buffer(width, height, true); }
+
 bool
 SurfaceSW::assign_vfunc(const rendering::Surface &surface)
 {
 	assert(this->surface);
-	this->surface->set_wh(surface.get_width(), surface.get_height());
-	if (surface.get_pixels(&(*this->surface)[0][0]))
+	if ( alloc_buffer(surface.get_width(), surface.get_height(), false)
+	  && surface.get_pixels(&(*this->surface)[0][0]) )
 		return true;
-	this->surface->set_wh(0, 0);
+	reset_vfunc();
 	set_desc(0, 0, true);
 	return false;
 }
@@ -105,6 +140,7 @@ SurfaceSW::reset_vfunc()
 {
 	assert(surface);
 	surface->set_wh(0, 0);
+	release_buffer();
 	return true;
 }
 
@@ -120,6 +156,12 @@ void
 SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 {
 	if (&surface == this->surface) {
+		if (buffer && !own_surface) {
+			// surface will not be owned, so it should not refer to the pooled buffer
+			synfig::Surface copy(surface);
+			surface = copy;
+			release_buffer();
+		}
 		this->own_surface = own_surface;
 		return;
 	}
@@ -128,6 +170,7 @@ SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 		assert(this->surface);
 		delete(this->surface);
 	}
+	release_buffer();
 
 	this->surface = &surface;
 	assert(this->surface);
@@ -142,6 +185,7 @@ SurfaceSW::reset_surface()
 		assert(surface);
 		delete(surface);
 	}
+	release_buffer();
 	own_surface = true;
 	surface = new synfig::Surface();
 	set_desc(0, 0, true);
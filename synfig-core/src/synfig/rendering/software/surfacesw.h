@@ -53,6 +53,11 @@ public:
 private:
 	bool own_surface;
 	synfig::Surface *surface;
+	void *buffer;        //!< pixels of own surface, taken from SurfacePool
+	size_t buffer_size;
+
+	bool alloc_buffer(int width, int height, bool clear);
+	void release_buffer();
 
 protected:
 	virtual bool create_vfunc(int width, int height);
@@ -30,6 +30,7 @@
 #endif
 
 #include "surfaceswpacked.h"
+#include "surfacepool.h"
 
 #endif
 
@@ -52,21 +53,33 @@ rendering::Surface::Token SurfaceSWPacked::token(
 bool
 SurfaceSWPacked::assign_vfunc(const rendering::Surface &surface)
 {
-	std::vector<Color> data;
+	mipmap.clear();
+
 	const Color *pixels = surface.get_pixels_pointer();
-	if (!pixels) {
-		data.resize(get_pixels_count());
-		if (!surface.get_pixels(&data.front()))
-			return false;
-		pixels = &data.front();
+	if (pixels) {
+		this->surface.set_pixels(pixels, surface.get_width(), surface.get_height());
+		return true;
 	}
-	this->surface.set_pixels(pixels, surface.get_width(), surface.get_height());
-	return true;
+
+	// temporary buffer for unpacked pixels
+	SurfacePool &pool = SurfacePool::get_instance();
+	size_t size = sizeof(Color)*surface.get_width()*surface.get_height();
+	bool zeroed = false;
+	Color *buffer = (Color*)pool.alloc(size, zeroed);
+	if (!buffer)
+		return false;
+
+	bool success = surface.get_pixels(buffer);
+	if (success)
+		this->surface.set_pixels(buffer, surface.get_width(), surface.get_height());
+	pool.free(buffer, size);
+	return success;
 }
 
 bool
 SurfaceSWPacked::reset_vfunc()
 {
+	mipmap.clear();
 	surface.clear();
 	return true;
 }
@@ -29,6 +29,7 @@
 
 #include "../surface.h"
 
+#include "function/mipmap.h"
 #include "function/packedsurface.h"
 
 /* === M A C R O S ========================================================= */
@@ -57,6 +58,7 @@ protected:
 
 private:
 	software::PackedSurface surface;
+	software::Mipmap mipmap;
 
 public:
 	SurfaceSWPacked()
@@ -65,6 +67,9 @@ public:
 		{ assign(other); }
 	const software::PackedSurface& get_surface() const
 		{ return surface; }
+	//! downscaled copies of surface, built on demand
+	const software::Mipmap& get_mipmap() const
+		{ return mipmap; }
 };
 
 } /* end namespace rendering */
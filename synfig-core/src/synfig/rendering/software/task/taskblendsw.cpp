@@ -35,6 +35,7 @@
 
 #include "../../common/task/taskblend.h"
 #include "tasksw.h"
+#include "../function/blend.h"
 
 #endif
 
@@ -130,15 +131,7 @@ public:
 					assert( 0 <= rb.minx + ob[0] && rb.maxx + ob[0] <= b.get_w()
 						 && 0 <= rb.miny + ob[1] && rb.maxy + ob[1] <= b.get_h() );
 
-					synfig::Surface::alpha_pen ap(c.get_pen(rb.minx, rb.miny));
-					ap.set_blend_method(blend_method);
-					ap.set_alpha(amount);
-					b.blit_to(
-						ap,
-						rb.minx + ob[0],
-						rb.miny + ob[1],
-						rb.maxx - rb.minx,
-						rb.maxy - rb.miny );
+					software::Blend::blend(c, rb, b, ob, amount, blend_method);
 
 					if (ra.is_valid())
 					{
@@ -163,13 +156,7 @@ public:
 					assert( 0 <= fill[i].minx && fill[i].minx < fill[i].maxx && fill[i].maxx <= c.get_w()
 						 && 0 <= fill[i].miny && fill[i].miny < fill[i].maxy && fill[i].miny <= c.get_h() );
 
-					synfig::Surface::alpha_pen ap(
-						c.get_pen(fill[i].minx, fill[i].miny) );
-					ap.set_blend_method(blend_method);
-					ap.set_alpha(amount);
-					c.fill( Color(0, 0, 0, 0), ap,
-							fill[i].maxx - fill[i].minx,
-							fill[i].maxy - fill[i].miny );
+					software::Blend::fill(c, fill[i], Color(0, 0, 0, 0), amount, blend_method);
 				}
 			}
 		}
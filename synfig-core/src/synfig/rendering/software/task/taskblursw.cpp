@@ -51,7 +51,9 @@ using namespace rendering;
 
 namespace {
 
-class TaskBlurSW: public TaskBlur, public TaskSW, public TaskInterfaceBlendToTarget
+class TaskBlurSW: public TaskBlur, public TaskSW,
+	public TaskInterfaceBlendToTarget,
+	public TaskInterfaceSplit
 {
 public:
 	typedef etl::handle<TaskBlurSW> Handle;
@@ -63,6 +65,12 @@ public:
 	virtual Color::BlendMethodFlags get_supported_blend_methods() const
 		{ return Color::BLEND_METHODS_ALL & ~Color::BLEND_METHODS_STRAIGHT; }
 
+	virtual VectorInt get_split_overlap() const {
+		return is_valid_coords()
+		     ? software::Blur::get_extra_size(blur.type, blur.size.multiply_coords(get_pixels_per_unit()))
+		     : VectorInt::zero();
+	}
+
 	virtual bool run(RunParams&) const {
 		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
 			return true;
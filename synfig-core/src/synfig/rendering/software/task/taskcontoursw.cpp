@@ -29,12 +29,17 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <vector>
+
+#include <synfig/threadpool.h>
 #include <synfig/debug/debugsurface.h>
 
 #include "../../primitive/polyspan.h"
 #include "../../common/task/taskcontour.h"
 #include "../../common/task/taskblend.h"
 #include "tasksw.h"
+#include "../contourcache.h"
 #include "../function/contour.h"
 
 #endif
@@ -56,6 +61,36 @@ class TaskContourSW: public TaskContour, public TaskSW,
 	public TaskInterfaceBlendToTarget,
 	public TaskInterfaceSplit
 {
+private:
+	//! band should not be smaller than the minimal band of OptimizerSplit
+	static const int min_band_area = 128*128;
+	//! few bands per thread allows to balance bands with different count of edges
+	static const int bands_per_thread = 4;
+
+	//! rasterizes chunks clipped by rect, which may be the whole target rect or its band
+	void render_band(
+		synfig::Surface *surface,
+		const rendering::Contour::ChunkList *chunks,
+		const Matrix &matrix,
+		const RectInt &rect ) const
+	{
+		Polyspan polyspan;
+		polyspan.init(rect, software::Contour::is_dense(*chunks, matrix, rect));
+		software::Contour::build_polyspan(*chunks, matrix, polyspan, detail);
+		polyspan.close();
+		polyspan.sort_marks();
+
+		software::Contour::render_polyspan(
+			*surface,
+			polyspan,
+			contour->invert,
+			allow_antialias && contour->antialias,
+			contour->winding_style,
+			contour->color,
+			blend ? amount : 1.0,
+			blend ? blend_method : Color::BLEND_COMPOSITE );
+	}
+
 public:
 	typedef etl::handle<TaskContourSW> Handle;
 	static Token token;
@@ -92,25 +127,44 @@ public:
 
 		Matrix matrix = bounds_transfromation * transformation->matrix;
 
-		Polyspan polyspan;
-		polyspan.init(target_rect);
-		software::Contour::build_polyspan(contour->get_chunks(), matrix, polyspan, detail);
-		polyspan.close();
-		polyspan.sort_marks();
+		// curves of contour which was rendered before at similar scale are already flattened
+		ContourCache::Handle flattened = ContourCache::get_instance().get(*contour, matrix, detail, target_rect);
+		const rendering::Contour::ChunkList &chunks = flattened ? *flattened : contour->get_chunks();
 
 		LockWrite la(this);
 		if (!la)
 			return false;
 
-		software::Contour::render_polyspan(
-			la->get_surface(),
-			polyspan,
-			contour->invert,
-			allow_antialias && contour->antialias,
-			contour->winding_style,
-			contour->color,
-			blend ? amount : 1.0,
-			blend ? blend_method : Color::BLEND_COMPOSITE );
+		// large contour is split to horizontal bands which rasterized in parallel,
+		// winding is accumulated along rows, so bands don't depend from each other
+		int w = target_rect.maxx - target_rect.minx;
+		int h = target_rect.maxy - target_rect.miny;
+		int max_bands = bands_per_thread*ThreadPool::instance().get_max_threads();
+		int band_rows = std::max((min_band_area + w - 1)/w, (h + max_bands - 1)/max_bands);
+
+		if (band_rows >= h) {
+			render_band(&la->get_surface(), &chunks, matrix, target_rect);
+			return true;
+		}
+
+		std::vector<rendering::Contour::ChunkList> bands;
+		software::Contour::split_bands(chunks, matrix, target_rect, band_rows, bands);
+
+		ThreadPool::Group group;
+		for(int i = 0; i < (int)bands.size(); ++i) {
+			if (bands[i].empty() && !contour->invert)
+				continue;
+			RectInt band( target_rect.minx,
+			              target_rect.miny + i*band_rows,
+			              target_rect.maxx,
+			              std::min(target_rect.maxy, target_rect.miny + (i + 1)*band_rows) );
+			group.enqueue( sigc::bind( sigc::mem_fun(*this, &TaskContourSW::render_band),
+				&la->get_surface(),
+				&bands[i],
+				Matrix(),
+				band ));
+		}
+		group.run();
 
 		return true;
 	}
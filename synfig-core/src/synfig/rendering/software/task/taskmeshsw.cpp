@@ -29,6 +29,13 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <synfig/threadpool.h>
+
 #include "../../common/task/taskmesh.h"
 #include "tasksw.h"
 #include "../function/mesh.h"
@@ -50,6 +57,31 @@ namespace {
 
 class TaskMeshSW: public TaskMesh, public TaskSW
 {
+private:
+	//! tile should not be smaller than the minimal tile of OptimizerSplit
+	static const int min_tile_size = 128;
+	//! few tiles per thread allows to balance tiles with different count of triangles
+	static const int tiles_per_thread = 4;
+
+	//! rasterizes triangles clipped by rect, which may be the whole target rect or its tile
+	void render_tile(
+		synfig::Surface *surface,
+		const software::Mesh::TriangleList *triangles,
+		const synfig::Surface *texture,
+		const Rect &texture_rect,
+		const RectInt &rect ) const
+	{
+		software::Mesh::render_triangles(
+			*surface,
+			rect,
+			*triangles,
+			*texture,
+			texture_rect,
+			1.0,
+			Color::BLEND_COMPOSITE );
+	}
+
+public:
 	typedef etl::handle<TaskMeshSW> Handle;
 	static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
@@ -90,16 +122,48 @@ class TaskMeshSW: public TaskMesh, public TaskSW
 		sub_target_rect.maxx = sub_target_rect_int.maxx;
 		sub_target_rect.maxy = sub_target_rect_int.maxy;
 		
-		software::Mesh::render_mesh(
-			la->get_surface(),
-			target_rect,
+		// vertices are transformed once, so triangles of all tiles have the same edges
+		software::Mesh::TriangleList triangles;
+		software::Mesh::transform_triangles(
 			*mesh,
-			lb->get_surface(),
-			sub_target_rect,
 			transfromation_matrix,
 			texture_transfromation_matrix,
-			1.0,
-			Color::BLEND_COMPOSITE );
+			target_rect,
+			triangles );
+
+		// large mesh is split to square tiles which rasterized in parallel,
+		// triangles crossing borders of tiles are clipped by each tile
+		int w = target_rect.maxx - target_rect.minx;
+		int h = target_rect.maxy - target_rect.miny;
+		int max_tiles = tiles_per_thread*ThreadPool::instance().get_max_threads();
+		int tile_size = std::max(min_tile_size, (int)ceil(sqrt((Real)w*h/max_tiles)));
+
+		if (tile_size >= w && tile_size >= h) {
+			render_tile(&la->get_surface(), &triangles, &lb->get_surface(), sub_target_rect, target_rect);
+			return true;
+		}
+
+		std::vector<software::Mesh::TriangleList> tiles;
+		software::Mesh::split_tiles(triangles, target_rect, tile_size, tiles);
+
+		int tiles_x = (w + tile_size - 1)/tile_size;
+		ThreadPool::Group group;
+		for(int i = 0; i < (int)tiles.size(); ++i) {
+			if (tiles[i].empty())
+				continue;
+			int x = target_rect.minx + (i % tiles_x)*tile_size;
+			int y = target_rect.miny + (i / tiles_x)*tile_size;
+			RectInt tile( x, y,
+			              std::min(target_rect.maxx, x + tile_size),
+			              std::min(target_rect.maxy, y + tile_size) );
+			group.enqueue( sigc::bind( sigc::mem_fun(*this, &TaskMeshSW::render_tile),
+				&la->get_surface(),
+				&tiles[i],
+				&lb->get_surface(),
+				sub_target_rect,
+				tile ));
+		}
+		group.run();
 
 		return true;
 	}
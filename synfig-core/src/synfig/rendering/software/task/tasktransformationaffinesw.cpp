@@ -57,7 +57,8 @@ using namespace rendering;
 namespace {
 
 class TaskTransformationAffineSW: public TaskTransformationAffine, public TaskSW,
-	public TaskInterfaceBlendToTarget
+	public TaskInterfaceBlendToTarget,
+	public TaskInterfaceSplit
 {
 private:
 	class Helper;
@@ -71,6 +72,10 @@ public:
 	virtual Color::BlendMethodFlags get_supported_blend_methods() const
 		{ return Color::BLEND_METHODS_ALL; }
 
+	// each pixel reads area of interpolation kernel around it
+	virtual VectorInt get_split_overlap() const
+		{ return VectorInt(2, 2); }
+
 	virtual bool run(RunParams&) const
 	{
 		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
@@ -112,7 +117,8 @@ public:
 				interpolation,
 				blend,
 				amount,
-				blend_method );
+				blend_method,
+				&src->get_mipmap() );
 		} else
 		if (lsrc.convert<TargetSurface>()) {
 			TargetSurface::Handle src = lsrc.cast<TargetSurface>();
@@ -31,6 +31,8 @@
 
 #include <cstring>
 
+#include <synfig/debug/profiler.h>
+
 #include "surface.h"
 
 #include "common/surfacememoryreadwrapper.h"
@@ -49,7 +51,7 @@ using namespace rendering;
 /* === M E T H O D S ======================================================= */
 
 synfig::Token Surface::token;
-int SurfaceResource::last_id = 0;
+std::atomic<long long> SurfaceResource::last_id(0);
 
 Surface::Surface():
 	blank(true),
@@ -100,6 +102,7 @@ Surface::create(int width, int height)
 	this->width = width;
 	this->height = height;
 	blank = true;
+	debug::Profiler::add_allocation((long long)width*height);
 	return true;
 }
 
@@ -203,6 +206,7 @@ SurfaceResource::SurfaceResource():
 { }
 
 SurfaceResource::SurfaceResource(Surface::Handle surface):
+	id(++last_id),
 	width(),
 	height(),
 	blank(true)
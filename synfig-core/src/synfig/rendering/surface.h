@@ -30,6 +30,7 @@
 #include <map>
 #include <vector>
 
+#include <atomic>
 #include <mutex>
 #include <glibmm/threads.h>
 
@@ -323,9 +324,10 @@ public:
 	};
 
 private:
-	static int last_id;
+	//! resources are created by many threads, ids are keys of RenderCache
+	static std::atomic<long long> last_id;
 
-	int id;
+	long long id;
 	int width;
 	int height;
 	bool blank;
@@ -355,7 +357,7 @@ public:
 	void create(const VectorInt &x)
 		{ create(x[0], x[1]); }
 
-	int get_id() const //!< helps to debug of renderer optimizers
+	long long get_id() const //!< helps to debug of renderer optimizers
 		{ return id; }
 	int get_width() const
 		{ std::lock_guard<std::mutex> lock(mutex); return width; }
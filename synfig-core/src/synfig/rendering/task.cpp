@@ -179,6 +179,35 @@ Task::clone_recursive() const
 	return task;
 }
 
+Hasher::Value
+Task::get_hash(HashMap &hashes) const
+{
+	HashMap::const_iterator found = hashes.find(this);
+	if (found != hashes.end())
+		return found->second;
+	return hashes[this] = calc_hash(hashes);
+}
+
+Hasher::Value
+Task::calc_hash(HashMap &hashes) const
+{
+	Hasher hasher;
+	hasher.add(get_token()->name);
+	hasher.add(source_rect);
+	hasher.add(target_rect);
+	hasher.add(target_surface ? target_surface->get_size() : VectorInt::zero());
+	if (!hash_params(hasher))
+		return 0;
+
+	hasher.add(sub_tasks.size());
+	for(List::const_iterator i = sub_tasks.begin(); i != sub_tasks.end(); ++i) {
+		Hasher::Value sub_hash = *i ? (*i)->get_hash(hashes) : 1;
+		if (!sub_hash) return 0;
+		hasher.add(sub_hash);
+	}
+	return hasher.get();
+}
+
 Vector
 Task::get_pixels_per_unit() const
 {
@@ -336,6 +365,19 @@ TaskList::calc_target_offset(const Task &a, const Task &b)
 }
 
 
+// TaskSurface
+
+bool
+TaskSurface::hash_params(Hasher &hasher) const
+{
+	// surfaces are never changed after they are assigned to layers,
+	// so id identifies the content
+	if (!target_surface) return false;
+	hasher.add(target_surface->get_id());
+	return true;
+}
+
+
 // TaskLockSurface
 
 void
@@ -90,6 +90,37 @@ public:
 };
 
 
+//! Accumulates hash of task parameters (FNV-1a), see Task::get_hash()
+class Hasher
+{
+public:
+	typedef unsigned long long Value;
+
+private:
+	Value value;
+
+public:
+	Hasher(): value(14695981039346656037ull) { }
+
+	void add_data(const void *data, size_t size)
+	{
+		for(const unsigned char *c = (const unsigned char*)data, *end = c + size; c < end; ++c)
+			{ value ^= *c; value *= 1099511628211ull; }
+	}
+
+	//! only for plain types without padding bytes
+	template<typename T>
+	void add(const T &x)
+		{ add_data(&x, sizeof(x)); }
+	void add(const String &x)
+		{ add(x.size()); add_data(x.c_str(), x.size()); }
+
+	//! zero is reserved for tasks which cannot be hashed
+	Value get() const
+		{ return value ? value : 1; }
+};
+
+
 // Mode
 
 
@@ -281,10 +312,28 @@ public:
 		Set tmp_deps;
 		Set tmp_back_deps;
 
+		//! count of unfinished dependencies, task is ready when it reaches zero
+		std::atomic<int> deps_count;
+
 		RunParams params;
 		bool success;
 
-		RendererData(): batch_index(), index(), success() { }
+		RendererData(): batch_index(), index(), deps_count(), success() { }
+		RendererData(const RendererData &other):
+			batch_index(), index(), deps_count(), success() { *this = other; }
+
+		RendererData& operator=(const RendererData &other) {
+			batch_index = other.batch_index;
+			index = other.index;
+			deps = other.deps;
+			back_deps = other.back_deps;
+			tmp_deps = other.tmp_deps;
+			tmp_back_deps = other.tmp_back_deps;
+			deps_count = other.deps_count.load();
+			params = other.params;
+			success = other.success;
+			return *this;
+		}
 	};
 
 	class LockReadBase: public SurfaceResource::LockReadBase
@@ -419,6 +468,25 @@ public:
 		return bounds;
 	}
 
+	//! adds parameters of the task (without coordinates and sub-tasks) to the hash,
+	//! returns false when result of the task cannot be identified by parameters
+	virtual bool hash_params(Hasher & /* hasher */) const
+		{ return false; }
+	//! hashes of tasks calculated in one optimization pass
+	typedef std::map<const Task*, Hasher::Value> HashMap;
+
+	//! hash of token, coordinates, parameters and sub-tasks,
+	//! zero when task or any of sub-tasks cannot be hashed (see RenderCache).
+	//! Not stored in task, optimizers change coordinates and sub-tasks of tasks in place.
+	Hasher::Value get_hash() const
+		{ HashMap hashes; return get_hash(hashes); }
+	//! the same, but reuses and fills hashes of sub-trees in \a hashes,
+	//! tasks should not be changed while \a hashes is in use
+	Hasher::Value get_hash(HashMap &hashes) const;
+private:
+	Hasher::Value calc_hash(HashMap &hashes) const;
+public:
+
 	Vector get_pixels_per_unit() const;
 	Vector get_units_per_pixel() const;
 
@@ -467,11 +535,16 @@ public:
 };
 
 
+//! Tasks with this interface may be cut into parts by target rect (see OptimizerSplit)
 class TaskInterfaceSplit
 {
 public:
 	virtual bool is_splittable() const
 		{ return true; }
+	//! count of extra pixels around each part which task reads from the sub-tasks
+	//! to produce this part (blur radius for example)
+	virtual VectorInt get_split_overlap() const
+		{ return VectorInt::zero(); }
 	virtual ~TaskInterfaceSplit() { }
 };
 
@@ -509,6 +582,7 @@ public:
 	typedef etl::handle<TaskSurface> Handle;
 	static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
+	virtual bool hash_params(Hasher &hasher) const;
 };
 
 
@@ -1080,7 +1080,7 @@ xmlpp::Element* encode_canvas_toplevel(xmlpp::Element* root,Canvas::ConstHandle
 }
 
 bool
-synfig::save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandle canvas, bool safe)
+synfig::save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandle canvas, bool safe, bool fast)
 {
     ChangeLocale change_locale(LC_NUMERIC, "C");
 
@@ -1101,7 +1101,8 @@ synfig::save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandl
 		}
 
 		if (filename_extension(identifier.filename) == ".sifz")
-			stream = FileSystem::WriteStream::Handle(new ZWriteStream(stream));
+			stream = FileSystem::WriteStream::Handle(new ZWriteStream(stream,
+				fast ? zstreambuf::fast_option_compression_level : zstreambuf::option_compression_level ));
 
 		document.write_to_stream_formatted(*stream, "UTF-8");
 
@@ -48,8 +48,9 @@ typedef bool (*save_canvas_external_file_callback_t)(void *user_data, Layer::Con
 
 
 //!	Saves a canvas to \a filename
-/*!	\return	\c true on success, \c false on error. */
-bool save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandle canvas, bool safe = true);
+/*!	\param fast use fast compression for .sifz files (i.e. for backups)
+**	\return	\c true on success, \c false on error. */
+bool save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandle canvas, bool safe = true, bool fast = false);
 
 //! Stores a Canvas in a string in XML format
 /*! \return The string with the XML canvas definition */
@@ -31,6 +31,10 @@
 #	include <config.h>
 #endif
 
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+
 #include "target_scanline.h"
 
 #include "general.h"
@@ -41,6 +45,7 @@
 #include "render.h"
 #include "string.h"
 #include "surface.h"
+#include "debug/profiler.h"
 #include "rendering/renderer.h"
 #include "rendering/surface.h"
 #include "rendering/software/surfacesw.h"
@@ -61,18 +66,72 @@ using namespace rendering;
 
 #define USE_PIXELRENDERING_LIMIT 1
 
+#define PIPELINE_DEPTH 2
+
+#define PIPELINE_MEMORY_LIMIT (512*1024*1024)
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
 
+/* === C L A S S E S ======================================================= */
+
+//! Frames which are rendering now, and waits to be put onto the target
+class Target_Scanline::Pipeline
+{
+public:
+	struct Frame
+	{
+		SurfaceResource::Handle surface;
+		TaskEvent::Handle event;
+		int frame;
+		size_t memory;
+		Frame(): frame(), memory() { }
+	};
+
+	const Renderer::Handle renderer;
+	std::deque<Frame> frames;
+	size_t memory;
+
+	explicit Pipeline(const Renderer::Handle &renderer):
+		renderer(renderer), memory() { }
+
+	~Pipeline()
+	{
+		// rendering was interrupted, don't leave tasks in queue
+		for(std::deque<Frame>::const_iterator i = frames.begin(); i != frames.end(); ++i)
+			if (i->event) {
+				if (renderer) renderer->cancel(i->event);
+				i->event->wait();
+			}
+	}
+
+	void push(const Frame &frame)
+		{ frames.push_back(frame); memory += frame.memory; }
+
+	Frame pop()
+	{
+		Frame frame = frames.front();
+		frames.pop_front();
+		memory -= frame.memory;
+		return frame;
+	}
+};
+
 /* === M E T H O D S ======================================================= */
 
 Target_Scanline::Target_Scanline():
-	threads_(2)
+	threads_(2),
+	pipeline_depth_(PIPELINE_DEPTH),
+	pipeline_memory_limit_(PIPELINE_MEMORY_LIMIT)
 {
 	curr_frame_=0;
 	if (const char *s = getenv("SYNFIG_TARGET_DEFAULT_ENGINE"))
 		set_engine(s);
+	if (const char *s = getenv("SYNFIG_TARGET_PIPELINE_DEPTH"))
+		set_pipeline_depth(std::max(0, atoi(s)));
+	if (const char *s = getenv("SYNFIG_TARGET_PIPELINE_MEMORY")) // in megabytes
+		set_pipeline_memory_limit((size_t)std::max(0, atoi(s))*1024*1024);
 }
 
 int
@@ -81,15 +140,22 @@ Target_Scanline::next_frame(Time& time)
 	return Target::next_frame(time);
 }
 
-bool
-synfig::Target_Scanline::call_renderer(
+etl::handle<rendering::TaskEvent>
+synfig::Target_Scanline::enqueue_renderer(
 	const etl::handle<rendering::SurfaceResource> &surface,
 	Canvas &canvas,
 	const ContextParams &context_params,
 	const RendDesc &renddesc )
 {
+	debug::Profiler::Scope profile("frame", etl::strprintf("frame %d", curr_frame_));
+	profile.add_arg("frame", curr_frame_);
+
 	surface->create(renddesc.get_w(), renddesc.get_h());
-	rendering::Task::Handle task = canvas.build_rendering_task(context_params);
+	rendering::Task::Handle task;
+	{
+		debug::Profiler::Scope profile_build("build", "build");
+		task = canvas.build_rendering_task(context_params);
+	}
 
 	if (task)
 	{
@@ -115,7 +181,58 @@ synfig::Target_Scanline::call_renderer(
 
 		rendering::Task::List list;
 		list.push_back(task);
-		renderer->run(list);
+		rendering::TaskEvent::Handle event = new rendering::TaskEvent();
+		renderer->enqueue(list, event);
+		return event;
+	}
+	return rendering::TaskEvent::Handle();
+}
+
+bool
+synfig::Target_Scanline::call_renderer(
+	const etl::handle<rendering::SurfaceResource> &surface,
+	Canvas &canvas,
+	const ContextParams &context_params,
+	const RendDesc &renddesc )
+{
+	rendering::TaskEvent::Handle event = enqueue_renderer(surface, canvas, context_params, renddesc);
+	if (event) event->wait();
+	return true;
+}
+
+bool
+synfig::Target_Scanline::flush_pipeline(Pipeline &pipeline, int max_frames, ProgressCallback *cb)
+{
+	while( !pipeline.frames.empty()
+	    && ( (int)pipeline.frames.size() > max_frames
+	      || pipeline.memory > pipeline_memory_limit_ ))
+	{
+		Pipeline::Frame frame = pipeline.pop();
+		if (frame.event) frame.event->wait();
+
+		SurfaceResource::LockRead<SurfaceSW> lock(frame.surface);
+		if(!lock)
+		{
+			if(cb)cb->error(_("Bad surface"));
+			return false;
+		}
+
+		// targets may check number of frame while encoding it,
+		// but next frames are already requested at this moment
+		int next_frame = curr_frame_;
+		curr_frame_ = frame.frame;
+		bool success;
+		{
+			debug::Profiler::Scope profile("output", etl::strprintf("output frame %d", frame.frame));
+			success = add_frame(&lock->get_surface());
+		}
+		curr_frame_ = next_frame;
+
+		if(!success)
+		{
+			if(cb)cb->error(_("Unable to put surface on target"));
+			return false;
+		}
 	}
 	return true;
 }
@@ -145,6 +262,9 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 
 	ContextParams context_params(desc.get_render_excluded_contexts());
 
+	// frames are rendered in background while previous frames are encoded
+	Pipeline pipeline(rendering::Renderer::get_renderer(get_engine()));
+
 	// Calculate the number of frames
 	total_frames=frame_end-frame_start+1;
 	if(total_frames<=0)total_frames=1;
@@ -188,6 +308,10 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 					synfig::info("Render split to %d block%s %d pixels tall, and a final block %d pixels tall",
 								 rows-1, rows==2?"":"s", rowheight, lastrowheight);
 
+					// previous frames should be put onto the target first
+					if (!flush_pipeline(pipeline, 0, cb))
+						return false;
+
 					// loop through all the full rows
 					if(!start_frame())
 					{
@@ -279,34 +403,25 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 				}else //use normal rendering...
 				{
 				#endif
-					SurfaceResource::Handle surface = new SurfaceResource();
-
-					if (!call_renderer(surface, *canvas, context_params, desc))
-					{
-						// For some reason, the accelerated renderer failed.
-						if(cb)cb->error(_("Accelerated Renderer Failure"));
+					Pipeline::Frame frame;
+					frame.surface = new SurfaceResource();
+					frame.event = enqueue_renderer(frame.surface, *canvas, context_params, desc);
+					frame.frame = curr_frame_;
+					frame.memory = (size_t)desc.get_w()*desc.get_h()*sizeof(Color);
+					pipeline.push(frame);
+
+					// Put the surfaces of previous frames
+					// onto the target while this frame is rendering.
+					if (!flush_pipeline(pipeline, pipeline_depth_, cb))
 						return false;
-					}
-
-					SurfaceResource::LockRead<SurfaceSW> lock(surface);
-					if(!lock)
-					{
-						if(cb)cb->error(_("Bad surface"));
-						return false;
-					}
-
-					// Put the surface we renderer
-					// onto the target.
-					if(!add_frame(&lock->get_surface()))
-					{
-						if(cb)cb->error(_("Unable to put surface on target"));
-						return false;
-					}
 				#if USE_PIXELRENDERING_LIMIT
 				}
 				#endif
 			}
 		}while(frames);
+
+		if (!flush_pipeline(pipeline, 0, cb))
+			return false;
 	}
     else
     {
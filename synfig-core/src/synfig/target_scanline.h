@@ -38,7 +38,7 @@
 
 namespace synfig {
 
-namespace rendering { class SurfaceResource; }
+namespace rendering { class SurfaceResource; class TaskEvent; }
 
 /*!	\class Target_Scanline
 **	\brief This is a Target class that implements the render function
@@ -51,6 +51,22 @@ class Target_Scanline : public Target
 
 	String engine_;
 
+	//! Number of frames which may be rendered while previous frames are encoded
+	int pipeline_depth_;
+
+	//! Maximum size in bytes of surfaces of frames rendered ahead
+	size_t pipeline_memory_limit_;
+
+	class Pipeline;
+
+	etl::handle<rendering::TaskEvent> enqueue_renderer(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc );
+
+	bool flush_pipeline(Pipeline &pipeline, int max_frames, ProgressCallback *cb);
+
 	bool call_renderer(
 		const etl::handle<rendering::SurfaceResource> &surface,
 		Canvas &canvas,
@@ -106,6 +122,14 @@ public:
 	const String& get_engine()const { return engine_; }
 	//! Sets engine
 	void set_engine(const String &x) { engine_=x; }
+	//! Sets the number of frames which may be rendered ahead of the encoder, zero disables pipelining
+	void set_pipeline_depth(int x) { pipeline_depth_=x; }
+	//! Gets the number of frames which may be rendered ahead of the encoder
+	int get_pipeline_depth()const { return pipeline_depth_; }
+	//! Sets the memory limit in bytes for frames rendered ahead of the encoder
+	void set_pipeline_memory_limit(size_t x) { pipeline_memory_limit_=x; }
+	//! Gets the memory limit in bytes for frames rendered ahead of the encoder
+	size_t get_pipeline_memory_limit()const { return pipeline_memory_limit_; }
 
 	//! Puts the rendered surface onto the target.
 	bool add_frame(const synfig::Surface *surface);
@@ -48,6 +48,7 @@
 #include "surface.h"
 
 #include "debug/measure.h"
+#include "debug/profiler.h"
 
 #include "rendering/renderer.h"
 #include "rendering/surface.h"
@@ -127,12 +128,16 @@ synfig::Target_Tile::call_renderer(
 	debug::Measure t("Target_Tile::call_renderer");
 	#endif
 
+	debug::Profiler::Scope profile("frame", etl::strprintf("frame %d", curr_frame_));
+	profile.add_arg("frame", curr_frame_);
+
 	surface->create(renddesc.get_w(), renddesc.get_h());
 	rendering::Task::Handle task;
 	{
 		#ifdef DEBUG_MEASURE
 		debug::Measure t("build rendering task");
 		#endif
+		debug::Profiler::Scope profile_build("build", "build");
 		task = canvas.build_rendering_task(context_params);
 	}
 
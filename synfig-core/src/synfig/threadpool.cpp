@@ -58,23 +58,125 @@ using namespace synfig;
 /* === M E T H O D S ======================================================= */
 
 ThreadPool* ThreadPool::instance_ = 0;
+thread_local ThreadPool::Worker* ThreadPool::current_worker = 0;
+thread_local ThreadPool::Priority ThreadPool::current_priority = ThreadPool::PRIORITY_NORMAL;
+
+
+// ThreadPool::Queue
+
+//! Bounded work-stealing deque (Chase-Lev) of slots.
+//! Only owner thread calls push() and pop(), any thread may call steal().
+class ThreadPool::Queue {
+private:
+	enum { size = 1024, mask = size - 1 };
+
+	std::atomic<long long> top;
+	char padding0[64];
+	std::atomic<long long> bottom;
+	char padding1[64];
+	std::atomic<Slot*> buffer[size];
+
+public:
+	Queue(): top(0), bottom(0)
+		{ for(int i = 0; i < size; ++i) buffer[i] = 0; }
+
+	//! returns false when queue is full
+	bool push(Slot *slot) {
+		long long b = bottom.load(std::memory_order_relaxed);
+		long long t = top.load(std::memory_order_acquire);
+		if (b - t >= size) return false;
+		buffer[b & mask].store(slot, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Slot* pop() {
+		long long b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return 0;
+		}
+		Slot *slot = buffer[b & mask].load(std::memory_order_relaxed);
+		if (t == b) {
+			// last slot, race with thieves
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				slot = 0;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return slot;
+	}
+
+	//! may return null when other thread takes the same slot
+	Slot* steal() {
+		long long t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long b = bottom.load(std::memory_order_acquire);
+		if (t >= b) return 0;
+		Slot *slot = buffer[t & mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return 0;
+		return slot;
+	}
+};
+
+
+// ThreadPool::Worker
+
+class ThreadPool::Worker {
+public:
+	ThreadPool &pool;
+	const int index;
+	Queue queues[PRIORITY_COUNT];
+
+	Worker(ThreadPool &pool, int index): pool(pool), index(index) { }
+};
+
+
+// ThreadPool::Group::Chunks
+
+class ThreadPool::Group::Chunks {
+public:
+	List tasks;
+	std::vector<int> bounds; //!< chunk i contains tasks from bounds[i] to bounds[i + 1]
+	std::atomic<int> next;
+	std::atomic<int> done;
+	Glib::Threads::Mutex mutex;
+	Glib::Threads::Cond cond;
+
+	Chunks(): next(0), done(0) { }
+
+	int count() const
+		{ return (int)bounds.size() - 1; }
+
+	void process() {
+		int processed = 0;
+		for(int i = next++; i < count(); i = next++, ++processed)
+			for(int j = bounds[i]; j < bounds[i + 1]; ++j)
+				try { tasks[j].second(); } catch(...) { }
+		if (processed && (done += processed) == count())
+			{ Glib::Threads::Mutex::Lock lock(mutex); cond.broadcast(); }
+	}
+};
 
 
 // ThreadPool::Group
 
 ThreadPool::Group::Group():
-	multithreading(), running_threads(0), sum_weight() { }
+	pool(instance()), priority(get_current_priority()), sum_weight() { }
+
+ThreadPool::Group::Group(ThreadPool &pool, Priority priority):
+	pool(pool), priority(priority), sum_weight() { }
 
 ThreadPool::Group::~Group()
 	{ run(); }
 
 void
-ThreadPool::Group::process(int begin, int end) {
-	for(int i = begin; i < end; ++i)
-		try { tasks[i].second(); } catch(...) { }
-	Glib::Threads::Mutex::Lock lock(mutex);
-	if (!--running_threads) cond.signal();
-}
+ThreadPool::Group::process(std::shared_ptr<Chunks> chunks)
+	{ chunks->process(); }
 
 void
 ThreadPool::Group::enqueue(const Slot &slot, Real weight) {
@@ -85,65 +187,73 @@ ThreadPool::Group::enqueue(const Slot &slot, Real weight) {
 
 void
 ThreadPool::Group::run(bool force_thread) {
-	// enqueue parallel tasks
-	Real sum = 0.0;
-	int begin = 0;
-	int end = 0;
-
-	for(int i = 0; i < (int)tasks.size(); ++i) {
-		end = i + 1;
-		sum += tasks[i].first;
-		if (sum_weight - sum < 0.75) break;
-		if (sum >= 0.75) {
-			multithreading = true;
-			++running_threads;
-			instance().enqueue( sigc::bind( sigc::mem_fun(this, &Group::process), begin, end ));
-			sum_weight -= sum;
-			sum = 0.0;
-			begin = end;
-		}
+	if (tasks.empty()) return;
+
+	// small groups are processed in current thread without any synchronization
+	if (!force_thread && sum_weight < 1.5) {
+		for(List::iterator i = tasks.begin(); i != tasks.end(); ++i)
+			i->second();
+		tasks.clear();
+		sum_weight = 0.0;
+		return;
 	}
-	end = (int)tasks.size();
 
-	// run in current thread
-	if (begin < end) {
-		if (force_thread) {
-			multithreading = true;
-			++running_threads;
-			instance().enqueue( sigc::bind( sigc::mem_fun(this, &Group::process), begin, end ));
-		} else {
-			for(int i = begin; i < end; ++i)
-				tasks[i].second();
-		}
+	// split to chunks, few chunks per thread allows to balance tasks with wrong weights,
+	// but chunk should not be lighter than the old threshold of 0.75 for a separate thread
+	std::shared_ptr<Chunks> chunks(new Chunks());
+	chunks->tasks.swap(tasks);
+	const List &list = chunks->tasks;
+	Real chunk_weight = std::max(0.75, sum_weight/(4*pool.get_max_threads()));
+	Real sum = 0.0;
+	chunks->bounds.push_back(0);
+	for(int i = 0; i < (int)list.size(); ++i) {
+		sum += list[i].first;
+		if (sum >= chunk_weight && i + 1 < (int)list.size())
+			{ chunks->bounds.push_back(i + 1); sum = 0.0; }
 	}
+	chunks->bounds.push_back((int)list.size());
+	sum_weight = 0.0;
 
-	// wait
-	if (multithreading) {
-		Glib::Threads::Mutex::Lock lock(mutex);
-		while(running_threads > 0) instance().wait(cond, mutex);
-	}
+	// enqueue helpers, each helper takes chunks until they ends
+	int helpers = std::min(chunks->count(), pool.get_max_threads());
+	if (!force_thread) --helpers;
+	for(int i = 0; i < helpers; ++i)
+		pool.enqueue(sigc::bind(sigc::ptr_fun(&Group::process), chunks), priority);
 
-	// reset
-	multithreading = false;
-	tasks.clear();
-	sum_weight = 0.0;
+	// run in current thread
+	if (!force_thread)
+		chunks->process();
+
+	// wait for chunks taken by other threads,
+	// helpers which was not started yet will find nothing to do
+	Glib::Threads::Mutex::Lock lock(chunks->mutex);
+	while(chunks->done < chunks->count())
+		pool.wait(chunks->cond, chunks->mutex);
 }
 
 
 // ThreadPool
 
-ThreadPool::ThreadPool():
+ThreadPool::ThreadPool(int threads):
 	max_running_threads(0),
 	last_thread_id(0),
 	running_threads(0),
 	ready_threads(0),
 	queue_size(0),
-	stopped(false)
+	stopped(false),
+	workers_count(0)
 {
+	for(int i = 0; i < max_workers; ++i)
+		workers[i] = 0;
+	for(int i = 0; i < PRIORITY_COUNT; ++i)
+		injected_size[i] = 0;
+
 	max_running_threads = g_get_num_processors();
 
 	if (const char *s = getenv("SYNFIG_GENERIC_THREADS"))
 		max_running_threads = atoi(s) + 1;
+	if (threads > 0)
+		max_running_threads = threads + 1;
 
 	if (max_running_threads < 2) max_running_threads = 2;
 	if (max_running_threads > 2) --max_running_threads;
@@ -178,20 +288,59 @@ ThreadPool::~ThreadPool() {
 		thread->join();
 	}
 
-	{
-		#ifdef DEBUG_PTHREAD_MEASURE
-		Glib::Threads::Mutex::Lock lock(mutex);
-		info("ThreadPool destroyed with unprocessed tasks in queue: %d", queue.size());
-		#endif
+	#ifdef DEBUG_PTHREAD_MEASURE
+	info("ThreadPool destroyed with unprocessed tasks in queue: %d", (int)queue_size);
+	#endif
+
+	// release unprocessed slots
+	for(int i = 0; i < PRIORITY_COUNT; ++i)
+		for(std::deque<Slot*>::iterator j = injected[i].begin(); j != injected[i].end(); ++j)
+			delete *j;
+	for(int i = 0; i < workers_count; ++i) {
+		for(int j = 0; j < PRIORITY_COUNT; ++j)
+			while(Slot *slot = workers[i].load()->queues[j].pop())
+				delete slot;
+		delete workers[i].load();
 	}
 }
 
+ThreadPool::Slot*
+ThreadPool::take(Worker *worker, Priority &priority) {
+	int count = workers_count.load(std::memory_order_acquire);
+	int first = worker ? worker->index + 1 : 0;
+	for(int p = 0; p < PRIORITY_COUNT; ++p) {
+		priority = (Priority)p;
+
+		// own queue
+		if (worker)
+			if (Slot *slot = worker->queues[p].pop())
+				return slot;
+
+		// slots enqueued from other threads
+		if (injected_size[p] > 0) {
+			Glib::Threads::Mutex::Lock lock(injected_mutex);
+			if (!injected[p].empty()) {
+				Slot *slot = injected[p].front();
+				injected[p].pop_front();
+				--injected_size[p];
+				return slot;
+			}
+		}
+
+		// steal
+		for(int i = 0; i < count; ++i) {
+			Worker *w = workers[(first + i)%count].load(std::memory_order_acquire);
+			if (w != worker)
+				if (Slot *slot = w->queues[p].steal())
+					return slot;
+		}
+	}
+	return 0;
+}
+
 void
-ThreadPool::thread_loop(int
-	#ifdef DEBUG_PTHREAD_MEASURE
-	id
-	#endif
-) {
+ThreadPool::thread_loop(int id) {
+	current_worker = id <= max_workers ? workers[id - 1].load() : 0;
 	++running_threads;
 
 	#ifdef DEBUG_PTHREAD_MEASURE
@@ -202,21 +351,30 @@ ThreadPool::thread_loop(int
 	#endif
 
 	while(true) {
-		Slot slot;
-		{
+		Slot *slot = 0;
+		Priority priority = PRIORITY_NORMAL;
+		if (running_threads <= max_running_threads && queue_size > 0)
+			slot = take(current_worker, priority);
+
+		if (!slot) {
+			// queue_size may be positive while other thread takes the last slot or
+			// steal() was failed because of concurrent access, so just try again
+			if (running_threads <= max_running_threads && queue_size > 0)
+				{ Glib::Threads::Thread::yield(); continue; }
+
 			Glib::Threads::Mutex::Lock lock(mutex);
-			while(!stopped && (queue.empty() || running_threads > max_running_threads)) {
-				++ready_threads;
-				--running_threads;
+			// ready_threads should be increased before check of queue_size,
+			// so enqueue() will see ready thread or thread will see new slot
+			++ready_threads;
+			--running_threads;
+			while(!stopped && (queue_size <= 0 || running_threads >= max_running_threads))
 				cond.wait(mutex);
-				++running_threads;
-				--ready_threads;
-			}
+			++running_threads;
+			--ready_threads;
 			if (stopped) break;
-			slot = queue.front();
-			queue.pop();
-			--queue_size;
+			continue;
 		}
+		--queue_size;
 
 		#ifdef DEBUG_PTHREAD_MEASURE
 		struct timespec spec;
@@ -231,7 +389,10 @@ ThreadPool::thread_loop(int
 				(int)queue_size );
 		#endif
 
-		slot();
+		current_priority = priority;
+		try { (*slot)(); } catch(...) { }
+		delete slot;
+		current_priority = PRIORITY_NORMAL;
 
 		#ifdef DEBUG_PTHREAD_MEASURE
 		clock_gettime(clock_id, &spec);
@@ -250,6 +411,7 @@ ThreadPool::thread_loop(int
 	#endif
 
 	--running_threads;
+	current_worker = 0;
 }
 
 void
@@ -257,20 +419,37 @@ ThreadPool::wakeup() {
 	int to_wakeup = std::max(0, std::min((int)queue_size, max_running_threads - (int)running_threads));
 	int to_create = std::max(0, to_wakeup - (int)ready_threads);
 	to_wakeup     = std::max(0, to_wakeup - to_create);
-	while(to_create-- > 0)
+	while(to_create-- > 0) {
+		int id = ++last_thread_id;
+		if (id <= max_workers) {
+			workers[id - 1].store(new Worker(*this, id - 1), std::memory_order_release);
+			workers_count.store(id, std::memory_order_release);
+		}
 		threads.push_back(
 			Glib::Threads::Thread::create(
-				sigc::bind( sigc::mem_fun(this, &ThreadPool::thread_loop), ++last_thread_id )));
+				sigc::bind( sigc::mem_fun(this, &ThreadPool::thread_loop), id )));
+	}
 	while(to_wakeup-- > 0)
 		cond.signal();
 }
 
 void
-ThreadPool::enqueue(const Slot &slot) {
-	Glib::Threads::Mutex::Lock lock(mutex);
+ThreadPool::enqueue(const Slot &slot, Priority priority) {
+	Slot *s = new Slot(slot);
+	Worker *worker = current_worker;
+	if (!worker || &worker->pool != this || !worker->queues[priority].push(s)) {
+		Glib::Threads::Mutex::Lock lock(injected_mutex);
+		injected[priority].push_back(s);
+		++injected_size[priority];
+	}
+
+	// queue_size is increased after push, so idle threads will not wait for slot
+	// which is not pushed yet, and then ready_threads is checked,
+	// thread_loop() does the same checks in reverse order.
+	// Lock only when there are sleeping threads or threads to create.
 	++queue_size;
-	queue.push(slot);
-	wakeup();
+	if (ready_threads > 0 || running_threads < max_running_threads)
+		{ Glib::Threads::Mutex::Lock lock(mutex); wakeup(); }
 }
 
 void
@@ -282,6 +461,10 @@ ThreadPool::wait(Glib::Threads::Cond &cond, Glib::Threads::Mutex &mutex) {
 	++running_threads;
 }
 
+ThreadPool::Priority
+ThreadPool::get_current_priority()
+	{ return current_priority; }
+
 ThreadPool&
 ThreadPool::instance() {
 	assert(instance_);
@@ -28,7 +28,9 @@
 /* === H E A D E R S ======================================================= */
 
 #include <atomic>
-#include <queue>
+#include <deque>
+#include <memory>
+#include <vector>
 
 #include <sigc++/signal.h>
 #include <glibmm/threads.h>
@@ -43,27 +45,50 @@
 
 namespace synfig {
 
+/*!	\class ThreadPool
+**	\brief Pool of threads with work-stealing queues.
+**
+**	Each thread of the pool has own lock-free queues, slots enqueued from
+**	the thread of the pool are pushed to its own queue and taken back
+**	in LIFO order, idle threads steal slots from queues of other threads.
+**	Slots from other threads are passed through shared queues.
+**	Slots of higher priority are taken first.
+*/
 class ThreadPool {
 public:
 	typedef sigc::slot<void> Slot;
 
+	enum Priority {
+		PRIORITY_INTERACTIVE, //!< preview in workarea, should not wait for background tasks
+		PRIORITY_NORMAL,
+		PRIORITY_BACKGROUND,  //!< prefetching and other work that nobody waits for
+		PRIORITY_COUNT
+	};
+
+	/*!	\class Group
+	**	\brief Runs group of slots and waits for their completion.
+	**
+	**	Slots are split to chunks by weight, chunks are taken dynamically
+	**	by the current thread and by helper slots enqueued to the pool,
+	**	so that threads which finished early take the rest of work.
+	*/
 	class Group {
 	public:
-	typedef std::pair<Real, Slot> Entry;
-	typedef std::vector<Entry> List;
+		typedef std::pair<Real, Slot> Entry;
+		typedef std::vector<Entry> List;
 
 	private:
-		bool multithreading;
-		std::atomic<int> running_threads;
-		Glib::Threads::Mutex mutex;
-		Glib::Threads::Cond cond;
+		class Chunks;
 
+		ThreadPool &pool;
+		Priority priority;
 		List tasks;
 		Real sum_weight;
 
-		void process(int begin, int end);
+		static void process(std::shared_ptr<Chunks> chunks);
 	public:
 		Group();
+		explicit Group(ThreadPool &pool, Priority priority = PRIORITY_NORMAL);
 		~Group();
 
 		void enqueue(const Slot &slot, Real weight = 1.0);
@@ -71,6 +96,11 @@ public:
 	};
 
 private:
+	class Queue;
+	class Worker;
+
+	enum { max_workers = 256 };
+
 	Glib::Threads::Mutex mutex;
 	Glib::Threads::Cond cond;
 	int max_running_threads;
@@ -78,22 +108,35 @@ private:
 	std::atomic<int> running_threads;
 	std::atomic<int> ready_threads;
 	std::atomic<int> queue_size;
-	std::queue<Slot> queue;
 	std::vector<Glib::Threads::Thread*> threads;
 	bool stopped;
 
+	std::atomic<Worker*> workers[max_workers];
+	std::atomic<int> workers_count;
+
+	Glib::Threads::Mutex injected_mutex;
+	std::deque<Slot*> injected[PRIORITY_COUNT];
+	std::atomic<int> injected_size[PRIORITY_COUNT];
+
 	static ThreadPool *instance_;
+	static thread_local Worker *current_worker;
+	static thread_local Priority current_priority;
 
+	Slot* take(Worker *worker, Priority &priority);
 	void thread_loop(int id);
 	void wakeup();
 
-	ThreadPool();
 	ThreadPool(const ThreadPool&) = delete;
 
 public:
+	//! \param threads count of threads like in SYNFIG_GENERIC_THREADS,
+	//!        zero means count of processors or value of SYNFIG_GENERIC_THREADS
+	explicit ThreadPool(int threads = 0);
 	~ThreadPool();
 
-	void enqueue(const Slot &slot);
+	void enqueue(const Slot &slot, Priority priority);
+	void enqueue(const Slot &slot)
+		{ enqueue(slot, get_current_priority()); }
 	void wait(Glib::Threads::Cond &cond, Glib::Threads::Mutex &mutex);
 
 	int get_max_threads() const
@@ -103,6 +146,10 @@ public:
 	int get_queue_size() const
 		{ return queue_size + running_threads; }
 
+	//! priority of slot processed by the current thread,
+	//! slots enqueued without priority inherit it
+	static Priority get_current_priority();
+
 	static ThreadPool& instance();
 	static bool subsys_init();
 	static bool subsys_stop();
@@ -33,6 +33,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <atomic>
 #include <typeinfo>
 #include <vector>
 #include <list>
@@ -79,6 +80,14 @@ struct timecmp
 	}
 };
 
+struct time_less_waypoint
+{
+	bool operator()(const Time &t, const Waypoint &rhs) const
+	{
+		return t < rhs.get_time();
+	}
+};
+
 template<class T>
 struct subtractor: public std::binary_function<T, T, T>
 	{ T operator()(const T &a,const T &b)const { return a-b; } };
@@ -343,11 +352,55 @@ public:
 		typedef vector<PathSegment> curve_list_type;
 		curve_list_type curve_list;
 
+		//! Everything from the waypoint which is used to build the curves,
+		//! allows to find waypoints changed since the last on_changed()
+		struct WaypointState
+		{
+			Time time;
+			ValueBase value;
+			Waypoint::Interpolation before, after;
+			Real tension, continuity, bias;
+			float temporal_tension;
+
+			explicit WaypointState(const Waypoint &x):
+				time(x.get_time()),
+				value(x.get_value()),
+				before(x.get_before()),
+				after(x.get_after()),
+				tension(x.get_tension()),
+				continuity(x.get_continuity()),
+				bias(x.get_bias()),
+				temporal_tension(x.get_temporal_tension())
+			{ }
+
+			bool operator==(const WaypointState &x) const
+			{
+				return time.is_equal(x.time)
+					&& before == x.before
+					&& after == x.after
+					&& tension == x.tension
+					&& continuity == x.continuity
+					&& bias == x.bias
+					&& temporal_tension == x.temporal_tension
+					&& value == x.value;
+			}
+		};
+
+		typedef vector<WaypointState> waypoint_state_list_type;
+		waypoint_state_list_type waypoint_states;
+
+		//! Index of the last found curve, sequential playback
+		//! usually evaluates the same or the next curve
+		mutable std::atomic<size_t> last_curve;
+
 		// Bounds of this curve
 		Time r,s;
 
+		static bool time_less_curve_end(const Time &t, const PathSegment &curve)
+			{ return t < curve.first.get_s(); }
+
 	public:
-		Hermite(ValueNode_AnimatedInterfaceConst &node): Interpolator(node) { }
+		Hermite(ValueNode_AnimatedInterfaceConst &node): Interpolator(node), last_curve(0) { }
 
 		virtual Interpolator* create(ValueNode_AnimatedInterfaceConst &node) const
 			{ return new Hermite(node); }
@@ -395,257 +448,307 @@ public:
 			return ret;
 		}
 
-		virtual void on_changed()
+		//! Calculates the curve between iter and the next waypoint.
+		//! Previous curve is used for TCB and clamped tangents,
+		//! and its second tangent may be changed for continuity.
+		void build_curve(WaypointList::iterator iter, PathSegment &curve, PathSegment *prev)
 		{
-			if (getenv("SYNFIG_DEBUG_ON_CHANGED"))
-				printf("%s:%d _Hermite::on_changed()\n", __FILE__, __LINE__);
+			WaypointList::iterator next(iter);
+			++next;
+			WaypointList::iterator after_next(next);
+			++after_next;
+
+			curve = PathSegment();
+			curve.start=iter;
+			curve.end=next;
+
+			// Set up the positions
+			curve.first.set_rs(iter->get_time(), next->get_time());
+			curve.second.set_rs(iter->get_time(), next->get_time());
+			// Retrieve the interpolations
+			Waypoint::Interpolation iter_get_after(iter->get_after());
+			Waypoint::Interpolation next_get_after(next->get_after());
+			Waypoint::Interpolation iter_get_before(iter->get_before());
+			Waypoint::Interpolation next_get_before(next->get_before());
 
-			if(animated.waypoint_list_.size()<=1)
-				return;
-			std::sort(animated.waypoint_list_.begin(), animated.waypoint_list_.end());
-
-			r=animated.waypoint_list_.front().get_time();
-			s=animated.waypoint_list_.back().get_time();
-
-			curve_list.clear();
+			if(is_angle())
+			{
+				if(iter_get_after==INTERPOLATION_TCB)
+					iter_get_after=INTERPOLATION_LINEAR;
+				if(next_get_after==INTERPOLATION_TCB)
+					next_get_after=INTERPOLATION_LINEAR;
+				if(iter_get_before==INTERPOLATION_TCB)
+					iter_get_before=INTERPOLATION_LINEAR;
+				if(next_get_before==INTERPOLATION_TCB)
+					next_get_before=INTERPOLATION_LINEAR;
+			}
 
-			WaypointList::iterator iter,next=animated.waypoint_list_.begin();
-			// The curve list must be calculated because we sorted the waypoints.
-			for(iter=next++;iter!=animated.waypoint_list_.end() && next!=animated.waypoint_list_.end(); iter=next++)
+			if(iter->is_static() && next->is_static())
 			{
-				typename curve_list_type::value_type curve;
-				WaypointList::iterator after_next(next);
-				++after_next;
-
-				curve.start=iter;
-				curve.end=next;
-
-				// Set up the positions
-				curve.first.set_rs(iter->get_time(), next->get_time());
-				curve.second.set_rs(iter->get_time(), next->get_time());
-				// Retrieve the interpolations
-				Waypoint::Interpolation iter_get_after(iter->get_after());
-				Waypoint::Interpolation next_get_after(next->get_after());
-				Waypoint::Interpolation iter_get_before(iter->get_before());
-				Waypoint::Interpolation next_get_before(next->get_before());
-
-				if(is_angle())
+				curve.second.p1()=iter->get_value().get(T());
+				curve.second.p2()=next->get_value().get(T());
+				///
+				/// ANY/CONSTANT ------ ANY/ANY
+				///               or
+				/// ANY/ANY-------------CONSTANT/ANY
+				///
+				if(iter_get_after==INTERPOLATION_CONSTANT || next_get_before==INTERPOLATION_CONSTANT)
 				{
-					if(iter_get_after==INTERPOLATION_TCB)
-						iter_get_after=INTERPOLATION_LINEAR;
-					if(next_get_after==INTERPOLATION_TCB)
-						next_get_after=INTERPOLATION_LINEAR;
-					if(iter_get_before==INTERPOLATION_TCB)
-						iter_get_before=INTERPOLATION_LINEAR;
-					if(next_get_before==INTERPOLATION_TCB)
-						next_get_before=INTERPOLATION_LINEAR;
+					// Sections must be constant on both sides.
+					// NOTE: this is commented out because of some
+					// user interface issues. Namely, if a section is
+					// constant and the user turns off the constant on
+					// one waypoint, this will end up turning it back on.
+					// Confusing.
+					//iter->get_after()=next->get_before()=INTERPOLATION_CONSTANT;
+					curve.second.p1()=
+					curve.second.p2()=iter->get_value().get(T());
+					curve.second.t1()=
+					curve.second.t2()=subtract_func(curve.second.p1(),curve.second.p2());
 				}
-
-				if(iter->is_static() && next->is_static())
+				else
 				{
-					curve.second.p1()=iter->get_value().get(T());
-					curve.second.p2()=next->get_value().get(T());
+					/// iter             next
+					/// ANY/TCB -------- ANY/ANY and iter is middle waypoint
 					///
-					/// ANY/CONSTANT ------ ANY/ANY
-					///               or
-					/// ANY/ANY-------------CONSTANT/ANY
-					///
-					if(iter_get_after==INTERPOLATION_CONSTANT || next_get_before==INTERPOLATION_CONSTANT)
-					{
-						// Sections must be constant on both sides.
-						// NOTE: this is commented out because of some
-						// user interface issues. Namely, if a section is
-						// constant and the user turns off the constant on
-						// one waypoint, this will end up turning it back on.
-						// Confusing.
-						//iter->get_after()=next->get_before()=INTERPOLATION_CONSTANT;
-						curve.second.p1()=
-						curve.second.p2()=iter->get_value().get(T());
-						curve.second.t1()=
-						curve.second.t2()=subtract_func(curve.second.p1(),curve.second.p2());
-					}
-					else
+				    if(iter_get_after==INTERPOLATION_TCB && iter!=animated.waypoint_list_.begin() && !is_angle())
 					{
-						/// iter             next
-						/// ANY/TCB -------- ANY/ANY and iter is middle waypoint
-						///
-					    if(iter_get_after==INTERPOLATION_TCB && iter!=animated.waypoint_list_.begin() && !is_angle())
+						if(iter->get_before()!=INTERPOLATION_TCB && prev)
 						{
-							if(iter->get_before()!=INTERPOLATION_TCB && !curve_list.empty())
-							{
-								curve.second.t1()=curve_list.back().second.t2();
-							}
-							else
-							{
-								const Real& t(iter->get_tension());		// Tension
-								const Real& c(iter->get_continuity());	// Continuity
-								const Real& b(iter->get_bias());		// Bias
-								// The following line works where the previous line fails.
-								value_type Pp; Pp=curve_list.back().second.p1();	// P_{i-1}
-								const value_type& Pc(curve.second.p1());	// P_i
-								const value_type& Pn(curve.second.p2());	// P_{i+1}
-
-								/// TCB calculation
-								value_type vect(static_cast<value_type>
-												(subtract_func(Pc,Pp) *
-												           (((1.0-t) * (1.0+c) * (1.0+b)) / 2.0) +
-												 (Pn-Pc) * (((1.0-t) * (1.0-c) * (1.0-b)) / 2.0)));
-								curve.second.t1()=vect;
-							}
+							curve.second.t1()=prev->second.t2();
 						}
 						else
 						{
-							///
-							/// ANY/LINEAR ----- ANY/ANY
-							///            or
-							/// ANY/EASE ------- ANY/ANY
-							///            or
-							/// ANY/TCB -------- ANY/ANY and iter is first.
-							///            or
-							/// ANY/CLAMPED ---- ANT/ANY and iter is first
-						    if(
-							iter_get_after==INTERPOLATION_LINEAR || iter_get_after==INTERPOLATION_HALT ||
-							(iter_get_after==INTERPOLATION_TCB && iter==animated.waypoint_list_.begin()) ||
-							(iter_get_after==INTERPOLATION_CLAMPED && iter==animated.waypoint_list_.begin())
-							)
-							{
-								/// t1 = p2 - p1
-								curve.second.t1()=subtract_func(curve.second.p2(),curve.second.p1());
-							}
-						}
-						/// iter             next
-						/// ANY/CLAMPED ---- ANY/ANY and iter is middle waypoint
-						if(iter_get_after == INTERPOLATION_CLAMPED && iter!=animated.waypoint_list_.begin() && !is_angle())
-						{
-							value_type Pp; Pp=curve_list.back().second.p1(); // P_{i-1}
-							const value_type& Pc(curve.second.p1());         // P_i
-							const value_type& Pn(curve.second.p2());         // P_{i+1}
-							Time T1(curve_list.back().first.p1());
-							Time T2(iter->get_time());
-							Time T3(next->get_time());
-							value_type vect(clamped_tangent(Pp, Pc, Pn, T1, T2, T3));
+							const Real& t(iter->get_tension());		// Tension
+							const Real& c(iter->get_continuity());	// Continuity
+							const Real& b(iter->get_bias());		// Bias
+							// The following line works where the previous line fails.
+							value_type Pp; Pp=prev->second.p1();	// P_{i-1}
+							const value_type& Pc(curve.second.p1());	// P_i
+							const value_type& Pn(curve.second.p2());	// P_{i+1}
+
+							/// TCB calculation
+							value_type vect(static_cast<value_type>
+											(subtract_func(Pc,Pp) *
+											           (((1.0-t) * (1.0+c) * (1.0+b)) / 2.0) +
+											 (Pn-Pc) * (((1.0-t) * (1.0-c) * (1.0-b)) / 2.0)));
 							curve.second.t1()=vect;
 						}
+					}
+					else
+					{
 						///
-						/// TCB/!TCB and list not empty
-						///
-						if(iter_get_before==INTERPOLATION_TCB && iter->get_after()!=INTERPOLATION_TCB && !curve_list.empty())
+						/// ANY/LINEAR ----- ANY/ANY
+						///            or
+						/// ANY/EASE ------- ANY/ANY
+						///            or
+						/// ANY/TCB -------- ANY/ANY and iter is first.
+						///            or
+						/// ANY/CLAMPED ---- ANT/ANY and iter is first
+					    if(
+						iter_get_after==INTERPOLATION_LINEAR || iter_get_after==INTERPOLATION_HALT ||
+						(iter_get_after==INTERPOLATION_TCB && iter==animated.waypoint_list_.begin()) ||
+						(iter_get_after==INTERPOLATION_CLAMPED && iter==animated.waypoint_list_.begin())
+						)
 						{
-							/// It means that there is one previous waypoint
-							/// that is at cuerve_list.back()
-							/// then its second tangent must be the same than
-							/// our first one for continuity of the tangents.
-							curve_list.back().second.t2()=curve.second.t1();
-							curve_list.back().second.sync();
+							/// t1 = p2 - p1
+							curve.second.t1()=subtract_func(curve.second.p2(),curve.second.p1());
 						}
-						/// iter          next          after_next
-						/// ANY/ANY ------TCB/ANY ----- ANY/ANY
-						///
-						if(next_get_before==INTERPOLATION_TCB && after_next!=animated.waypoint_list_.end()  && !is_angle())
-						{
-							const Real &t(next->get_tension());       // Tension
-							const Real &c(next->get_continuity());    // Continuity
-							const Real &b(next->get_bias());          // Bias
-							const value_type &Pp(curve.second.p1());  // P_{i-1}
-							const value_type &Pc(curve.second.p2());  // P_i
-							value_type Pn; Pn=after_next->get_value().get(T()); // P_{i+1}
+					}
+					/// iter             next
+					/// ANY/CLAMPED ---- ANY/ANY and iter is middle waypoint
+					if(iter_get_after == INTERPOLATION_CLAMPED && iter!=animated.waypoint_list_.begin() && !is_angle())
+					{
+						value_type Pp; Pp=prev->second.p1(); // P_{i-1}
+						const value_type& Pc(curve.second.p1());         // P_i
+						const value_type& Pn(curve.second.p2());         // P_{i+1}
+						Time T1(prev->first.p1());
+						Time T2(iter->get_time());
+						Time T3(next->get_time());
+						value_type vect(clamped_tangent(Pp, Pc, Pn, T1, T2, T3));
+						curve.second.t1()=vect;
+					}
+					///
+					/// TCB/!TCB and list not empty
+					///
+					if(iter_get_before==INTERPOLATION_TCB && iter->get_after()!=INTERPOLATION_TCB && prev)
+					{
+						/// It means that there is one previous waypoint
+						/// that is at cuerve_list.back()
+						/// then its second tangent must be the same than
+						/// our first one for continuity of the tangents.
+						prev->second.t2()=curve.second.t1();
+						prev->second.sync();
+					}
+					/// iter          next          after_next
+					/// ANY/ANY ------TCB/ANY ----- ANY/ANY
+					///
+					if(next_get_before==INTERPOLATION_TCB && after_next!=animated.waypoint_list_.end()  && !is_angle())
+					{
+						const Real &t(next->get_tension());       // Tension
+						const Real &c(next->get_continuity());    // Continuity
+						const Real &b(next->get_bias());          // Bias
+						const value_type &Pp(curve.second.p1());  // P_{i-1}
+						const value_type &Pc(curve.second.p2());  // P_i
+						value_type Pn; Pn=after_next->get_value().get(T()); // P_{i+1}
+
+						/// TCB calculation
+						value_type vect(static_cast<value_type>(subtract_func(Pc,Pp) * (((1.0-t)*(1.0-c)*(1.0+b))/2.0) +
+																			 (Pn-Pc) * (((1.0-t)*(1.0+c)*(1.0-b))/2.0)));
+						curve.second.t2()=vect;
+					}
+					else
+						/// iter          next
+						/// ANY/ANY ----- LINEAR/ANY
+						///           or
+						/// ANY/ANY ----- EASE/ANY
+						///           or
+						/// ANY/ANY ----- TCB/ANY ---- END
+						///           or
+						/// ANY/ANY ----- CLAMPED/ANY ----END
+					    if(
+						next_get_before==INTERPOLATION_LINEAR || next_get_before==INTERPOLATION_HALT ||
+						(next_get_before==INTERPOLATION_TCB && after_next==animated.waypoint_list_.end()) ||
+						(next_get_before==INTERPOLATION_CLAMPED && after_next==animated.waypoint_list_.end())
+						)
+					{
+						/// t2 = p2 - p1
+						curve.second.t2()=subtract_func(curve.second.p2(),curve.second.p1());
+					}
+					/// iter             next         after_next
+					/// ANY/ANY ---- CLAMPED/ANY      ANY/ANY
+					if(next_get_before == INTERPOLATION_CLAMPED && after_next!=animated.waypoint_list_.end()  && !is_angle())
+					{
+						const value_type &Pp(curve.second.p1());            // P_{i-1}
+						const value_type &Pc(curve.second.p2());            // P_i
+						value_type Pn; Pn=after_next->get_value().get(T()); // P_{i+1}
+						Time T1(iter->get_time());
+						Time T2(next->get_time());
+						Time T3(after_next->get_time());
+						value_type vect(clamped_tangent(Pp, Pc, Pn, T1, T2, T3));
+						curve.second.t2()=vect;
+					}
+					// Adjust for time
+					const float timeadjust(0.5);
+					/// iter           next
+					/// ANY/EASE ------ANY/ANY
+					///
+					if(iter_get_after==INTERPOLATION_HALT)
+						curve.second.t1()*=0;
+					// if this isn't the first curve
+					else
+					/// prev         iter              next
+					/// ANY/ANY -----ANY/!LINEAR ----- ANY/ANY
+					///
+					if(iter_get_after != INTERPOLATION_LINEAR && prev)
+						// adjust it for the curve that came before it
+						curve.second.t1() = static_cast<T>(curve.second.t1() * // cast to prevent warning
+							//                  (time span of this curve) * 1.5
+							// -----------------------------------------------------------------
+							// ((time span of this curve) * 0.5) + (time span of previous curve)
+							  (curve.second.get_dt()*(timeadjust+1)) /
+							  (curve.second.get_dt()*timeadjust + prev->second.get_dt()));
+					/// iter           next
+					/// ANY/ANY ------EASE/ANY
+					///
+					if(next_get_before==INTERPOLATION_HALT)
+						curve.second.t2()*=0;
+					// if this isn't the last curve
+					else
+					/// iter           next               after_next
+					/// ANY/ANY ----- !LINEAR/ANY ------- ANY/ANY
+					///
+					if(next_get_before != INTERPOLATION_LINEAR && after_next!=animated.waypoint_list_.end())
+						// adjust it for the curve that came after it
+						curve.second.t2() = static_cast<T>(curve.second.t2() * // cast to prevent warning
+							//                (time span of this curve) * 1.5
+							// -------------------------------------------------------------
+							// ((time span of this curve) * 0.5) + (time span of next curve)
+							  (curve.second.get_dt()*(timeadjust+1)) /
+							  (curve.second.get_dt()*timeadjust+(after_next->get_time()-next->get_time())));
+				} // not CONSTANT
+			}
 
-							/// TCB calculation
-							value_type vect(static_cast<value_type>(subtract_func(Pc,Pp) * (((1.0-t)*(1.0-c)*(1.0+b))/2.0) +
-																				 (Pn-Pc) * (((1.0-t)*(1.0+c)*(1.0-b))/2.0)));
-							curve.second.t2()=vect;
-						}
-						else
-							/// iter          next
-							/// ANY/ANY ----- LINEAR/ANY
-							///           or
-							/// ANY/ANY ----- EASE/ANY
-							///           or
-							/// ANY/ANY ----- TCB/ANY ---- END
-							///           or
-							/// ANY/ANY ----- CLAMPED/ANY ----END
-						    if(
-							next_get_before==INTERPOLATION_LINEAR || next_get_before==INTERPOLATION_HALT ||
-							(next_get_before==INTERPOLATION_TCB && after_next==animated.waypoint_list_.end()) ||
-							(next_get_before==INTERPOLATION_CLAMPED && after_next==animated.waypoint_list_.end())
-							)
-						{
-							/// t2 = p2 - p1
-							curve.second.t2()=subtract_func(curve.second.p2(),curve.second.p1());
-						}
-						/// iter             next         after_next
-						/// ANY/ANY ---- CLAMPED/ANY      ANY/ANY
-						if(next_get_before == INTERPOLATION_CLAMPED && after_next!=animated.waypoint_list_.end()  && !is_angle())
-						{
-							const value_type &Pp(curve.second.p1());            // P_{i-1}
-							const value_type &Pc(curve.second.p2());            // P_i
-							value_type Pn; Pn=after_next->get_value().get(T()); // P_{i+1}
-							Time T1(iter->get_time());
-							Time T2(next->get_time());
-							Time T3(after_next->get_time());
-							value_type vect(clamped_tangent(Pp, Pc, Pn, T1, T2, T3));
-							curve.second.t2()=vect;
-						}
-						// Adjust for time
-						const float timeadjust(0.5);
-						/// iter           next
-						/// ANY/EASE ------ANY/ANY
-						///
-						if(iter_get_after==INTERPOLATION_HALT)
-							curve.second.t1()*=0;
-						// if this isn't the first curve
-						else
-						/// prev         iter              next
-						/// ANY/ANY -----ANY/!LINEAR ----- ANY/ANY
-						///
-						if(iter_get_after != INTERPOLATION_LINEAR && !curve_list.empty())
-							// adjust it for the curve that came before it
-							curve.second.t1() = static_cast<T>(curve.second.t1() * // cast to prevent warning
-								//                  (time span of this curve) * 1.5
-								// -----------------------------------------------------------------
-								// ((time span of this curve) * 0.5) + (time span of previous curve)
-								  (curve.second.get_dt()*(timeadjust+1)) /
-								  (curve.second.get_dt()*timeadjust + curve_list.back().second.get_dt()));
-						/// iter           next
-						/// ANY/ANY ------EASE/ANY
-						///
-						if(next_get_before==INTERPOLATION_HALT)
-							curve.second.t2()*=0;
-						// if this isn't the last curve
-						else
-						/// iter           next               after_next
-						/// ANY/ANY ----- !LINEAR/ANY ------- ANY/ANY
-						///
-						if(next_get_before != INTERPOLATION_LINEAR && after_next!=animated.waypoint_list_.end())
-							// adjust it for the curve that came after it
-							curve.second.t2() = static_cast<T>(curve.second.t2() * // cast to prevent warning
-								//                (time span of this curve) * 1.5
-								// -------------------------------------------------------------
-								// ((time span of this curve) * 0.5) + (time span of next curve)
-								  (curve.second.get_dt()*(timeadjust+1)) /
-								  (curve.second.get_dt()*timeadjust+(after_next->get_time()-next->get_time())));
-					} // not CONSTANT
-				}
+			// Set up the time to the default stuff
+			curve.first.set_rs(iter->get_time(), next->get_time());
+			curve.first.p1()=iter->get_time();
+			curve.first.p2()=next->get_time();
+			curve.first.t1()=(curve.first.p2()-curve.first.p1())*(1.0f-iter->get_temporal_tension());
+			curve.first.t2()=(curve.first.p2()-curve.first.p1())*(1.0f-next->get_temporal_tension());
+
+
+			curve.first.sync();
+			
+			// for proper integer interpolation
+			curve.second.p1() = premult( curve.second.p1() );
+			curve.second.p2() = premult( curve.second.p2() );
+			curve.second.t1() = premult( curve.second.t1() );
+			curve.second.t2() = premult( curve.second.t2() );
+			curve.second.sync();
+		}
 
-				// Set up the time to the default stuff
-				curve.first.set_rs(iter->get_time(), next->get_time());
-				curve.first.p1()=iter->get_time();
-				curve.first.p2()=next->get_time();
-				curve.first.t1()=(curve.first.p2()-curve.first.p1())*(1.0f-iter->get_temporal_tension());
-				curve.first.t2()=(curve.first.p2()-curve.first.p1())*(1.0f-next->get_temporal_tension());
+		virtual void on_changed()
+		{
+			if (getenv("SYNFIG_DEBUG_ON_CHANGED"))
+				printf("%s:%d _Hermite::on_changed()\n", __FILE__, __LINE__);
 
+			if(animated.waypoint_list_.size()<=1)
+			{
+				curve_list.clear();
+				waypoint_states.clear();
+				return;
+			}
+			std::sort(animated.waypoint_list_.begin(), animated.waypoint_list_.end());
+
+			r=animated.waypoint_list_.front().get_time();
+			s=animated.waypoint_list_.back().get_time();
 
-				curve.first.sync();
-				
-				// for proper integer interpolation
-				curve.second.p1() = premult( curve.second.p1() );
-				curve.second.p2() = premult( curve.second.p2() );
-				curve.second.t1() = premult( curve.second.t1() );
-				curve.second.t2() = premult( curve.second.t2() );
-				curve.second.sync();
+			const size_t count = animated.waypoint_list_.size();
+			waypoint_state_list_type states;
+			states.reserve(count);
+			for(WaypointList::const_iterator i = animated.waypoint_list_.begin(); i != animated.waypoint_list_.end(); ++i)
+				states.push_back(WaypointState(*i));
 
-				curve_list.push_back(curve);
+			// Find the range of changed waypoints,
+			// rebuild all curves when waypoints was added or removed.
+			size_t first_changed = 0, last_changed = count - 1;
+			if (waypoint_states.size() == count && curve_list.size() + 1 == count)
+			{
+				while(first_changed < count && states[first_changed] == waypoint_states[first_changed])
+					++first_changed;
+				if (first_changed == count)
+					return;
+				while(last_changed > first_changed && states[last_changed] == waypoint_states[last_changed])
+					--last_changed;
+			}
+			else
+			{
+				curve_list.clear();
+				curve_list.resize(count - 1);
+			}
+			waypoint_states.swap(states);
+
+			// Curve i uses waypoints from i-1 to i+2, so changed waypoint
+			// affects curves from i-2 to i+1. Also TCB waypoint may change
+			// the second tangent of previous curve, so keep going while the
+			// next curve depends on the rebuilt one in that way.
+			size_t begin = first_changed > 2 ? first_changed - 2 : 0;
+			size_t end = std::min(last_changed + 2, count - 1);
+			while( end < count - 1
+			    && !is_angle()
+			    && animated.waypoint_list_[end].get_before() == INTERPOLATION_TCB
+			    && animated.waypoint_list_[end].get_after() != INTERPOLATION_TCB )
+				++end;
+
+			// waypoints may be moved in memory, so update all iterators
+			for(size_t i = 0; i < count - 1; ++i)
+			{
+				curve_list[i].start = animated.waypoint_list_.begin() + i;
+				curve_list[i].end = curve_list[i].start + 1;
 			}
+
+			for(size_t i = begin; i < end; ++i)
+				build_curve(animated.waypoint_list_.begin() + i, curve_list[i], i ? &curve_list[i-1] : NULL);
 		}
 
 		virtual ValueBase operator()(Time t)const
@@ -659,15 +762,21 @@ public:
 			if(t>=s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			typename curve_list_type::const_iterator iter;
-
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(iter=curve_list.begin();iter<curve_list.end() && t>=iter->first.get_s();++iter)
-				continue;
-			if(iter==curve_list.end())
+			// Try the last used curve and the next one,
+			// then find the first curve which ends after the given time.
+			size_t index = last_curve.load(std::memory_order_relaxed);
+			if ( index < curve_list.size()
+			  && !time_less_curve_end(t, curve_list[index])
+			  && index + 1 < curve_list.size() )
+				++index;
+			if ( index >= curve_list.size()
+			  || !time_less_curve_end(t, curve_list[index])
+			  || (index > 0 && time_less_curve_end(t, curve_list[index - 1])) )
+				index = std::upper_bound(curve_list.begin(), curve_list.end(), t, time_less_curve_end) - curve_list.begin();
+			if(index>=curve_list.size())
 				return animated.waypoint_list_.back().get_value(t);
-			return iter->resolve(t);
+			last_curve.store(index, std::memory_order_relaxed);
+			return curve_list[index].resolve(t);
 		}
 	}; // END of class Hermite
 
@@ -750,13 +859,10 @@ public:
 			if(t>=s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			WaypointList::const_iterator iter;
-			WaypointList::const_iterator next;
-
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(next=animated.waypoint_list_.begin(),iter=next++;next!=animated.waypoint_list_.end() && t>=next->get_time();iter=next++)
-				continue;
+			// find the last waypoint which is not later than the given time
+			WaypointList::const_iterator iter = std::upper_bound(
+				animated.waypoint_list_.begin(), animated.waypoint_list_.end(), t, time_less_waypoint() );
+			--iter;
 
 			return iter->get_value(t);
 		}
@@ -841,14 +947,11 @@ public:
 			if(t>s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			WaypointList::const_iterator iter;
-			WaypointList::const_iterator next;
-
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(next=animated.waypoint_list_.begin(),iter=next++;next!=animated.waypoint_list_.end() && t>=next->get_time();iter=next++)
-				if(iter->get_time()==t)
-					return iter->get_value(t);
+			// find the last waypoint which is not later than the given time
+			WaypointList::const_iterator next = std::upper_bound(
+				animated.waypoint_list_.begin(), animated.waypoint_list_.end(), t, time_less_waypoint() );
+			WaypointList::const_iterator iter = next;
+			--iter;
 
 			if(iter->get_time()==t)
 				return iter->get_value(t);
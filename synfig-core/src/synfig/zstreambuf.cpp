@@ -30,6 +30,7 @@
 #endif
 
 #include <cstring>
+#include <algorithm>
 #include "zstreambuf.h"
 
 #endif
@@ -44,12 +45,17 @@ using namespace synfig;
 
 /* === G L O B A L S ======================================================= */
 
+// zlib counts input in uInt
+static const size_t max_deflate_block = 1 << 30;
+
 /* === P R O C E D U R E S ================================================= */
 
 /* === M E T H O D S ======================================================= */
 
-zstreambuf::zstreambuf(std::streambuf *buf):
+zstreambuf::zstreambuf(std::streambuf *buf, int compression_level, size_t bufsize):
 	buf_(buf),
+	compression_level_(compression_level),
+	bufsize_(std::max(bufsize, (size_t)256)),
 	inflate_initialized(false),
 	deflate_initialized(false)
 {
@@ -57,7 +63,8 @@ zstreambuf::zstreambuf(std::streambuf *buf):
 
 zstreambuf::~zstreambuf()
 {
-	sync();
+	deflate_buf(Z_FINISH);
+	buf_->pubsync();
 	if (inflate_initialized) inflateEnd(&inflate_stream_);
 	if (deflate_initialized) deflateEnd(&deflate_stream_);
 }
@@ -88,6 +95,8 @@ bool zstreambuf::pack(std::vector<char> &dest, const void *src, size_t size, boo
 			{ result = false; break; }
 	} while (stream.avail_out == 0);
 	if (stream.avail_in != 0) result = false;
+	// unused tail of the last block
+	dest.resize(dest.size() - stream.avail_out);
 	deflateEnd(&stream);
 	return result;
 }
@@ -134,6 +143,8 @@ bool zstreambuf::unpack(std::vector<char> &dest, const void *src, size_t size) {
 			{ result = false; break; }
 	} while (stream.avail_out == 0);
 	if (stream.avail_in != 0) result = false;
+	// unused tail of the last block
+	dest.resize(dest.size() - stream.avail_out);
 	inflateEnd(&stream);
 	return result;
 }
@@ -165,13 +176,13 @@ bool zstreambuf::inflate_buf()
     }
 
     // read and inflate new chunk of data
-    char in_buf[option_bufsize];
-    inflate_stream_.avail_in = buf_->sgetn(in_buf, sizeof(in_buf));
-    inflate_stream_.next_in = (Bytef*)in_buf;
+    if (in_buffer_.size() < bufsize_) in_buffer_.resize(bufsize_);
+    inflate_stream_.avail_in = buf_->sgetn(&in_buffer_.front(), in_buffer_.size());
+    inflate_stream_.next_in = (Bytef*)&in_buffer_.front();
 	read_buffer_.resize(0);
 	do
 	{
-		inflate_stream_.avail_out = option_bufsize;
+		inflate_stream_.avail_out = bufsize_;
 		read_buffer_.resize(read_buffer_.size() + inflate_stream_.avail_out);
 		inflate_stream_.next_out = (Bytef*)(&read_buffer_.back() + 1 - inflate_stream_.avail_out);
 		int ret = ::inflate(&inflate_stream_, Z_NO_FLUSH);
@@ -189,48 +200,70 @@ bool zstreambuf::inflate_buf()
     return true;
 }
 
-bool zstreambuf::deflate_buf(bool flush)
+bool zstreambuf::deflate_block(const char *data, size_t size, int flush)
 {
-	if (pbase() != NULL && pptr() > pbase())
+	// initialize deflate if need
+	if (!deflate_initialized)
 	{
-		// initialize deflate if need
-		if (!deflate_initialized)
-		{
-			memset(&deflate_stream_, 0, sizeof(deflate_stream_));
+		// nothing was written, so nothing to flush
+		if (size == 0) return true;
 
-			if (Z_OK != deflateInit2(&deflate_stream_,
-					option_compression_level,
-					option_method,
-					option_window_bits,
-					option_mem_level,
-					option_strategy
-			)) return false;
+		memset(&deflate_stream_, 0, sizeof(deflate_stream_));
 
-			deflate_initialized = true;
-		}
+		if (Z_OK != deflateInit2(&deflate_stream_,
+				compression_level_,
+				option_method,
+				option_window_bits,
+				option_mem_level,
+				option_strategy
+		)) return false;
+
+		deflate_initialized = true;
+	}
 
-		// deflate and write new chunk of data
-		char out_buf[option_bufsize];
-		deflate_stream_.avail_in = (uInt)(pptr() - pbase());
-		deflate_stream_.next_in = (Bytef*)pbase();
+	if (out_buffer_.size() < bufsize_) out_buffer_.resize(bufsize_);
+
+	// deflate and write data, whole output buffer goes to the underlying stream at once
+	do
+	{
+		size_t chunk = std::min(size, max_deflate_block);
+		int chunk_flush = chunk < size ? Z_NO_FLUSH : flush;
+		deflate_stream_.avail_in = (uInt)chunk;
+		deflate_stream_.next_in = (Bytef*)const_cast<char*>(data);
 		do
 		{
-			deflate_stream_.avail_out = sizeof(out_buf);
-			deflate_stream_.next_out = (Bytef*)out_buf;
-			if (Z_STREAM_ERROR == deflate(&deflate_stream_, flush ? Z_FINISH : Z_NO_FLUSH))
+			deflate_stream_.avail_out = (uInt)out_buffer_.size();
+			deflate_stream_.next_out = (Bytef*)&out_buffer_.front();
+			if (Z_STREAM_ERROR == deflate(&deflate_stream_, chunk_flush))
+				return false;
+			std::streamsize out_size = (std::streamsize)(out_buffer_.size() - deflate_stream_.avail_out);
+			if (out_size > 0 && out_size != buf_->sputn(&out_buffer_.front(), out_size))
 				return false;
-			if (deflate_stream_.avail_out < sizeof(out_buf))
-				buf_->sputn(out_buf, sizeof(out_buf) - deflate_stream_.avail_out);
 		} while (deflate_stream_.avail_out == 0);
 		assert(deflate_stream_.avail_in == 0);
-		setp(NULL, NULL);
-	}
+		data += chunk;
+		size -= chunk;
+	} while (size > 0);
 	return true;
 }
 
+bool zstreambuf::deflate_buf(int flush)
+{
+	bool success = true;
+	if (pbase() != NULL && pptr() > pbase())
+		success = deflate_block(pbase(), pptr() - pbase(), flush);
+	else
+	if (flush == Z_FINISH)
+		success = deflate_block(NULL, 0, flush);
+	if (pbase() != NULL)
+		setp(pbase(), epptr());
+	return success;
+}
+
 int zstreambuf::sync()
 {
-	bool deflate_success = deflate_buf(true);
+	// stream stays open, it will be finished in destructor
+	bool deflate_success = deflate_buf(Z_SYNC_FLUSH);
 	bool buf_sync_success = 0 == buf_->pubsync();
 	return deflate_success && buf_sync_success ? 0 : -1;
 }
@@ -248,14 +281,18 @@ int zstreambuf::overflow(int c)
 	// flush
 	if (c == EOF) { sync(); return EOF; }
 
-	// save data and prepare new buffer
-	if (pptr() >= epptr())
+	// prepare buffer or save data
+	if (pbase() == NULL)
 	{
-		if (!deflate_buf(false)) return EOF;
-		if (write_buffer_.size() < option_bufsize) write_buffer_.resize(option_bufsize);
+		write_buffer_.resize(bufsize_);
 		char *pointer = &write_buffer_.front();
 		setp(pointer, pointer + write_buffer_.size());
 	}
+	else
+	if (pptr() >= epptr())
+	{
+		if (!deflate_buf(Z_NO_FLUSH)) return EOF;
+	}
 
 	// put character
 	*pptr() = traits_type::to_char_type(c);
@@ -263,5 +300,17 @@ int zstreambuf::overflow(int c)
 	return c;
 }
 
+std::streamsize zstreambuf::xsputn(const char *s, std::streamsize n)
+{
+	// small blocks are collected in buffer
+	if (n <= 0 || (size_t)n < bufsize_)
+		return std::streambuf::xsputn(s, n);
+
+	// big blocks are deflated directly, without copying
+	if (!deflate_buf(Z_NO_FLUSH) || !deflate_block(s, (size_t)n, Z_NO_FLUSH))
+		return 0;
+	return n;
+}
+
 /* === E N T R Y P O I N T ================================================= */
 
@@ -46,7 +46,7 @@ namespace synfig {
 	{
 	public:
 		enum {
-			option_bufsize				= 4096,
+			option_bufsize				= 65536,
 			option_method				= Z_DEFLATED,
 			option_compression_level	= Z_BEST_COMPRESSION,
 			option_window_bits			= 16+MAX_WBITS,
@@ -60,26 +60,36 @@ namespace synfig {
 
 	private:
 		std::streambuf *buf_;
+		int compression_level_;
+		size_t bufsize_;
 
 		bool inflate_initialized;
 		z_stream inflate_stream_;
+		std::vector<char> in_buffer_;
 		std::vector<char> read_buffer_;
 
 		bool deflate_initialized;
 		z_stream deflate_stream_;
+		std::vector<char> out_buffer_;
 		std::vector<char> write_buffer_;
 
 		bool inflate_buf();
-		bool deflate_buf(bool flush);
+		bool deflate_block(const char *data, size_t size, int flush);
+		bool deflate_buf(int flush);
 
 	public:
-		explicit zstreambuf(std::streambuf *buf);
+		//! \a compression_level is used only for writing, gzip stream is finished in destructor
+		explicit zstreambuf(
+			std::streambuf *buf,
+			int compression_level = option_compression_level,
+			size_t bufsize = option_bufsize );
 		virtual ~zstreambuf();
 
 	protected:
 		virtual int sync();
 		virtual int underflow();
 		virtual int overflow(int c = EOF);
+		virtual std::streamsize xsputn(const char *s, std::streamsize n);
 
 	public:
 		static bool pack(std::vector<char> &dest, const void *src, size_t size, bool fast = false);
@@ -120,23 +130,24 @@ namespace synfig {
 	private:
 		FileSystem::WriteStream::Handle stream_;
 		zstreambuf buf_;
-		std::ostream ostream_;
 
 	protected:
 		virtual size_t internal_write(const void *buffer, size_t size)
 		{
-			for(size_t i = 0; i < size; i++)
-				if (!ostream_.put(((const char*)buffer)[i]).good())
-					return i;
-			return size;
+			std::streamsize written = buf_.sputn((const char*)buffer, (std::streamsize)size);
+			return written > 0 ? (size_t)written : 0;
 		}
 
 	public:
-		ZWriteStream(FileSystem::WriteStream::Handle stream):
+		//! use zstreambuf::fast_option_compression_level for temporary files
+		ZWriteStream(
+			FileSystem::WriteStream::Handle stream,
+			int compression_level = zstreambuf::option_compression_level,
+			size_t bufsize = zstreambuf::option_bufsize
+		):
 			FileSystem::WriteStream(stream->file_system()),
 			stream_(stream),
-			buf_(stream_->rdbuf()),
-			ostream_(&buf_)
+			buf_(stream_->rdbuf(), compression_level, bufsize)
 		{ }
 	};
 }
@@ -101,6 +101,10 @@ public:
 
 	void set_should_print_benchmarks(bool print_benchmarks);
 
+	std::string get_profile_filename() const;
+
+	void set_profile_filename(const std::string& filename);
+
 private:
 	SynfigToolGeneralOptions(const char* argv0);
 
@@ -109,6 +113,7 @@ private:
 	size_t _threads;
 	bool _should_be_quiet,
 		 _should_print_benchmarks;
+	std::string _profile_filename;
 
 	static std::shared_ptr<SynfigToolGeneralOptions> _instance;
 };
@@ -57,6 +57,8 @@
 #include <synfig/string.h>
 #include <synfig/paramdesc.h>
 #include <synfig/main.h>
+#include <synfig/debug/profiler.h>
+#include <synfig/rendering/software/surfacepool.h>
 #include <autorevision.h>
 #include "definitions.h"
 #include "progress.h"
@@ -297,6 +299,24 @@ int main(int argc, char* argv[])
 
 		process_job_list(job_list, parser.extract_targetparam());
 
+		const std::string profile_filename =
+			SynfigToolGeneralOptions::instance()->get_profile_filename();
+		if (!profile_filename.empty())
+		{
+			synfig::debug::Profiler::set_enabled(false);
+			if (SynfigToolGeneralOptions::instance()->should_print_benchmarks())
+			{
+				const synfig::rendering::SurfacePool &pool =
+					synfig::rendering::SurfacePool::get_instance();
+				std::cout << synfig::debug::Profiler::get_summary()
+						  << "surface pool: " << pool.get_hits() << " hits, "
+						  << pool.get_misses() << " misses" << std::endl;
+			}
+			if (!synfig::debug::Profiler::save(profile_filename))
+				throw SynfigToolException(SYNFIGTOOL_INVALIDOUTPUT,
+					_("Unable to write profile: ") + profile_filename);
+		}
+
 		return SYNFIGTOOL_OK;
 
     }
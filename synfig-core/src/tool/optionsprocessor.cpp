@@ -49,6 +49,7 @@
 #include <synfig/filesystemgroup.h>
 #include <synfig/filesystemnative.h>
 #include <synfig/filecontainerzip.h>
+#include <synfig/debug/profiler.h>
 
 #include "definitions.h"
 #include "job.h"
@@ -118,6 +119,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	sw_quiet(),
 	sw_print_benchmarks(),
 	sw_extract_alpha(),
+	sw_profile_filename(),
 
 	// Misc group
 	misc_append_filename(),
@@ -177,6 +179,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_switch, "quiet",         'q', sw_quiet, 				_("Quiet mode (No progress/time-remaining display)"), "");
 	add_option(og_switch, "benchmarks",    'b', sw_print_benchmarks,	_("Print benchmarks"), "");
 	add_option(og_switch, "extract-alpha", 'x', sw_extract_alpha, 		_("Extract alpha"), "");
+	add_option_filename(og_switch, "profile", ' ', sw_profile_filename,	_("Write timings of rendering tasks into <filename> in Chrome trace-event format"), _("filename"));
 
 	//SynfigOptionGroup og_misc("misc", _("Misc options"), "Show Misc options help");
 	add_option_filename(og_misc, "append", ' ', misc_append_filename, 	_("Append layers in <filename> to composition"), _("filename"));
@@ -355,6 +358,12 @@ void SynfigCommandLineParser::process_settings_options()
 		SynfigToolGeneralOptions::instance()->set_should_be_quiet(true);
 	}
 
+	if (!sw_profile_filename.empty())
+	{
+		SynfigToolGeneralOptions::instance()->set_profile_filename(sw_profile_filename);
+		synfig::debug::Profiler::set_enabled(true);
+	}
+
 	if (set_num_threads > 0)
 	{
 		SynfigToolGeneralOptions::instance()->set_threads(set_num_threads);
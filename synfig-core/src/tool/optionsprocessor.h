@@ -173,6 +173,7 @@ private:
 	bool			sw_quiet;
 	bool			sw_print_benchmarks;
 	bool			sw_extract_alpha;
+	std::string		sw_profile_filename;
 
 	// Misc group
 	std::string		misc_append_filename;
@@ -0,0 +1,90 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_blend.cpp
+**	\brief Measures speed of blend kernels for each blend method
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <vector>
+
+#include <ETL/clock>
+
+#include <synfig/color.h>
+#include <synfig/rendering/software/function/blend.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define BLEND_ROW_SIZE		(1920)
+#define BLEND_ITERATIONS	(1080)
+
+/* === P R O C E D U R E S ================================================= */
+
+int blend_benchmark()
+{
+	vector<Color> src(BLEND_ROW_SIZE), dest(BLEND_ROW_SIZE);
+	for(int i = 0; i < BLEND_ROW_SIZE; ++i) {
+		ColorReal k = ColorReal(i)/ColorReal(BLEND_ROW_SIZE);
+		src[i] = Color(k, 1.0 - k, 0.5*k, 0.25 + 0.5*k);
+		dest[i] = Color(0.5*k, k, 1.0 - k, 1.0 - 0.5*k);
+	}
+
+	etl::clock timer;
+	for(int m = 0; m < Color::BLEND_END; ++m) {
+		printf("blend method %2d:", m);
+		for(int k = 0; k < software::Blend::INSTRUCTIONS_COUNT; ++k) {
+			software::Blend::Instructions instructions = (software::Blend::Instructions)k;
+			if (!software::Blend::is_supported(instructions))
+				continue;
+
+			vector<Color> d(dest);
+			timer.reset();
+			for(int i = 0; i < BLEND_ITERATIONS; ++i)
+				software::Blend::blend_row(&d[0], &src[0], BLEND_ROW_SIZE, 0.75, (Color::BlendMethod)m, instructions);
+			etl::clock::value_type t = timer();
+
+			printf( "  %s %8.3f ms",
+				software::Blend::get_instructions_name(instructions),
+				t*1000 );
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	return blend_benchmark();
+}
@@ -0,0 +1,132 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_contour.cpp
+**	\brief Compares rasterization of contours with sorted marks and with accumulation buffer
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <ETL/clock>
+
+#include <synfig/surface.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/function/contour.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define SURFACE_SIZE	(512)
+#define REPEATS			(8)
+
+/* === P R O C E D U R E S ================================================= */
+
+//! star-like closed paths with random radius, count of vertices sets density of edges
+static void make_contour(Contour::ChunkList &chunks, int paths, int vertices, Real size)
+{
+	srand(vertices*paths);
+	chunks.clear();
+	for(int p = 0; p < paths; ++p) {
+		Vector center(rand()%SURFACE_SIZE, rand()%SURFACE_SIZE);
+		for(int i = 0; i < vertices; ++i) {
+			Real a = 2.0*PI*i/vertices;
+			Real r = (0.2 + 0.8*(rand()%1000)/1000.0)*size;
+			Vector v = center + Vector(cos(a)*r, sin(a)*r);
+			chunks.push_back(Contour::Chunk(i ? Contour::LINE : Contour::MOVE, v));
+		}
+		chunks.push_back(Contour::Chunk(Contour::CLOSE, Vector()));
+	}
+}
+
+static double render(
+	Surface &surface,
+	const Contour::ChunkList &chunks,
+	Contour::WindingStyle winding_style,
+	bool accumulation )
+{
+	RectInt window(0, 0, surface.get_w(), surface.get_h());
+	etl::clock timer;
+	for(int i = 0; i < REPEATS; ++i) {
+		Polyspan polyspan;
+		polyspan.init(window, accumulation);
+		software::Contour::build_polyspan(chunks, Matrix(), polyspan);
+		polyspan.sort_marks();
+		software::Contour::render_polyspan(
+			surface, polyspan, false, true, winding_style,
+			Color::white(), 1.0, Color::BLEND_COMPOSITE );
+	}
+	return timer()/REPEATS;
+}
+
+int contour_benchmark()
+{
+	static const struct { int paths, vertices; Real size; } cases[] = {
+		{    1,    16,  16.0 },
+		{    1,    16, 256.0 },
+		{    1,   256, 256.0 },
+		{    1,  4096, 256.0 },
+		{   16,   256,  64.0 },
+		{   64,  1024, 128.0 },
+		{  256,  1024, 256.0 }
+	};
+
+	Surface surface(SURFACE_SIZE, SURFACE_SIZE);
+	Contour::ChunkList chunks;
+
+	printf("  paths  vertices   size      non-zero (marks / accum)      even-odd (marks / accum)   dense\n");
+	for(int i = 0; i < (int)(sizeof(cases)/sizeof(cases[0])); ++i) {
+		make_contour(chunks, cases[i].paths, cases[i].vertices, cases[i].size);
+		double t[4];
+		t[0] = render(surface, chunks, Contour::WINDING_NON_ZERO, false);
+		t[1] = render(surface, chunks, Contour::WINDING_NON_ZERO, true);
+		t[2] = render(surface, chunks, Contour::WINDING_EVEN_ODD, false);
+		t[3] = render(surface, chunks, Contour::WINDING_EVEN_ODD, true);
+		bool dense = software::Contour::is_dense(
+			chunks, Matrix(), RectInt(0, 0, surface.get_w(), surface.get_h()) );
+		printf( "%7d  %8d  %5.0f   %9.3f / %9.3f ms   %9.3f / %9.3f ms   %s\n",
+				cases[i].paths, cases[i].vertices, cases[i].size,
+				t[0]*1000, t[1]*1000,
+				t[2]*1000, t[3]*1000,
+				dense ? "yes" : "no" );
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	return contour_benchmark();
+}
@@ -0,0 +1,108 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_ffmpeg_import.cpp
+**	\brief Compares per-frame and streaming modes of the ffmpeg importer
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <ETL/clock>
+#include <ETL/stringf>
+
+#include <synfig/main.h>
+#include <synfig/importer.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/renddesc.h>
+#include <synfig/surface.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+#define IMPORT_FRAMES		(240)
+#define IMPORT_FRAME_RATE	(24)
+
+/* === P R O C E D U R E S ================================================= */
+
+int import_benchmark(const String &filename, bool streaming)
+{
+	if (streaming)
+		unsetenv("SYNFIG_DISABLE_FFMPEG_STREAMING");
+	else
+		setenv("SYNFIG_DISABLE_FFMPEG_STREAMING", "1", 1);
+
+	FileSystem::Identifier identifier = FileSystemNative::instance()->get_identifier(filename);
+	Importer::forget(identifier);
+	Importer::Handle importer = Importer::open(identifier);
+	if (!importer) {
+		printf("cannot open %s\n", filename.c_str());
+		return 1;
+	}
+
+	RendDesc desc;
+	desc.set_frame_rate(IMPORT_FRAME_RATE);
+
+	int frames = 0;
+	etl::clock timer;
+	timer.reset();
+	for(int i = 0; i < IMPORT_FRAMES; ++i) {
+		Surface surface;
+		if (!importer->get_frame(surface, desc, Time(i)/IMPORT_FRAME_RATE))
+			break;
+		++frames;
+	}
+	etl::clock::value_type t = timer();
+
+	printf( "%-10s %4d frames  %8.3f s  %8.2f fps\n",
+		streaming ? "streaming" : "per-frame",
+		frames, t, t > 0 ? frames/t : 0.0 );
+
+	Importer::forget(identifier);
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		printf("usage: %s <video file>\n", argv[0]);
+		return 0;
+	}
+
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+	failures += import_benchmark(argv[1], false);
+	failures += import_benchmark(argv[1], true);
+	return failures;
+}
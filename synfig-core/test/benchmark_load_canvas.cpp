@@ -0,0 +1,129 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_load_canvas.cpp
+**	\brief Compares load time and peak memory of DOM and streaming canvas loaders
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <ETL/clock>
+#include <ETL/stringf>
+
+#include <synfig/main.h>
+#include <synfig/canvas.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/loadcanvas.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+
+/* === P R O C E D U R E S ================================================= */
+
+// runs in separate process, so peak memory of every run is measured separately
+int load_benchmark(const char *dirname, const String &filename, bool streaming)
+{
+	if (streaming)
+		unsetenv("SYNFIG_DISABLE_CANVAS_STREAMING");
+	else
+		setenv("SYNFIG_DISABLE_CANVAS_STREAMING", "1", 1);
+
+	synfig::Main main(dirname);
+
+	struct rusage usage_before;
+	getrusage(RUSAGE_SELF, &usage_before);
+
+	etl::clock timer;
+	timer.reset();
+
+	String errors, warnings;
+	Canvas::Handle canvas = open_canvas_as(
+		FileSystemNative::instance()->get_identifier(filename), filename, errors, warnings );
+	etl::clock::value_type t = timer();
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	if (!canvas) {
+		printf("cannot load %s\n%s", filename.c_str(), errors.c_str());
+		return 1;
+	}
+
+	// ru_maxrss is in kilobytes on Linux
+	printf( "%-10s %8.3f s  %10ld KiB peak  %10ld KiB before loading\n",
+		streaming ? "streaming" : "dom",
+		t, (long)usage.ru_maxrss, (long)usage_before.ru_maxrss );
+	return 0;
+}
+
+int run_benchmark(const char *dirname, const String &filename, bool streaming)
+{
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) {
+		printf("cannot fork\n");
+		return 1;
+	}
+	if (pid == 0) {
+		int result = load_benchmark(dirname, filename, streaming);
+		fflush(stdout);
+		_exit(result);
+	}
+
+	int status = 0;
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+		return 1;
+	return WEXITSTATUS(status);
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		printf("usage: %s <sif or sifz file> [<file> ...]\n", argv[0]);
+		return 0;
+	}
+
+	String dirname = etl::dirname(argv[0]);
+
+	int failures = 0;
+	for(int i = 1; i < argc; ++i) {
+		printf("%s\n", argv[i]);
+		failures += run_benchmark(dirname.c_str(), argv[i], false);
+		failures += run_benchmark(dirname.c_str(), argv[i], true);
+	}
+	return failures;
+}
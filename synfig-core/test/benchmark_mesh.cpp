@@ -0,0 +1,174 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_mesh.cpp
+**	\brief Measures rasterization of dense deformation meshes by the whole target and by tiles
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <ETL/clock>
+
+#include <synfig/surface.h>
+#include <synfig/threadpool.h>
+#include <synfig/rendering/primitive/mesh.h>
+#include <synfig/rendering/software/function/mesh.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define SURFACE_SIZE	(512)
+#define TEXTURE_SIZE	(512)
+#define TILE_SIZE		(128)
+#define REPEATS			(8)
+
+/* === P R O C E D U R E S ================================================= */
+
+//! grid of \a cells x \a cells quads covering the surface, warped by waves
+//! like a skeleton deformation, texture coordinates stay regular
+static void make_mesh(rendering::Mesh &mesh, int cells)
+{
+	mesh.vertices.clear();
+	mesh.triangles.clear();
+	Real step = (Real)SURFACE_SIZE/cells;
+	for(int j = 0; j <= cells; ++j) {
+		for(int i = 0; i <= cells; ++i) {
+			Real x = i*step, y = j*step;
+			rendering::Mesh::Vertex vertex;
+			vertex.position = Vector(
+				x + 16.0*sin(y*0.02)*sin(x*PI/SURFACE_SIZE),
+				y + 16.0*sin(x*0.03)*sin(y*PI/SURFACE_SIZE) );
+			vertex.tex_coords = Vector(i, j)*((Real)TEXTURE_SIZE/cells);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+	for(int j = 0; j < cells; ++j) {
+		for(int i = 0; i < cells; ++i) {
+			int v = j*(cells + 1) + i;
+			rendering::Mesh::Triangle triangle;
+			triangle.vertices[0] = v;
+			triangle.vertices[1] = v + 1;
+			triangle.vertices[2] = v + cells + 2;
+			mesh.triangles.push_back(triangle);
+			triangle.vertices[1] = v + cells + 2;
+			triangle.vertices[2] = v + cells + 1;
+			mesh.triangles.push_back(triangle);
+		}
+	}
+}
+
+static void render_tile(
+	Surface *surface,
+	const software::Mesh::TriangleList *triangles,
+	const Surface *texture,
+	RectInt rect )
+{
+	software::Mesh::render_triangles(
+		*surface, rect, *triangles,
+		*texture, Rect(0.0, 0.0, TEXTURE_SIZE, TEXTURE_SIZE),
+		1.0, Color::BLEND_COMPOSITE );
+}
+
+static double render_whole(Surface &surface, const rendering::Mesh &mesh, const Surface &texture)
+{
+	etl::clock timer;
+	for(int i = 0; i < REPEATS; ++i)
+		software::Mesh::render_mesh(
+			surface, RectInt(0, 0, SURFACE_SIZE, SURFACE_SIZE), mesh,
+			texture, Rect(0.0, 0.0, TEXTURE_SIZE, TEXTURE_SIZE),
+			Matrix(), Matrix(), 1.0, Color::BLEND_COMPOSITE );
+	return timer()/REPEATS;
+}
+
+//! the same way as TaskMeshSW renders big targets
+static double render_tiles(ThreadPool &pool, Surface &surface, const rendering::Mesh &mesh, const Surface &texture)
+{
+	RectInt rect(0, 0, SURFACE_SIZE, SURFACE_SIZE);
+	int tiles_x = (SURFACE_SIZE + TILE_SIZE - 1)/TILE_SIZE;
+	etl::clock timer;
+	for(int i = 0; i < REPEATS; ++i) {
+		software::Mesh::TriangleList triangles;
+		software::Mesh::transform_triangles(mesh, Matrix(), Matrix(), rect, triangles);
+		vector<software::Mesh::TriangleList> tiles;
+		software::Mesh::split_tiles(triangles, rect, TILE_SIZE, tiles);
+
+		ThreadPool::Group group(pool);
+		for(int j = 0; j < (int)tiles.size(); ++j) {
+			int x = (j % tiles_x)*TILE_SIZE;
+			int y = (j / tiles_x)*TILE_SIZE;
+			group.enqueue( sigc::bind( sigc::ptr_fun(&render_tile),
+				&surface, &tiles[j], &texture,
+				RectInt(x, y, x + TILE_SIZE, y + TILE_SIZE) ));
+		}
+		group.run();
+	}
+	return timer()/REPEATS;
+}
+
+int mesh_benchmark()
+{
+	static const int cells[] = { 4, 16, 64, 128, 256 };
+	static const int threads[] = { 1, 4, 16 };
+	const int threads_count = (int)(sizeof(threads)/sizeof(threads[0]));
+
+	Surface texture(TEXTURE_SIZE, TEXTURE_SIZE);
+	for(int y = 0; y < TEXTURE_SIZE; ++y)
+		for(int x = 0; x < TEXTURE_SIZE; ++x)
+			texture[y][x] = ((x/16 + y/16) % 2) ? Color(1.0, 0.5, 0.0, 1.0) : Color(0.0, 0.2, 1.0, 0.5);
+
+	Surface surface(SURFACE_SIZE, SURFACE_SIZE);
+	rendering::Mesh mesh;
+
+	printf("  cells  triangles        whole     tiles x1     tiles x4    tiles x16\n");
+	for(int i = 0; i < (int)(sizeof(cells)/sizeof(cells[0])); ++i) {
+		make_mesh(mesh, cells[i]);
+		double whole = render_whole(surface, mesh, texture);
+		double t[threads_count];
+		for(int j = 0; j < threads_count; ++j) {
+			ThreadPool pool(threads[j]);
+			t[j] = render_tiles(pool, surface, mesh, texture);
+		}
+		printf( "%7d  %9d  %8.3f ms  %8.3f ms  %8.3f ms  %8.3f ms\n",
+				cells[i], (int)mesh.triangles.size(),
+				whole*1000, t[0]*1000, t[1]*1000, t[2]*1000 );
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	return mesh_benchmark();
+}
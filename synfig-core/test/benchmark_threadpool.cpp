@@ -0,0 +1,282 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_threadpool.cpp
+**	\brief Compares ThreadPool with the previous pool based on single locked queue
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <queue>
+#include <vector>
+
+#include <ETL/clock>
+
+#include <synfig/threadpool.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+#define TINY_SLOTS		(100000)
+#define NESTED_DEPTH	(4)
+#define NESTED_FANOUT	(8)
+#define UNBALANCED_SLOTS	(256)
+
+/* === C L A S S E S ======================================================= */
+
+//! Previous implementation of ThreadPool: single queue under mutex,
+//! and static partition of weighted slots in Group
+class QueuePool {
+public:
+	typedef ThreadPool::Slot Slot;
+
+	class Group {
+	private:
+		QueuePool &pool;
+		bool multithreading;
+		std::atomic<int> running_threads;
+		Glib::Threads::Mutex mutex;
+		Glib::Threads::Cond cond;
+		vector< pair<Real, Slot> > tasks;
+		Real sum_weight;
+
+		void process(int begin, int end) {
+			for(int i = begin; i < end; ++i)
+				tasks[i].second();
+			Glib::Threads::Mutex::Lock lock(mutex);
+			if (!--running_threads) cond.signal();
+		}
+
+	public:
+		explicit Group(QueuePool &pool):
+			pool(pool), multithreading(), running_threads(0), sum_weight() { }
+		~Group() { run(); }
+
+		void enqueue(const Slot &slot, Real weight = 1.0)
+			{ tasks.push_back(make_pair(weight, slot)); sum_weight += weight; }
+
+		void run() {
+			Real sum = 0.0;
+			int begin = 0;
+			for(int i = 0; i < (int)tasks.size(); ++i) {
+				sum += tasks[i].first;
+				if (sum_weight - sum < 0.75) break;
+				if (sum >= 0.75) {
+					multithreading = true;
+					++running_threads;
+					pool.enqueue( sigc::bind( sigc::mem_fun(this, &Group::process), begin, i + 1 ));
+					sum_weight -= sum;
+					sum = 0.0;
+					begin = i + 1;
+				}
+			}
+			for(int i = begin; i < (int)tasks.size(); ++i)
+				tasks[i].second();
+			if (multithreading) {
+				Glib::Threads::Mutex::Lock lock(mutex);
+				while(running_threads > 0) pool.wait(cond, mutex);
+			}
+			multithreading = false;
+			tasks.clear();
+			sum_weight = 0.0;
+		}
+	};
+
+private:
+	Glib::Threads::Mutex mutex;
+	Glib::Threads::Cond cond;
+	int max_running_threads;
+	std::atomic<int> running_threads;
+	std::atomic<int> ready_threads;
+	std::atomic<int> queue_size;
+	std::queue<Slot> queue;
+	vector<Glib::Threads::Thread*> threads;
+	bool stopped;
+
+	void thread_loop() {
+		++running_threads;
+		while(true) {
+			Slot slot;
+			{
+				Glib::Threads::Mutex::Lock lock(mutex);
+				while(!stopped && (queue.empty() || running_threads > max_running_threads)) {
+					++ready_threads;
+					--running_threads;
+					cond.wait(mutex);
+					++running_threads;
+					--ready_threads;
+				}
+				if (stopped) break;
+				slot = queue.front();
+				queue.pop();
+				--queue_size;
+			}
+			slot();
+		}
+		--running_threads;
+	}
+
+	void wakeup() {
+		int to_wakeup = std::max(0, std::min((int)queue_size, max_running_threads - (int)running_threads));
+		int to_create = std::max(0, to_wakeup - (int)ready_threads);
+		to_wakeup     = std::max(0, to_wakeup - to_create);
+		while(to_create-- > 0)
+			threads.push_back(Glib::Threads::Thread::create(sigc::mem_fun(this, &QueuePool::thread_loop)));
+		while(to_wakeup-- > 0)
+			cond.signal();
+	}
+
+public:
+	explicit QueuePool(int threads):
+		max_running_threads(std::max(2, threads)),
+		running_threads(1),
+		ready_threads(0),
+		queue_size(0),
+		stopped(false)
+	{ }
+
+	~QueuePool() {
+		{
+			Glib::Threads::Mutex::Lock lock(mutex);
+			stopped = true;
+			cond.broadcast();
+		}
+		for(vector<Glib::Threads::Thread*>::iterator i = threads.begin(); i != threads.end(); ++i)
+			(*i)->join();
+	}
+
+	void enqueue(const Slot &slot) {
+		Glib::Threads::Mutex::Lock lock(mutex);
+		++queue_size;
+		queue.push(slot);
+		wakeup();
+	}
+
+	void wait(Glib::Threads::Cond &cond, Glib::Threads::Mutex &mutex) {
+		if (--running_threads < max_running_threads)
+			if (queue_size)
+				{ Glib::Threads::Mutex::Lock lock(this->mutex); wakeup(); }
+		cond.wait(mutex);
+		++running_threads;
+	}
+};
+
+/* === G L O B A L S ======================================================= */
+
+static std::atomic<int> counter;
+
+/* === P R O C E D U R E S ================================================= */
+
+static void tiny_slot()
+	{ ++counter; }
+
+static void unbalanced_slot(int index) {
+	// work of the first slots is much bigger than their weight tells
+	volatile double x = 0.0;
+	int count = index < UNBALANCED_SLOTS/8 ? 200000 : 2000;
+	for(int i = 0; i < count; ++i) x = x + 1.0/(1.0 + i);
+	++counter;
+}
+
+// the same pattern as in Renderer::optimize_recursive()
+template<typename Pool>
+static void nested_slot(Pool *pool, int depth) {
+	if (!depth) { ++counter; return; }
+	typename Pool::Group group(*pool);
+	for(int i = 0; i < NESTED_FANOUT; ++i)
+		group.enqueue(sigc::bind(sigc::ptr_fun(&nested_slot<Pool>), pool, depth - 1), 1.0);
+	group.run();
+}
+
+template<typename Pool>
+static double tiny_benchmark(Pool &pool) {
+	etl::clock timer;
+	counter = 0;
+	for(int i = 0; i < TINY_SLOTS; ++i)
+		pool.enqueue(sigc::ptr_fun(&tiny_slot));
+	while(counter < TINY_SLOTS)
+		Glib::Threads::Thread::yield();
+	return timer();
+}
+
+template<typename Pool>
+static double nested_benchmark(Pool &pool) {
+	etl::clock timer;
+	counter = 0;
+	nested_slot(&pool, NESTED_DEPTH);
+	return timer();
+}
+
+template<typename Pool>
+static double unbalanced_benchmark(Pool &pool) {
+	etl::clock timer;
+	counter = 0;
+	{
+		typename Pool::Group group(pool);
+		for(int i = 0; i < UNBALANCED_SLOTS; ++i)
+			group.enqueue(sigc::bind(sigc::ptr_fun(&unbalanced_slot), i), 1.0);
+		group.run();
+	}
+	return timer();
+}
+
+int threadpool_benchmark()
+{
+	printf("threads      tiny slots (old / new)   nested groups (old / new)   unbalanced group (old / new)\n");
+	for(int threads = 1; threads <= 64; threads *= 2) {
+		double t[6];
+		{
+			QueuePool pool(threads);
+			t[0] = tiny_benchmark(pool);
+			t[2] = nested_benchmark(pool);
+			t[4] = unbalanced_benchmark(pool);
+		}
+		{
+			ThreadPool pool(threads);
+			t[1] = tiny_benchmark(pool);
+			t[3] = nested_benchmark(pool);
+			t[5] = unbalanced_benchmark(pool);
+		}
+		printf( "%7d  %9.3f / %9.3f ms   %9.3f / %9.3f ms      %9.3f / %9.3f ms\n",
+				threads,
+				t[0]*1000, t[1]*1000,
+				t[2]*1000, t[3]*1000,
+				t[4]*1000, t[5]*1000 );
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	return threadpool_benchmark();
+}
@@ -0,0 +1,110 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file importercache.cpp
+**	\brief Checks cache of decoded frames of importers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <iostream>
+
+#include <synfig/main.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/importercache.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+rendering::Surface::Handle create_surface(int width, int height)
+{
+	rendering::Surface::Handle surface(new rendering::SurfaceSW());
+	surface->create(width, height);
+	return surface;
+}
+
+ImporterCache::Key create_key(const String &filename, long long file_time = 0, Time time = Time())
+	{ return ImporterCache::Key(FileSystem::Identifier(FileSystemNative::instance(), filename), file_time, time); }
+
+int cache_test()
+{
+	int failures = 0;
+
+	rendering::Surface::Handle surface = create_surface(16, 16);
+	size_t size = ImporterCache::get_surface_size(surface);
+	if (size != 16*16*sizeof(Color))
+		{ cerr << "wrong surface size" << endl; ++failures; }
+
+	ImporterCache cache(3*size);
+	cache.put(create_key("a.png"), surface);
+	cache.put(create_key("b.png"), create_surface(16, 16));
+	cache.put(create_key("c.png"), create_surface(16, 16));
+
+	if (cache.get(create_key("a.png")) != surface || cache.get_hits() != 1)
+		{ cerr << "frame was not cached" << endl; ++failures; }
+
+	// changed file or other frame should not be taken from cache
+	if (cache.get(create_key("a.png", 1)) || cache.get(create_key("a.png", 0, Time(1.0))) || cache.get_misses() != 2)
+		{ cerr << "wrong frame was taken from cache" << endl; ++failures; }
+
+	// least recently used frame should be released first, "a.png" was used recently
+	cache.put(create_key("d.png"), create_surface(16, 16));
+	if (!cache.get(create_key("a.png")) || cache.get(create_key("b.png")) || cache.get_memory() != 3*size)
+		{ cerr << "wrong frame was released" << endl; ++failures; }
+
+	// frames bigger than limit are not kept
+	cache.put(create_key("e.png"), create_surface(64, 64));
+	if (cache.get(create_key("e.png")))
+		{ cerr << "memory limit exceeded" << endl; ++failures; }
+
+	cache.set_memory_limit(0);
+	if (cache.get_memory())
+		{ cerr << "memory limit was not applied" << endl; ++failures; }
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += cache_test();
+
+	return failures;
+}
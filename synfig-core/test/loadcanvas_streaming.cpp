@@ -0,0 +1,408 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file loadcanvas_streaming.cpp
+**	\brief Test that streaming and DOM loaders of canvas files give the same canvases
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/guid.h>
+#include <synfig/layer.h>
+#include <synfig/loadcanvas.h>
+#include <synfig/main.h>
+#include <synfig/valuenode.h>
+#include <synfig/zstreambuf.h>
+#include <synfig/valuenodes/valuenode_animated.h>
+#include <synfig/valuenodes/valuenode_const.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+// guids of the nodes which are shared in the document
+static const char *shared_guids[] = {
+	"6A3F3E4C2D1B0A998877665544332211",
+	"0F1E2D3C4B5A69788796A5B4C3D2E1F0"
+};
+
+//! exported values and canvas, linkable and animated nodes,
+//! inline canvases and nodes shared by guid
+static const char *document =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<canvas version=\"1.0\" width=\"64\" height=\"48\" xres=\"2834.645669\" yres=\"2834.645669\""
+	" view-box=\"-1.0 0.75 1.0 -0.75\" antialias=\"1\" fps=\"24.000\" begin-time=\"0f\" end-time=\"2s\""
+	" bgcolor=\"0.5 0.5 0.5 1.0\">\n"
+	"  <name>streaming</name>\n"
+	"  <desc>loader test</desc>\n"
+	"  <defs>\n"
+	"    <real id=\"amount\" value=\"0.75\"/>\n"
+	"    <scale id=\"scaled\" type=\"real\" scalar=\":amount\">\n"
+	"      <link><real value=\"0.5\"/></link>\n"
+	"    </scale>\n"
+	"    <canvas id=\"item\">\n"
+	"      <layer type=\"SolidColor\" active=\"true\" version=\"0.1\" desc=\"exported solid\">\n"
+	"        <param name=\"color\"><color><r>0.1</r><g>0.2</g><b>0.3</b><a>1.0</a></color></param>\n"
+	"      </layer>\n"
+	"    </canvas>\n"
+	"  </defs>\n"
+	"  <layer type=\"SolidColor\" active=\"true\" version=\"0.1\" desc=\"background\">\n"
+	"    <param name=\"amount\" use=\":amount\"/>\n"
+	"    <param name=\"color\"><color><r>1.0</r><g>0.5</g><b>0.25</b><a>1.0</a></color></param>\n"
+	"  </layer>\n"
+	"  <layer type=\"polygon\" active=\"true\" version=\"0.1\" desc=\"animated polygon\">\n"
+	"    <param name=\"amount\">\n"
+	"      <animated type=\"real\">\n"
+	"        <waypoint time=\"0s\" before=\"clamped\" after=\"linear\"><real value=\"1.0\"/></waypoint>\n"
+	"        <waypoint time=\"1s\" before=\"ease\" after=\"constant\"><real value=\"0.25\"/></waypoint>\n"
+	"        <waypoint time=\"2s\" before=\"halt\" after=\"clamped\">\n"
+	"          <scale type=\"real\" scalar=\":amount\"><link><real value=\"0.5\"/></link></scale>\n"
+	"        </waypoint>\n"
+	"      </animated>\n"
+	"    </param>\n"
+	"    <param name=\"color\">\n"
+	"      <color guid=\"0F1E2D3C4B5A69788796A5B4C3D2E1F0\"><r>0.0</r><g>1.0</g><b>0.0</b><a>1.0</a></color>\n"
+	"    </param>\n"
+	"    <param name=\"origin\">\n"
+	"      <vector guid=\"6A3F3E4C2D1B0A998877665544332211\"><x>0.1</x><y>-0.2</y></vector>\n"
+	"    </param>\n"
+	"    <param name=\"vector_list\">\n"
+	"      <dynamic_list type=\"vector\">\n"
+	"        <entry><vector><x>-0.5</x><y>0.5</y></vector></entry>\n"
+	"        <entry><vector><x>0.5</x><y>0.25</y></vector></entry>\n"
+	"        <entry>\n"
+	"          <composite type=\"vector\"><x><real value=\"0.0\"/></x><y><real value=\"-0.5\"/></y></composite>\n"
+	"        </entry>\n"
+	"      </dynamic_list>\n"
+	"    </param>\n"
+	"  </layer>\n"
+	"  <layer type=\"group\" active=\"true\" exclude_from_rendering=\"false\" version=\"0.3\" desc=\"inline group\">\n"
+	"    <param name=\"amount\" use=\":scaled\"/>\n"
+	"    <param name=\"origin\">\n"
+	"      <vector guid=\"6A3F3E4C2D1B0A998877665544332211\"><x>0.1</x><y>-0.2</y></vector>\n"
+	"    </param>\n"
+	"    <param name=\"canvas\">\n"
+	"      <canvas>\n"
+	"        <layer type=\"polygon\" active=\"true\" version=\"0.1\" desc=\"inner polygon\">\n"
+	"          <param name=\"color\">\n"
+	"            <color guid=\"0F1E2D3C4B5A69788796A5B4C3D2E1F0\"><r>0.0</r><g>1.0</g><b>0.0</b><a>1.0</a></color>\n"
+	"          </param>\n"
+	"          <param name=\"vector_list\">\n"
+	"            <list type=\"vector\">\n"
+	"              <vector><x>0.0</x><y>0.0</y></vector>\n"
+	"              <vector><x>0.25</x><y>0.0</y></vector>\n"
+	"              <vector><x>0.0</x><y>0.25</y></vector>\n"
+	"            </list>\n"
+	"          </param>\n"
+	"        </layer>\n"
+	"        <layer type=\"SolidColor\" active=\"false\" version=\"0.1\" desc=\"disabled\">\n"
+	"          <param name=\"amount\" use=\":scaled\"/>\n"
+	"        </layer>\n"
+	"      </canvas>\n"
+	"    </param>\n"
+	"  </layer>\n"
+	"  <layer type=\"group\" active=\"true\" version=\"0.3\" desc=\"exported group\">\n"
+	"    <param name=\"canvas\" use=\"item\"/>\n"
+	"  </layer>\n"
+	"</canvas>\n";
+
+/* === P R O C E D U R E S ================================================= */
+
+//! Walks two canvases in parallel, pairs their nodes and canvases,
+//! so shared nodes should be shared in the same way in both canvases
+class CanvasComparer
+{
+private:
+	String name;
+	Canvas::ConstHandle root_a, root_b;
+	map<const ValueNode*, const ValueNode*> nodes;
+	map<const Canvas*, const Canvas*> canvases;
+	int failures;
+
+	void fail(const String &path, const String &message)
+		{ cerr << name << ": " << path << ": " << message << endl; ++failures; }
+
+public:
+	CanvasComparer(const String &name, const Canvas::ConstHandle &a, const Canvas::ConstHandle &b):
+		name(name), root_a(a), root_b(b), failures(0) { }
+
+	int get_failures() const { return failures; }
+
+	void compare_value(const String &path, const ValueBase &a, const ValueBase &b)
+	{
+		if (a.get_type() != b.get_type())
+			{ fail(path, "types differ"); return; }
+		if (a.get_static() != b.get_static() || a.get_interpolation() != b.get_interpolation())
+			fail(path, "flags differ");
+
+		if (a.get_type() == type_canvas) {
+			compare_canvas(path,
+				Canvas::ConstHandle(a.get(Canvas::LooseHandle()).get()),
+				Canvas::ConstHandle(b.get(Canvas::LooseHandle()).get()) );
+		} else
+		if (a.get_type() == type_list) {
+			const ValueBase::List &la = a.get_list();
+			const ValueBase::List &lb = b.get_list();
+			if (la.size() != lb.size())
+				{ fail(path, "sizes of lists differ"); return; }
+			for(int i = 0; i < (int)la.size(); ++i)
+				compare_value(strprintf("%s[%d]", path.c_str(), i), la[i], lb[i]);
+		} else
+		if (a != b) {
+			fail(path, "values differ");
+		}
+	}
+
+	void compare_node(const String &path, const ValueNode::ConstHandle &a, const ValueNode::ConstHandle &b)
+	{
+		if (!a || !b)
+			{ if (a || b) fail(path, "node is missing"); return; }
+
+		map<const ValueNode*, const ValueNode*>::const_iterator i = nodes.find(a.get());
+		if (i != nodes.end())
+			{ if (i->second != b.get()) fail(path, "nodes are shared differently"); return; }
+		nodes[a.get()] = b.get();
+
+		if (a->get_name() != b->get_name())
+			{ fail(path, "node " + a->get_name() + " loaded as " + b->get_name()); return; }
+		if (a->get_type() != b->get_type())
+			{ fail(path, "types of nodes differ"); return; }
+		if (a->get_id() != b->get_id())
+			fail(path, "ids differ");
+
+		if (ValueNode_Const::ConstHandle ca = ValueNode_Const::ConstHandle::cast_dynamic(a)) {
+			ValueNode_Const::ConstHandle cb = ValueNode_Const::ConstHandle::cast_dynamic(b);
+			compare_value(path, ca->get_value(), cb->get_value());
+		}
+
+		if (LinkableValueNode::ConstHandle la = LinkableValueNode::ConstHandle::cast_dynamic(a)) {
+			LinkableValueNode::ConstHandle lb = LinkableValueNode::ConstHandle::cast_dynamic(b);
+			if (la->link_count() != lb->link_count())
+				{ fail(path, "counts of links differ"); return; }
+			for(int j = 0; j < la->link_count(); ++j)
+				compare_node(path + "." + la->link_name(j),
+					ValueNode::ConstHandle(la->get_link(j).get()),
+					ValueNode::ConstHandle(lb->get_link(j).get()) );
+		}
+
+		if (const ValueNode_AnimatedInterfaceConst *aa = dynamic_cast<const ValueNode_AnimatedInterfaceConst*>(a.get())) {
+			const ValueNode_AnimatedInterfaceConst *ab = dynamic_cast<const ValueNode_AnimatedInterfaceConst*>(b.get());
+			const WaypointList &wa = aa->waypoint_list();
+			const WaypointList &wb = ab->waypoint_list();
+			if (wa.size() != wb.size())
+				{ fail(path, "counts of waypoints differ"); return; }
+			for(WaypointList::const_iterator j = wa.begin(), k = wb.begin(); j != wa.end(); ++j, ++k) {
+				String waypoint_path = path + "@" + j->get_time().get_string();
+				if ( j->get_time() != k->get_time()
+				  || j->get_before() != k->get_before()
+				  || j->get_after() != k->get_after()
+				  || j->get_tension() != k->get_tension()
+				  || j->get_continuity() != k->get_continuity()
+				  || j->get_bias() != k->get_bias()
+				  || j->get_temporal_tension() != k->get_temporal_tension() )
+					fail(waypoint_path, "waypoints differ");
+				compare_node(waypoint_path, j->get_value_node(), k->get_value_node());
+			}
+		}
+	}
+
+	void compare_layer(const String &path, const Layer::ConstHandle &a, const Layer::ConstHandle &b)
+	{
+		if (a->get_name() != b->get_name())
+			{ fail(path, "layer " + a->get_name() + " loaded as " + b->get_name()); return; }
+		if ( a->get_description() != b->get_description()
+		  || a->active() != b->active()
+		  || a->get_exclude_from_rendering() != b->get_exclude_from_rendering() )
+			fail(path, "properties of layer differ");
+
+		Layer::ParamList pa = a->get_param_list();
+		Layer::ParamList pb = b->get_param_list();
+		if (pa.size() != pb.size())
+			fail(path, "counts of params differ");
+		for(Layer::ParamList::const_iterator i = pa.begin(); i != pa.end(); ++i) {
+			Layer::ParamList::const_iterator j = pb.find(i->first);
+			if (j == pb.end())
+				fail(path + "." + i->first, "param is missing");
+			else
+				compare_value(path + "." + i->first, i->second, j->second);
+		}
+
+		const Layer::DynamicParamList &da = a->dynamic_param_list();
+		const Layer::DynamicParamList &db = b->dynamic_param_list();
+		if (da.size() != db.size())
+			fail(path, "counts of linked params differ");
+		for(Layer::DynamicParamList::const_iterator i = da.begin(); i != da.end(); ++i) {
+			Layer::DynamicParamList::const_iterator j = db.find(i->first);
+			if (j == db.end())
+				fail(path + "." + i->first, "param is not linked");
+			else
+				compare_node(path + "." + i->first, i->second, j->second);
+		}
+	}
+
+	void compare_canvas(const String &path, const Canvas::ConstHandle &a, const Canvas::ConstHandle &b)
+	{
+		if (!a || !b)
+			{ if (a || b) fail(path, "canvas is missing"); return; }
+
+		map<const Canvas*, const Canvas*>::const_iterator i = canvases.find(a.get());
+		if (i != canvases.end())
+			{ if (i->second != b.get()) fail(path, "canvases are shared differently"); return; }
+		canvases[a.get()] = b.get();
+
+		if ( a->get_id() != b->get_id()
+		  || a->get_name() != b->get_name()
+		  || a->get_description() != b->get_description()
+		  || a->is_inline() != b->is_inline() )
+			fail(path, "properties of canvas differ");
+
+		const RendDesc &ra = a->rend_desc();
+		const RendDesc &rb = b->rend_desc();
+		if ( ra.get_w() != rb.get_w() || ra.get_h() != rb.get_h()
+		  || ra.get_tl() != rb.get_tl() || ra.get_br() != rb.get_br()
+		  || ra.get_frame_rate() != rb.get_frame_rate()
+		  || ra.get_time_start() != rb.get_time_start() || ra.get_time_end() != rb.get_time_end() )
+			fail(path, "render descriptions differ");
+
+		const ValueNodeList &va = a->value_node_list();
+		const ValueNodeList &vb = b->value_node_list();
+		if (va.size() != vb.size())
+			fail(path, "counts of exported values differ");
+		for(ValueNodeList::const_iterator j = va.begin(); j != va.end(); ++j)
+			compare_node(path + ":" + (*j)->get_id(), *j, b->find_value_node((*j)->get_id(), true));
+
+		const list<Canvas::Handle> &ca = a->children();
+		const list<Canvas::Handle> &cb = b->children();
+		if (ca.size() != cb.size())
+			fail(path, "counts of exported canvases differ");
+		for(list<Canvas::Handle>::const_iterator j = ca.begin(), k = cb.begin(); j != ca.end() && k != cb.end(); ++j, ++k)
+			compare_canvas(path + "#" + (*j)->get_id(), *j, *k);
+
+		if (a->size() != b->size())
+			{ fail(path, "counts of layers differ"); return; }
+		int index = 0;
+		for(Canvas::const_iterator j = a->begin(), k = b->begin(); j != a->end(); ++j, ++k, ++index)
+			compare_layer(strprintf("%s/%d", path.c_str(), index), *j, *k);
+	}
+
+	//! guids are stored in file relative to guid of the root canvas,
+	//! other nodes get random guids, so only the known ones are compared
+	void compare_guids()
+	{
+		for(int i = 0; i < (int)(sizeof(shared_guids)/sizeof(shared_guids[0])); ++i) {
+			GUID guid(shared_guids[i]);
+			ValueNode::LooseHandle a = find_value_node(guid ^ root_a->get_guid());
+			ValueNode::LooseHandle b = find_value_node(guid ^ root_b->get_guid());
+			if (!a || !b)
+				{ fail(shared_guids[i], "node is not found by guid"); continue; }
+			map<const ValueNode*, const ValueNode*>::const_iterator j = nodes.find(a.get());
+			if (j == nodes.end() || j->second != b.get())
+				fail(shared_guids[i], "nodes with the same guid do not match");
+		}
+	}
+};
+
+static bool
+write_document(const String &filename)
+{
+	FileSystem::WriteStream::Handle stream = FileSystemNative::instance()->get_write_stream(filename);
+	if (!stream)
+		return false;
+	if (filename_extension(filename) == ".sifz")
+		stream = FileSystem::WriteStream::Handle(new ZWriteStream(stream));
+	*stream << document;
+	return !stream->fail();
+}
+
+static Canvas::Handle
+load(const String &filename, bool streaming)
+{
+	if (streaming)
+		unsetenv("SYNFIG_DISABLE_CANVAS_STREAMING");
+	else
+		setenv("SYNFIG_DISABLE_CANVAS_STREAMING", "1", 1);
+
+	String errors, warnings;
+	Canvas::Handle canvas = open_canvas_as(
+		FileSystemNative::instance()->get_identifier(filename), filename, errors, warnings );
+	if (!canvas)
+		cerr << "cannot load " << filename << endl << errors;
+	return canvas;
+}
+
+//! file is loaded under two names, because loaded canvases are shared by name
+int loaders_test(const String &dirname, const String &extension)
+{
+	String streaming_filename = dirname + ETL_DIRECTORY_SEPARATOR + "loadcanvas_streaming" + extension;
+	String dom_filename = dirname + ETL_DIRECTORY_SEPARATOR + "loadcanvas_dom" + extension;
+	if (!write_document(streaming_filename) || !write_document(dom_filename))
+		{ cerr << "cannot write " << extension << " files" << endl; return 1; }
+
+	int failures = 0;
+	Canvas::Handle streaming = load(streaming_filename, true);
+	Canvas::Handle dom = load(dom_filename, false);
+	if (!streaming || !dom) {
+		++failures;
+	} else {
+		CanvasComparer comparer(extension, dom, streaming);
+		comparer.compare_canvas("", dom, streaming);
+		comparer.compare_guids();
+		failures += comparer.get_failures();
+	}
+
+	unsetenv("SYNFIG_DISABLE_CANVAS_STREAMING");
+	FileSystemNative::instance()->file_remove(streaming_filename);
+	FileSystemNative::instance()->file_remove(dom_filename);
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	String dirname = etl::dirname(argv[0]);
+	synfig::Main main(dirname);
+
+	int failures = 0;
+
+	failures += loaders_test(dirname, ".sif");
+	failures += loaders_test(dirname, ".sifz");
+
+	return failures;
+}
@@ -0,0 +1,136 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_blend.cpp
+**	\brief Compares vectorized blend kernels with Color::blend()
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <synfig/color.h>
+#include <synfig/rendering/software/function/blend.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int row_size = 4099;
+
+/* === P R O C E D U R E S ================================================= */
+
+static unsigned int random_seed = 1;
+
+static ColorReal
+random_value()
+{
+	random_seed = random_seed*1103515245u + 12345u;
+	ColorReal x = ColorReal((random_seed >> 8) & 0xffff)/ColorReal(0xffff);
+	// special values to check branches of blend functions
+	if (x < 0.04) return 0.0;
+	if (x < 0.08) return 1.0;
+	if (x < 0.10) return 0.5;
+	if (x < 0.11) return 1e-7;
+	return x*1.4 - 0.2;
+}
+
+static Color
+random_color()
+{
+	ColorReal r = random_value();
+	ColorReal g = random_value();
+	ColorReal b = random_value();
+	ColorReal a = random_value();
+	return Color(r, g, b, a);
+}
+
+int blend_test()
+{
+	static const ColorReal amounts[] = { 1.0, 0.75, 0.3, 1e-7, -0.6, 1.5 };
+
+	vector<Color> src(row_size), dest(row_size);
+	for(int i = 0; i < row_size; ++i)
+		{ src[i] = random_color(); dest[i] = random_color(); }
+
+	int failures = 0;
+	for(int m = 0; m < Color::BLEND_END; ++m) {
+		Color::BlendMethod method = (Color::BlendMethod)m;
+		for(int j = 0; j < (int)(sizeof(amounts)/sizeof(*amounts)); ++j) {
+			ColorReal amount = amounts[j];
+
+			vector<Color> expected(row_size);
+			for(int i = 0; i < row_size; ++i)
+				expected[i] = Color::blend(src[i], dest[i], amount, method);
+
+			for(int k = 0; k < software::Blend::INSTRUCTIONS_COUNT; ++k) {
+				software::Blend::Instructions instructions = (software::Blend::Instructions)k;
+				if (!software::Blend::is_supported(instructions))
+					continue;
+
+				// odd offsets and counts to check tails of rows
+				vector<Color> actual(dest);
+				software::Blend::blend_row(&actual[0], &src[0], 1, amount, method, instructions);
+				software::Blend::blend_row(&actual[1], &src[1], 6, amount, method, instructions);
+				software::Blend::blend_row(&actual[7], &src[7], row_size - 7, amount, method, instructions);
+
+				for(int i = 0; i < row_size; ++i)
+					if (memcmp(&expected[i], &actual[i], sizeof(Color))) {
+						cerr << "blend method " << m
+						     << " amount " << amount
+						     << " instructions " << software::Blend::get_instructions_name(instructions)
+						     << " differs at " << i << endl;
+						++failures;
+						break;
+					}
+			}
+		}
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	cout << "blend instructions: "
+	     << software::Blend::get_instructions_name(software::Blend::get_instructions())
+	     << endl;
+
+	int failures = 0;
+
+	failures += blend_test();
+
+	return failures;
+}
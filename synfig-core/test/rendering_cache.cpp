@@ -0,0 +1,250 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_cache.cpp
+**	\brief Checks reusing of rendered sub-trees between frames
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/main.h>
+#include <synfig/matrix.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/rendercache.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/taskblur.h>
+#include <synfig/rendering/common/task/taskcontour.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int width = 256;
+static const int height = 256;
+
+/* === P R O C E D U R E S ================================================= */
+
+static Task::Handle
+make_contour(const Color &color, Real offset)
+{
+	Contour::Handle contour(new Contour());
+	contour->color = color;
+	contour->move_to(Vector(-1.5 + offset, -1.0));
+	contour->cubic_to(Vector(1.5, -1.2), Vector(0.0, -2.0), Vector(1.0, 0.5));
+	contour->line_to(Vector(0.5, 1.5 - offset));
+	contour->conic_to(Vector(-1.5 + offset, -1.0), Vector(-1.8, 1.8));
+	contour->close();
+
+	TaskContour::Handle task_contour(new TaskContour());
+	task_contour->contour = contour;
+	return task_contour;
+}
+
+static Task::Handle
+make_background()
+{
+	// static background with blur and transformation
+	TaskBlend::Handle background(new TaskBlend());
+	background->sub_task_a() = make_contour(Color(0.2, 0.4, 0.6, 1.0), 0.0);
+	background->sub_task_b() = make_contour(Color(0.9, 0.1, 0.1, 0.5), 0.7);
+
+	TaskTransformationAffine::Handle transformation(new TaskTransformationAffine());
+	transformation->transformation->matrix = Matrix().set_scale(0.8);
+	transformation->sub_task() = background;
+
+	TaskBlur::Handle blur(new TaskBlur());
+	blur->blur = Blur(Blur::FASTGAUSSIAN, Vector(0.1, 0.1));
+	blur->sub_task() = transformation;
+	return blur;
+}
+
+static Task::Handle
+make_scene(const Color &color, Real offset, ColorReal amount = 0.8)
+{
+	// animated foreground
+	TaskBlend::Handle scene(new TaskBlend());
+	scene->sub_task_a() = make_background();
+	scene->sub_task_b() = make_contour(color, offset);
+	scene->amount = amount;
+	return scene;
+}
+
+static Task::Handle
+make_frame(int frame)
+	{ return make_scene(Color(0.1*frame, 0.5, 0.2, 1.0), 0.1*frame); }
+
+//! invisible animated layer, blend passes to the static background
+static Task::Handle
+make_frame_transparent(int frame)
+	{ return make_scene(Color(0.1*frame, 0.5, 0.2, 1.0), 0.1*frame, 0.0); }
+
+//! identity transformation passes to the static background
+static Task::Handle
+make_frame_identity(int /* frame */)
+{
+	TaskTransformationAffine::Handle transformation(new TaskTransformationAffine());
+	transformation->sub_task() = make_background();
+	return transformation;
+}
+
+static bool
+render(const Task::Handle &task, synfig::Surface &out)
+{
+	Task::Handle t = task->clone_recursive();
+	t->target_surface = new SurfaceResource();
+	t->target_surface->create(width, height);
+	t->target_rect = RectInt(0, 0, width, height);
+	t->source_rect = Rect(-2.0, -2.0, 2.0, 2.0);
+	if (!Renderer::get_renderer("software")->run(t, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(t->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			const Color &a = expected[y][x];
+			const Color &b = actual[y][x];
+			ColorReal diff = std::max(
+				std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+				std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+			if (!(diff <= max_diff)) max_diff = diff;
+		}
+
+	// cached sub-tree is not merged with the parent by optimizers,
+	// so rounding errors may be accumulated in different order
+	if (!(max_diff <= ColorReal(1e-5))) {
+		cerr << name << ": differs by " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int cache_frames_test(const String &name, Task::Handle (*make)(int frame))
+{
+	RenderCache &cache = *Renderer::get_cache();
+
+	static const int frames = 5;
+	synfig::Surface expected[frames];
+	cache.set_memory_limit(0);
+	for(int i = 0; i < frames; ++i)
+		if (!render(make(i), expected[i]))
+			{ cerr << name << ": render without cache failed" << endl; return 1; }
+
+	int failures = 0;
+	cache.set_memory_limit(64*1024*1024);
+	for(int i = 0; i < frames; ++i) {
+		synfig::Surface actual;
+		if (!render(make(i), actual))
+			{ cerr << name << ": render with cache failed" << endl; ++failures; continue; }
+		failures += compare(strprintf("%s, frame %d", name.c_str(), i), expected[i], actual);
+	}
+
+	// background should be stored in the second frame
+	if (!cache.get_memory()) {
+		cerr << name << ": static sub-tree was not cached" << endl;
+		++failures;
+	}
+
+	cache.clear();
+	return failures;
+}
+
+int cache_limit_test()
+{
+	RenderCache cache(3*64*64*sizeof(Color));
+
+	SurfaceResource::Handle surfaces[4];
+	for(int i = 0; i < 4; ++i) {
+		surfaces[i] = new SurfaceResource();
+		surfaces[i]->create(64, 64);
+	}
+
+	int failures = 0;
+
+	// result is stored only when it was requested before
+	if (cache.request(1) || !cache.request(1))
+		{ cerr << "wrong request" << endl; ++failures; }
+
+	cache.put(1, surfaces[0]);
+	cache.put(2, surfaces[1]);
+	cache.put(3, surfaces[2]);
+	cache.get(1);
+	cache.put(4, surfaces[3]);
+
+	// least recently used surface should be removed
+	if ( cache.get(1) != surfaces[0]
+	  || cache.get(2)
+	  || cache.get(3) != surfaces[2]
+	  || cache.get(4) != surfaces[3] )
+		{ cerr << "wrong eviction order" << endl; ++failures; }
+
+	if (cache.get_memory() > cache.get_memory_limit())
+		{ cerr << "memory limit exceeded" << endl; ++failures; }
+
+	cache.set_memory_limit(64*64*sizeof(Color));
+	if (cache.get_memory() > cache.get_memory_limit() || cache.get(1))
+		{ cerr << "memory limit was not applied" << endl; ++failures; }
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += cache_limit_test();
+	failures += cache_frames_test("blend", &make_frame);
+	failures += cache_frames_test("transparent blend", &make_frame_transparent);
+	failures += cache_frames_test("identity transformation", &make_frame_identity);
+
+	return failures;
+}
@@ -0,0 +1,189 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_contour.cpp
+**	\brief Test software rasterization of contours
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include <synfig/main.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/function/contour.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define WIDTH	(160)
+#define HEIGHT	(120)
+
+/* === P R O C E D U R E S ================================================= */
+
+//! self-intersecting star with a curve, so winding styles give different results
+void create_contour(Contour::ChunkList &chunks, const Vector &center, Real radius)
+{
+	chunks.clear();
+	for(int i = 0; i < 7; ++i) {
+		Real a = 2.0*PI*3*i/7;
+		Vector v = center + Vector(cos(a), sin(a))*radius;
+		chunks.push_back(Contour::Chunk(i ? Contour::LINE : Contour::MOVE, v));
+	}
+	chunks.push_back(Contour::Chunk(
+		Contour::CUBIC, center + Vector(radius, 0.0),
+		center + Vector(0.3*radius, 0.9*radius), center + Vector(1.4*radius, -0.5*radius) ));
+	chunks.push_back(Contour::Chunk(Contour::CLOSE, center + Vector(radius, 0.0)));
+}
+
+void render(
+	Surface &surface,
+	const Contour::ChunkList &chunks,
+	const Matrix &matrix,
+	const RectInt &window,
+	bool accumulation,
+	bool invert,
+	Contour::WindingStyle winding_style )
+{
+	Polyspan polyspan;
+	polyspan.init(window, accumulation);
+	software::Contour::build_polyspan(chunks, matrix, polyspan);
+	polyspan.close();
+	polyspan.sort_marks();
+	software::Contour::render_polyspan(
+		surface, polyspan, invert, true, winding_style,
+		Color::white(), 1.0, Color::BLEND_COMPOSITE );
+}
+
+int compare(const String &name, const Surface &expected, const Surface &actual)
+{
+	ColorReal max_diff = 0;
+	for(int y = 0; y < expected.get_h(); ++y)
+		for(int x = 0; x < expected.get_w(); ++x) {
+			ColorReal diff = fabs(expected[y][x].get_a() - actual[y][x].get_a());
+			if (!(diff <= max_diff)) max_diff = diff;
+		}
+	if (!(max_diff <= ColorReal(1e-5))) {
+		cerr << name << ": alpha differs by " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+//! accumulation buffer should give the same antialiasing as sorted marks
+int accumulation_test()
+{
+	static const struct { const char *name; Real radius; RectInt window; } cases[] = {
+		{ "whole",   40.0, RectInt(0, 0, WIDTH, HEIGHT) },
+		{ "clipped", 90.0, RectInt(0, 0, WIDTH, HEIGHT) },
+		{ "window",  50.0, RectInt(35, 20, 120, 95) }
+	};
+
+	int failures = 0;
+	Contour::ChunkList chunks;
+	Surface expected(WIDTH, HEIGHT), actual(WIDTH, HEIGHT);
+	for(int i = 0; i < (int)(sizeof(cases)/sizeof(cases[0])); ++i) {
+		create_contour(chunks, Vector(0.5*WIDTH + 0.3, 0.5*HEIGHT + 0.7), cases[i].radius);
+		for(int invert = 0; invert < 2; ++invert) {
+			for(int winding = 0; winding < 2; ++winding) {
+				Contour::WindingStyle winding_style = winding ? Contour::WINDING_EVEN_ODD : Contour::WINDING_NON_ZERO;
+				expected.fill(Color(0, 0, 0, 0));
+				actual.fill(Color(0, 0, 0, 0));
+				render(expected, chunks, Matrix(), cases[i].window, false, invert, winding_style);
+				render(actual,   chunks, Matrix(), cases[i].window, true,  invert, winding_style);
+				failures += compare(
+					strprintf("%s%s, %s", cases[i].name, invert ? " inverted" : "", winding ? "even-odd" : "non-zero"),
+					expected, actual );
+			}
+		}
+	}
+	return failures;
+}
+
+//! contour split to bands should be rendered the same as the whole contour
+int bands_test()
+{
+	static const int band_rows = 16;
+	static const RectInt window(0, 0, WIDTH, HEIGHT);
+
+	int failures = 0;
+	Contour::ChunkList chunks;
+	create_contour(chunks, Vector(0.0, 0.0), 1.0);
+
+	// transformed and a bit higher than the window, so some chunks are outside
+	Matrix matrix = Matrix().set_translate(0.5*WIDTH + 0.3, 0.5*HEIGHT + 0.7)
+	              * Matrix().set_rotate(Angle::deg(20.0))
+	              * Matrix().set_scale(Vector(0.45*WIDTH, 0.55*HEIGHT));
+
+	vector<Contour::ChunkList> bands;
+	software::Contour::split_bands(chunks, matrix, window, band_rows, bands);
+	if ((int)bands.size() != (HEIGHT + band_rows - 1)/band_rows)
+		{ cerr << "wrong count of bands: " << bands.size() << endl; return 1; }
+
+	Surface expected(WIDTH, HEIGHT), actual(WIDTH, HEIGHT);
+	for(int invert = 0; invert < 2; ++invert) {
+		for(int winding = 0; winding < 2; ++winding) {
+			Contour::WindingStyle winding_style = winding ? Contour::WINDING_EVEN_ODD : Contour::WINDING_NON_ZERO;
+			expected.fill(Color(0, 0, 0, 0));
+			actual.fill(Color(0, 0, 0, 0));
+			render(expected, chunks, matrix, window, false, invert, winding_style);
+			for(int i = 0; i < (int)bands.size(); ++i) {
+				RectInt band(0, i*band_rows, WIDTH, std::min(HEIGHT, (i + 1)*band_rows));
+				render(actual, bands[i], Matrix(), band, false, invert, winding_style);
+			}
+			failures += compare(
+				strprintf("bands%s, %s", invert ? " inverted" : "", winding ? "even-odd" : "non-zero"),
+				expected, actual );
+		}
+	}
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += accumulation_test();
+	failures += bands_test();
+
+	return failures;
+}
@@ -0,0 +1,157 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_contourcache.cpp
+**	\brief Checks cache of contours with flattened curves
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <synfig/main.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/contourcache.h>
+#include <synfig/rendering/software/function/contour.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define WIDTH	(160)
+#define HEIGHT	(120)
+
+/* === P R O C E D U R E S ================================================= */
+
+void create_contour(Contour &contour, Real offset)
+{
+	contour.clear();
+	contour.move_to(Vector(0.0, 0.0));
+	contour.cubic_to(Vector(1.0, 0.0), Vector(0.2 + offset, 0.6), Vector(0.8, -0.6));
+	contour.conic_to(Vector(0.5, 0.9), Vector(1.2, 0.7));
+	contour.line_to(Vector(0.1, 0.4));
+	contour.close();
+}
+
+Matrix create_matrix(Real scale, Real angle, const Vector &offset)
+{
+	Matrix m;
+	m.m00 =  cos(angle)*scale; m.m01 = sin(angle)*scale;
+	m.m10 = -sin(angle)*scale; m.m11 = cos(angle)*scale;
+	m.m20 = offset[0];         m.m21 = offset[1];
+	return m;
+}
+
+void render(Surface &surface, const Contour::ChunkList &chunks, const Matrix &matrix)
+{
+	surface.set_wh(WIDTH, HEIGHT);
+	surface.fill(Color(0, 0, 0, 0));
+	Polyspan polyspan;
+	polyspan.init(0, 0, WIDTH, HEIGHT);
+	software::Contour::build_polyspan(chunks, matrix, polyspan);
+	polyspan.close();
+	polyspan.sort_marks();
+	software::Contour::render_polyspan(
+		surface, polyspan, false, true, Contour::WINDING_NON_ZERO,
+		Color::white(), 1.0, Color::BLEND_COMPOSITE );
+}
+
+int cache_test()
+{
+	int failures = 0;
+	const RectInt window(0, 0, WIDTH, HEIGHT);
+	ContourCache cache(1024*1024);
+
+	Contour contour;
+	create_contour(contour, 0.0);
+	Matrix matrix = create_matrix(100.0, 0.0, Vector(20.0, 40.0));
+
+	ContourCache::Handle flattened = cache.get(contour, matrix, 0.25, window);
+	if (!flattened || cache.get_misses() != 1)
+		{ cerr << "contour was not flattened" << endl; ++failures; return failures; }
+
+	// lines should be the same as curves subdivided by Polyspan
+	Surface a, b;
+	render(a, contour.get_chunks(), matrix);
+	render(b, *flattened, matrix);
+	Real max_diff = 0.0;
+	for(int y = 0; y < HEIGHT; ++y)
+		for(int x = 0; x < WIDTH; ++x)
+			max_diff = std::max(max_diff, (Real)fabs(a[y][x].get_a() - b[y][x].get_a()));
+	if (max_diff > 0.05)
+		{ cerr << "flattened contour differs from original, " << max_diff << endl; ++failures; }
+
+	// rebuilt contour with translation and rotation should take the same lines
+	Contour same;
+	create_contour(same, 0.0);
+	if (cache.get(same, create_matrix(100.0, 0.7, Vector(-3.0, 11.0)), 0.25, window) != flattened || cache.get_hits() != 1)
+		{ cerr << "lines were not reused" << endl; ++failures; }
+
+	// other scale, detail or geometry should be flattened again
+	Contour other;
+	create_contour(other, 0.1);
+	if ( cache.get(contour, create_matrix(200.0, 0.0, Vector()), 0.25, window) == flattened
+	  || cache.get(contour, matrix, 0.5, window) == flattened
+	  || cache.get(other, matrix, 0.25, window) == flattened
+	  || cache.get_misses() != 4 )
+		{ cerr << "wrong lines were taken from cache" << endl; ++failures; }
+
+	// contours without curves and contours much bigger than target are not cached
+	Contour lines;
+	lines.move_to(Vector(0.0, 0.0));
+	lines.line_to(Vector(1.0, 0.0));
+	lines.line_to(Vector(1.0, 1.0));
+	lines.close();
+	if ( cache.get(lines, matrix, 0.25, window)
+	  || cache.get(contour, create_matrix(10000.0, 0.0, Vector()), 0.25, window) )
+		{ cerr << "contour should not be cached" << endl; ++failures; }
+
+	cache.set_memory_limit(0);
+	if (cache.get_memory() || cache.get(contour, matrix, 0.25, window))
+		{ cerr << "memory limit was not applied" << endl; ++failures; }
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += cache_test();
+
+	return failures;
+}
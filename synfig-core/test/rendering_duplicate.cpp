@@ -0,0 +1,221 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_duplicate.cpp
+**	\brief Test that copies of Duplicate layer are blended as the sequence of layers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/main.h>
+#include <synfig/layers/layer_duplicate.h>
+#include <synfig/layers/layer_group.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/valuenodes/valuenode_composite.h>
+#include <synfig/valuenodes/valuenode_const.h>
+#include <synfig/valuenodes/valuenode_duplicate.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int width = 64;
+static const int height = 64;
+
+// index of copies goes from -0.5 to 0.5, steps are exact in binary
+static const int copies = 5;
+static const Real index_from = -0.5;
+static const Real index_step = 0.25;
+
+/* === P R O C E D U R E S ================================================= */
+
+static Canvas::Handle
+create_canvas()
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(width, height);
+	canvas->rend_desc().set_tl(Point(-1.0, 1.0));
+	canvas->rend_desc().set_br(Point(1.0, -1.0));
+	return canvas;
+}
+
+//! semitransparent triangle, so blending of copies is visible
+static Layer::Handle
+create_triangle(const ValueBase &origin)
+{
+	Layer::Handle polygon = Layer::create("polygon");
+	polygon->set_param("color", Color(0.2, 0.6, 1.0, 0.7));
+	polygon->set_param("origin", origin);
+	return polygon;
+}
+
+//! Duplicate layer over triangle, which moves with the index when \a moving
+static Canvas::Handle
+make_duplicate_canvas(ColorReal amount, Color::BlendMethod blend_method, bool moving)
+{
+	Canvas::Handle canvas = create_canvas();
+
+	ValueNode_Duplicate::Handle index = ValueNode_Duplicate::create(Real(index_from + (copies - 1)*index_step));
+	index->set_link("from", ValueNode_Const::create(Real(index_from)));
+	index->set_link("step", ValueNode_Const::create(Real(index_step)));
+
+	etl::handle<Layer_Composite> duplicate = new Layer_Duplicate();
+	duplicate->set_amount(amount);
+	duplicate->set_blend_method(blend_method);
+	duplicate->connect_dynamic_param("index", ValueNode::LooseHandle(index));
+	canvas->push_back(duplicate);
+
+	Layer::Handle triangle = create_triangle(Point(0.0, 0.0));
+	if (moving) {
+		ValueNode_Composite::Handle origin = ValueNode_Composite::create(Point(0.0, 0.0));
+		origin->set_link("x", index);
+		triangle->connect_dynamic_param("origin", ValueNode::LooseHandle(origin));
+	}
+	canvas->push_back(triangle);
+
+	return canvas;
+}
+
+//! the same copies as groups, each of them is blended onto previous ones,
+//! as Layer_Duplicate blended them before the balanced tree
+static Canvas::Handle
+make_sequence_canvas(ColorReal amount, Color::BlendMethod blend_method, bool moving)
+{
+	Canvas::Handle canvas = create_canvas();
+
+	// the first copy is the bottom one
+	for(int i = copies - 1; i >= 0; --i) {
+		Canvas::Handle sub_canvas = Canvas::create_inline(canvas);
+		sub_canvas->push_back(create_triangle(Point(moving ? index_from + i*index_step : 0.0, 0.0)));
+
+		Layer_Group::Handle group = new Layer_Group();
+		group->set_amount(amount);
+		group->set_blend_method(blend_method);
+		group->set_sub_canvas(sub_canvas);
+		canvas->push_back(group);
+	}
+
+	return canvas;
+}
+
+static bool
+render(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	Task::Handle task = canvas->build_rendering_task(ContextParams());
+	if (!task)
+		return false;
+
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(width, height);
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+	if (!Renderer::get_renderer("software")->run(task, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			const Color &a = expected[y][x];
+			const Color &b = actual[y][x];
+			ColorReal diff = std::max(
+				std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+				std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+			if (!(diff <= max_diff)) max_diff = diff;
+		}
+	if (!(max_diff <= ColorReal(1e-5))) {
+		cerr << name << ": differs by " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int duplicate_test()
+{
+	// blend methods and amounts with balanced tree, and one with chain for comparison
+	static const struct { Color::BlendMethod blend_method; ColorReal amount; } cases[] = {
+		{ Color::BLEND_COMPOSITE,     1.0 },
+		{ Color::BLEND_COMPOSITE,     0.6 },
+		{ Color::BLEND_ADD_COMPOSITE, 1.0 },
+		{ Color::BLEND_ADD_COMPOSITE, 0.6 }
+	};
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(cases)/sizeof(cases[0])); ++i) {
+		// equal copies are built once and cloned
+		for(int moving = 0; moving < 2; ++moving) {
+			String name = strprintf( "blend method %d, amount %.1f%s",
+				(int)cases[i].blend_method,
+				(double)cases[i].amount,
+				moving ? "" : ", equal copies" );
+
+			synfig::Surface expected, actual;
+			if (!render(make_sequence_canvas(cases[i].amount, cases[i].blend_method, moving), expected))
+				{ cerr << name << ": render of sequence failed" << endl; ++failures; continue; }
+			if (!render(make_duplicate_canvas(cases[i].amount, cases[i].blend_method, moving), actual))
+				{ cerr << name << ": render of duplicate failed" << endl; ++failures; continue; }
+			failures += compare(name, expected, actual);
+		}
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += duplicate_test();
+
+	return failures;
+}
@@ -0,0 +1,263 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_fractal.cpp
+**	\brief Test rendering tasks of Mandelbrot and Julia layers against get_color()
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/main.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include <modules/lyr_std/julia.h>
+#include <modules/lyr_std/mandelbrot.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace modules;
+using namespace lyr_std;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+// width is not a multiple of the group of pixels of the kernel,
+// pixels have size of 1/16, so coordinates of pixels are exact and
+// some of them escape exactly on the bailout, like c = -2 or c = 2i
+static const int width = 61;
+static const int height = 64;
+static const Real pixel_step = 1.0/16.0;
+static const Point origin(-2.0, -2.0);
+
+static const int iterations[] = { 1, 2, 7, 33, 200 };
+
+/* === P R O C E D U R E S ================================================= */
+
+static Canvas::Handle
+make_canvas(const Layer::Handle &layer)
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(width, height);
+	canvas->push_back(layer);
+	return canvas;
+}
+
+//! get_color() in the corners of pixels, where the tasks calculate them
+static void
+render_get_color(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	Context context = canvas->get_context(ContextParams());
+	out.set_wh(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			out[y][x] = context.get_color(origin + Vector(x*pixel_step, y*pixel_step));
+}
+
+static bool
+render_task(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	Task::Handle task = canvas->build_rendering_task(ContextParams());
+	if (!task)
+		return false;
+
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(width, height);
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(origin, origin + Vector(width*pixel_step, height*pixel_step));
+	if (!Renderer::get_renderer("software")->run(task, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+//! kernel calculates the same values as get_color(), but when compiler fuses
+//! multiply-add in scalar code of get_color(), the last bits differ, and chaotic
+//! orbits of a few pixels diverge after many iterations
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	if (expected.get_w() != width || expected.get_h() != height
+	 || actual.get_w() != width || actual.get_h() != height)
+		{ cerr << name << ": wrong size of surface" << endl; return 1; }
+
+#ifdef __FMA__
+	const int allowed = width*height/100;
+#else
+	const int allowed = 0;
+#endif
+
+	int count = 0;
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			const Color &a = expected[y][x];
+			const Color &b = actual[y][x];
+			ColorReal diff = std::max(
+				std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+				std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+			if (!(diff <= ColorReal(1e-5))) {
+				++count;
+				if (!(diff <= max_diff)) max_diff = diff;
+			}
+		}
+	if (count > allowed) {
+		cerr << name << ": " << count << " pixels differ, up to " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static int
+compare_layer(const String &name, const Layer::Handle &layer)
+{
+	Canvas::Handle canvas = make_canvas(layer);
+	synfig::Surface expected, actual;
+	render_get_color(canvas, expected);
+	if (!render_task(canvas, actual))
+		{ cerr << name << ": task render failed" << endl; return 1; }
+	return compare(name, expected, actual);
+}
+
+int mandelbrot_test()
+{
+	// bailout is given as radius, layer squares it
+	static const struct { Real bailout; bool broken; bool smooth; Real offset_inside; bool loop_inside; Real offset_outside; Real scale_outside; } cases[] = {
+		{ 2.0, false, false, 0.0, true,  0.0, 1.0 },
+		{ 2.0, false, true,  0.0, true,  0.0, 1.0 },
+		{ 3.0, false, true,  0.3, false, 0.2, 3.0 },
+		{ 2.0, true,  false, 0.1, true,  0.0, 1.0 },
+		{ 3.0, true,  true,  0.0, false, 0.5, 0.7 }
+	};
+
+	Gradient gradient_inside(Color(0.0, 0.0, 0.5, 1.0), Color(1.0, 1.0, 0.0, 1.0));
+	Gradient gradient_outside(Color(1.0, 0.0, 0.0, 1.0), Color(0.0, 1.0, 0.5, 0.5));
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(cases)/sizeof(cases[0])); ++i) {
+		for(int j = 0; j < (int)(sizeof(iterations)/sizeof(iterations[0])); ++j) {
+			String name = strprintf( "mandelbrot, bailout %.1f%s%s, %d iterations",
+				(double)cases[i].bailout,
+				cases[i].broken ? ", broken" : "",
+				cases[i].smooth ? ", smooth" : "",
+				iterations[j] );
+
+			Layer::Handle layer = new Mandelbrot();
+			layer->set_param("solid_inside", true);
+			layer->set_param("solid_outside", true);
+			layer->set_param("iterations", iterations[j]);
+			layer->set_param("bailout", cases[i].bailout);
+			layer->set_param("broken", cases[i].broken);
+			layer->set_param("smooth_outside", cases[i].smooth);
+			layer->set_param("gradient_inside", gradient_inside);
+			layer->set_param("gradient_offset_inside", cases[i].offset_inside);
+			layer->set_param("gradient_loop_inside", cases[i].loop_inside);
+			layer->set_param("gradient_outside", gradient_outside);
+			layer->set_param("gradient_offset_outside", cases[i].offset_outside);
+			layer->set_param("gradient_scale_outside", cases[i].scale_outside);
+			failures += compare_layer(name, layer);
+		}
+	}
+
+	return failures;
+}
+
+int julia_test()
+{
+	// seed -2 keeps z = 0 and z = 2 exactly on the bailout
+	static const struct { Point seed; bool broken; bool smooth; bool shade; bool invert; bool color; bool cycle; } cases[] = {
+		{ Point(-2.0,   0.0  ), false, false, false, false, false, false },
+		{ Point(-2.0,   0.0  ), false, true,  true,  false, true,  false },
+		{ Point(-0.8,   0.156), false, true,  true,  false, true,  true  },
+		{ Point(-0.8,   0.156), true,  false, false, true,  false, true  },
+		{ Point( 0.285, 0.01 ), true,  true,  true,  true,  true,  false }
+	};
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(cases)/sizeof(cases[0])); ++i) {
+		for(int j = 0; j < (int)(sizeof(iterations)/sizeof(iterations[0])); ++j) {
+			String name = strprintf( "julia, seed (%.3f, %.3f)%s%s%s%s%s%s, %d iterations",
+				(double)cases[i].seed[0], (double)cases[i].seed[1],
+				cases[i].broken ? ", broken" : "",
+				cases[i].smooth ? ", smooth" : "",
+				cases[i].shade ? ", shade" : "",
+				cases[i].invert ? ", invert" : "",
+				cases[i].color ? ", color" : "",
+				cases[i].cycle ? ", cycle" : "",
+				iterations[j] );
+
+			Layer::Handle layer = new Julia();
+			layer->set_param("solid_inside", true);
+			layer->set_param("solid_outside", true);
+			layer->set_param("icolor", Color(0.1, 0.2, 0.7, 1.0));
+			layer->set_param("ocolor", Color(0.9, 0.5, 0.1, 0.8));
+			layer->set_param("color_shift", Angle::deg(25.0));
+			layer->set_param("iterations", iterations[j]);
+			layer->set_param("seed", cases[i].seed);
+			layer->set_param("broken", cases[i].broken);
+			layer->set_param("smooth_outside", cases[i].smooth);
+			layer->set_param("shade_inside", cases[i].shade);
+			layer->set_param("shade_outside", cases[i].shade);
+			layer->set_param("invert_inside", cases[i].invert);
+			layer->set_param("invert_outside", cases[i].invert);
+			layer->set_param("color_inside", cases[i].color);
+			layer->set_param("color_outside", cases[i].color);
+			layer->set_param("color_cycle", cases[i].cycle);
+			failures += compare_layer(name, layer);
+		}
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += mandelbrot_test();
+	failures += julia_test();
+
+	return failures;
+}
@@ -0,0 +1,213 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_gradient.cpp
+**	\brief Test rendering tasks of gradient layers against their color functions
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/main.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include <modules/mod_gradient/conicalgradient.h>
+#include <modules/mod_gradient/lineargradient.h>
+#include <modules/mod_gradient/radialgradient.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int width = 64;
+static const int height = 64;
+
+/* === P R O C E D U R E S ================================================= */
+
+//! gradient with transparent end and almost sharp step,
+//! the hardest case for the lookup table of the tasks
+static Gradient
+make_gradient()
+{
+	Gradient gradient;
+	gradient.push_back(Gradient::CPoint(0.0, Color(1.0, 0.0, 0.0, 1.0)));
+	gradient.push_back(Gradient::CPoint(0.3, Color(0.0, 1.0, 0.0, 0.5)));
+	gradient.push_back(Gradient::CPoint(0.3001, Color(0.0, 0.0, 1.0, 1.0)));
+	gradient.push_back(Gradient::CPoint(1.0, Color(1.0, 1.0, 1.0, 0.0)));
+	gradient.sort();
+	return gradient;
+}
+
+static Canvas::Handle
+make_canvas(const Layer::Handle &layer)
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(width, height);
+	canvas->rend_desc().set_tl(Point(-1.0, 1.0));
+	canvas->rend_desc().set_br(Point(1.0, -1.0));
+	canvas->push_back(layer);
+	return canvas;
+}
+
+//! old way, layer fills the surface by its color function
+static bool
+render_legacy(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	return canvas->get_context(ContextParams())
+	     .accelerated_render(&out, 3, canvas->rend_desc(), NULL);
+}
+
+//! the same way as Target_Scanline renders frames
+static bool
+render_task(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	Task::Handle task = canvas->build_rendering_task(ContextParams());
+	if (!task)
+		return false;
+
+	// canvas has y axis directed upwards
+	TaskTransformationAffine::Handle flip = new TaskTransformationAffine();
+	flip->transformation->matrix.m11 = -1.0;
+	flip->sub_task() = task;
+	task = flip;
+
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(width, height);
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+	if (!Renderer::get_renderer("software")->run(task, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+//! compares premultiplied colors, hue of almost transparent pixels is meaningless,
+//! lookup table of the tasks is discrete, so a few 8-bit levels of difference are allowed
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	if (expected.get_w() != width || expected.get_h() != height
+	 || actual.get_w() != width || actual.get_h() != height)
+		{ cerr << name << ": wrong size of surface" << endl; return 1; }
+
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			Color a = expected[y][x].premult_alpha();
+			Color b = actual[y][x].premult_alpha();
+			ColorReal diff = std::max(
+				std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+				std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+			if (!(diff <= max_diff)) max_diff = diff;
+		}
+	if (!(max_diff <= ColorReal(0.02))) {
+		cerr << name << ": differs by " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static int
+compare_layer(const String &name, const Layer::Handle &layer)
+{
+	Canvas::Handle canvas = make_canvas(layer);
+	synfig::Surface expected, actual;
+	if (!render_legacy(canvas, expected))
+		{ cerr << name << ": legacy render failed" << endl; return 1; }
+	if (!render_task(canvas, actual))
+		{ cerr << name << ": task render failed" << endl; return 1; }
+	return compare(name, expected, actual);
+}
+
+int gradient_test()
+{
+	int failures = 0;
+
+	for(int loop = 0; loop < 2; ++loop) {
+		for(int zigzag = 0; zigzag < 2; ++zigzag) {
+			String flags = strprintf("%s%s", loop ? " loop" : "", zigzag ? " zigzag" : "");
+
+			Layer::Handle linear = new LinearGradient();
+			linear->set_param("gradient", make_gradient());
+			linear->set_param("p1", Point(-0.7, 0.3));
+			linear->set_param("p2", Point(0.6, -0.4));
+			linear->set_param("loop", bool(loop));
+			linear->set_param("zigzag", bool(zigzag));
+			failures += compare_layer("linear" + flags, linear);
+
+			Layer::Handle radial = new RadialGradient();
+			radial->set_param("gradient", make_gradient());
+			radial->set_param("center", Point(0.1, -0.2));
+			radial->set_param("radius", Real(0.45));
+			radial->set_param("loop", bool(loop));
+			radial->set_param("zigzag", bool(zigzag));
+			failures += compare_layer("radial" + flags, radial);
+		}
+	}
+
+	// conical gradient is always looped
+	for(int symmetric = 0; symmetric < 2; ++symmetric) {
+		Layer::Handle conical = new ConicalGradient();
+		conical->set_param("gradient", make_gradient());
+		conical->set_param("center", Point(0.1, -0.2));
+		conical->set_param("angle", Angle::deg(30.0));
+		conical->set_param("symmetric", bool(symmetric));
+		failures += compare_layer(symmetric ? "conical symmetric" : "conical", conical);
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += gradient_test();
+
+	return failures;
+}
@@ -0,0 +1,157 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_mesh.cpp
+**	\brief Test software rasterization of meshes
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <synfig/main.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/primitive/mesh.h>
+#include <synfig/rendering/software/function/mesh.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define SIZE		(160)
+#define CELLS		(23)
+#define TEXTURE		(64)
+
+/* === P R O C E D U R E S ================================================= */
+
+void create_mesh(rendering::Mesh &mesh)
+{
+	Real step = (SIZE - 20.0)/CELLS;
+	for(int j = 0; j <= CELLS; ++j) {
+		for(int i = 0; i <= CELLS; ++i) {
+			rendering::Mesh::Vertex vertex;
+			vertex.position = Vector(
+				10.3 + i*step + 0.3*step*sin(0.7*j + i),
+				10.1 + j*step + 0.3*step*cos(1.3*i + j) );
+			vertex.tex_coords = Vector(i, j)*((Real)TEXTURE/CELLS);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+	for(int j = 0; j < CELLS; ++j) {
+		for(int i = 0; i < CELLS; ++i) {
+			int v = j*(CELLS + 1) + i;
+			rendering::Mesh::Triangle triangle;
+			triangle.vertices[0] = v;
+			triangle.vertices[1] = v + 1;
+			triangle.vertices[2] = v + CELLS + 2;
+			mesh.triangles.push_back(triangle);
+			triangle.vertices[1] = v + CELLS + 2;
+			triangle.vertices[2] = v + CELLS + 1;
+			mesh.triangles.push_back(triangle);
+		}
+	}
+}
+
+int mesh_test()
+{
+	int failures = 0;
+
+	rendering::Mesh mesh;
+	create_mesh(mesh);
+	RectInt window(0, 0, SIZE, SIZE);
+	Rect texture_rect(0.0, 0.0, TEXTURE, TEXTURE);
+
+	Surface texture(TEXTURE, TEXTURE);
+	for(int y = 0; y < TEXTURE; ++y)
+		for(int x = 0; x < TEXTURE; ++x)
+			texture[y][x] = Color((x ^ y) & 1, x/(Real)TEXTURE, y/(Real)TEXTURE, (x + y) % 3 ? 1.0 : 0.5);
+
+	// each pixel is covered by one triangle only, even at shared edges
+	Surface white(TEXTURE, TEXTURE);
+	white.fill(Color::white());
+	Surface surface(SIZE, SIZE);
+	surface.fill(Color(0, 0, 0, 0));
+	software::Mesh::render_mesh(
+		surface, window, mesh, white, texture_rect,
+		Matrix(), Matrix(), 0.5, Color::BLEND_COMPOSITE );
+	int overlaps = 0, covered = 0;
+	for(int y = 0; y < SIZE; ++y)
+		for(int x = 0; x < SIZE; ++x) {
+			if (surface[y][x].get_a() > 0.6) ++overlaps;
+			if (surface[y][x].get_a() > 0.4) ++covered;
+		}
+	if (overlaps)
+		{ cerr << overlaps << " pixels blended twice at shared edges" << endl; ++failures; }
+	if (fabs(covered - (SIZE - 20.0)*(SIZE - 20.0)) > 2.0*SIZE)
+		{ cerr << "wrong count of covered pixels: " << covered << endl; ++failures; }
+
+	// rendering by tiles gives exactly the same result
+	Surface whole(SIZE, SIZE), tiled(SIZE, SIZE);
+	whole.fill(Color(0, 0, 0, 0));
+	tiled.fill(Color(0, 0, 0, 0));
+	software::Mesh::render_mesh(
+		whole, window, mesh, texture, texture_rect,
+		Matrix(), Matrix(), 1.0, Color::BLEND_COMPOSITE );
+
+	const int tile_size = 50;
+	const int tiles_x = (SIZE + tile_size - 1)/tile_size;
+	software::Mesh::TriangleList triangles;
+	software::Mesh::transform_triangles(mesh, Matrix(), Matrix(), window, triangles);
+	vector<software::Mesh::TriangleList> tiles;
+	software::Mesh::split_tiles(triangles, window, tile_size, tiles);
+	for(int i = 0; i < (int)tiles.size(); ++i) {
+		int x = (i % tiles_x)*tile_size;
+		int y = (i / tiles_x)*tile_size;
+		software::Mesh::render_triangles(
+			tiled, RectInt(x, y, x + tile_size, y + tile_size) & window, tiles[i],
+			texture, texture_rect, 1.0, Color::BLEND_COMPOSITE );
+	}
+	for(int y = 0; y < SIZE; ++y)
+		if (memcmp(whole[y], tiled[y], SIZE*sizeof(Color)))
+			{ cerr << "tiled mesh differs at row " << y << endl; ++failures; break; }
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += mesh_test();
+
+	return failures;
+}
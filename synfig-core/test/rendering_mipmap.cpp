@@ -0,0 +1,244 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_mipmap.cpp
+**	\brief Test that resampling through mipmap levels is close to direct resampling
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/matrix.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/software/function/mipmap.h>
+#include <synfig/rendering/software/function/packedsurface.h>
+#include <synfig/rendering/software/function/resample.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+// odd size, so levels are rounded up
+static const int width = 301;
+static const int height = 203;
+
+/* === P R O C E D U R E S ================================================= */
+
+//! smooth waves, resampled results should be close everywhere
+static void
+make_smooth_texture(software::PackedSurface &texture)
+{
+	synfig::Surface surface(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			surface[y][x] = Color(
+				0.5 + 0.5*sin(x*0.05),
+				0.5 + 0.5*cos(y*0.07),
+				(ColorReal)(x + y)/(width + height),
+				0.75 + 0.25*sin((x - y)*0.03) );
+	texture.set_pixels(surface[0], width, height, surface.get_pitch());
+}
+
+//! semitransparent checker with sharp edges
+static void
+make_checker_texture(software::PackedSurface &texture)
+{
+	synfig::Surface surface(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			bool cell = ((x/12) + (y/12)) % 2;
+			surface[y][x] = Color(
+				(ColorReal)x/width,
+				(ColorReal)y/height,
+				cell ? 1.0 : 0.2,
+				cell ? 1.0 : 0.5 );
+		}
+	texture.set_pixels(surface[0], width, height, surface.get_pitch());
+}
+
+static void
+resample(
+	synfig::Surface &dest,
+	const software::PackedSurface &texture,
+	const Matrix &transformation,
+	Color::Interpolation interpolation,
+	const software::Mipmap *mipmap )
+{
+	dest.clear();
+	software::Resample::resample(
+		dest,
+		RectInt(0, 0, dest.get_w(), dest.get_h()),
+		texture,
+		RectInt(0, 0, width, height),
+		transformation,
+		interpolation,
+		false,
+		1.0,
+		Color::BLEND_COMPOSITE,
+		mipmap );
+}
+
+static ColorReal
+color_diff(const Color &a, const Color &b)
+{
+	return std::max(
+		std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+		std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+}
+
+//! compares premultiplied colors, mipmap level adds its own box filter,
+//! so sharp edges are blurred a bit more, and only the average error
+//! and the average color are checked for them
+static int
+compare(
+	const String &name,
+	const synfig::Surface &expected,
+	const synfig::Surface &actual,
+	ColorReal max_tolerance,
+	ColorReal mean_tolerance )
+{
+	ColorReal max_diff = 0;
+	ColorReal sum_diff = 0;
+	Color sum_expected, sum_actual;
+	for(int y = 0; y < expected.get_h(); ++y)
+		for(int x = 0; x < expected.get_w(); ++x) {
+			Color a = expected[y][x].premult_alpha();
+			Color b = actual[y][x].premult_alpha();
+			ColorReal diff = color_diff(a, b);
+			if (!(diff <= max_diff)) max_diff = diff;
+			sum_diff += diff;
+			sum_expected += a;
+			sum_actual += b;
+		}
+
+	ColorReal count = expected.get_w()*expected.get_h();
+	ColorReal mean_diff = sum_diff/count;
+	ColorReal average_diff = color_diff(sum_expected/count, sum_actual/count);
+
+	if (!(max_diff <= max_tolerance)) {
+		cerr << name << ": differs by " << max_diff << endl;
+		return 1;
+	}
+	if (!(mean_diff <= mean_tolerance)) {
+		cerr << name << ": differs by " << mean_diff << " in average" << endl;
+		return 1;
+	}
+	if (!(average_diff <= ColorReal(0.002))) {
+		cerr << name << ": average color differs by " << average_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+//! levels should have sizes told by get_level_size()
+int levels_test()
+{
+	software::PackedSurface texture;
+	make_checker_texture(texture);
+	software::Mipmap mipmap;
+
+	int failures = 0;
+	for(int level = 0; level < 10; ++level) {
+		int w, h;
+		software::Mipmap::get_level_size(width, height, level, w, h);
+		const software::PackedSurface *surface = mipmap.get_level(texture, level);
+		if (!surface || surface->get_width() != w || surface->get_height() != h) {
+			cerr << "level " << level << ": wrong size" << endl;
+			++failures;
+		}
+	}
+	return failures;
+}
+
+int resample_test()
+{
+	// scales of 1/2 and bigger are resampled from the source itself
+	static const struct { Real sx; Real sy; } scales[] = {
+		{ 1.0/3.0,  1.0/3.0  },
+		{ 0.25,     0.25     },
+		{ 0.2,      0.3      },
+		{ 0.125,    0.125    },
+		{ 1.0/16.0, 1.0/11.0 }
+	};
+	static const Color::Interpolation interpolations[] = {
+		Color::INTERPOLATION_LINEAR,
+		Color::INTERPOLATION_COSINE,
+		Color::INTERPOLATION_CUBIC
+	};
+
+	static const struct { const char *name; void (*make)(software::PackedSurface&); ColorReal max_tolerance; ColorReal mean_tolerance; } textures[] = {
+		{ "smooth",  make_smooth_texture,  0.03, 0.01 },
+		{ "checker", make_checker_texture, 0.35, 0.04 }
+	};
+
+	int failures = 0;
+	for(int t = 0; t < (int)(sizeof(textures)/sizeof(textures[0])); ++t) {
+		software::PackedSurface texture;
+		textures[t].make(texture);
+
+		for(int i = 0; i < (int)(sizeof(scales)/sizeof(scales[0])); ++i) {
+			int w = (int)ceil(width*scales[i].sx);
+			int h = (int)ceil(height*scales[i].sy);
+			Matrix transformation = Matrix().set_translate(0.3, 0.6)
+			                      * Matrix().set_scale(scales[i].sx, scales[i].sy);
+
+			for(int j = 0; j < (int)(sizeof(interpolations)/sizeof(interpolations[0])); ++j) {
+				String name = strprintf( "%s, scale %.3f x %.3f, interpolation %d",
+					textures[t].name, (double)scales[i].sx, (double)scales[i].sy, (int)interpolations[j] );
+
+				// new mipmap for each case, so levels are built by the resampling itself
+				software::Mipmap mipmap;
+				synfig::Surface expected(w, h), actual(w, h);
+				resample(expected, texture, transformation, interpolations[j], NULL);
+				resample(actual, texture, transformation, interpolations[j], &mipmap);
+				failures += compare(name, expected, actual, textures[t].max_tolerance, textures[t].mean_tolerance);
+			}
+		}
+	}
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+
+	failures += levels_test();
+	failures += resample_test();
+
+	return failures;
+}
@@ -0,0 +1,234 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_noise.cpp
+**	\brief Test rendering task of Noise Gradient layer against its color function
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/main.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include <modules/mod_noise/noise.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int width = 64;
+static const int height = 64;
+
+/* === P R O C E D U R E S ================================================= */
+
+//! size of the noise is not a divisor of the pixel size,
+//! so lattice points do not fall onto the pixels
+static Layer::Handle
+make_noise(RandomNoise::SmoothType smooth, bool turbulent, bool do_alpha, bool super_sample, Real speed)
+{
+	Gradient gradient;
+	gradient.push_back(Gradient::CPoint(0.0, Color(1.0, 0.0, 0.0, 1.0)));
+	gradient.push_back(Gradient::CPoint(0.5, Color(0.0, 1.0, 0.0, 0.5)));
+	gradient.push_back(Gradient::CPoint(1.0, Color(0.0, 0.0, 1.0, 1.0)));
+	gradient.sort();
+
+	Layer::Handle noise = new Noise();
+	noise->set_param("amount", Real(1.0));
+	noise->set_param("blend_method", int(Color::BLEND_STRAIGHT));
+	noise->set_param("gradient", gradient);
+	noise->set_param("seed", int(12345));
+	noise->set_param("size", Vector(0.37, 0.29));
+	noise->set_param("smooth", int(smooth));
+	noise->set_param("detail", int(4));
+	noise->set_param("speed", speed);
+	noise->set_param("turbulent", turbulent);
+	noise->set_param("do_alpha", do_alpha);
+	noise->set_param("super_sample", super_sample);
+	return noise;
+}
+
+static Canvas::Handle
+make_canvas(const Layer::Handle &layer)
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(width, height);
+	canvas->rend_desc().set_tl(Point(-1.0, 1.0));
+	canvas->rend_desc().set_br(Point(1.0, -1.0));
+	canvas->push_back(layer);
+	// time is not an integer, so animated noise is interpolated between frames of lattice
+	canvas->set_time(Time(1.3));
+	return canvas;
+}
+
+//! get_color() in the corner of each pixel, where accelerated_render() takes colors
+static void
+render_get_color(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	const RendDesc &desc = canvas->rend_desc();
+	Context context = canvas->get_context(ContextParams());
+	out.set_wh(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			out[y][x] = context.get_color(Point(
+				desc.get_tl()[0] + x*desc.get_pw(),
+				desc.get_tl()[1] + y*desc.get_ph() ));
+}
+
+//! supersampling is done by accelerated_render() only
+static bool
+render_legacy(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	return canvas->get_context(ContextParams())
+	     .accelerated_render(&out, 3, canvas->rend_desc(), NULL);
+}
+
+//! the same way as Target_Scanline renders frames
+static bool
+render_task(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	Task::Handle task = canvas->build_rendering_task(ContextParams());
+	if (!task)
+		return false;
+
+	// canvas has y axis directed upwards
+	TaskTransformationAffine::Handle flip = new TaskTransformationAffine();
+	flip->transformation->matrix.m11 = -1.0;
+	flip->sub_task() = task;
+	task = flip;
+
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(width, height);
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+	if (!Renderer::get_renderer("software")->run(task, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+//! noise itself is the same up to float rounding,
+//! colors differ by the step of the lookup table of the gradient
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	if (expected.get_w() != width || expected.get_h() != height
+	 || actual.get_w() != width || actual.get_h() != height)
+		{ cerr << name << ": wrong size of surface" << endl; return 1; }
+
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			Color a = expected[y][x].premult_alpha();
+			Color b = actual[y][x].premult_alpha();
+			ColorReal diff = std::max(
+				std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+				std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+			if (!(diff <= max_diff)) max_diff = diff;
+		}
+	if (!(max_diff <= ColorReal(1e-3))) {
+		cerr << name << ": differs by " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int noise_test()
+{
+	static const struct { RandomNoise::SmoothType smooth; const char *name; } smooths[] = {
+		{ RandomNoise::SMOOTH_DEFAULT, "nearest" },
+		{ RandomNoise::SMOOTH_LINEAR,  "linear"  },
+		{ RandomNoise::SMOOTH_COSINE,  "cosine"  },
+		{ RandomNoise::SMOOTH_SPLINE,  "spline"  },
+		{ RandomNoise::SMOOTH_CUBIC,   "cubic"   }
+	};
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(smooths)/sizeof(smooths[0])); ++i) {
+		for(int turbulent = 0; turbulent < 2; ++turbulent) {
+			for(int do_alpha = 0; do_alpha < 2; ++do_alpha) {
+				// not animated spline is calculated as fast spline
+				for(int animated = 0; animated < 2; ++animated) {
+					for(int super_sample = 0; super_sample < 2; ++super_sample) {
+						String name = strprintf( "%s%s%s%s%s",
+							smooths[i].name,
+							turbulent ? ", turbulent" : "",
+							do_alpha ? ", alpha" : "",
+							animated ? ", animated" : "",
+							super_sample ? ", super sample" : "" );
+
+						Canvas::Handle canvas = make_canvas(make_noise(
+							smooths[i].smooth, turbulent, do_alpha, super_sample, animated ? 0.7 : 0.0 ));
+
+						synfig::Surface expected, actual;
+						if (super_sample) {
+							if (!render_legacy(canvas, expected))
+								{ cerr << name << ": legacy render failed" << endl; ++failures; continue; }
+						} else {
+							render_get_color(canvas, expected);
+						}
+						if (!render_task(canvas, actual))
+							{ cerr << name << ": task render failed" << endl; ++failures; continue; }
+						failures += compare(name, expected, actual);
+					}
+				}
+			}
+		}
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += noise_test();
+
+	return failures;
+}
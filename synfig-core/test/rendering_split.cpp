@@ -0,0 +1,325 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_split.cpp
+**	\brief Compares output of split and unsplit rendering tasks
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/main.h>
+#include <synfig/angle.h>
+#include <synfig/matrix.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/rendercache.h>
+#include <synfig/rendering/software/renderersw.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/common/optimizer/optimizersplit.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/taskblur.h>
+#include <synfig/rendering/common/task/taskcontour.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int width = 512;
+static const int height = 512;
+
+/* === P R O C E D U R E S ================================================= */
+
+class RendererNoSplit: public RendererSW
+{
+public:
+	RendererNoSplit()
+	{
+		Optimizer::List list = get_optimizers(Optimizer::CATEGORY_ID_LIST);
+		for(Optimizer::List::const_iterator i = list.begin(); i != list.end(); ++i)
+			if (etl::handle<OptimizerSplit>::cast_dynamic(*i))
+				unregister_optimizer(*i);
+	}
+};
+
+class RendererSplit: public RendererNoSplit
+{
+public:
+	explicit RendererSplit(int threads)
+		{ register_optimizer(new OptimizerSplit(threads)); }
+};
+
+static unsigned int random_seed = 1;
+
+static ColorReal
+random_value()
+{
+	random_seed = random_seed*1103515245u + 12345u;
+	return ColorReal((random_seed >> 16) & 0x7fff)/ColorReal(0x7fff);
+}
+
+static Task::Handle
+make_image(int size, Real angle)
+{
+	SurfaceResource::Handle surface = new SurfaceResource();
+	surface->create(size, size);
+	{
+		SurfaceResource::LockWrite<SurfaceSW> lock(surface);
+		synfig::Surface &s = lock->get_surface();
+		for(int y = 0; y < size; ++y)
+			for(int x = 0; x < size; ++x) {
+				ColorReal a = random_value();
+				s[y][x] = Color(random_value()*a, random_value()*a, random_value()*a, a);
+			}
+	}
+
+	TaskSurface::Handle task_surface(new TaskSurface());
+	task_surface->target_surface = surface;
+	task_surface->target_rect = RectInt(VectorInt(), surface->get_size());
+	task_surface->source_rect = Rect(0.0, 0.0, 1.0, 1.0);
+
+	TaskTransformationAffine::Handle task_transformation(new TaskTransformationAffine());
+	task_transformation->interpolation = Color::INTERPOLATION_CUBIC;
+	task_transformation->transformation->matrix =
+		  Matrix().set_rotate(Angle::deg(angle))
+		* Matrix().set_translate(-1.5, -1.5)
+		* Matrix().set_scale(3.0);
+	task_transformation->sub_task() = task_surface;
+	return task_transformation;
+}
+
+static Task::Handle
+make_blend(const Task::Handle &a, const Task::Handle &b, Color::BlendMethod blend_method)
+{
+	TaskBlend::Handle task_blend(new TaskBlend());
+	task_blend->blend_method = blend_method;
+	task_blend->amount = 0.75;
+	task_blend->sub_task_a() = a;
+	task_blend->sub_task_b() = b;
+	return task_blend;
+}
+
+static Task::Handle
+make_blur(const Task::Handle &task, Blur::Type type, Real size)
+{
+	TaskBlur::Handle task_blur(new TaskBlur());
+	task_blur->blur = Blur(type, Vector(size, size));
+	task_blur->sub_task() = task;
+	return task_blur;
+}
+
+static Task::Handle
+make_contour(Contour::WindingStyle winding_style)
+{
+	Contour::Handle contour(new Contour());
+	contour->winding_style = winding_style;
+	contour->color = Color(0.25, 0.5, 0.75, 1.0);
+	contour->move_to(Vector(-1.7, -1.1));
+	for(int i = 0; i < 11; ++i) {
+		Real a0 = 2.0*PI*(i + 0.3)/11.0;
+		Real a1 = 2.0*PI*(i + 0.6)/11.0;
+		Real a2 = 2.0*PI*(i*5 % 11)/11.0;
+		contour->cubic_to(
+			Vector(1.8*cos(a2), 1.8*sin(a2)),
+			Vector(0.5*cos(a0), 0.7*sin(a0)),
+			Vector(1.9*cos(a1), 0.3*sin(a1)) );
+	}
+	contour->close();
+
+	TaskContour::Handle task_contour(new TaskContour());
+	task_contour->contour = contour;
+	return task_contour;
+}
+
+static bool
+render(const Renderer::Handle &renderer, const Task::Handle &task, synfig::Surface &out)
+{
+	Task::Handle t = task->clone_recursive();
+	t->target_surface = new SurfaceResource();
+	t->target_surface->create(width, height);
+	t->target_rect = RectInt(0, 0, width, height);
+	t->source_rect = Rect(-2.0, -2.0, 2.0, 2.0);
+	if (!renderer->run(t, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(t->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+static int
+compare(const String &name, const Task::Handle &task, ColorReal precision)
+{
+	static const int threads_list[] = { 2, 5, 16, 64 };
+
+	Renderer::Handle renderer_no_split(new RendererNoSplit());
+	synfig::Surface expected;
+	if (!render(renderer_no_split, task, expected)) {
+		cerr << name << ": render failed" << endl;
+		return 1;
+	}
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(threads_list)/sizeof(*threads_list)); ++i) {
+		Renderer::Handle renderer_split(new RendererSplit(threads_list[i]));
+		synfig::Surface actual;
+		if (!render(renderer_split, task, actual)) {
+			cerr << name << ": render with split failed" << endl;
+			++failures;
+			continue;
+		}
+
+		ColorReal max_diff = 0;
+		int wrong_x = 0, wrong_y = 0;
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x) {
+				const Color &a = expected[y][x];
+				const Color &b = actual[y][x];
+				ColorReal diff = std::max(
+					std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+					std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+				if (!(diff <= max_diff)) { max_diff = diff; wrong_x = x; wrong_y = y; }
+			}
+
+		if (!(max_diff <= precision)) {
+			cerr << name << ": split into " << threads_list[i] << " threads differs at ("
+			     << wrong_x << ", " << wrong_y << ") by " << max_diff << endl;
+			++failures;
+		}
+	}
+
+	return failures;
+}
+
+int split_blend_test()
+{
+	static const Color::BlendMethod methods[] = {
+		Color::BLEND_COMPOSITE,
+		Color::BLEND_STRAIGHT,
+		Color::BLEND_ONTO,
+		Color::BLEND_STRAIGHT_ONTO,
+		Color::BLEND_BEHIND,
+		Color::BLEND_SCREEN,
+		Color::BLEND_OVERLAY,
+		Color::BLEND_HARD_LIGHT,
+		Color::BLEND_MULTIPLY,
+		Color::BLEND_DIVIDE,
+		Color::BLEND_ADD,
+		Color::BLEND_SUBTRACT,
+		Color::BLEND_DIFFERENCE,
+		Color::BLEND_BRIGHTEN,
+		Color::BLEND_DARKEN,
+		Color::BLEND_COLOR,
+		Color::BLEND_HUE,
+		Color::BLEND_SATURATION,
+		Color::BLEND_LUMINANCE,
+		Color::BLEND_ALPHA_OVER,
+		Color::BLEND_ALPHA_BRIGHTEN,
+		Color::BLEND_ALPHA_DARKEN };
+
+	Task::Handle a = make_image(64, 10.0);
+	Task::Handle b = make_image(48, -35.0);
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(methods)/sizeof(*methods)); ++i)
+		failures += compare(
+			strprintf("blend %d", (int)methods[i]),
+			make_blend(a, b, methods[i]),
+			ColorReal(1e-5) );
+	return failures;
+}
+
+int split_blur_test()
+{
+	static const Blur::Type types[] = {
+		Blur::BOX,
+		Blur::FASTGAUSSIAN,
+		Blur::CROSS,
+		Blur::GAUSSIAN,
+		Blur::DISC };
+	static const Real sizes[] = { 0.01, 0.05, 0.3 };
+
+	Task::Handle task = make_blend(make_image(64, 10.0), make_image(48, -35.0), Color::BLEND_COMPOSITE);
+
+	// running sums and FFT accumulate rounding errors in different order,
+	// so allow small difference for blur
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(types)/sizeof(*types)); ++i)
+		for(int j = 0; j < (int)(sizeof(sizes)/sizeof(*sizes)); ++j)
+			failures += compare(
+				strprintf("blur %d size %f", (int)types[i], sizes[j]),
+				make_blur(task, types[i], sizes[j]),
+				ColorReal(1e-3) );
+	return failures;
+}
+
+int split_contour_test()
+{
+	Task::Handle image = make_image(64, 10.0);
+
+	int failures = 0;
+	failures += compare("contour non-zero", make_contour(Contour::WINDING_NON_ZERO), ColorReal(1e-5));
+	failures += compare("contour even-odd", make_contour(Contour::WINDING_EVEN_ODD), ColorReal(1e-5));
+	failures += compare(
+		"contour over image",
+		make_blend(image, make_contour(Contour::WINDING_NON_ZERO), Color::BLEND_COMPOSITE),
+		ColorReal(1e-5) );
+	failures += compare(
+		"contour onto image",
+		make_blend(image, make_contour(Contour::WINDING_EVEN_ODD), Color::BLEND_ONTO),
+		ColorReal(1e-5) );
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	// compare real rendering, not the cached surfaces
+	Renderer::get_cache()->set_memory_limit(0);
+
+	int failures = 0;
+
+	failures += split_blend_test();
+	failures += split_blur_test();
+	failures += split_contour_test();
+
+	return failures;
+}
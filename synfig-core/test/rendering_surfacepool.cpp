@@ -0,0 +1,135 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_surfacepool.cpp
+**	\brief Checks reusing of pixel buffers of software surfaces
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+
+#include <synfig/main.h>
+#include <synfig/rendering/software/surfacepool.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const size_t megabyte = 1024*1024;
+
+/* === P R O C E D U R E S ================================================= */
+
+int pool_test()
+{
+	int failures = 0;
+	SurfacePool pool(8*megabyte);
+
+	// sizes from the same bucket should share buffers
+	if (SurfacePool::calc_bucket_size(megabyte) != megabyte
+	 || SurfacePool::calc_bucket_size(megabyte + 1) != megabyte + megabyte/4
+	 || SurfacePool::calc_bucket_size(100) != 100 )
+		{ cerr << "wrong bucket size" << endl; ++failures; }
+
+	bool zeroed = false;
+	void *a = pool.alloc(megabyte + 100, zeroed);
+	if (!a || !zeroed)
+		{ cerr << "new buffer is not zeroed" << endl; ++failures; }
+	memset(a, 1, megabyte + 100);
+	pool.free(a, megabyte + 100);
+	if (pool.get_memory() != megabyte + megabyte/4)
+		{ cerr << "buffer was not kept" << endl; ++failures; }
+
+	void *b = pool.alloc(megabyte + 200, zeroed);
+	if (b != a || zeroed || pool.get_hits() != 1 || pool.get_misses() != 1)
+		{ cerr << "buffer was not reused" << endl; ++failures; }
+	pool.free(b, megabyte + 200);
+
+	// buffers over the limit are freed, biggest first
+	void *c = pool.alloc(4*megabyte, zeroed);
+	void *d = pool.alloc(4*megabyte, zeroed);
+	pool.free(c, 4*megabyte);
+	pool.free(d, 4*megabyte);
+	if (pool.get_memory() > pool.get_memory_limit())
+		{ cerr << "memory limit exceeded" << endl; ++failures; }
+
+	pool.set_memory_limit(0);
+	if (pool.get_memory())
+		{ cerr << "memory limit was not applied" << endl; ++failures; }
+
+	return failures;
+}
+
+int surface_test()
+{
+	int failures = 0;
+	SurfacePool &pool = SurfacePool::get_instance();
+	pool.clear();
+	pool.reset_counters();
+
+	static const int size = 512;
+	for(int i = 0; i < 3; ++i) {
+		SurfaceSW::Handle surface(new SurfaceSW());
+		surface->create(size, size);
+
+		// reused buffer should be cleared
+		const synfig::Surface &s = surface->get_surface();
+		for(int y = 0; y < size; y += 17)
+			for(int x = 0; x < size; x += 13)
+				if (s[y][x] != Color())
+					{ cerr << "surface is not cleared" << endl; ++failures; y = size; break; }
+
+		surface->get_surface().fill(Color(1.0, 0.5, 0.25, 1.0));
+	}
+
+	if (pool.get_hits() != 2 || pool.get_misses() != 1)
+		{ cerr << "surfaces do not reuse buffers" << endl; ++failures; }
+
+	pool.clear();
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += pool_test();
+	failures += surface_test();
+
+	return failures;
+}
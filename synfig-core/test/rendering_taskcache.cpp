@@ -0,0 +1,167 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_taskcache.cpp
+**	\brief Test reuse of rendering tasks of unchanged layers
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/main.h>
+#include <synfig/layers/layer_duplicate.h>
+#include <synfig/layers/layer_solidcolor.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/valuenodes/valuenode_const.h>
+#include <synfig/valuenodes/valuenode_duplicate.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int width = 64;
+static const int height = 64;
+
+/* === P R O C E D U R E S ================================================= */
+
+//! Duplicate layer over solid color which amount is driven by the index,
+//! so each copy has its own amount
+static Canvas::Handle
+make_canvas()
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(width, height);
+	canvas->rend_desc().set_tl(Point(-1.0, 1.0));
+	canvas->rend_desc().set_br(Point(1.0, -1.0));
+
+	ValueNode_Duplicate::Handle index = ValueNode_Duplicate::create(Real(0.75));
+	index->set_link("from", ValueNode_Const::create(Real(0.25)));
+	index->set_link("step", ValueNode_Const::create(Real(0.25)));
+
+	Layer::Handle duplicate = new Layer_Duplicate();
+	duplicate->connect_dynamic_param("index", ValueNode::LooseHandle(index));
+	canvas->push_back(duplicate);
+
+	Layer::Handle solid = new Layer_SolidColor();
+	solid->set_param("color", Color(0.8, 0.4, 0.2, 1.0));
+	solid->connect_dynamic_param("amount", ValueNode::LooseHandle(index));
+	canvas->push_back(solid);
+
+	return canvas;
+}
+
+static bool
+render(const Canvas::Handle &canvas, Time time, bool use_task_cache, synfig::Surface &out)
+{
+	ContextParams params;
+	params.use_task_cache = use_task_cache;
+	canvas->set_time(time);
+	Task::Handle task = canvas->build_rendering_task(params);
+	if (!task)
+		return false;
+
+	// cached tasks are shared between builds
+	task = task->clone_recursive();
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(width, height);
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+	if (!Renderer::get_renderer("software")->run(task, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			const Color &a = expected[y][x];
+			const Color &b = actual[y][x];
+			ColorReal diff = std::max(
+				std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+				std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+			if (!(diff <= max_diff)) max_diff = diff;
+		}
+	if (!(max_diff <= ColorReal(1e-5))) {
+		cerr << name << ": differs by " << max_diff << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int duplicate_test()
+{
+	int failures = 0;
+
+	synfig::Surface expected;
+	if (!render(make_canvas(), 0, false, expected))
+		{ cerr << "render without cache failed" << endl; return 1; }
+
+	// copies should differ in each build and in each frame,
+	// the second build reuses tasks of the first one
+	Canvas::Handle canvas = make_canvas();
+	for(int i = 0; i < 3; ++i) {
+		synfig::Surface actual;
+		if (!render(canvas, i, true, actual))
+			{ cerr << "render with cache failed" << endl; ++failures; continue; }
+		failures += compare(strprintf("build %d", i), expected, actual);
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += duplicate_test();
+
+	return failures;
+}
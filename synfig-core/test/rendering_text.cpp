@@ -0,0 +1,298 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_text.cpp
+**	\brief Test contour rendering task of Text layer against accelerated_render()
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/main.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include <modules/lyr_freetype/lyr_freetype.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! the module is not loaded, so the library is initialized here
+FT_Library ft_library;
+
+// 72 pixels per unit, so the default size of 0.25 gives exactly 32 pixels
+// per em in accelerated_render(), and glyphs are not scaled to the rounded size
+static const int width = 192;
+static const int height = 144;
+static const Point tl(-4.0/3.0, 1.0);
+static const Point br(4.0/3.0, -1.0);
+
+// two lines and a kerned pair
+static const char *text = "Synfig\nText AV";
+
+/* === P R O C E D U R E S ================================================= */
+
+//! font is taken from SYNFIG_TEST_FONT, or from usual places of DejaVu Sans
+static String
+find_font()
+{
+	static const char *paths[] = {
+		"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+		"/usr/share/fonts/TTF/DejaVuSans.ttf",
+		"/usr/share/fonts/dejavu/DejaVuSans.ttf",
+		"/usr/share/fonts/dejavu-sans-fonts/DejaVuSans.ttf",
+		"/usr/local/share/fonts/dejavu/DejaVuSans.ttf",
+		"/Library/Fonts/DejaVuSans.ttf"
+	};
+
+	if (const char *path = getenv("SYNFIG_TEST_FONT"))
+		return path;
+	for(int i = 0; i < (int)(sizeof(paths)/sizeof(paths[0])); ++i)
+		if (ifstream(paths[i]).good())
+			return paths[i];
+	return String();
+}
+
+static Canvas::Handle
+make_canvas(const String &font, bool grid_fit, const Point &origin, Real compress, Real vcompress, bool use_kerning)
+{
+	Layer::Handle layer = new Layer_Freetype();
+	layer->set_param("family", font);
+	layer->set_param("text", String(text));
+	layer->set_param("color", Color::black());
+	layer->set_param("origin", origin);
+	layer->set_param("compress", compress);
+	layer->set_param("vcompress", vcompress);
+	layer->set_param("use_kerning", use_kerning);
+	layer->set_param("grid_fit", grid_fit);
+
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(width, height);
+	canvas->rend_desc().set_tl(tl);
+	canvas->rend_desc().set_br(br);
+	canvas->push_back(layer);
+	return canvas;
+}
+
+static bool
+render_legacy(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	return canvas->get_context(ContextParams())
+	     .accelerated_render(&out, 3, canvas->rend_desc(), NULL);
+}
+
+//! the same way as Target_Scanline renders frames
+static bool
+render_task(const Canvas::Handle &canvas, synfig::Surface &out)
+{
+	Task::Handle task = canvas->build_rendering_task(ContextParams());
+	if (!task)
+		return false;
+
+	// canvas has y axis directed upwards
+	TaskTransformationAffine::Handle flip = new TaskTransformationAffine();
+	flip->transformation->matrix.m11 = -1.0;
+	flip->sub_task() = task;
+	task = flip;
+
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(width, height);
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(tl[0], br[1], br[0], tl[1]);
+	if (!Renderer::get_renderer("software")->run(task, true))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	if (!lock)
+		return false;
+	out = lock->get_surface();
+	return true;
+}
+
+//! pixels which are covered more than a half
+static RectInt
+bounding_rect(const synfig::Surface &surface)
+{
+	RectInt rect(width, height, 0, 0);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			if (surface[y][x].get_a() > ColorReal(0.5)) {
+				rect.minx = std::min(rect.minx, x);
+				rect.miny = std::min(rect.miny, y);
+				rect.maxx = std::max(rect.maxx, x + 1);
+				rect.maxy = std::max(rect.maxy, y + 1);
+			}
+	return rect;
+}
+
+static ColorReal
+total_alpha(const synfig::Surface &surface)
+{
+	ColorReal sum = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			sum += surface[y][x].get_a();
+	return sum;
+}
+
+//! how far alpha of pixel is outside of alpha range of 3x3 pixels around it in other surface
+static ColorReal
+max_neighbour_diff(const synfig::Surface &a, const synfig::Surface &b)
+{
+	ColorReal max_diff = 0;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			ColorReal min_alpha = 1, max_alpha = 0;
+			for(int yy = std::max(0, y - 1); yy <= std::min(height - 1, y + 1); ++yy)
+				for(int xx = std::max(0, x - 1); xx <= std::min(width - 1, x + 1); ++xx) {
+					min_alpha = std::min(min_alpha, b[yy][xx].get_a());
+					max_alpha = std::max(max_alpha, b[yy][xx].get_a());
+				}
+			ColorReal alpha = a[y][x].get_a();
+			max_diff = std::max(max_diff, std::max(min_alpha - alpha, alpha - max_alpha));
+		}
+	return max_diff;
+}
+
+//! accelerated_render() rounds positions of glyphs to whole pixels and
+//! contour is placed exactly, so glyphs may be shifted by a pixel;
+//! rasterizer of contours fills spans between edges without antialiasing,
+//! so pixels on horizontal edges may differ up to a half
+static int
+compare(const String &name, const synfig::Surface &expected, const synfig::Surface &actual)
+{
+	if (expected.get_w() != width || expected.get_h() != height
+	 || actual.get_w() != width || actual.get_h() != height)
+		{ cerr << name << ": wrong size of surface" << endl; return 1; }
+
+	RectInt expected_rect = bounding_rect(expected);
+	RectInt actual_rect = bounding_rect(actual);
+	if (!expected_rect.is_valid() || !actual_rect.is_valid())
+		{ cerr << name << ": nothing is rendered" << endl; return 1; }
+	if ( abs(expected_rect.minx - actual_rect.minx) > 1
+	  || abs(expected_rect.miny - actual_rect.miny) > 1
+	  || abs(expected_rect.maxx - actual_rect.maxx) > 1
+	  || abs(expected_rect.maxy - actual_rect.maxy) > 1 )
+	{
+		cerr << name << ": bounds "
+			 << actual_rect.minx << " " << actual_rect.miny << " "
+			 << actual_rect.maxx << " " << actual_rect.maxy << " instead of "
+			 << expected_rect.minx << " " << expected_rect.miny << " "
+			 << expected_rect.maxx << " " << expected_rect.maxy << endl;
+		return 1;
+	}
+
+	ColorReal expected_alpha = total_alpha(expected);
+	ColorReal actual_alpha = total_alpha(actual);
+	if (!(std::fabs(actual_alpha - expected_alpha) <= ColorReal(0.03)*expected_alpha))
+		{ cerr << name << ": coverage " << actual_alpha << " instead of " << expected_alpha << endl; return 1; }
+
+	ColorReal diff = std::max(
+		max_neighbour_diff(expected, actual),
+		max_neighbour_diff(actual, expected) );
+	if (!(diff <= ColorReal(0.5)))
+		{ cerr << name << ": differs by " << diff << " from neighbour pixels" << endl; return 1; }
+
+	return 0;
+}
+
+int text_test(const String &font)
+{
+	// origins are not aligned to pixels
+	static const Point origins[] = {
+		Point( 0.0,    0.0   ),
+		Point( 0.013, -0.027 ),
+		Point( 0.1,    0.07  ),
+		Point(-0.07,   0.05  )
+	};
+	static const struct { Real compress; Real vcompress; bool use_kerning; } spacings[] = {
+		{ 1.0, 1.0, true  },
+		{ 0.8, 1.3, true  },
+		{ 1.2, 0.9, false }
+	};
+
+	int failures = 0;
+	for(int grid_fit = 0; grid_fit < 2; ++grid_fit) {
+		// sharpened text is rendered by accelerated_render() in both ways
+		for(int i = 0; i < (int)(sizeof(origins)/sizeof(origins[0])); ++i) {
+			for(int j = 0; j < (int)(sizeof(spacings)/sizeof(spacings[0])); ++j) {
+				String name = strprintf( "origin (%.3f, %.3f), compress %.1f, vcompress %.1f%s%s",
+					(double)origins[i][0], (double)origins[i][1],
+					(double)spacings[j].compress, (double)spacings[j].vcompress,
+					spacings[j].use_kerning ? ", kerning" : "",
+					grid_fit ? ", grid fit" : "" );
+
+				Canvas::Handle canvas = make_canvas(
+					font, grid_fit, origins[i], spacings[j].compress, spacings[j].vcompress, spacings[j].use_kerning );
+
+				synfig::Surface expected, actual;
+				if (!render_legacy(canvas, expected))
+					{ cerr << name << ": legacy render failed" << endl; ++failures; continue; }
+				if (!render_task(canvas, actual))
+					{ cerr << name << ": task render failed" << endl; ++failures; continue; }
+				failures += compare(name, expected, actual);
+			}
+		}
+	}
+
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	// 77 tells the test harness that the test is skipped
+	String font = find_font();
+	if (font.empty())
+		{ cerr << "font is not found, set SYNFIG_TEST_FONT to a TrueType font" << endl; return 77; }
+	if (FT_Init_FreeType(&ft_library))
+		{ cerr << "FreeType initialization failed" << endl; return 1; }
+
+	int failures = 0;
+
+	failures += text_test(font);
+
+	return failures;
+}
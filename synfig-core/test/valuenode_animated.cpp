@@ -0,0 +1,198 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file valuenode_animated.cpp
+**	\brief Checks lookup and incremental rebuild of animated value nodes
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include <synfig/main.h>
+#include <synfig/valuenodes/valuenode_animated.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const int waypoints_count = 40;
+static const int samples_count = 997;
+static const Real time_step = 0.5;
+
+struct WaypointParams
+{
+	Time time;
+	Real value;
+	Interpolation before, after;
+	Real tension;
+	WaypointParams(): value(), before(), after(), tension() { }
+};
+
+/* === P R O C E D U R E S ================================================= */
+
+static vector<WaypointParams>
+make_params()
+{
+	static const Interpolation interpolations[] = {
+		INTERPOLATION_TCB,
+		INTERPOLATION_CLAMPED,
+		INTERPOLATION_LINEAR,
+		INTERPOLATION_TCB,
+		INTERPOLATION_HALT,
+		INTERPOLATION_CONSTANT };
+	static const int interpolations_count = sizeof(interpolations)/sizeof(interpolations[0]);
+
+	vector<WaypointParams> params(waypoints_count);
+	for(int i = 0; i < waypoints_count; ++i) {
+		params[i].time = Time(time_step*i);
+		params[i].value = std::sin(Real(i))*i;
+		params[i].before = interpolations[i % interpolations_count];
+		params[i].after = interpolations[(i*7/3) % interpolations_count];
+		params[i].tension = 0.1*(i % 5);
+	}
+	return params;
+}
+
+static void
+apply(ValueNode_Animated::WaypointList::iterator iter, const WaypointParams &params)
+{
+	iter->set_time(params.time);
+	iter->set_value(params.value);
+	iter->set_before(params.before);
+	iter->set_after(params.after);
+	iter->set_tension(params.tension);
+}
+
+//! every add() rebuilds all curves, because count of waypoints changes
+static ValueNode_Animated::Handle
+create_node(const vector<WaypointParams> &params)
+{
+	ValueNode_Animated::Handle node = ValueNode_Animated::create(type_real);
+	for(vector<WaypointParams>::const_iterator i = params.begin(); i != params.end(); ++i) {
+		ValueNode_Animated::WaypointList::iterator iter = node->new_waypoint(i->time, ValueBase(i->value));
+		apply(iter, *i);
+		node->changed();
+	}
+	return node;
+}
+
+static Time
+sample_time(int index)
+	{ return Time(time_step*(waypoints_count + 2)*index/samples_count - time_step); }
+
+static int
+compare(const String &name, const ValueNode_Animated &expected, const ValueNode_Animated &actual)
+{
+	// evaluate forward, backward and with big steps to check the lookup hint
+	vector<Real> values(samples_count);
+	for(int i = 0; i < samples_count; ++i)
+		values[i] = expected(sample_time(i)).get(Real());
+
+	for(int pass = 0; pass < 3; ++pass)
+		for(int j = 0; j < samples_count; ++j) {
+			int i = pass == 0 ? j
+			      : pass == 1 ? samples_count - 1 - j
+			      : (j*101) % samples_count;
+			Real value = actual(sample_time(i)).get(Real());
+			if (value != values[i]) {
+				cerr << name << ": wrong value at " << sample_time(i) << ": "
+					 << value << " instead of " << values[i] << endl;
+				return 1;
+			}
+		}
+	return 0;
+}
+
+int lookup_test()
+{
+	vector<WaypointParams> params = make_params();
+	ValueNode_Animated::Handle node = create_node(params);
+
+	int failures = 0;
+	for(int i = 0; i < waypoints_count; ++i) {
+		Real value = (*node)(params[i].time).get(Real());
+		if (std::fabs(value - params[i].value) > 1e-8) {
+			cerr << "lookup: wrong value at waypoint " << i << ": "
+				 << value << " instead of " << params[i].value << endl;
+			++failures;
+		}
+	}
+	failures += compare("lookup", *create_node(params), *node);
+	return failures;
+}
+
+int incremental_test()
+{
+	int failures = 0;
+	const int indices[] = { 0, 1, 2, 3, 7, 18, waypoints_count/2, waypoints_count - 3, waypoints_count - 2, waypoints_count - 1 };
+	for(int k = 0; k < (int)(sizeof(indices)/sizeof(indices[0])); ++k) {
+		int index = indices[k];
+		for(int mode = 0; mode < 3; ++mode) {
+			vector<WaypointParams> params = make_params();
+			ValueNode_Animated::Handle node = create_node(params);
+			ValueNode_Animated::WaypointList::iterator iter = node->find(params[index].time);
+
+			// change single waypoint and rebuild curves incrementally
+			WaypointParams &p = params[index];
+			if (mode == 0)
+				p.value += 3.0;
+			else
+			if (mode == 1)
+				{ p.before = p.before == INTERPOLATION_TCB ? INTERPOLATION_LINEAR : INTERPOLATION_TCB; p.after = INTERPOLATION_CLAMPED; }
+			else
+				p.time = Time(p.time + time_step*2.5); // move over the neighbours
+			apply(iter, p);
+			node->changed();
+
+			failures += compare(strprintf("waypoint %d, mode %d", index, mode), *create_node(params), *node);
+		}
+	}
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int /* argc */, char **argv)
+{
+	synfig::Main main(etl::dirname(argv[0]));
+
+	int failures = 0;
+
+	failures += lookup_test();
+	failures += incremental_test();
+
+	return failures;
+}
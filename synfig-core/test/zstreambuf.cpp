@@ -0,0 +1,233 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file zstreambuf.cpp
+**	\brief Test that data written through zstreambuf is decompressed unchanged
+**
+**	$Id$
+**
+**	\legal
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include <synfig/zstreambuf.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace std;
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+enum WriteMode {
+	WRITE_WHOLE,           //!< one call of sputn()
+	WRITE_BYTES,           //!< sputc() for each byte
+	WRITE_CHUNKS,          //!< sputn() with chunks of different sizes, smaller and bigger than buffer
+	WRITE_CHUNKS_SYNC,     //!< the same with pubsync() after each chunk
+	WRITE_STREAM_FLUSH,    //!< std::ostream with flush after some of chunks
+	WRITE_MODES_COUNT
+};
+
+static const char *write_mode_names[] = {
+	"whole", "bytes", "chunks", "chunks with sync", "stream with flush" };
+
+/* === P R O C E D U R E S ================================================= */
+
+static unsigned int
+next_random(unsigned int &seed)
+	{ return (seed = seed*1103515245u + 12345u) >> 16; }
+
+//! text which compresses well, interleaved with random bytes which do not
+static string
+make_payload(size_t size, unsigned int seed)
+{
+	string payload;
+	payload.reserve(size);
+	while(payload.size() < size) {
+		if (next_random(seed) % 2) {
+			payload += strprintf("<waypoint time=\"%us\"><real value=\"%u\"/></waypoint>\n", next_random(seed) % 100, next_random(seed));
+		} else {
+			for(unsigned int i = next_random(seed) % 512; i > 0; --i)
+				payload += (char)next_random(seed);
+		}
+	}
+	payload.resize(size);
+	return payload;
+}
+
+static void
+write_packed(const string &payload, stringbuf &out, WriteMode mode, int compression_level, size_t bufsize)
+{
+	// stream is finished when zstreambuf is destroyed
+	zstreambuf buf(&out, compression_level, bufsize);
+	const char *data = payload.data();
+	size_t size = payload.size();
+
+	unsigned int seed = 7;
+	switch(mode) {
+	case WRITE_WHOLE:
+		buf.sputn(data, size);
+		break;
+	case WRITE_BYTES:
+		for(size_t i = 0; i < size; ++i)
+			buf.sputc(data[i]);
+		break;
+	case WRITE_CHUNKS:
+	case WRITE_CHUNKS_SYNC:
+		for(size_t i = 0; i < size; ) {
+			size_t chunk = std::min(size - i, (size_t)(next_random(seed) % (3*bufsize)));
+			buf.sputn(data + i, chunk);
+			if (mode == WRITE_CHUNKS_SYNC)
+				buf.pubsync();
+			i += chunk;
+		}
+		break;
+	case WRITE_STREAM_FLUSH: {
+		ostream stream(&buf);
+		for(size_t i = 0; i < size; ) {
+			size_t chunk = std::min(size - i, (size_t)(next_random(seed) % (2*bufsize)));
+			stream.write(data + i, chunk);
+			if (next_random(seed) % 3 == 0)
+				stream << flush;
+			i += chunk;
+		}
+		stream << flush;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+//! reads through zstreambuf by small portions
+static string
+read_packed(const string &packed, size_t bufsize)
+{
+	stringbuf in(packed, ios_base::in);
+	zstreambuf buf(&in, zstreambuf::option_compression_level, bufsize);
+	istream stream(&buf);
+
+	string result;
+	char portion[1000];
+	while(stream.read(portion, sizeof(portion)) || stream.gcount() > 0)
+		result.append(portion, (size_t)stream.gcount());
+	return result;
+}
+
+static int
+compare(const String &name, const string &expected, const string &actual)
+{
+	if (expected.size() != actual.size()) {
+		cerr << name << ": size " << actual.size() << " instead of " << expected.size() << endl;
+		return 1;
+	}
+	if (memcmp(expected.data(), actual.data(), expected.size())) {
+		size_t i = 0;
+		while(expected[i] == actual[i]) ++i;
+		cerr << name << ": differs at byte " << i << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int round_trip_test()
+{
+	static const size_t sizes[] = { 1, 1000, 200000 };
+	static const size_t bufsizes[] = { 1024, zstreambuf::option_bufsize };
+	static const int levels[] = { zstreambuf::option_compression_level, zstreambuf::fast_option_compression_level };
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); ++i) {
+		string payload = make_payload(sizes[i], i + 1);
+		for(int j = 0; j < (int)(sizeof(bufsizes)/sizeof(bufsizes[0])); ++j) {
+			for(int k = 0; k < (int)(sizeof(levels)/sizeof(levels[0])); ++k) {
+				for(int mode = 0; mode < WRITE_MODES_COUNT; ++mode) {
+					String name = strprintf( "%s, %d bytes, buffer %d, level %d",
+						write_mode_names[mode], (int)sizes[i], (int)bufsizes[j], levels[k] );
+
+					stringbuf out(ios_base::out);
+					write_packed(payload, out, (WriteMode)mode, levels[k], bufsizes[j]);
+					string packed = out.str();
+
+					vector<char> unpacked;
+					if (!zstreambuf::unpack(unpacked, packed.data(), packed.size()))
+						{ cerr << name << ": cannot unpack" << endl; ++failures; continue; }
+					failures += compare(name + ", unpack", payload, string(unpacked.begin(), unpacked.end()));
+
+					// one byte more, to be sure that nothing is left
+					vector<char> buffer(payload.size() + 1);
+					size_t size = zstreambuf::unpack(&buffer.front(), buffer.size(), packed.data(), packed.size());
+					failures += compare(name + ", unpack to buffer", payload, string(&buffer.front(), size));
+
+					failures += compare(name + ", read", payload, read_packed(packed, bufsizes[j]));
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+//! static functions, which are used for packed surfaces
+int pack_test()
+{
+	static const size_t sizes[] = { 1, 1000, 200000 };
+
+	int failures = 0;
+	for(int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); ++i) {
+		string payload = make_payload(sizes[i], i + 1);
+		for(int fast = 0; fast < 2; ++fast) {
+			String name = strprintf("pack%s, %d bytes", fast ? " fast" : "", (int)sizes[i]);
+
+			vector<char> packed;
+			if (!zstreambuf::pack(packed, payload.data(), payload.size(), fast))
+				{ cerr << name << ": cannot pack" << endl; ++failures; continue; }
+			vector<char> unpacked;
+			if (!zstreambuf::unpack(unpacked, &packed.front(), packed.size()))
+				{ cerr << name << ": cannot unpack" << endl; ++failures; continue; }
+			failures += compare(name, payload, string(unpacked.begin(), unpacked.end()));
+		}
+	}
+	return failures;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+
+	failures += round_trip_test();
+	failures += pack_test();
+
+	return failures;
+}
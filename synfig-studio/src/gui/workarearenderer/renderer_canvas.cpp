@@ -430,6 +430,8 @@ Renderer_Canvas::enqueue_render_frame(
 	rend_desc.set_wh(w, h);
 	rend_desc.set_render_excluded_contexts(true);
 	ContextParams context_params(rend_desc.get_render_excluded_contexts());
+	// rebuild only changed layers, tasks are cloned for each tile below
+	context_params.use_task_cache = true;
 	TileList &frame_tiles = tiles[id];
 
 	// create transformation matrix to flip result if needed
@@ -502,10 +504,12 @@ Renderer_Canvas::enqueue_render_frame(
 
 		++enqueued_tasks;
 
-		// Renderer::enqueue contains the expensive 'optimization' stage, so call it async
+		// Renderer::enqueue contains the expensive 'optimization' stage, so call it async,
+		// workarea waits for it, so it goes before background tasks of the pool
 		ThreadPool::instance().enqueue( sigc::bind(
 			sigc::ptr_fun(&rendering::Renderer::enqueue_task_func),
-			renderer, tile_task, tile->event, false ));
+			renderer, tile_task, tile->event, false ),
+			ThreadPool::PRIORITY_INTERACTIVE );
 	}
 
 	return true;
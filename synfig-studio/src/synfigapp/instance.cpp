@@ -589,7 +589,7 @@ Instance::backup(bool save_even_if_unchanged)
 	// don't save images while backup
 	//if (success)
 	//	save_all_layers();
-	if (!save_canvas(get_canvas()->get_identifier(), get_canvas(), false))
+	if (!save_canvas(get_canvas()->get_identifier(), get_canvas(), false, true))
 		return false;
 	
 	return temporary_filesystem->save_temporary();